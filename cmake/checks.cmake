@@ -31,6 +31,17 @@
 include(CheckCXXSourceCompiles)
 include(CheckIncludeFileCXX)
 
+check_include_file_cxx(coroutine HAVE_COROUTINE_INCLUDE)
+if(HAVE_COROUTINE_INCLUDE)
+  check_cxx_source_compiles(
+    "#include <coroutine>
+    #include <cstdint>
+    #include <tuple> // std::ignore
+    std::int32_t main() { std::ignore = std::coroutine_handle<>::from_address( nullptr ); return 0; }"
+    HAVE_COROUTINE
+  )
+endif()
+
 check_include_file_cxx(format HAVE_FORMAT_INCLUDE)
 if(HAVE_FORMAT_INCLUDE)
   check_cxx_source_compiles(
@@ -54,6 +65,28 @@ if(HAVE_THREAD_INCLUDE)
   )
 endif()
 
+if(SQLITE_IO_URING)
+  check_include_file_cxx(linux/io_uring.h HAVE_IO_URING_INCLUDE)
+  if(HAVE_IO_URING_INCLUDE)
+    check_cxx_source_compiles(
+      "#include <cstdint>
+      #include <linux/io_uring.h>
+      #include <sys/syscall.h>
+      std::int32_t main() { return __NR_io_uring_setup + __NR_io_uring_enter + IORING_OP_READ + IORING_OP_WRITE; }"
+      HAVE_IO_URING
+    )
+  endif()
+endif()
+
+# The bundled sqlite is configured with the session extension
+if(SQLITE_SESSION)
+  if(NOT SQLite3_FOUND OR SQLITE3_SESSION)
+    set(HAVE_SQLITE_SESSION ON)
+  else()
+    message(STATUS "Session helpers disabled - sqlite has no session extension")
+  endif()
+endif()
+
 check_include_file_cxx(ranges HAVE_RANGES_INCLUDE)
 if(HAVE_RANGES_INCLUDE)
   check_cxx_source_compiles(
@@ -35,6 +35,11 @@ option(CMAKE_VERBOSE_MAKEFILE "Show the complete build commands" OFF)
 option(SQLITE_BUILD_EXAMPLES "Build examples for sqlite_functions" ON)
 option(SQLITE_BUILD_TESTS "Build tests for sqlite_functions" ON)
 
+# optional features
+option(SQLITE_IO_URING "Build the io_uring vfs on Linux" ON)
+option(SQLITE_SESSION "Build the session helpers, if sqlite has the session extension" ON)
+option(SQLITE_FUNCTION_STATS "Count calls and time of the sql functions" ON)
+
 # General
 set(CMAKE_TLS_VERIFY TRUE)
 set(CMAKE_EXPORT_COMPILE_COMMANDS ON)
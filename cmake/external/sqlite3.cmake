@@ -54,7 +54,7 @@ endif()
 if(WIN32)
   set(SQLITE_CONFIGURE_COMMAND echo)
 #  set(SQLITE_BUILD_COMMAND nmake /f ${SQLITE_SRC}/src/SQLite/Makefile.msc TOP=${SQLITE_SRC}/src/SQLite DEBUG=3)
-  set(SQLITE_BUILD_COMMAND nmake /f Makefile.msc DEBUG=3)
+  set(SQLITE_BUILD_COMMAND nmake /f Makefile.msc DEBUG=3 SESSION=1)
   set(SQLITE_BUILD_IN_SOURCE TRUE)
   set(SQLITE_INSTALL_COMMAND lib sqlite3.obj)
 else()
@@ -68,6 +68,7 @@ else()
         --enable-static=yes
         --enable-shared=no
         --enable-threadsafe
+        --enable-session
         ${SQLITE_DEBUG}
   )
   set(SQLITE_BUILD_COMMAND make -j${CPU_COUNT})
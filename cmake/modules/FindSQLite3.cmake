@@ -89,6 +89,11 @@ if(NOT SQLITE3_SERIALIZE)
   message(STATUS "Found sqlite, but the sqlite3_serialize is disabled")
 endif()
 
+check_library_exists("${SQLITE3_LIBRARY}" sqlite3session_create "" SQLITE3_SESSION)
+if(NOT SQLITE3_SESSION)
+  message(STATUS "Found sqlite, but the session extension is disabled")
+endif()
+
 check_library_exists("${SQLITE3_LIBRARY}" sqlite3_enable_load_extension "" SQLITE3_LOAD_EXTENSION)
 if(NOT SQLITE3_LOAD_EXTENSION)
   if(APPLE)
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+
+/* stl header */
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* sqlite_functions */
+#include <SqliteBulkLoader.h>
+#include <SqliteUtils.h>
+
+/*
+ * Loader benchmark
+ *
+ * Inserts the same rows once with one sqlite3_exec per literal INSERT statement
+ * and once with the bulk loader and prints the duration of both.
+ */
+
+namespace {
+
+  constexpr std::size_t rows = 100000;
+
+  constexpr std::string_view createTable = "CREATE TABLE cities (id INTEGER, city TEXT, latitude REAL, longitude REAL)";
+
+  std::int32_t printResultAndExit( std::int32_t _code,
+                                   const std::string &_message,
+                                   const std::string &_sql ) {
+
+    std::cout << "RESULT CODE: (" << _code << ")" << std::endl;
+    std::cout << "ERROR: '" << _message << "'" << std::endl;
+    std::cout << "SQL: '" << _sql << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+std::int32_t main() {
+
+  /* Open databases */
+  std::error_code error {};
+  const auto literal { vx::sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+  const auto bulk { vx::sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+  if ( !literal || !bulk || error ) {
+
+    std::cout << "ERROR: '" << error.message() << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for ( sqlite3 *handle : { literal.get(), bulk.get() } ) {
+
+    const std::int32_t resultCode = sqlite3_exec( handle, std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      return printResultAndExit( resultCode, sqlite3_errmsg( handle ), std::string( createTable ) );
+    }
+  }
+
+  /* Rows */
+  std::vector<std::int64_t> ids( rows );
+  std::vector<std::string> names( rows );
+  std::vector<std::string_view> cities( rows );
+  std::vector<double> latitudes( rows );
+  std::vector<double> longitudes( rows );
+  for ( std::size_t i = 0; i < rows; ++i ) {
+
+    ids[ i ] = static_cast<std::int64_t>( i );
+    names[ i ] = "City " + std::to_string( i );
+    cities[ i ] = names[ i ];
+    latitudes[ i ] = static_cast<double>( i % 180 ) - 90.0;
+    longitudes[ i ] = static_cast<double>( i % 360 ) - 180.0;
+  }
+
+  /* One sqlite3_exec per literal INSERT */
+  auto start = std::chrono::steady_clock::now();
+  for ( std::size_t i = 0; i < rows; ++i ) {
+
+    const std::string sql = "INSERT INTO cities VALUES(" + std::to_string( ids[ i ] ) + ", '" + names[ i ] + "', " + std::to_string( latitudes[ i ] ) + ", " + std::to_string( longitudes[ i ] ) + ")";
+    const std::int32_t resultCode = sqlite3_exec( literal.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      return printResultAndExit( resultCode, sqlite3_errmsg( literal.get() ), sql );
+    }
+  }
+  const auto literalDuration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+
+  /* Bulk loader with columnar batch */
+  start = std::chrono::steady_clock::now();
+  vx::sqlite_utils::BulkLoader loader( bulk.get(), "cities", 4 );
+  error = loader.insert( { vx::sqlite_utils::BulkColumnView<std::int64_t> { ids.data(), ids.size() },
+                           vx::sqlite_utils::BulkColumnView<std::string_view> { cities.data(), cities.size() },
+                           vx::sqlite_utils::BulkColumnView<double> { latitudes.data(), latitudes.size() },
+                           vx::sqlite_utils::BulkColumnView<double> { longitudes.data(), longitudes.size() } } );
+  if ( !error ) {
+
+    error = loader.finish();
+  }
+  if ( error ) {
+
+    std::cout << "ERROR: '" << error.message() << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+  const auto bulkDuration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+
+  std::cout << "ROWS: " << rows << std::endl;
+  std::cout << "LITERAL INSERT: " << literalDuration.count() << " ms" << std::endl;
+  std::cout << "BULK LOADER: " << bulkDuration.count() << " ms" << std::endl;
+  std::cout << std::endl;
+  return EXIT_SUCCESS;
+}
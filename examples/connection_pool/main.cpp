@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t, std::uint64_t
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+
+/* stl header */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* sqlite_functions */
+#include <SqliteBulkLoader.h>
+#include <SqliteConnectionPool.h>
+#include <SqliteUtils.h>
+
+/*
+ * Thread scaling benchmark
+ *
+ * Runs point queries against the readers of a connection pool
+ * with a growing number of threads and prints the read throughput.
+ */
+
+namespace {
+
+  constexpr std::string_view databaseFilename = "connection_pool.db";
+
+  constexpr std::int64_t rows = 100000;
+
+  constexpr std::chrono::milliseconds duration { 1000 };
+}
+
+std::int32_t main() {
+
+  const std::size_t cores = std::max( 1U, std::thread::hardware_concurrency() );
+  vx::sqlite_utils::ConnectionPool pool( std::string( databaseFilename ), cores );
+  std::error_code error = pool.open();
+  if ( error ) {
+
+    std::cout << "ERROR: '" << error.message() << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Fill the database */
+  {
+    const vx::sqlite_utils::Lease writer = pool.write();
+    const std::int32_t resultCode = sqlite3_exec( writer.get(), "CREATE TABLE IF NOT EXISTS cities (id INTEGER PRIMARY KEY, latitude REAL, longitude REAL); DELETE FROM cities", nullptr, nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      std::cout << "ERROR: '" << sqlite3_errmsg( writer.get() ) << "'" << std::endl;
+      std::cout << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::vector<vx::sqlite_utils::BulkValue> values {};
+    values.reserve( rows * 3 );
+    for ( std::int64_t i = 0; i < rows; ++i ) {
+
+      values.emplace_back( i );
+      values.emplace_back( static_cast<double>( i % 180 ) - 90.0 );
+      values.emplace_back( static_cast<double>( i % 360 ) - 180.0 );
+    }
+    vx::sqlite_utils::BulkLoader loader( writer.get(), "cities", 3 );
+    error = loader.insert( values );
+    if ( !error ) {
+
+      error = loader.finish();
+    }
+    if ( error ) {
+
+      std::cout << "ERROR: '" << error.message() << "'" << std::endl;
+      std::cout << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* Point queries with 1, 2, 4 ... threads */
+  for ( std::size_t threads = 1; threads <= cores; threads *= 2 ) {
+
+    std::atomic<bool> stop { false };
+    std::atomic<std::uint64_t> queries { 0 };
+    std::vector<std::thread> workers {};
+    for ( std::size_t i = 0; i < threads; ++i ) {
+
+      workers.emplace_back( [ &pool, &stop, &queries, i ]() {
+        std::uint64_t count = 0;
+        auto id = static_cast<std::int64_t>( i );
+        while ( !stop.load( std::memory_order_relaxed ) ) {
+
+          const vx::sqlite_utils::Lease reader = pool.read();
+          const auto statement = vx::sqlite_utils::sqlite3_stmt_make_unique( reader.get(), "SELECT latitude, longitude FROM cities WHERE id = ?" );
+          for ( std::int32_t j = 0; j < 100; ++j ) {
+
+            id = ( id * 7919 + 1 ) % rows;
+            sqlite3_bind_int64( statement.get(), 1, id );
+            sqlite3_step( statement.get() );
+            sqlite3_reset( statement.get() );
+            ++count;
+          }
+        }
+        queries += count;
+      } );
+    }
+    std::this_thread::sleep_for( duration );
+    stop = true;
+    for ( std::thread &worker : workers ) {
+
+      worker.join();
+    }
+
+    std::cout << "THREADS: " << threads << " QUERIES/S: " << queries * 1000 / static_cast<std::uint64_t>( duration.count() ) << std::endl;
+  }
+
+  const vx::sqlite_utils::PoolMetrics metrics = pool.metrics();
+  std::cout << "LEASES: " << metrics.leases << " WAITS: " << metrics.waits << " MAX WAIT: " << metrics.maxWaitTime.count() << " ns" << std::endl;
+  std::cout << std::endl;
+
+  std::filesystem::remove( std::string( databaseFilename ) + "-wal" );
+  std::filesystem::remove( std::string( databaseFilename ) + "-shm" );
+  std::filesystem::remove( databaseFilename );
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+
+/* stl header */
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* sqlite_functions */
+#include <SqliteProfiler.h>
+#include <SqliteUtils.h>
+
+/*
+ * Profiler overhead benchmark
+ *
+ * Runs the same point lookups and range scans with and without profiling
+ * and prints the overhead and the profile of the statements.
+ */
+
+namespace {
+
+  constexpr std::int64_t rows = 100000;
+
+  constexpr std::int64_t lookups = 200000;
+
+  constexpr std::int32_t rounds = 5;
+
+  std::int32_t printErrorAndExit( const std::string &_message ) {
+
+    std::cout << "ERROR: '" << _message << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /**
+   * @brief Run the workload on a new connection.
+   * @param _error   Error code.
+   * @return Time of the workload.
+   */
+  std::chrono::nanoseconds workload( std::error_code &_error ) {
+
+    const auto database { vx::sqlite_utils::sqlite3_make_unique( ":memory:", _error ) };
+    if ( _error ) {
+
+      return {};
+    }
+    const std::string create = "CREATE TABLE cities (id INTEGER PRIMARY KEY, latitude REAL, longitude REAL); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " + std::to_string( rows ) + ") INSERT INTO cities SELECT i, i % 180 - 90.0, i % 360 - 180.0 FROM n";
+    sqlite3_exec( database.get(), create.c_str(), nullptr, nullptr, nullptr );
+
+    const auto lookup = vx::sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT latitude, longitude FROM cities WHERE id = ?" );
+    const auto scan = vx::sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT count(*) FROM cities WHERE id BETWEEN ? AND ? + 100" );
+    const auto start = std::chrono::steady_clock::now();
+    for ( std::int64_t i = 0; i < lookups; ++i ) {
+
+      sqlite3_stmt *statement = i % 4 == 0 ? scan.get() : lookup.get();
+      sqlite3_bind_int64( statement, 1, i * 7919 % rows + 1 );
+      if ( statement == scan.get() ) {
+
+        sqlite3_bind_int64( statement, 2, i * 7919 % rows + 1 );
+      }
+      while ( sqlite3_step( statement ) == SQLITE_ROW ) {}
+      sqlite3_reset( statement );
+    }
+    return std::chrono::steady_clock::now() - start;
+  }
+}
+
+std::int32_t main() {
+
+  /* Best of several rounds, alternating */
+  std::chrono::nanoseconds plain = std::chrono::nanoseconds::max();
+  std::chrono::nanoseconds profiled = std::chrono::nanoseconds::max();
+  for ( std::int32_t round = 0; round < rounds; ++round ) {
+
+    std::error_code error {};
+    vx::sqlite_utils::enableProfiling( false );
+    plain = std::min( plain, workload( error ) );
+    vx::sqlite_utils::enableProfiling( true );
+    profiled = std::min( profiled, workload( error ) );
+    if ( error ) {
+
+      return printErrorAndExit( error.message() );
+    }
+  }
+  vx::sqlite_utils::enableProfiling( false );
+
+  const auto milliseconds = []( std::chrono::nanoseconds _time ) { return std::chrono::duration_cast<std::chrono::milliseconds>( _time ).count(); };
+  std::cout << "PLAIN: " << milliseconds( plain ) << " ms" << std::endl;
+  std::cout << "PROFILED: " << milliseconds( profiled ) << " ms" << std::endl;
+  std::cout << "OVERHEAD: " << 100.0 * static_cast<double>( ( profiled - plain ).count() ) / static_cast<double>( plain.count() ) << " %" << std::endl;
+  std::cout << std::endl;
+  std::cout << vx::sqlite_utils::profileText( vx::sqlite_utils::profileSnapshot() ) << std::endl;
+  return EXIT_SUCCESS;
+}
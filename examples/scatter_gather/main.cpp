@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+
+/* stl header */
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* sqlite_functions */
+#include <SqliteBulkLoader.h>
+#include <SqliteScatterGather.h>
+#include <SqliteUtils.h>
+
+/*
+ * Shard scaling benchmark
+ *
+ * Sorts the cities of all shards once with ATTACH and UNION ALL on one connection
+ * and once with a parallel scatter-gather query and a k-way merge.
+ */
+
+namespace {
+
+  constexpr std::int64_t rowsPerShard = 200000;
+
+  constexpr std::size_t limit = 1000;
+
+  std::int32_t printErrorAndExit( const std::string &_message ) {
+
+    std::cout << "ERROR: '" << _message << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+std::int32_t main() {
+
+  const std::size_t shardCount = std::max( 2U, std::thread::hardware_concurrency() );
+  std::vector<std::string> filenames {};
+  for ( std::size_t i = 0; i < shardCount; ++i ) {
+
+    filenames.emplace_back( "scatter_gather_" + std::to_string( i ) + ".db" );
+  }
+
+  /* Fill the shards */
+  for ( std::size_t i = 0; i < shardCount; ++i ) {
+
+    std::error_code error {};
+    const auto database { vx::sqlite_utils::sqlite3_make_unique( filenames[ i ], error ) };
+    if ( !database || error ) {
+
+      return printErrorAndExit( error.message() );
+    }
+    if ( sqlite3_exec( database.get(), "DROP TABLE IF EXISTS cities; CREATE TABLE cities (id INTEGER, latitude REAL, longitude REAL)", nullptr, nullptr, nullptr ) != SQLITE_OK ) {
+
+      return printErrorAndExit( sqlite3_errmsg( database.get() ) );
+    }
+    std::vector<vx::sqlite_utils::BulkValue> values {};
+    values.reserve( rowsPerShard * 3 );
+    for ( std::int64_t row = 0; row < rowsPerShard; ++row ) {
+
+      const std::int64_t id = row * static_cast<std::int64_t>( shardCount ) + static_cast<std::int64_t>( i );
+      values.emplace_back( id );
+      values.emplace_back( static_cast<double>( ( id * 7919 ) % 18000 ) / 100.0 - 90.0 );
+      values.emplace_back( static_cast<double>( id % 360 ) - 180.0 );
+    }
+    vx::sqlite_utils::BulkLoader loader( database.get(), "cities", 3 );
+    error = loader.insert( values );
+    if ( !error ) {
+
+      error = loader.finish();
+    }
+    if ( error ) {
+
+      return printErrorAndExit( error.message() );
+    }
+  }
+
+  /* One connection with attached shards */
+  {
+    std::error_code error {};
+    const auto database { vx::sqlite_utils::sqlite3_make_unique( filenames[ 0 ], error ) };
+    std::string sql = "SELECT id, latitude FROM main.cities";
+    for ( std::size_t i = 1; i < shardCount; ++i ) {
+
+      const std::string attach = "ATTACH DATABASE '" + filenames[ i ] + "' AS shard_" + std::to_string( i );
+      if ( sqlite3_exec( database.get(), attach.c_str(), nullptr, nullptr, nullptr ) != SQLITE_OK ) {
+
+        return printErrorAndExit( sqlite3_errmsg( database.get() ) );
+      }
+      sql += " UNION ALL SELECT id, latitude FROM shard_" + std::to_string( i ) + ".cities";
+    }
+    sql += " ORDER BY latitude LIMIT " + std::to_string( limit );
+
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t rows = 0;
+    const auto statement = vx::sqlite_utils::sqlite3_stmt_make_unique( database.get(), sql );
+    while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {
+
+      ++rows;
+    }
+    const auto time = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+    std::cout << "UNION ALL: " << shardCount << " SHARDS " << rows << " ROWS " << time.count() << " ms" << std::endl;
+  }
+
+  /* Parallel shards with k-way merge */
+  {
+    vx::sqlite_utils::ScatterGather shards( filenames );
+    std::error_code error = shards.open();
+    if ( error ) {
+
+      return printErrorAndExit( error.message() );
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<vx::sqlite_utils::ShardRow> rows {};
+    error = shards.query( "SELECT id, latitude FROM cities ORDER BY latitude", { { 1 } }, rows, limit );
+    if ( error ) {
+
+      return printErrorAndExit( error.message() );
+    }
+    const auto time = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+    std::cout << "SCATTER-GATHER: " << shardCount << " SHARDS " << rows.size() << " ROWS " << time.count() << " ms" << std::endl;
+  }
+  std::cout << std::endl;
+
+  for ( const std::string &filename : filenames ) {
+
+    std::filesystem::remove( filename );
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+
+/* stl header */
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* sqlite_functions */
+#include <SqliteQuery.h>
+#include <SqliteUtils.h>
+
+/*
+ * Typed query benchmark
+ *
+ * Runs the same point query with hand-written bind and column calls
+ * and with the typed query API on one prepared statement.
+ */
+
+namespace {
+
+  constexpr std::int64_t rows = 1000;
+
+  constexpr std::int64_t iterations = 1000000;
+
+  constexpr std::string_view pointQuery = "SELECT city, latitude, longitude FROM cities WHERE id = ?1";
+}
+
+std::int32_t main() {
+
+  /* Open database */
+  std::error_code error {};
+  const auto database { vx::sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+  if ( !database ) {
+
+    std::cout << "ERROR: '" << error.message() << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  error = vx::sqlite_utils::execute( database.get(), "CREATE TABLE cities (id INTEGER PRIMARY KEY, city TEXT, latitude REAL, longitude REAL)" );
+  for ( std::int64_t id = 0; id < rows && !error; ++id ) {
+
+    error = vx::sqlite_utils::execute( database.get(), "INSERT INTO cities VALUES(?, ?, ?, ?)", id, "City " + std::to_string( id ), static_cast<double>( id % 180 ) - 90.0, static_cast<double>( id % 360 ) - 180.0 );
+  }
+  const auto statement = vx::sqlite_utils::sqlite3_stmt_make_unique( database.get(), std::string( pointQuery ), error );
+  if ( error || !statement ) {
+
+    std::cout << "ERROR: '" << error.message() << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Hand-written C API */
+  double checksum = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  for ( std::int64_t i = 0; i < iterations; ++i ) {
+
+    sqlite3_bind_int64( statement.get(), 1, i % rows );
+    while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {
+
+      const auto *city = reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ); // NOSONAR sqlite text is utf-8
+      const auto size = static_cast<std::size_t>( sqlite3_column_bytes( statement.get(), 0 ) );
+      checksum += sqlite3_column_double( statement.get(), 1 ) + sqlite3_column_double( statement.get(), 2 ) + static_cast<double>( std::string_view( city, size ).size() );
+    }
+    sqlite3_reset( statement.get() );
+  }
+  const auto handWritten = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+
+  /* Typed query API */
+  double typedChecksum = 0.0;
+  start = std::chrono::steady_clock::now();
+  for ( std::int64_t i = 0; i < iterations; ++i ) {
+
+    for ( const auto &[ city, latitude, longitude ] : vx::sqlite_utils::query<std::string_view, double, double>( statement.get(), i % rows ) ) {
+
+      typedChecksum += latitude + longitude + static_cast<double>( city.size() );
+    }
+  }
+  const auto typed = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start );
+
+  std::cout << "QUERIES: " << iterations << std::endl;
+  std::cout << "HAND-WRITTEN: " << handWritten.count() << " ms" << std::endl;
+  std::cout << "TYPED QUERY: " << typed.count() << " ms" << std::endl;
+  std::cout << "SAME RESULT: " << std::boolalpha << ( checksum == typedChecksum ) << std::endl;
+  std::cout << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+#include <cstdlib> // EXIT_FAILURE, EXIT_SUCCESS
+
+/* stl header */
+#include <iostream>
+
+#ifdef HAVE_IO_URING
+/* stl header */
+  #include <chrono>
+  #include <filesystem>
+  #include <random>
+  #include <string>
+  #include <string_view>
+  #include <system_error>
+
+/* sqlite header */
+  #include <sqlite3.h>
+
+/* sqlite_functions */
+  #include <SqliteOpenOptions.h>
+  #include <SqliteUringVfs.h>
+  #include <SqliteUtils.h>
+#endif
+
+/*
+ * Vfs benchmark in the style of fio
+ *
+ * Reads one database with the default vfs, the io_uring vfs and the io_uring vfs with O_DIRECT.
+ * A sequential scan reports MB/s and random point lookups report lookups/s.
+ * The page cache is kept small, so nearly every page is read through the vfs.
+ * Runs on the local disk and on tmpfs, if /dev/shm exists.
+ */
+
+namespace {
+
+  std::int32_t printErrorAndExit( const std::string_view _message ) {
+
+    std::cout << "ERROR: '" << _message << "'" << std::endl;
+    std::cout << std::endl;
+    return EXIT_FAILURE;
+  }
+
+#ifdef HAVE_IO_URING
+  constexpr std::int64_t rows = 200000;
+
+  constexpr std::int64_t lookups = 100000;
+
+  /**
+   * @brief Create the benchmark database.
+   * @param _filename   Database filename.
+   * @return Result code and message of operation.
+   */
+  std::error_code createDatabase( const std::string &_filename ) {
+
+    std::filesystem::remove( _filename );
+    std::error_code error {};
+    const auto database { vx::sqlite_utils::sqlite3_make_unique( _filename, error ) };
+    if ( error ) {
+
+      return error;
+    }
+    const std::string sql = "CREATE TABLE numbers (id INTEGER PRIMARY KEY, payload BLOB); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " + std::to_string( rows ) + ") INSERT INTO numbers SELECT i, randomblob(200) FROM n";
+    if ( sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr ) != SQLITE_OK ) {
+
+      return { SQLITE_ERROR, std::generic_category() };
+    }
+    return {};
+  }
+
+  /**
+   * @brief Scan and look up through a vfs.
+   * @param _filename   Database filename.
+   * @param _vfs   Name of the vfs - empty is the default vfs.
+   * @return Result code and message of operation.
+   */
+  std::error_code benchmark( const std::string &_filename,
+                             std::string_view _vfs ) {
+
+    vx::sqlite_utils::OpenOptions options = vx::sqlite_utils::openOptions( vx::sqlite_utils::Profile::ReadReplica );
+    options.vfs = std::string( _vfs );
+    options.cacheSize = 16;
+    options.mmapSize = 0;
+    std::error_code error {};
+    const auto database { vx::sqlite_utils::sqlite3_make_unique( _filename, options, error ) };
+    if ( error ) {
+
+      return error;
+    }
+
+    const std::string name = _vfs.empty() ? "default" : std::string( _vfs );
+    {
+      const auto statement = vx::sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT sum(length(payload)) FROM numbers" );
+      const auto start = std::chrono::steady_clock::now();
+      sqlite3_step( statement.get() );
+      const auto time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start );
+      const double megabytes = static_cast<double>( std::filesystem::file_size( _filename ) ) / ( 1024.0 * 1024.0 );
+      std::cout << "  " << name << " SEQUENTIAL: " << static_cast<std::int64_t>( megabytes / time.count() ) << " MB/s" << std::endl;
+    }
+    {
+      const auto statement = vx::sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT length(payload) FROM numbers WHERE id = ?" );
+      std::mt19937_64 random( 42 );
+      std::uniform_int_distribution<std::int64_t> ids( 1, rows );
+      const auto start = std::chrono::steady_clock::now();
+      for ( std::int64_t i = 0; i < lookups; ++i ) {
+
+        sqlite3_bind_int64( statement.get(), 1, ids( random ) );
+        sqlite3_step( statement.get() );
+        sqlite3_reset( statement.get() );
+      }
+      const auto time = std::chrono::duration<double>( std::chrono::steady_clock::now() - start );
+      std::cout << "  " << name << " RANDOM: " << static_cast<std::int64_t>( static_cast<double>( lookups ) / time.count() ) << " lookups/s" << std::endl;
+    }
+    return {};
+  }
+#endif
+}
+
+std::int32_t main() {
+
+#ifdef HAVE_IO_URING
+  if ( const std::error_code error = vx::sqlite_utils::registerUringVfs(); error ) {
+
+    return printErrorAndExit( error.message() );
+  }
+
+  for ( const std::string directory : { ".", "/dev/shm" } ) {
+
+    if ( !std::filesystem::is_directory( directory ) ) {
+
+      continue;
+    }
+    const std::string filename = directory + "/uring_vfs.db";
+    if ( const std::error_code error = createDatabase( filename ); error ) {
+
+      return printErrorAndExit( error.message() );
+    }
+    std::cout << directory << std::endl;
+    for ( const std::string_view vfs : { std::string_view {}, vx::sqlite_utils::uringVfsName, vx::sqlite_utils::uringDirectVfsName } ) {
+
+      if ( const std::error_code error = benchmark( filename, vfs ); error ) {
+
+        return printErrorAndExit( error.message() );
+      }
+    }
+    std::filesystem::remove( filename );
+  }
+  std::cout << std::endl;
+  return EXIT_SUCCESS;
+#else
+  return printErrorAndExit( "Built without io_uring." );
+#endif
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_COROUTINE
+/* c header */
+  #include <cstdint> // std::int32_t, std::uint8_t
+
+/* stl header */
+  #include <algorithm>
+  #include <coroutine>
+  #include <mutex>
+  #include <string>
+  #include <system_error>
+  #include <type_traits>
+  #include <utility>
+  #include <variant>
+  #include <vector>
+
+/* sqlite header */
+  #include <sqlite3.h>
+
+/* local header */
+  #include "SqliteAsync.h"
+  #include "SqliteError.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Bind a query value - it lives in the awaitable until the query ran.
+     * @param _statement   Statement to bind.
+     * @param _index   Parameter index.
+     * @param _value   Value to bind.
+     * @return Result code of the bind.
+     */
+    std::int32_t bindValue( sqlite3_stmt *_statement,
+                            std::int32_t _index,
+                            const AsyncValue &_value ) noexcept {
+
+      return std::visit( [ _statement, _index ]( const auto &_content ) {
+        using T = std::decay_t<decltype( _content )>;
+        if constexpr ( std::is_same_v<T, std::int64_t> ) {
+
+          return sqlite3_bind_int64( _statement, _index, _content );
+        }
+        else if constexpr ( std::is_same_v<T, double> ) {
+
+          return sqlite3_bind_double( _statement, _index, _content );
+        }
+        else if constexpr ( std::is_same_v<T, std::string> ) {
+
+          return sqlite3_bind_text64( _statement, _index, _content.data(), _content.size(), SQLITE_STATIC, SQLITE_UTF8 );
+        }
+        else if constexpr ( std::is_same_v<T, std::vector<std::uint8_t>> ) {
+
+          return sqlite3_bind_blob64( _statement, _index, _content.data(), _content.size(), SQLITE_STATIC );
+        }
+        else {
+
+          return sqlite3_bind_null( _statement, _index );
+        }
+      },
+                         _value );
+    }
+
+    /**
+     * @brief Copy a column of the current row.
+     * @param _statement   Statement with a row.
+     * @param _column   Column index.
+     * @return Column value.
+     */
+    AsyncValue columnValue( sqlite3_stmt *_statement,
+                            std::int32_t _column ) {
+
+      switch ( sqlite3_column_type( _statement, _column ) ) {
+
+        case SQLITE_INTEGER:
+          return sqlite3_column_int64( _statement, _column );
+        case SQLITE_FLOAT:
+          return sqlite3_column_double( _statement, _column );
+        case SQLITE_TEXT: {
+          const auto *text = reinterpret_cast<const char *>( sqlite3_column_text( _statement, _column ) ); // NOSONAR sqlite text is utf-8
+          return std::string( text, static_cast<std::size_t>( sqlite3_column_bytes( _statement, _column ) ) );
+        }
+        case SQLITE_BLOB: {
+          const auto *blob = static_cast<const std::uint8_t *>( sqlite3_column_blob( _statement, _column ) );
+          return std::vector<std::uint8_t>( blob, blob + sqlite3_column_bytes( _statement, _column ) );
+        }
+        default:
+          return std::monostate {};
+      }
+    }
+
+    /**
+     * @brief Error of a cancelled query.
+     * @return Result code and message of operation.
+     */
+    std::error_code interrupted() {
+
+      return makeError( SQLITE_INTERRUPT, "Query was cancelled." );
+    }
+  }
+
+  CancelToken::CancelToken()
+    : m_state( std::make_shared<State>() ) {}
+
+  void CancelToken::cancel() noexcept {
+
+    /* Interrupt only while the query of this token runs */
+    const std::lock_guard lock( m_state->mutex );
+    m_state->cancelled = true;
+    if ( m_state->running ) {
+
+      sqlite3_interrupt( m_state->running );
+    }
+  }
+
+  bool CancelToken::cancelled() const noexcept {
+
+    const std::lock_guard lock( m_state->mutex );
+    return m_state->cancelled;
+  }
+
+  AsyncExecutor::Awaitable::Awaitable( AsyncExecutor *_executor,
+                                       std::string _sql,
+                                       std::vector<AsyncValue> _params,
+                                       CancelToken _token ) noexcept
+    : m_executor( _executor ),
+      m_sql( std::move( _sql ) ),
+      m_params( std::move( _params ) ),
+      m_token( std::move( _token ) ) {}
+
+  bool AsyncExecutor::Awaitable::await_suspend( std::coroutine_handle<> _handle ) {
+
+    m_handle = _handle;
+    {
+      const std::lock_guard lock( m_executor->m_mutex );
+      if ( !m_executor->m_workers.empty() && !m_executor->m_stop ) {
+
+        m_executor->m_queue.push_back( this );
+        m_executor->m_condition.notify_one();
+        return true;
+      }
+    }
+
+    m_result.error = makeError( SQLITE_MISUSE, "Executor is not open." );
+    return false;
+  }
+
+  AsyncExecutor::AsyncExecutor( const std::string &_filename,
+                                std::size_t _workers,
+                                OpenOptions _options,
+                                Resume _resume,
+                                std::size_t _batchSize ) noexcept
+    : m_filename( _filename ),
+      m_workerCount( std::max( std::size_t { 1 }, _workers ) ),
+      m_options( std::move( _options ) ),
+      m_resume( std::move( _resume ) ),
+      m_batchSize( std::max( std::size_t { 1 }, _batchSize ) ) {}
+
+  AsyncExecutor::~AsyncExecutor() {
+
+    {
+      const std::lock_guard lock( m_mutex );
+      m_stop = true;
+    }
+    m_condition.notify_all();
+    for ( const auto &worker : m_workers ) {
+
+      if ( worker->thread.joinable() ) {
+
+        worker->thread.join();
+      }
+    }
+  }
+
+  std::error_code AsyncExecutor::open() {
+
+    const std::lock_guard lock( m_mutex );
+    if ( !m_workers.empty() ) {
+
+      return makeError( SQLITE_MISUSE, "Executor is already open." );
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers {};
+    for ( std::size_t i = 0; i < m_workerCount; ++i ) {
+
+      std::error_code error {};
+      auto worker = std::make_unique<Worker>();
+      worker->handle = sqlite3_make_unique( m_filename, m_options, error );
+      if ( !worker->handle ) {
+
+        return error;
+      }
+      worker->statements = std::make_unique<StatementCache>( worker->handle.get() );
+      workers.emplace_back( std::move( worker ) );
+    }
+
+    m_workers = std::move( workers );
+    for ( const auto &worker : m_workers ) {
+
+      worker->thread = std::thread( [ this, &worker = *worker ] { run( worker ); } );
+    }
+    return {};
+  }
+
+  AsyncExecutor::Awaitable AsyncExecutor::query( std::string _sql,
+                                                 std::vector<AsyncValue> _params,
+                                                 CancelToken _token ) noexcept {
+
+    return { this, std::move( _sql ), std::move( _params ), std::move( _token ) };
+  }
+
+  void AsyncExecutor::run( Worker &_worker ) {
+
+    std::vector<Awaitable *> batch {};
+    batch.reserve( m_batchSize );
+    while ( true ) {
+
+      /* Take several queries per wake up */
+      {
+        std::unique_lock lock( m_mutex );
+        m_condition.wait( lock, [ this ] { return m_stop || !m_queue.empty(); } );
+        if ( m_queue.empty() ) {
+
+          break;
+        }
+        const std::size_t count = std::min( m_batchSize, m_queue.size() );
+        batch.assign( m_queue.begin(), m_queue.begin() + static_cast<std::ptrdiff_t>( count ) );
+        m_queue.erase( m_queue.begin(), m_queue.begin() + static_cast<std::ptrdiff_t>( count ) );
+        if ( !m_queue.empty() ) {
+
+          m_condition.notify_one();
+        }
+      }
+
+      for ( Awaitable *query : batch ) {
+
+        execute( _worker, *query );
+
+        /* The awaitable may be gone after the resume */
+        const std::coroutine_handle<> handle = query->m_handle;
+        if ( m_resume ) {
+
+          m_resume( handle );
+        }
+        else {
+
+          handle.resume();
+        }
+      }
+      batch.clear();
+    }
+  }
+
+  void AsyncExecutor::execute( Worker &_worker,
+                               Awaitable &_query ) {
+
+    CancelToken::State &state = *_query.m_token.m_state;
+    {
+      const std::lock_guard lock( state.mutex );
+      if ( state.cancelled ) {
+
+        _query.m_result.error = interrupted();
+        return;
+      }
+      state.running = _worker.handle.get();
+    }
+
+    sqlite3 *handle = _worker.handle.get();
+    AsyncResult &result = _query.m_result;
+    const CachedStatement statement = _worker.statements->prepare( _query.m_sql, result.error );
+    for ( std::size_t i = 0; statement && i < _query.m_params.size(); ++i ) {
+
+      if ( const std::int32_t resultCode = bindValue( statement.get(), static_cast<std::int32_t>( i + 1 ), _query.m_params[ i ] ); resultCode != SQLITE_OK ) {
+
+        result.error = makeError( resultCode, sqlite3_errmsg( handle ) );
+        break;
+      }
+    }
+
+    if ( statement && !result.error ) {
+
+      const std::int32_t columns = sqlite3_column_count( statement.get() );
+      std::int32_t resultCode = SQLITE_OK;
+      while ( ( resultCode = sqlite3_step( statement.get() ) ) == SQLITE_ROW ) {
+
+        AsyncRow &row = result.rows.emplace_back();
+        row.reserve( static_cast<std::size_t>( columns ) );
+        for ( std::int32_t column = 0; column < columns; ++column ) {
+
+          row.emplace_back( columnValue( statement.get(), column ) );
+        }
+      }
+      if ( resultCode != SQLITE_DONE ) {
+
+        result.error = makeError( resultCode, sqlite3_errmsg( handle ) );
+      }
+    }
+
+    const std::lock_guard lock( state.mutex );
+    state.running = nullptr;
+  }
+}
+#endif
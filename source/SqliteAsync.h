@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef HAVE_COROUTINE
+/* c header */
+  #include <cstddef> // std::size_t
+  #include <cstdint> // std::int64_t, std::uint8_t
+
+/* stl header */
+  #include <condition_variable>
+  #include <coroutine>
+  #include <deque>
+  #include <functional>
+  #include <memory>
+  #include <mutex>
+  #include <string>
+  #include <system_error>
+  #include <thread>
+  #include <variant>
+  #include <vector>
+
+/* sqlite_functions */
+  #include "SqliteOpenOptions.h"
+  #include "SqliteStatementCache.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Default number of queries a worker takes per wake up.
+   */
+  constexpr std::size_t asyncBatchSize = 16;
+
+  /**
+   * @brief Value of an async query - monostate is NULL, text is UTF-8.
+   */
+  using AsyncValue = std::variant<std::monostate, std::int64_t, double, std::string, std::vector<std::uint8_t>>;
+
+  /**
+   * @brief Row of an async query.
+   */
+  using AsyncRow = std::vector<AsyncValue>;
+
+  /**
+   * @brief The AsyncResult struct.
+   */
+  struct AsyncResult {
+
+    /**
+     * @brief Member for the rows.
+     */
+    std::vector<AsyncRow> rows {};
+
+    /**
+     * @brief Member for the result code and message of operation.
+     */
+    std::error_code error {};
+  };
+
+  /**
+   * @brief The CancelToken class.
+   * Cancels a queued query or interrupts it while it runs.
+   */
+  class CancelToken {
+
+  public:
+    /**
+     * @brief Default constructor for CancelToken.
+     */
+    CancelToken();
+
+    /**
+     * @brief Cancel the query - a running query is interrupted with sqlite3_interrupt.
+     */
+    void cancel() noexcept;
+
+    /**
+     * @brief Check for a cancelled query.
+     * @return True, if the query was cancelled - otherwise false.
+     */
+    [[nodiscard]] bool cancelled() const noexcept;
+
+  private:
+    friend class AsyncExecutor;
+
+    /**
+     * @brief The State struct.
+     */
+    struct State {
+
+      /**
+       * @brief Member for the lock of the running connection.
+       */
+      std::mutex mutex {};
+
+      /**
+       * @brief Member for the connection running the query.
+       */
+      sqlite3 *running = nullptr;
+
+      /**
+       * @brief Member for a cancelled query.
+       */
+      bool cancelled = false;
+    };
+
+    /**
+     * @brief Member for the shared state.
+     */
+    std::shared_ptr<State> m_state {};
+  };
+
+  /**
+   * @brief The AsyncExecutor class.
+   * Owns one connection per worker thread and runs co_await-able queries.
+   * Coroutines are resumed on the worker thread, unless a resume function hands them to an event loop.
+   */
+  class AsyncExecutor {
+
+  public:
+    /**
+     * @brief Resume of a coroutine after its query finished.
+     */
+    using Resume = std::function<void( std::coroutine_handle<> )>;
+
+    /**
+     * @brief The Awaitable class.
+     * Lives in the coroutine frame while the query is queued - no allocation per query.
+     */
+    class Awaitable {
+
+    public:
+      /**
+       * @brief Constructor for Awaitable.
+       * @param _executor   Executor to run the query.
+       * @param _sql   Sql command.
+       * @param _params   Values for parameters 1 to N.
+       * @param _token   Cancellation of the query.
+       */
+      Awaitable( AsyncExecutor *_executor,
+                 std::string _sql,
+                 std::vector<AsyncValue> _params,
+                 CancelToken _token ) noexcept;
+
+      /**
+       * @brief Delete copy constructor for Awaitable.
+       */
+      Awaitable( const Awaitable & ) = delete;
+
+      /**
+       * @brief Delete copy assign operator.
+       * @return Nothing.
+       */
+      Awaitable &operator=( const Awaitable & ) = delete;
+
+      /**
+       * @brief The query always suspends.
+       * @return False.
+       */
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      /**
+       * @brief Queue the query.
+       * @param _handle   Suspended coroutine.
+       * @return True, if the query is queued - otherwise false to resume immediately.
+       */
+      bool await_suspend( std::coroutine_handle<> _handle );
+
+      /**
+       * @brief Result of the query.
+       * @return Rows or error.
+       */
+      AsyncResult await_resume() noexcept { return std::move( m_result ); }
+
+    private:
+      friend class AsyncExecutor;
+
+      /**
+       * @brief Member for the executor.
+       */
+      AsyncExecutor *m_executor = nullptr;
+
+      /**
+       * @brief Member for the sql command.
+       */
+      std::string m_sql {};
+
+      /**
+       * @brief Member for the parameter values.
+       */
+      std::vector<AsyncValue> m_params {};
+
+      /**
+       * @brief Member for the cancellation.
+       */
+      CancelToken m_token {};
+
+      /**
+       * @brief Member for the suspended coroutine.
+       */
+      std::coroutine_handle<> m_handle {};
+
+      /**
+       * @brief Member for the result.
+       */
+      AsyncResult m_result {};
+    };
+
+    /**
+     * @brief Constructor for AsyncExecutor.
+     * @param _filename   Database filename.
+     * @param _workers   Number of worker threads with their own connection.
+     * @param _options   Open options of the connections.
+     * @param _resume   Resume of finished coroutines - empty resumes on the worker thread.
+     * @param _batchSize   Maximum number of queries per wake up.
+     */
+    AsyncExecutor( const std::string &_filename,
+                   std::size_t _workers,
+                   OpenOptions _options = {},
+                   Resume _resume = {},
+                   std::size_t _batchSize = asyncBatchSize ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for AsyncExecutor.
+     */
+    AsyncExecutor( const AsyncExecutor & ) = delete;
+
+    /**
+     * @brief Delete move constructor for AsyncExecutor.
+     */
+    AsyncExecutor( AsyncExecutor && ) = delete;
+
+    /**
+     * @brief Destructor for AsyncExecutor - runs the queued queries and stops the workers.
+     */
+    ~AsyncExecutor();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    AsyncExecutor &operator=( const AsyncExecutor & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    AsyncExecutor &operator=( AsyncExecutor && ) = delete;
+
+    /**
+     * @brief Open the connections and start the workers.
+     * @return Result code and message of operation.
+     */
+    std::error_code open();
+
+    /**
+     * @brief Query to co_await.
+     * @param _sql   Sql command.
+     * @param _params   Values for parameters 1 to N.
+     * @param _token   Cancellation of the query.
+     * @return Awaitable with the rows or the error.
+     */
+    Awaitable query( std::string _sql,
+                     std::vector<AsyncValue> _params = {},
+                     CancelToken _token = {} ) noexcept;
+
+  private:
+    /**
+     * @brief The Worker struct.
+     */
+    struct Worker {
+
+      /**
+       * @brief Member for the connection.
+       */
+      std::unique_ptr<sqlite3, sqlite3_deleter> handle {};
+
+      /**
+       * @brief Member for the statements of the connection.
+       */
+      std::unique_ptr<StatementCache> statements {};
+
+      /**
+       * @brief Member for the thread.
+       */
+      std::thread thread {};
+    };
+
+    /**
+     * @brief Worker thread loop.
+     * @param _worker   Worker of the thread.
+     */
+    void run( Worker &_worker );
+
+    /**
+     * @brief Run one query.
+     * @param _worker   Worker of the thread.
+     * @param _query   Queued query.
+     */
+    static void execute( Worker &_worker,
+                         Awaitable &_query );
+
+    /**
+     * @brief Member for the database filename.
+     */
+    std::string m_filename {};
+
+    /**
+     * @brief Member for the number of workers.
+     */
+    std::size_t m_workerCount = 0;
+
+    /**
+     * @brief Member for the open options.
+     */
+    OpenOptions m_options {};
+
+    /**
+     * @brief Member for the resume of finished coroutines.
+     */
+    Resume m_resume {};
+
+    /**
+     * @brief Member for the maximum number of queries per wake up.
+     */
+    std::size_t m_batchSize = 0;
+
+    /**
+     * @brief Member for the queued queries.
+     */
+    std::deque<Awaitable *> m_queue {};
+
+    /**
+     * @brief Member for the lock of the queue.
+     */
+    std::mutex m_mutex {};
+
+    /**
+     * @brief Member for waking the workers.
+     */
+    std::condition_variable m_condition {};
+
+    /**
+     * @brief Member for stopping the workers.
+     */
+    bool m_stop = false;
+
+    /**
+     * @brief Member for the workers.
+     */
+    std::vector<std::unique_ptr<Worker>> m_workers {};
+  };
+}
+#endif
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteBulkLoader.h"
+#include "SqliteError.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Bind one value with SQLITE_STATIC.
+     * @param _statement   Statement to bind.
+     * @param _index   Parameter index.
+     * @param _value   Value to bind.
+     * @return Result code of the bind.
+     */
+    template <typename T>
+    std::int32_t bindValue( sqlite3_stmt *_statement,
+                            std::int32_t _index,
+                            const T &_value ) noexcept {
+
+      if constexpr ( std::is_same_v<T, std::int64_t> ) {
+
+        return sqlite3_bind_int64( _statement, _index, _value );
+      }
+      else if constexpr ( std::is_same_v<T, double> ) {
+
+        return sqlite3_bind_double( _statement, _index, _value );
+      }
+      else if constexpr ( std::is_same_v<T, std::string_view> ) {
+
+        return sqlite3_bind_text64( _statement, _index, _value.data(), _value.size(), SQLITE_STATIC, SQLITE_UTF8 );
+      }
+      else {
+
+        return sqlite3_bind_null( _statement, _index );
+      }
+    }
+
+    /**
+     * @brief Error for a misused loader.
+     * @param _message   Error message.
+     * @return Result code and message of operation.
+     */
+    std::error_code misuse( const char *_message ) {
+
+      return makeError( SQLITE_MISUSE, _message );
+    }
+  }
+
+  BulkLoader::BulkLoader( sqlite3 *_handle,
+                          const std::string &_table,
+                          std::size_t _columns,
+                          std::size_t _rowsPerCommit,
+                          const std::string &_schema ) noexcept
+    : m_handle( _handle ),
+      m_columns( _columns ),
+      m_rowsPerCommit( std::max( std::size_t { 1 }, _rowsPerCommit ) ),
+      m_ownTransaction( sqlite3_get_autocommit( _handle ) != 0 ) {
+
+    const std::unique_ptr<char, sqlite3_str_deleter> insert( sqlite3_mprintf( "INSERT INTO \"%w\".\"%w\" VALUES", _schema.c_str(), _table.c_str() ) );
+    if ( insert ) {
+
+      m_insert = insert.get();
+    }
+
+    /* As many rows as the host parameters allow */
+    const auto variables = static_cast<std::size_t>( sqlite3_limit( _handle, SQLITE_LIMIT_VARIABLE_NUMBER, -1 ) );
+    m_rowsPerStatement = m_columns > 0 ? std::max( std::size_t { 1 }, variables / m_columns ) : 0;
+  }
+
+  BulkLoader::~BulkLoader() {
+
+    finish();
+  }
+
+  std::error_code BulkLoader::insert( const std::vector<BulkValue> &_values ) {
+
+    if ( m_columns == 0 || _values.size() % m_columns != 0 ) {
+
+      return misuse( "Values are not a multiple of the column count." );
+    }
+
+    return insertRows( _values.size() / m_columns, [ this, &_values ]( sqlite3_stmt *_statement, std::size_t _row, std::int32_t _offset ) {
+      std::int32_t resultCode = SQLITE_OK;
+      for ( std::size_t column = 0; column < m_columns && resultCode == SQLITE_OK; ++column ) {
+
+        const std::int32_t index = _offset + static_cast<std::int32_t>( column ) + 1;
+        resultCode = std::visit( [ _statement, index ]( const auto &_value ) { return bindValue( _statement, index, _value ); }, _values[ _row * m_columns + column ] );
+      }
+      return resultCode;
+    } );
+  }
+
+  std::error_code BulkLoader::insert( const std::vector<BulkColumn> &_columns ) {
+
+    if ( m_columns == 0 || _columns.size() != m_columns ) {
+
+      return misuse( "Columns do not match the column count." );
+    }
+    const std::size_t rowCount = std::visit( []( const auto &_column ) { return _column.size; }, _columns.front() );
+    if ( !std::all_of( _columns.cbegin(), _columns.cend(), [ rowCount ]( const BulkColumn &_column ) { return std::visit( []( const auto &_view ) { return _view.size; }, _column ) == rowCount; } ) ) {
+
+      return misuse( "Columns differ in size." );
+    }
+
+    return insertRows( rowCount, [ this, &_columns ]( sqlite3_stmt *_statement, std::size_t _row, std::int32_t _offset ) {
+      std::int32_t resultCode = SQLITE_OK;
+      for ( std::size_t column = 0; column < m_columns && resultCode == SQLITE_OK; ++column ) {
+
+        const std::int32_t index = _offset + static_cast<std::int32_t>( column ) + 1;
+        resultCode = std::visit( [ _statement, index, _row ]( const auto &_view ) { return bindValue( _statement, index, _view.data[ _row ] ); }, _columns[ column ] );
+      }
+      return resultCode;
+    } );
+  }
+
+  std::error_code BulkLoader::finish() {
+
+    if ( !m_transaction ) {
+
+      return {};
+    }
+    if ( const std::int32_t resultCode = sqlite3_exec( m_handle, "COMMIT", nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+      return rollback( makeError( resultCode, sqlite3_errmsg( m_handle ) ) );
+    }
+    m_transaction = false;
+    m_pending = 0;
+    return {};
+  }
+
+  sqlite3_stmt *BulkLoader::statement( std::size_t _rows,
+                                       std::error_code &_error ) {
+
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> &cached = _rows == m_rowsPerStatement ? m_full : m_tail;
+    if ( cached && ( &cached == &m_full || m_tailRows == _rows ) ) {
+
+      return cached.get();
+    }
+
+    /* INSERT INTO "schema"."table" VALUES(?,?),(?,?) */
+    std::string sql {};
+    sql.reserve( m_insert.size() + _rows * ( m_columns * 2 + 2 ) );
+    sql += m_insert;
+    for ( std::size_t row = 0; row < _rows; ++row ) {
+
+      sql += row == 0 ? "(" : ",(";
+      for ( std::size_t column = 0; column < m_columns; ++column ) {
+
+        sql += column == 0 ? "?" : ",?";
+      }
+      sql += ')';
+    }
+
+    cached = sqlite3_stmt_make_unique( m_handle, sql, _error );
+    if ( &cached == &m_tail ) {
+
+      m_tailRows = cached ? _rows : 0;
+    }
+    return cached.get();
+  }
+
+  template <typename Bind>
+  std::error_code BulkLoader::insertRows( std::size_t _rows,
+                                          const Bind &_bind ) {
+
+    for ( std::size_t row = 0; row < _rows; ) {
+
+      const std::size_t count = std::min( m_rowsPerStatement, _rows - row );
+      std::error_code error {};
+      sqlite3_stmt *insert = statement( count, error );
+      if ( !insert ) {
+
+        return rollback( error );
+      }
+
+      for ( std::size_t i = 0; i < count; ++i ) {
+
+        if ( const std::int32_t resultCode = _bind( insert, row + i, static_cast<std::int32_t>( i * m_columns ) ); resultCode != SQLITE_OK ) {
+
+          return rollback( makeError( resultCode, sqlite3_errmsg( m_handle ) ) );
+        }
+      }
+      if ( error = step( insert, count ); error ) {
+
+        return rollback( error );
+      }
+      row += count;
+    }
+    return {};
+  }
+
+  std::error_code BulkLoader::step( sqlite3_stmt *_statement,
+                                    std::size_t _rows ) {
+
+    if ( m_ownTransaction && !m_transaction ) {
+
+      if ( const std::int32_t resultCode = sqlite3_exec( m_handle, "BEGIN", nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+      }
+      m_transaction = true;
+    }
+
+    if ( const std::int32_t resultCode = sqlite3_step( _statement ); resultCode != SQLITE_DONE ) {
+
+      const std::error_code error = makeError( resultCode, sqlite3_errmsg( m_handle ) );
+      sqlite3_reset( _statement );
+      return error;
+    }
+    sqlite3_reset( _statement );
+
+    m_rows += _rows;
+    m_pending += _rows;
+    if ( m_transaction && m_pending >= m_rowsPerCommit ) {
+
+      return finish();
+    }
+    return {};
+  }
+
+  std::error_code BulkLoader::rollback( const std::error_code &_error ) noexcept {
+
+    if ( !m_transaction ) {
+
+      return _error;
+    }
+    m_transaction = false;
+    m_rows -= m_pending;
+    m_pending = 0;
+
+    /* Errors like SQLITE_FULL already rolled back the transaction */
+    if ( sqlite3_get_autocommit( m_handle ) == 0 ) {
+
+      sqlite3_exec( m_handle, "ROLLBACK", nullptr, nullptr, nullptr );
+    }
+    return _error;
+  }
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int64_t
+
+/* stl header */
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <variant>
+#include <vector>
+
+/* sqlite_functions */
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Default number of rows per transaction of the bulk loader.
+   */
+  constexpr std::size_t bulkRowsPerCommit = 100000;
+
+  /**
+   * @brief Value of a row-major batch - monostate is NULL, text is UTF-8.
+   */
+  using BulkValue = std::variant<std::monostate, std::int64_t, double, std::string_view>;
+
+  /**
+   * @brief The BulkColumnView struct.
+   * Non-owning view of one column of a columnar batch.
+   */
+  template <typename T>
+  struct BulkColumnView {
+
+    /**
+     * @brief Member for the first value.
+     */
+    const T *data = nullptr;
+
+    /**
+     * @brief Member for the number of values.
+     */
+    std::size_t size = 0;
+  };
+
+  /**
+   * @brief Column of a columnar batch - text is UTF-8.
+   */
+  using BulkColumn = std::variant<BulkColumnView<std::int64_t>, BulkColumnView<double>, BulkColumnView<std::string_view>>;
+
+  /**
+   * @brief The BulkLoader class.
+   * Inserts batches through a cached multi-row INSERT sized to SQLITE_LIMIT_VARIABLE_NUMBER.
+   * Values are bound with SQLITE_STATIC, so they must stay valid until insert returns.
+   * Transactions are committed every rowsPerCommit rows, unless the caller already runs a transaction.
+   * A failed insert or commit rolls back the rows since the last commit of the loader - rows() only counts the kept rows.
+   * Inside a transaction of the caller only the failed statement is undone and the caller decides about the rest.
+   */
+  class BulkLoader {
+
+  public:
+    /**
+     * @brief Constructor for BulkLoader.
+     * @param _handle   Database handle.
+     * @param _table   Table name.
+     * @param _columns   Number of inserted columns.
+     * @param _rowsPerCommit   Number of rows per transaction.
+     * @param _schema   Table schema - default is main.
+     */
+    BulkLoader( sqlite3 *_handle,
+                const std::string &_table,
+                std::size_t _columns,
+                std::size_t _rowsPerCommit = bulkRowsPerCommit,
+                const std::string &_schema = "main" ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for BulkLoader.
+     */
+    BulkLoader( const BulkLoader & ) = delete;
+
+    /**
+     * @brief Delete move constructor for BulkLoader.
+     */
+    BulkLoader( BulkLoader && ) = delete;
+
+    /**
+     * @brief Destructor for BulkLoader - commits the pending rows.
+     */
+    ~BulkLoader();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    BulkLoader &operator=( const BulkLoader & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    BulkLoader &operator=( BulkLoader && ) = delete;
+
+    /**
+     * @brief Insert a row-major batch.
+     * @param _values   Values of all rows one after another - a multiple of the column count.
+     * @return Result code and message of operation.
+     */
+    std::error_code insert( const std::vector<BulkValue> &_values );
+
+    /**
+     * @brief Insert a columnar batch.
+     * @param _columns   One view per column - all of the same size.
+     * @return Result code and message of operation.
+     */
+    std::error_code insert( const std::vector<BulkColumn> &_columns );
+
+    /**
+     * @brief Commit the pending rows - rolled back if the commit fails.
+     * @return Result code and message of operation.
+     */
+    std::error_code finish();
+
+    /**
+     * @brief Number of inserted rows.
+     * @return Inserted rows.
+     */
+    [[nodiscard]] std::size_t rows() const noexcept { return m_rows; }
+
+  private:
+    /**
+     * @brief Prepared INSERT statement for a number of rows.
+     * @param _rows   Rows of the statement.
+     * @param _error   Error code.
+     * @return Cached statement or nullptr on error.
+     */
+    sqlite3_stmt *statement( std::size_t _rows,
+                             std::error_code &_error );
+
+    /**
+     * @brief Insert rows with a bind function.
+     * @param _rows   Number of rows.
+     * @param _bind   Binds one row to the statement at a parameter offset.
+     * @return Result code and message of operation.
+     */
+    template <typename Bind>
+    std::error_code insertRows( std::size_t _rows,
+                                const Bind &_bind );
+
+    /**
+     * @brief Step an INSERT statement and commit every rowsPerCommit rows.
+     * @param _statement   Bound statement.
+     * @param _rows   Rows of the statement.
+     * @return Result code and message of operation.
+     */
+    std::error_code step( sqlite3_stmt *_statement,
+                          std::size_t _rows );
+
+    /**
+     * @brief Roll back the rows since the last commit of the loader.
+     * @param _error   Error of the failed insert or commit.
+     * @return The passed error.
+     */
+    std::error_code rollback( const std::error_code &_error ) noexcept;
+
+    /**
+     * @brief Member for the database handle.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the INSERT prefix with quoted schema and table.
+     */
+    std::string m_insert {};
+
+    /**
+     * @brief Member for the number of columns.
+     */
+    std::size_t m_columns = 0;
+
+    /**
+     * @brief Member for the number of rows per transaction.
+     */
+    std::size_t m_rowsPerCommit = 0;
+
+    /**
+     * @brief Member for the number of rows of the full statement.
+     */
+    std::size_t m_rowsPerStatement = 0;
+
+    /**
+     * @brief Member for the rows since the last commit.
+     */
+    std::size_t m_pending = 0;
+
+    /**
+     * @brief Member for the number of inserted rows.
+     */
+    std::size_t m_rows = 0;
+
+    /**
+     * @brief Member for transactions managed by the loader.
+     */
+    bool m_ownTransaction = false;
+
+    /**
+     * @brief Member for a running transaction of the loader.
+     */
+    bool m_transaction = false;
+
+    /**
+     * @brief Member for the full statement.
+     */
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> m_full {};
+
+    /**
+     * @brief Member for the last tail statement.
+     */
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> m_tail {};
+
+    /**
+     * @brief Member for the rows of the last tail statement.
+     */
+    std::size_t m_tailRows = 0;
+  };
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring> // std::memcpy
+
+/* stl header */
+#include <array>
+
+/* intrinsics */
+#if defined __x86_64__ || defined _M_X64
+  #include <nmmintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #endif
+#elif defined __aarch64__ && defined __ARM_FEATURE_CRC32
+  #include <arm_acle.h>
+#endif
+
+/* local header */
+#include "SqliteChecksum.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Reflected CRC32C polynomial.
+     */
+    constexpr std::uint32_t polynomial = 0x82F63B78;
+
+    /**
+     * @brief Number of slicing tables - bytes processed per step.
+     */
+    constexpr std::size_t slices = 8;
+
+    /**
+     * @brief Entries per table.
+     */
+    constexpr std::size_t tableSize = 256;
+
+    /**
+     * @brief Bits of a byte.
+     */
+    constexpr std::uint32_t bitsPerByte = 8;
+
+    /**
+     * @brief Mask of the lowest byte.
+     */
+    constexpr std::uint32_t byteMask = 0xFF;
+
+    /**
+     * @brief Create the slicing by 8 lookup tables.
+     * @return Lookup tables.
+     */
+    constexpr std::array<std::array<std::uint32_t, tableSize>, slices> createTables() {
+
+      std::array<std::array<std::uint32_t, tableSize>, slices> tables {};
+      for ( std::uint32_t i = 0; i < tableSize; ++i ) {
+
+        std::uint32_t crc = i;
+        for ( std::uint32_t bit = 0; bit < bitsPerByte; ++bit ) {
+
+          crc = ( crc & 1 ) != 0 ? ( crc >> 1 ) ^ polynomial : crc >> 1;
+        }
+        tables[ 0 ][ i ] = crc;
+      }
+      for ( std::size_t slice = 1; slice < slices; ++slice ) {
+
+        for ( std::size_t i = 0; i < tableSize; ++i ) {
+
+          const std::uint32_t previous = tables[ slice - 1 ][ i ];
+          tables[ slice ][ i ] = ( previous >> bitsPerByte ) ^ tables[ 0 ][ previous & byteMask ];
+        }
+      }
+      return tables;
+    }
+
+    /**
+     * @brief Slicing by 8 lookup tables.
+     */
+    constexpr std::array<std::array<std::uint32_t, tableSize>, slices> tables = createTables();
+
+    /**
+     * @brief Table based CRC32C on the inverted checksum.
+     * @param _data   Data to checksum.
+     * @param _size   Size of data.
+     * @param _crc   Inverted checksum.
+     * @return Inverted checksum.
+     */
+    std::uint32_t crc32cTable( const std::uint8_t *_data,
+                               std::size_t _size,
+                               std::uint32_t _crc ) noexcept {
+
+      while ( _size >= slices ) {
+
+        std::uint32_t low = 0;
+        std::uint32_t high = 0;
+        std::memcpy( &low, _data, sizeof( low ) );
+        std::memcpy( &high, _data + sizeof( low ), sizeof( high ) );
+        low ^= _crc;
+        _crc = tables[ 7 ][ low & byteMask ] ^ tables[ 6 ][ ( low >> 8 ) & byteMask ] ^ tables[ 5 ][ ( low >> 16 ) & byteMask ] ^ tables[ 4 ][ low >> 24 ] ^ tables[ 3 ][ high & byteMask ] ^ tables[ 2 ][ ( high >> 8 ) & byteMask ] ^ tables[ 1 ][ ( high >> 16 ) & byteMask ] ^ tables[ 0 ][ high >> 24 ];
+        _data += slices;
+        _size -= slices;
+      }
+      while ( _size-- > 0 ) {
+
+        _crc = ( _crc >> bitsPerByte ) ^ tables[ 0 ][ ( _crc ^ *_data++ ) & byteMask ];
+      }
+      return _crc;
+    }
+
+#if defined __x86_64__ || defined _M_X64
+    /**
+     * @brief SSE4.2 based CRC32C on the inverted checksum.
+     * @param _data   Data to checksum.
+     * @param _size   Size of data.
+     * @param _crc   Inverted checksum.
+     * @return Inverted checksum.
+     */
+  #ifndef _MSC_VER
+    __attribute__( ( target( "sse4.2" ) ) )
+  #endif
+    std::uint32_t crc32cHardware( const std::uint8_t *_data,
+                                  std::size_t _size,
+                                  std::uint32_t _crc ) noexcept {
+
+      std::uint64_t crc = _crc;
+      while ( _size >= sizeof( std::uint64_t ) ) {
+
+        std::uint64_t value = 0;
+        std::memcpy( &value, _data, sizeof( value ) );
+        crc = _mm_crc32_u64( crc, value );
+        _data += sizeof( value );
+        _size -= sizeof( value );
+      }
+      auto result = static_cast<std::uint32_t>( crc );
+      while ( _size-- > 0 ) {
+
+        result = _mm_crc32_u8( result, *_data++ );
+      }
+      return result;
+    }
+
+    /**
+     * @brief Check the cpu for SSE4.2.
+     * @return True, if the crc instructions are available - otherwise false.
+     */
+    bool hasHardware() noexcept {
+
+  #ifdef _MSC_VER
+      constexpr std::int32_t sse42 = 1 << 20;
+      std::array<std::int32_t, 4> info {};
+      __cpuid( info.data(), 1 );
+      return ( info[ 2 ] & sse42 ) != 0;
+  #else
+      return __builtin_cpu_supports( "sse4.2" ) != 0;
+  #endif
+    }
+#elif defined __aarch64__ && defined __ARM_FEATURE_CRC32
+    /**
+     * @brief ARMv8 based CRC32C on the inverted checksum.
+     * @param _data   Data to checksum.
+     * @param _size   Size of data.
+     * @param _crc   Inverted checksum.
+     * @return Inverted checksum.
+     */
+    std::uint32_t crc32cHardware( const std::uint8_t *_data,
+                                  std::size_t _size,
+                                  std::uint32_t _crc ) noexcept {
+
+      while ( _size >= sizeof( std::uint64_t ) ) {
+
+        std::uint64_t value = 0;
+        std::memcpy( &value, _data, sizeof( value ) );
+        _crc = __crc32cd( _crc, value );
+        _data += sizeof( value );
+        _size -= sizeof( value );
+      }
+      while ( _size-- > 0 ) {
+
+        _crc = __crc32cb( _crc, *_data++ );
+      }
+      return _crc;
+    }
+
+    /**
+     * @brief Check the cpu for crc instructions - part of the target architecture.
+     * @return Always true.
+     */
+    constexpr bool hasHardware() noexcept { return true; }
+#endif
+  }
+
+  std::uint32_t crc32c( const std::uint8_t *_data,
+                        std::size_t _size,
+                        std::uint32_t _crc ) noexcept {
+
+#if defined __x86_64__ || defined _M_X64 || defined __aarch64__ && defined __ARM_FEATURE_CRC32
+    static const bool hardware = hasHardware();
+    if ( hardware ) {
+
+      return ~crc32cHardware( _data, _size, ~_crc );
+    }
+#endif
+    return ~crc32cTable( _data, _size, ~_crc );
+  }
+}
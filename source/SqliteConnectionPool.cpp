@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::uint32_t, std::uint64_t
+
+/* stl header */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteConnectionPool.h"
+#include "SqliteError.h"
+#include "SqliteOpenOptions.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Bits of the slot in the free stack head.
+     */
+    constexpr std::uint32_t slotBits = 32;
+
+    /**
+     * @brief Slot of a free stack head.
+     * @param _head   Free stack head.
+     * @return Slot.
+     */
+    constexpr std::uint32_t slotOf( std::uint64_t _head ) noexcept { return static_cast<std::uint32_t>( _head ); }
+
+    /**
+     * @brief Next free stack head with a new ABA tag.
+     * @param _head   Current free stack head.
+     * @param _slot   New top slot.
+     * @return New free stack head.
+     */
+    constexpr std::uint64_t nextHead( std::uint64_t _head,
+                                      std::uint32_t _slot ) noexcept { return ( ( ( _head >> slotBits ) + 1 ) << slotBits ) | _slot; }
+  }
+
+  Lease::Lease( ConnectionPool *_pool,
+                sqlite3 *_handle,
+                std::uint32_t _slot ) noexcept
+    : m_pool( _pool ),
+      m_handle( _handle ),
+      m_slot( _slot ) {}
+
+  Lease::Lease( Lease &&_lease ) noexcept
+    : m_pool( std::exchange( _lease.m_pool, nullptr ) ),
+      m_handle( std::exchange( _lease.m_handle, nullptr ) ),
+      m_slot( _lease.m_slot ) {}
+
+  Lease::~Lease() {
+
+    release();
+  }
+
+  Lease &Lease::operator=( Lease &&_lease ) noexcept {
+
+    if ( this != &_lease ) {
+
+      release();
+      m_pool = std::exchange( _lease.m_pool, nullptr );
+      m_handle = std::exchange( _lease.m_handle, nullptr );
+      m_slot = _lease.m_slot;
+    }
+    return *this;
+  }
+
+  void Lease::release() noexcept {
+
+    if ( m_pool && m_handle ) {
+
+      m_pool->release( m_slot );
+    }
+    m_pool = nullptr;
+    m_handle = nullptr;
+  }
+
+  ConnectionPool::ConnectionPool( const std::string &_filename,
+                                  std::size_t _readers,
+                                  Setup _setup ) noexcept
+    : m_filename( _filename ),
+      m_readerCount( std::min<std::size_t>( _readers, writerSlot - 1 ) ),
+      m_setup( std::move( _setup ) ) {}
+
+  std::error_code ConnectionPool::open() {
+
+    if ( m_writer ) {
+
+      return makeError( SQLITE_MISUSE, "Connection pool is already open." );
+    }
+
+    /* The writer creates the database and switches it to WAL */
+    std::error_code error {};
+    auto writer = sqlite3_make_unique( m_filename, openOptions( Profile::Oltp ), error );
+    if ( !writer ) {
+
+      return error;
+    }
+    if ( m_setup ) {
+
+      if ( error = m_setup( writer.get() ); error ) {
+
+        return error;
+      }
+    }
+
+    std::vector<std::unique_ptr<sqlite3, sqlite3_deleter>> readers {};
+    readers.reserve( m_readerCount );
+    for ( std::size_t i = 0; i < m_readerCount; ++i ) {
+
+      auto reader = sqlite3_make_unique( m_filename, openOptions( Profile::ReadReplica ), error );
+      if ( !reader ) {
+
+        return error;
+      }
+      if ( m_setup ) {
+
+        if ( error = m_setup( reader.get() ); error ) {
+
+          return error;
+        }
+      }
+      readers.emplace_back( std::move( reader ) );
+    }
+
+    m_writer = std::move( writer );
+    m_readers = std::move( readers );
+    m_next = std::make_unique<std::atomic<std::uint32_t>[]>( m_readerCount );
+    for ( std::size_t slot = m_readerCount; slot > 0; --slot ) {
+
+      push( static_cast<std::uint32_t>( slot - 1 ) );
+    }
+    return {};
+  }
+
+  Lease ConnectionPool::read() {
+
+    if ( m_readers.empty() ) {
+
+      return {};
+    }
+
+    std::uint32_t slot = 0;
+    if ( pop( slot ) ) {
+
+      record( std::chrono::nanoseconds::zero() );
+      return { this, m_readers[ slot ].get(), slot };
+    }
+
+    /* Every reader is leased */
+    const auto start = std::chrono::steady_clock::now();
+    m_waiting.fetch_add( 1 );
+    {
+      std::unique_lock<std::mutex> lock( m_waitLock );
+      m_released.wait( lock, [ this, &slot ]() { return pop( slot ); } );
+    }
+    m_waiting.fetch_sub( 1 );
+    record( std::max( std::chrono::nanoseconds( 1 ), std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ) ) );
+    return { this, m_readers[ slot ].get(), slot };
+  }
+
+  Lease ConnectionPool::write() {
+
+    if ( !m_writer ) {
+
+      return {};
+    }
+
+    if ( m_writerLock.try_lock() ) {
+
+      record( std::chrono::nanoseconds::zero() );
+      return { this, m_writer.get(), writerSlot };
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    m_writerLock.lock();
+    record( std::max( std::chrono::nanoseconds( 1 ), std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ) ) );
+    return { this, m_writer.get(), writerSlot };
+  }
+
+  PoolMetrics ConnectionPool::metrics() const noexcept {
+
+    PoolMetrics metrics {};
+    metrics.leases = m_leases.load( std::memory_order_relaxed );
+    metrics.waits = m_waits.load( std::memory_order_relaxed );
+    metrics.waitTime = std::chrono::nanoseconds( m_waitTime.load( std::memory_order_relaxed ) );
+    metrics.maxWaitTime = std::chrono::nanoseconds( m_maxWaitTime.load( std::memory_order_relaxed ) );
+    return metrics;
+  }
+
+  void ConnectionPool::release( std::uint32_t _slot ) noexcept {
+
+    if ( _slot == writerSlot ) {
+
+      m_writerLock.unlock();
+      return;
+    }
+
+    push( _slot );
+    if ( m_waiting.load() > 0 ) {
+
+      const std::lock_guard<std::mutex> lock( m_waitLock );
+      m_released.notify_one();
+    }
+  }
+
+  bool ConnectionPool::pop( std::uint32_t &_slot ) noexcept {
+
+    std::uint64_t head = m_head.load( std::memory_order_acquire );
+    while ( slotOf( head ) != writerSlot ) {
+
+      const std::uint32_t next = m_next[ slotOf( head ) ].load( std::memory_order_relaxed );
+      if ( m_head.compare_exchange_weak( head, nextHead( head, next ), std::memory_order_acq_rel, std::memory_order_acquire ) ) {
+
+        _slot = slotOf( head );
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void ConnectionPool::push( std::uint32_t _slot ) noexcept {
+
+    std::uint64_t head = m_head.load( std::memory_order_relaxed );
+    do {
+
+      m_next[ _slot ].store( slotOf( head ), std::memory_order_relaxed );
+    } while ( !m_head.compare_exchange_weak( head, nextHead( head, _slot ) ) );
+  }
+
+  void ConnectionPool::record( std::chrono::nanoseconds _waited ) noexcept {
+
+    m_leases.fetch_add( 1, std::memory_order_relaxed );
+    if ( _waited == std::chrono::nanoseconds::zero() ) {
+
+      return;
+    }
+
+    m_waits.fetch_add( 1, std::memory_order_relaxed );
+    m_waitTime.fetch_add( _waited.count(), std::memory_order_relaxed );
+    std::int64_t longest = m_maxWaitTime.load( std::memory_order_relaxed );
+    while ( longest < _waited.count() && !m_maxWaitTime.compare_exchange_weak( longest, _waited.count(), std::memory_order_relaxed ) ) {}
+  }
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint32_t, std::uint64_t
+
+/* stl header */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/* sqlite_functions */
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The PoolMetrics struct.
+   */
+  struct PoolMetrics {
+
+    /**
+     * @brief Member for the number of leases.
+     */
+    std::uint64_t leases = 0;
+
+    /**
+     * @brief Member for the number of leases that had to wait.
+     */
+    std::uint64_t waits = 0;
+
+    /**
+     * @brief Member for the summed wait time.
+     */
+    std::chrono::nanoseconds waitTime {};
+
+    /**
+     * @brief Member for the longest wait time.
+     */
+    std::chrono::nanoseconds maxWaitTime {};
+  };
+
+  class ConnectionPool;
+
+  /**
+   * @brief The Lease class.
+   * Returns the connection to the pool on destruction.
+   */
+  class Lease {
+
+  public:
+    /**
+     * @brief Default constructor for Lease.
+     */
+    Lease() noexcept = default;
+
+    /**
+     * @brief Constructor for Lease.
+     * @param _pool   Owning pool.
+     * @param _handle   Leased connection.
+     * @param _slot   Reader slot - writerSlot for the writer.
+     */
+    Lease( ConnectionPool *_pool,
+           sqlite3 *_handle,
+           std::uint32_t _slot ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for Lease.
+     */
+    Lease( const Lease & ) = delete;
+
+    /**
+     * @brief Move constructor for Lease.
+     * @param _lease   Lease to take over.
+     */
+    Lease( Lease &&_lease ) noexcept;
+
+    /**
+     * @brief Destructor for Lease - returns the connection.
+     */
+    ~Lease();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    Lease &operator=( const Lease & ) = delete;
+
+    /**
+     * @brief Move assign operator.
+     * @param _lease   Lease to take over.
+     * @return This lease.
+     */
+    Lease &operator=( Lease &&_lease ) noexcept;
+
+    /**
+     * @brief Leased connection.
+     * @return Database handle or nullptr.
+     */
+    [[nodiscard]] sqlite3 *get() const noexcept { return m_handle; }
+
+    /**
+     * @brief Check for a leased connection.
+     * @return True, if a connection is leased - otherwise false.
+     */
+    explicit operator bool() const noexcept { return m_handle != nullptr; }
+
+    /**
+     * @brief Return the connection to the pool early.
+     */
+    void release() noexcept;
+
+  private:
+    /**
+     * @brief Member for the owning pool.
+     */
+    ConnectionPool *m_pool = nullptr;
+
+    /**
+     * @brief Member for the leased connection.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the reader slot.
+     */
+    std::uint32_t m_slot = 0;
+  };
+
+  /**
+   * @brief The ConnectionPool class.
+   * Keeps read-only connections and one writer on a WAL database.
+   * Free readers are kept in a lock-free stack - threads only block if every reader is leased.
+   * The pool must outlive its leases.
+   */
+  class ConnectionPool {
+
+  public:
+    /**
+     * @brief Slot of the writer lease.
+     */
+    static constexpr std::uint32_t writerSlot = UINT32_MAX;
+
+    /**
+     * @brief Setup of each connection after open - e.g. function registration and PRAGMAs.
+     */
+    using Setup = std::function<std::error_code( sqlite3 * )>;
+
+    /**
+     * @brief Constructor for ConnectionPool.
+     * @param _filename   Database filename.
+     * @param _readers   Number of read-only connections.
+     * @param _setup   Setup of each connection.
+     */
+    ConnectionPool( const std::string &_filename,
+                    std::size_t _readers,
+                    Setup _setup = {} ) noexcept;
+
+    /**
+     * @brief Open the writer and the readers.
+     * The writer switches the database to WAL before the readers are opened.
+     * @return Result code and message of operation.
+     */
+    std::error_code open();
+
+    /**
+     * @brief Lease a read-only connection - waits until one is free.
+     * @return Lease of a reader - empty if the pool is not open.
+     */
+    Lease read();
+
+    /**
+     * @brief Lease the writer - waits until it is free.
+     * @return Lease of the writer - empty if the pool is not open.
+     */
+    Lease write();
+
+    /**
+     * @brief Wait metrics of the leases.
+     * @return Snapshot of the metrics.
+     */
+    [[nodiscard]] PoolMetrics metrics() const noexcept;
+
+  private:
+    friend class Lease;
+
+    /**
+     * @brief Return a connection.
+     * @param _slot   Reader slot - writerSlot for the writer.
+     */
+    void release( std::uint32_t _slot ) noexcept;
+
+    /**
+     * @brief Pop a free reader.
+     * @param _slot   Popped slot.
+     * @return True, if a reader was free - otherwise false.
+     */
+    bool pop( std::uint32_t &_slot ) noexcept;
+
+    /**
+     * @brief Push a free reader.
+     * @param _slot   Free slot.
+     */
+    void push( std::uint32_t _slot ) noexcept;
+
+    /**
+     * @brief Count a lease and its wait time.
+     * @param _waited   Time spent waiting - zero if uncontended.
+     */
+    void record( std::chrono::nanoseconds _waited ) noexcept;
+
+    /**
+     * @brief Member for the database filename.
+     */
+    std::string m_filename {};
+
+    /**
+     * @brief Member for the number of readers.
+     */
+    std::size_t m_readerCount = 0;
+
+    /**
+     * @brief Member for the connection setup.
+     */
+    Setup m_setup {};
+
+    /**
+     * @brief Member for the writer.
+     */
+    std::unique_ptr<sqlite3, sqlite3_deleter> m_writer {};
+
+    /**
+     * @brief Member for the writer lock.
+     */
+    std::mutex m_writerLock {};
+
+    /**
+     * @brief Member for the readers.
+     */
+    std::vector<std::unique_ptr<sqlite3, sqlite3_deleter>> m_readers {};
+
+    /**
+     * @brief Member for the next free slot of each reader.
+     */
+    std::unique_ptr<std::atomic<std::uint32_t>[]> m_next {};
+
+    /**
+     * @brief Member for the free stack head - ABA tag in the upper, slot in the lower half.
+     */
+    std::atomic<std::uint64_t> m_head { writerSlot };
+
+    /**
+     * @brief Member for the number of threads waiting for a reader.
+     */
+    std::atomic<std::uint32_t> m_waiting { 0 };
+
+    /**
+     * @brief Member for the lock of waiting threads.
+     */
+    std::mutex m_waitLock {};
+
+    /**
+     * @brief Member for waking waiting threads.
+     */
+    std::condition_variable m_released {};
+
+    /**
+     * @brief Member for the number of leases.
+     */
+    std::atomic<std::uint64_t> m_leases { 0 };
+
+    /**
+     * @brief Member for the number of waiting leases.
+     */
+    std::atomic<std::uint64_t> m_waits { 0 };
+
+    /**
+     * @brief Member for the summed wait time in nanoseconds.
+     */
+    std::atomic<std::int64_t> m_waitTime { 0 };
+
+    /**
+     * @brief Member for the longest wait time in nanoseconds.
+     */
+    std::atomic<std::int64_t> m_maxWaitTime { 0 };
+  };
+}
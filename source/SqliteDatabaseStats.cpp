@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* stl header */
+#include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteDatabaseStats.h"
+#include "SqliteError.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief The Field struct.
+     * One status value of DatabaseStats.
+     */
+    struct Field {
+
+      /** @brief Member for the name in sqlite_database_stats. */
+      std::string_view name;
+
+      /** @brief Member for sqlite3_status - otherwise sqlite3_db_status. */
+      bool global;
+
+      /** @brief Member for the status operation. */
+      std::int32_t operation;
+
+      /** @brief Member for the high-water value - otherwise the current value. */
+      bool highwater;
+
+      /** @brief Member for a counter - otherwise a gauge. */
+      bool counter;
+
+      /** @brief Member for the value in DatabaseStats. */
+      std::int64_t DatabaseStats::*member;
+    };
+
+    /**
+     * @brief Every status value - lookaside hits and misses are reported as high-water values by sqlite.
+     */
+    constexpr std::array<Field, 18> fields = { {
+      { "cache_used", false, SQLITE_DBSTATUS_CACHE_USED, false, false, &DatabaseStats::cacheUsed },
+      { "cache_hit", false, SQLITE_DBSTATUS_CACHE_HIT, false, true, &DatabaseStats::cacheHit },
+      { "cache_miss", false, SQLITE_DBSTATUS_CACHE_MISS, false, true, &DatabaseStats::cacheMiss },
+      { "cache_write", false, SQLITE_DBSTATUS_CACHE_WRITE, false, true, &DatabaseStats::cacheWrite },
+      { "cache_spill", false, SQLITE_DBSTATUS_CACHE_SPILL, false, true, &DatabaseStats::cacheSpill },
+      { "lookaside_used", false, SQLITE_DBSTATUS_LOOKASIDE_USED, false, false, &DatabaseStats::lookasideUsed },
+      { "lookaside_highwater", false, SQLITE_DBSTATUS_LOOKASIDE_USED, true, false, &DatabaseStats::lookasideHighwater },
+      { "lookaside_hit", false, SQLITE_DBSTATUS_LOOKASIDE_HIT, true, true, &DatabaseStats::lookasideHit },
+      { "lookaside_miss_size", false, SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, true, true, &DatabaseStats::lookasideMissSize },
+      { "lookaside_miss_full", false, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, true, true, &DatabaseStats::lookasideMissFull },
+      { "schema_used", false, SQLITE_DBSTATUS_SCHEMA_USED, false, false, &DatabaseStats::schemaUsed },
+      { "statement_used", false, SQLITE_DBSTATUS_STMT_USED, false, false, &DatabaseStats::statementUsed },
+      { "memory_used", true, SQLITE_STATUS_MEMORY_USED, false, false, &DatabaseStats::memoryUsed },
+      { "memory_highwater", true, SQLITE_STATUS_MEMORY_USED, true, false, &DatabaseStats::memoryHighwater },
+      { "malloc_count", true, SQLITE_STATUS_MALLOC_COUNT, false, false, &DatabaseStats::mallocCount },
+      { "malloc_size_highwater", true, SQLITE_STATUS_MALLOC_SIZE, true, false, &DatabaseStats::mallocSizeHighwater },
+      { "page_cache_overflow", true, SQLITE_STATUS_PAGECACHE_OVERFLOW, false, false, &DatabaseStats::pageCacheOverflow },
+      { "page_cache_overflow_highwater", true, SQLITE_STATUS_PAGECACHE_OVERFLOW, true, false, &DatabaseStats::pageCacheOverflowHighwater }
+    } };
+
+    /*
+     * Eponymous virtual table sqlite_database_stats
+     */
+
+    /**
+     * @brief The StatsTable struct.
+     * Virtual table of one connection.
+     */
+    struct StatsTable {
+
+      /** @brief Member for the sqlite base - must be first. */
+      sqlite3_vtab base {};
+
+      /** @brief Member for the connection of the table. */
+      sqlite3 *handle = nullptr;
+    };
+
+    /**
+     * @brief The StatsCursor struct.
+     * Snapshot of the status values for one scan.
+     */
+    struct StatsCursor {
+
+      /** @brief Member for the sqlite base - must be first. */
+      sqlite3_vtab_cursor base {};
+
+      /** @brief Member for the snapshot. */
+      DatabaseStats stats {};
+
+      /** @brief Member for the current field. */
+      std::size_t row = 0;
+    };
+
+    /**
+     * @brief Columns of sqlite_database_stats.
+     */
+    enum Column : std::int32_t {
+      Name,
+      Scope,
+      Type,
+      Value
+    };
+
+    std::int32_t statsConnect( sqlite3 *_handle,
+                               [[maybe_unused]] void *_data, // NOSONAR sqlite api
+                               [[maybe_unused]] std::int32_t _argc,
+                               [[maybe_unused]] const char *const *_argv,
+                               sqlite3_vtab **_table,
+                               [[maybe_unused]] char **_error ) noexcept {
+
+      const std::int32_t resultCode = sqlite3_declare_vtab( _handle, "CREATE TABLE x(name TEXT, scope TEXT, type TEXT, value INTEGER)" );
+      if ( resultCode != SQLITE_OK ) {
+
+        return resultCode;
+      }
+      auto *table = new ( std::nothrow ) StatsTable();
+      if ( !table ) {
+
+        return SQLITE_NOMEM;
+      }
+      table->handle = _handle;
+      *_table = &table->base;
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsDisconnect( sqlite3_vtab *_table ) noexcept {
+
+      delete reinterpret_cast<StatsTable *>( _table ); // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsBestIndex( [[maybe_unused]] sqlite3_vtab *_table,
+                                 sqlite3_index_info *_info ) noexcept {
+
+      _info->estimatedCost = static_cast<double>( fields.size() );
+      _info->estimatedRows = static_cast<sqlite3_int64>( fields.size() );
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsOpen( [[maybe_unused]] sqlite3_vtab *_table,
+                            sqlite3_vtab_cursor **_cursor ) noexcept {
+
+      auto *cursor = new ( std::nothrow ) StatsCursor();
+      if ( !cursor ) {
+
+        return SQLITE_NOMEM;
+      }
+      *_cursor = &cursor->base;
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsClose( sqlite3_vtab_cursor *_cursor ) noexcept {
+
+      delete reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsFilter( sqlite3_vtab_cursor *_cursor,
+                              [[maybe_unused]] std::int32_t _indexNumber,
+                              [[maybe_unused]] const char *_indexString,
+                              [[maybe_unused]] std::int32_t _argc,
+                              [[maybe_unused]] sqlite3_value **_argv ) noexcept {
+
+      auto *cursor = reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      cursor->stats = databaseStats( reinterpret_cast<StatsTable *>( cursor->base.pVtab )->handle ); // NOSONAR base is the first member
+      cursor->row = 0;
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsNext( sqlite3_vtab_cursor *_cursor ) noexcept {
+
+      ++reinterpret_cast<StatsCursor *>( _cursor )->row; // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsEof( sqlite3_vtab_cursor *_cursor ) noexcept {
+
+      return reinterpret_cast<StatsCursor *>( _cursor )->row >= fields.size() ? 1 : 0; // NOSONAR base is the first member
+    }
+
+    std::int32_t statsColumn( sqlite3_vtab_cursor *_cursor,
+                              sqlite3_context *_context,
+                              std::int32_t _column ) noexcept {
+
+      const auto *cursor = reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      const Field &field = fields[ cursor->row ];
+      const auto text = [ _context ]( std::string_view _text ) {
+        sqlite3_result_text( _context, _text.data(), static_cast<std::int32_t>( _text.size() ), SQLITE_STATIC );
+      };
+      switch ( _column ) {
+
+        case Column::Name:
+          text( field.name );
+          break;
+        case Column::Scope:
+          text( field.global ? "global" : "connection" );
+          break;
+        case Column::Type:
+          text( field.counter ? "counter" : "gauge" );
+          break;
+        case Column::Value:
+          sqlite3_result_int64( _context, cursor->stats.*field.member );
+          break;
+        default:
+          sqlite3_result_null( _context );
+          break;
+      }
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsRowid( sqlite3_vtab_cursor *_cursor,
+                             sqlite3_int64 *_rowid ) noexcept {
+
+      *_rowid = static_cast<sqlite3_int64>( reinterpret_cast<StatsCursor *>( _cursor )->row ); // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    /**
+     * @brief Module of sqlite_database_stats - eponymous only, as xCreate is empty.
+     * @return Module.
+     */
+    const sqlite3_module &statsModule() noexcept {
+
+      static const sqlite3_module module = [] {
+        sqlite3_module result {};
+        result.xConnect = statsConnect;
+        result.xBestIndex = statsBestIndex;
+        result.xDisconnect = statsDisconnect;
+        result.xOpen = statsOpen;
+        result.xClose = statsClose;
+        result.xFilter = statsFilter;
+        result.xNext = statsNext;
+        result.xEof = statsEof;
+        result.xColumn = statsColumn;
+        result.xRowid = statsRowid;
+        return result;
+      }();
+      return module;
+    }
+  }
+
+  DatabaseStats databaseStats( sqlite3 *_handle,
+                               bool _resetHighwater ) noexcept {
+
+    DatabaseStats stats {};
+    stats.time = std::chrono::steady_clock::now();
+    const std::int32_t reset = _resetHighwater ? 1 : 0;
+    for ( const Field &field : fields ) {
+
+      if ( field.global ) {
+
+        sqlite3_int64 current = 0;
+        sqlite3_int64 highwater = 0;
+        if ( sqlite3_status64( field.operation, &current, &highwater, reset ) == SQLITE_OK ) {
+
+          stats.*field.member = field.highwater ? highwater : current;
+        }
+      }
+      else if ( _handle ) {
+
+        std::int32_t current = 0;
+        std::int32_t highwater = 0;
+        if ( sqlite3_db_status( _handle, field.operation, &current, &highwater, reset ) == SQLITE_OK ) {
+
+          stats.*field.member = field.highwater ? highwater : current;
+        }
+      }
+    }
+    return stats;
+  }
+
+  DatabaseStats databaseStatsDelta( const DatabaseStats &_previous,
+                                    const DatabaseStats &_current ) noexcept {
+
+    DatabaseStats delta = _current;
+    for ( const Field &field : fields ) {
+
+      if ( field.counter ) {
+
+        delta.*field.member -= _previous.*field.member;
+      }
+    }
+    return delta;
+  }
+
+  std::error_code registerDatabaseStats( sqlite3 *_handle ) noexcept {
+
+    const std::int32_t resultCode = sqlite3_create_module_v2( _handle, "sqlite_database_stats", &statsModule(), nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, sqlite3_errmsg( _handle ) );
+    }
+    return {};
+  }
+
+  DatabaseStatsSampler::DatabaseStatsSampler( sqlite3 *_handle,
+                                              std::chrono::milliseconds _interval,
+                                              Callback _callback )
+    : m_handle( _handle ),
+      m_interval( _interval ),
+      m_callback( std::move( _callback ) ),
+      m_latest( databaseStats( _handle ) ),
+      m_thread( [ this ] { run(); } ) {}
+
+  DatabaseStatsSampler::~DatabaseStatsSampler() {
+
+    {
+      const std::lock_guard lock( m_mutex );
+      m_stop = true;
+    }
+    m_condition.notify_all();
+    if ( m_thread.joinable() ) {
+
+      m_thread.join();
+    }
+  }
+
+  DatabaseStats DatabaseStatsSampler::latest() const {
+
+    const std::lock_guard lock( m_mutex );
+    return m_latest;
+  }
+
+  void DatabaseStatsSampler::run() {
+
+    DatabaseStats previous = latest();
+    while ( true ) {
+
+      {
+        std::unique_lock lock( m_mutex );
+        if ( m_condition.wait_for( lock, m_interval, [ this ] { return m_stop; } ) ) {
+
+          break;
+        }
+      }
+
+      /* Outside the lock - the connection may be busy */
+      const DatabaseStats current = databaseStats( m_handle );
+      {
+        const std::lock_guard lock( m_mutex );
+        m_latest = current;
+      }
+      if ( m_callback ) {
+
+        m_callback( current, databaseStatsDelta( previous, current ) );
+      }
+      previous = current;
+    }
+  }
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstdint> // std::int64_t
+
+/* stl header */
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+/* forward declaration of sqlite3 */
+struct sqlite3;
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The DatabaseStats struct.
+   * Snapshot of sqlite3_db_status of one connection and the global sqlite3_status.
+   * Counters only grow - gauges are current values or high-water marks.
+   */
+  struct DatabaseStats {
+
+    /**
+     * @brief Member for the time of the snapshot.
+     */
+    std::chrono::steady_clock::time_point time {};
+
+    /**
+     * @brief Member for the page cache memory of the connection - gauge in bytes.
+     */
+    std::int64_t cacheUsed = 0;
+
+    /**
+     * @brief Member for the page cache hits - counter.
+     */
+    std::int64_t cacheHit = 0;
+
+    /**
+     * @brief Member for the page cache misses - counter.
+     */
+    std::int64_t cacheMiss = 0;
+
+    /**
+     * @brief Member for the written dirty pages - counter.
+     */
+    std::int64_t cacheWrite = 0;
+
+    /**
+     * @brief Member for the dirty pages written in the middle of a transaction - counter.
+     */
+    std::int64_t cacheSpill = 0;
+
+    /**
+     * @brief Member for the used lookaside slots - gauge.
+     */
+    std::int64_t lookasideUsed = 0;
+
+    /**
+     * @brief Member for the most lookaside slots used at once - gauge.
+     */
+    std::int64_t lookasideHighwater = 0;
+
+    /**
+     * @brief Member for the allocations served by lookaside - counter.
+     */
+    std::int64_t lookasideHit = 0;
+
+    /**
+     * @brief Member for the allocations too large for lookaside - counter.
+     */
+    std::int64_t lookasideMissSize = 0;
+
+    /**
+     * @brief Member for the allocations with every lookaside slot in use - counter.
+     */
+    std::int64_t lookasideMissFull = 0;
+
+    /**
+     * @brief Member for the schema memory of the connection - gauge in bytes.
+     */
+    std::int64_t schemaUsed = 0;
+
+    /**
+     * @brief Member for the prepared statement memory of the connection - gauge in bytes.
+     */
+    std::int64_t statementUsed = 0;
+
+    /**
+     * @brief Member for the memory of the process used by sqlite - gauge in bytes.
+     */
+    std::int64_t memoryUsed = 0;
+
+    /**
+     * @brief Member for the most memory used by sqlite at once - gauge in bytes.
+     */
+    std::int64_t memoryHighwater = 0;
+
+    /**
+     * @brief Member for the outstanding allocations - gauge.
+     */
+    std::int64_t mallocCount = 0;
+
+    /**
+     * @brief Member for the largest allocation - gauge in bytes.
+     */
+    std::int64_t mallocSizeHighwater = 0;
+
+    /**
+     * @brief Member for the page cache memory outside SQLITE_CONFIG_PAGECACHE - gauge in bytes.
+     */
+    std::int64_t pageCacheOverflow = 0;
+
+    /**
+     * @brief Member for the most page cache memory outside SQLITE_CONFIG_PAGECACHE - gauge in bytes.
+     */
+    std::int64_t pageCacheOverflowHighwater = 0;
+  };
+
+  /**
+   * @brief Snapshot of the status counters.
+   * @param _handle   Database handle - nullptr for the global counters only.
+   * @param _resetHighwater   Restart the high-water marks and lookaside counters after reading.
+   * @return Counters and gauges.
+   */
+  [[nodiscard]] DatabaseStats databaseStats( sqlite3 *_handle,
+                                             bool _resetHighwater = false ) noexcept;
+
+  /**
+   * @brief Change between two snapshots.
+   * Counters become differences - gauges keep the value of the current snapshot.
+   * @param _previous   Earlier snapshot.
+   * @param _current   Later snapshot.
+   * @return Delta with the time of the current snapshot.
+   */
+  [[nodiscard]] DatabaseStats databaseStatsDelta( const DatabaseStats &_previous,
+                                                  const DatabaseStats &_current ) noexcept;
+
+  /**
+   * @brief Register the eponymous virtual table sqlite_database_stats.
+   * SELECT name, scope, type, value FROM sqlite_database_stats - one row per member of DatabaseStats for the querying connection.
+   * @param _handle   Database handle.
+   * @return Result code and message of operation.
+   */
+  std::error_code registerDatabaseStats( sqlite3 *_handle ) noexcept;
+
+  /**
+   * @brief The DatabaseStatsSampler class.
+   * Takes a snapshot of a connection periodically in an own thread and reports it with the delta to the previous one.
+   * The connection must be opened in serialized mode - SQLITE_OPEN_FULLMUTEX - when it is used by other threads meanwhile.
+   */
+  class DatabaseStatsSampler {
+
+  public:
+    /**
+     * @brief Callback with the snapshot and the delta to the previous one.
+     */
+    using Callback = std::function<void( const DatabaseStats &_stats, const DatabaseStats &_delta )>;
+
+    /**
+     * @brief Constructor for DatabaseStatsSampler - takes the first snapshot and starts the sampler thread.
+     * @param _handle   Database handle - nullptr for the global counters only.
+     * @param _interval   Time between two snapshots.
+     * @param _callback   Called from the sampler thread for every snapshot after the first.
+     */
+    DatabaseStatsSampler( sqlite3 *_handle,
+                          std::chrono::milliseconds _interval,
+                          Callback _callback );
+
+    /**
+     * @brief Delete copy constructor for DatabaseStatsSampler.
+     */
+    DatabaseStatsSampler( const DatabaseStatsSampler & ) = delete;
+
+    /**
+     * @brief Delete move constructor for DatabaseStatsSampler.
+     */
+    DatabaseStatsSampler( DatabaseStatsSampler && ) = delete;
+
+    /**
+     * @brief Destructor for DatabaseStatsSampler - stops the sampler thread.
+     */
+    ~DatabaseStatsSampler();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    DatabaseStatsSampler &operator=( const DatabaseStatsSampler & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    DatabaseStatsSampler &operator=( DatabaseStatsSampler && ) = delete;
+
+    /**
+     * @brief Latest snapshot.
+     * @return Counters and gauges.
+     */
+    [[nodiscard]] DatabaseStats latest() const;
+
+  private:
+    /**
+     * @brief Sampler thread loop.
+     */
+    void run();
+
+    /**
+     * @brief Member for the database handle.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the time between two snapshots.
+     */
+    std::chrono::milliseconds m_interval {};
+
+    /**
+     * @brief Member for the callback.
+     */
+    Callback m_callback {};
+
+    /**
+     * @brief Member for the latest snapshot.
+     */
+    DatabaseStats m_latest {};
+
+    /**
+     * @brief Member for the lock of the latest snapshot and the stop flag.
+     */
+    mutable std::mutex m_mutex {};
+
+    /**
+     * @brief Member for waking the sampler thread.
+     */
+    std::condition_variable m_condition {};
+
+    /**
+     * @brief Member for stopping the sampler thread.
+     */
+    bool m_stop = false;
+
+    /**
+     * @brief Member for the sampler thread.
+     */
+    std::thread m_thread {};
+  };
+}
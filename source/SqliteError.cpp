@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief The ErrorDetail struct.
+     * Message of the last error of a thread.
+     */
+    struct ErrorDetail {
+
+      /** @brief Member for the result code of the message. */
+      std::int32_t code = SQLITE_OK;
+
+      /** @brief Member for the length of the message. */
+      std::size_t length = 0;
+
+      /** @brief Member for the message - not null terminated. */
+      std::array<char, errorMessageSize> text {};
+    };
+
+    /**
+     * @brief Error detail of the calling thread - trivially destructible and without lock.
+     * @return Error detail.
+     */
+    ErrorDetail &errorDetail() noexcept {
+
+      thread_local ErrorDetail detail {};
+      return detail;
+    }
+  }
+
+  std::string SqliteErrorCategory::message( std::int32_t _condition ) const {
+
+    if ( const ErrorDetail &detail = errorDetail(); detail.code == _condition && detail.length > 0 ) {
+
+      return { detail.text.data(), detail.length };
+    }
+    return sqlite3_errstr( _condition );
+  }
+
+  std::error_code makeError( std::int32_t _resultCode,
+                             std::string_view _message ) noexcept {
+
+    ErrorDetail &detail = errorDetail();
+    detail.code = _resultCode;
+    detail.length = std::min( _message.size(), detail.text.size() );
+    std::copy_n( _message.data(), detail.length, detail.text.data() );
+    return { _resultCode, SqliteErrorCategory::instance() };
+  }
+}
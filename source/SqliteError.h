@@ -31,6 +31,7 @@
 #pragma once
 
 /* c header */
+#include <cstddef> // std::size_t
 #include <cstdint> // std::int32_t
 
 /* stl header */
@@ -92,8 +93,20 @@ namespace std {
   struct is_error_code_enum<vx::sqlite::Error> : true_type {};
 }
 
-namespace { // NOSONAR
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Capacity of the error message of a thread - longer messages are truncated.
+   */
+  constexpr std::size_t errorMessageSize = 256;
 
+  /**
+   * @brief The SqliteErrorCategory class.
+   * Stateless - the value of the error code is the sqlite result code.
+   */
   class SqliteErrorCategory final : public std::error_category,
                                     public vx::Singleton<SqliteErrorCategory> {
 
@@ -106,21 +119,31 @@ namespace { // NOSONAR
 
     /**
      * @brief Reimplementation of std::error_category::message.
+     * The message of the last error of the calling thread with this result code - otherwise sqlite3_errstr of the result code.
      * @param _condition   Condition value.
      * @return Error message for condition.
      */
-    [[nodiscard]] std::string message( [[maybe_unused]] std::int32_t _condition ) const noexcept override { return m_message; }
+    [[nodiscard]] std::string message( std::int32_t _condition ) const override;
+  };
 
-    /**
-     * @brief Set a textual message.
-     * @param _message   Message to set.
-     */
-    [[maybe_unused]] void setMessage( std::string_view _message ) noexcept { m_message = _message; }
+  /**
+   * @brief Error code of a result code - without lock and allocation.
+   * The message is copied into a fixed buffer of the calling thread and kept until its next error.
+   * Other threads receiving the error code see sqlite3_errstr.
+   * @param _resultCode   Sqlite result code - extended result codes included.
+   * @param _message   Message of the error - empty for sqlite3_errstr.
+   * @return Error code.
+   */
+  std::error_code makeError( std::int32_t _resultCode,
+                             std::string_view _message = {} ) noexcept;
+}
 
-  private:
-    /**
-     * @brief Member for message.
-     */
-    std::string m_message {};
-  };
+namespace vx::sqlite {
+
+  /**
+   * @brief Error code of an error enum - without message.
+   * @param _error   Error enum.
+   * @return Error code.
+   */
+  inline std::error_code make_error_code( Error _error ) noexcept { return { static_cast<std::int32_t>( _error ), sqlite_utils::SqliteErrorCategory::instance() }; }
 }
@@ -0,0 +1,551 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::int64_t, std::uint64_t
+
+/* stl header */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteFunctionStats.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Sql names by SqlFunction.
+     */
+    constexpr std::array<std::string_view, 2> functionNames = { "DISTANCE", "TRANSLITERATION" };
+
+#ifdef SQLITE_FUNCTION_STATS
+    /**
+     * @brief The Counters struct.
+     * Counters of one sql function.
+     */
+    struct Counters {
+
+      /** @brief Member for the calls. */
+      std::atomic<std::uint64_t> calls { 0 };
+
+      /** @brief Member for the nanoseconds. */
+      std::atomic<std::uint64_t> nanoseconds { 0 };
+
+      /** @brief Member for the NULL results. */
+      std::atomic<std::uint64_t> nulls { 0 };
+
+      /** @brief Member for the cache hits. */
+      std::atomic<std::uint64_t> cacheHits { 0 };
+    };
+
+    /**
+     * @brief Counters of every sql function.
+     */
+    using Shard = std::array<Counters, functionNames.size()>;
+
+    /**
+     * @brief Add to a counter written only by the calling thread - no read-modify-write.
+     * @param _counter   Counter.
+     * @param _value   Value to add.
+     */
+    void bump( std::atomic<std::uint64_t> &_counter,
+               std::uint64_t _value ) noexcept {
+
+      _counter.store( _counter.load( std::memory_order_relaxed ) + _value, std::memory_order_relaxed );
+    }
+
+    /**
+     * @brief The Shards class.
+     * Registry of the thread shards - merged on read.
+     */
+    class Shards {
+
+    public:
+      /**
+       * @brief Add the shard of a thread.
+       * @param _shard   Shard of the thread.
+       */
+      void attach( const Shard &_shard ) noexcept {
+
+        const std::lock_guard lock( m_mutex );
+        try {
+
+          m_threads.push_back( &_shard );
+        }
+        catch ( const std::bad_alloc & ) {
+
+          /* The thread is not counted until it ends */
+        }
+      }
+
+      /**
+       * @brief Fold the shard of an ending thread into the retired counters.
+       * @param _shard   Shard of the thread.
+       */
+      void detach( const Shard &_shard ) noexcept {
+
+        const std::lock_guard lock( m_mutex );
+        m_threads.erase( std::remove( std::begin( m_threads ), std::end( m_threads ), &_shard ), std::end( m_threads ) );
+        for ( std::size_t function = 0; function < _shard.size(); ++function ) {
+
+          m_retired[ function ].calls.fetch_add( _shard[ function ].calls.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+          m_retired[ function ].nanoseconds.fetch_add( _shard[ function ].nanoseconds.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+          m_retired[ function ].nulls.fetch_add( _shard[ function ].nulls.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+          m_retired[ function ].cacheHits.fetch_add( _shard[ function ].cacheHits.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        }
+      }
+
+      /**
+       * @brief Add a call of a thread without shard.
+       * @param _function   Sql function.
+       * @param _nanoseconds   Time of the call.
+       * @param _null   NULL result.
+       * @param _cacheHit   Served by a cache.
+       */
+      void retire( std::size_t _function,
+                   std::uint64_t _nanoseconds,
+                   bool _null,
+                   bool _cacheHit ) noexcept {
+
+        Counters &counters = m_retired[ _function ];
+        counters.calls.fetch_add( 1, std::memory_order_relaxed );
+        counters.nanoseconds.fetch_add( _nanoseconds, std::memory_order_relaxed );
+        counters.nulls.fetch_add( _null ? 1 : 0, std::memory_order_relaxed );
+        counters.cacheHits.fetch_add( _cacheHit ? 1 : 0, std::memory_order_relaxed );
+      }
+
+      /**
+       * @brief Summed counters without the baseline.
+       * @return Counters by function.
+       */
+      std::vector<FunctionStats> stats() {
+
+        std::vector<FunctionStats> result = sum();
+        const std::lock_guard lock( m_mutex );
+        for ( std::size_t function = 0; function < result.size(); ++function ) {
+
+          result[ function ].calls -= m_baseline[ function ].calls;
+          result[ function ].time -= m_baseline[ function ].time;
+          result[ function ].nulls -= m_baseline[ function ].nulls;
+          result[ function ].cacheHits -= m_baseline[ function ].cacheHits;
+        }
+        return result;
+      }
+
+      /**
+       * @brief Use the current sums as baseline - the shards are only written by their threads.
+       */
+      void reset() noexcept {
+
+        try {
+
+          std::vector<FunctionStats> current = sum();
+          const std::lock_guard lock( m_mutex );
+          std::copy( std::cbegin( current ), std::cend( current ), std::begin( m_baseline ) );
+        }
+        catch ( const std::bad_alloc & ) {
+
+          /* Keep the previous baseline */
+        }
+      }
+
+    private:
+      /**
+       * @brief Summed counters of the retired and running threads.
+       * @return Counters by function.
+       */
+      std::vector<FunctionStats> sum() {
+
+        std::vector<FunctionStats> result( functionNames.size() );
+        const auto add = [ &result ]( const Shard &_shard ) {
+          for ( std::size_t function = 0; function < _shard.size(); ++function ) {
+
+            result[ function ].calls += _shard[ function ].calls.load( std::memory_order_relaxed );
+            result[ function ].time += std::chrono::nanoseconds( _shard[ function ].nanoseconds.load( std::memory_order_relaxed ) );
+            result[ function ].nulls += _shard[ function ].nulls.load( std::memory_order_relaxed );
+            result[ function ].cacheHits += _shard[ function ].cacheHits.load( std::memory_order_relaxed );
+          }
+        };
+
+        const std::lock_guard lock( m_mutex );
+        add( m_retired );
+        for ( const Shard *shard : m_threads ) {
+
+          add( *shard );
+        }
+        for ( std::size_t function = 0; function < result.size(); ++function ) {
+
+          result[ function ].name = functionNames[ function ];
+        }
+        return result;
+      }
+
+      /**
+       * @brief Member for the mutex of the registry and the baseline.
+       */
+      std::mutex m_mutex {};
+
+      /**
+       * @brief Member for the shards of the running threads.
+       */
+      std::vector<const Shard *> m_threads {};
+
+      /**
+       * @brief Member for the counters of ended threads.
+       */
+      Shard m_retired {};
+
+      /**
+       * @brief Member for the sums of the last reset.
+       */
+      std::array<FunctionStats, functionNames.size()> m_baseline {};
+    };
+
+    /**
+     * @brief Registry of the thread shards - leaked for sql functions called during static destruction.
+     * @return Registry.
+     */
+    Shards &shards() noexcept {
+
+      static Shards *instance = new Shards(); // NOSONAR intentionally leaked
+      return *instance;
+    }
+
+    /**
+     * @brief The shard of the calling thread has been destroyed.
+     */
+    thread_local bool threadExited = false; // NOSONAR trivially destructible flag
+
+    /**
+     * @brief The ThreadShard struct.
+     * Registers the shard of one thread for its lifetime.
+     */
+    struct ThreadShard {
+
+      /**
+       * @brief Constructor for ThreadShard.
+       */
+      ThreadShard() noexcept { shards().attach( shard ); }
+
+      /**
+       * @brief Delete copy constructor for ThreadShard.
+       */
+      ThreadShard( const ThreadShard & ) = delete;
+
+      /**
+       * @brief Delete move constructor for ThreadShard.
+       */
+      ThreadShard( ThreadShard && ) = delete;
+
+      /**
+       * @brief Destructor for ThreadShard - folds the counters into the retired ones.
+       */
+      ~ThreadShard() {
+
+        shards().detach( shard );
+        threadExited = true;
+      }
+
+      /**
+       * @brief Delete copy assign operator.
+       * @return Nothing.
+       */
+      ThreadShard &operator=( const ThreadShard & ) = delete;
+
+      /**
+       * @brief Delete move assign operator.
+       * @return Nothing.
+       */
+      ThreadShard &operator=( ThreadShard && ) = delete;
+
+      /** @brief Member for the counters of the thread. */
+      Shard shard {};
+    };
+
+    /**
+     * @brief Shard of the calling thread.
+     * @return Shard or nullptr, if the thread is ending.
+     */
+    Shard *threadShard() noexcept {
+
+      if ( threadExited ) {
+
+        return nullptr;
+      }
+      thread_local ThreadShard shard {};
+      return &shard.shard;
+    }
+#endif
+
+    /*
+     * Eponymous virtual table sqlite_functions_stats
+     */
+
+    /**
+     * @brief The StatsCursor struct.
+     * Snapshot of the counters for one scan.
+     */
+    struct StatsCursor {
+
+      /** @brief Member for the sqlite base - must be first. */
+      sqlite3_vtab_cursor base {};
+
+      /** @brief Member for the counters. */
+      std::vector<FunctionStats> rows {};
+
+      /** @brief Member for the current row. */
+      std::size_t row = 0;
+    };
+
+    /**
+     * @brief Columns of sqlite_functions_stats.
+     */
+    enum Column : std::int32_t {
+      Name,
+      Calls,
+      Nanoseconds,
+      Nulls,
+      CacheHits
+    };
+
+    std::int32_t statsConnect( sqlite3 *_handle,
+                               [[maybe_unused]] void *_data, // NOSONAR sqlite api
+                               [[maybe_unused]] std::int32_t _argc,
+                               [[maybe_unused]] const char *const *_argv,
+                               sqlite3_vtab **_table,
+                               [[maybe_unused]] char **_error ) noexcept {
+
+      const std::int32_t resultCode = sqlite3_declare_vtab( _handle, "CREATE TABLE x(name TEXT, calls INTEGER, nanoseconds INTEGER, nulls INTEGER, cache_hits INTEGER)" );
+      if ( resultCode != SQLITE_OK ) {
+
+        return resultCode;
+      }
+      *_table = static_cast<sqlite3_vtab *>( sqlite3_malloc( sizeof( sqlite3_vtab ) ) );
+      if ( !*_table ) {
+
+        return SQLITE_NOMEM;
+      }
+      **_table = {};
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsDisconnect( sqlite3_vtab *_table ) noexcept {
+
+      sqlite3_free( _table );
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsBestIndex( [[maybe_unused]] sqlite3_vtab *_table,
+                                 sqlite3_index_info *_info ) noexcept {
+
+      _info->estimatedCost = static_cast<double>( functionNames.size() );
+      _info->estimatedRows = static_cast<sqlite3_int64>( functionNames.size() );
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsOpen( [[maybe_unused]] sqlite3_vtab *_table,
+                            sqlite3_vtab_cursor **_cursor ) noexcept {
+
+      auto *cursor = new ( std::nothrow ) StatsCursor();
+      if ( !cursor ) {
+
+        return SQLITE_NOMEM;
+      }
+      *_cursor = &cursor->base;
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsClose( sqlite3_vtab_cursor *_cursor ) noexcept {
+
+      delete reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsFilter( sqlite3_vtab_cursor *_cursor,
+                              [[maybe_unused]] std::int32_t _indexNumber,
+                              [[maybe_unused]] const char *_indexString,
+                              [[maybe_unused]] std::int32_t _argc,
+                              [[maybe_unused]] sqlite3_value **_argv ) noexcept {
+
+      auto *cursor = reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      try {
+
+        cursor->rows = functionStats();
+      }
+      catch ( const std::bad_alloc & ) {
+
+        return SQLITE_NOMEM;
+      }
+      cursor->row = 0;
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsNext( sqlite3_vtab_cursor *_cursor ) noexcept {
+
+      ++reinterpret_cast<StatsCursor *>( _cursor )->row; // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsEof( sqlite3_vtab_cursor *_cursor ) noexcept {
+
+      const auto *cursor = reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      return cursor->row >= cursor->rows.size() ? 1 : 0;
+    }
+
+    std::int32_t statsColumn( sqlite3_vtab_cursor *_cursor,
+                              sqlite3_context *_context,
+                              std::int32_t _column ) noexcept {
+
+      const auto *cursor = reinterpret_cast<StatsCursor *>( _cursor ); // NOSONAR base is the first member
+      const FunctionStats &stats = cursor->rows[ cursor->row ];
+      switch ( _column ) {
+
+        case Column::Name:
+          sqlite3_result_text( _context, stats.name.data(), static_cast<std::int32_t>( stats.name.size() ), SQLITE_STATIC );
+          break;
+        case Column::Calls:
+          sqlite3_result_int64( _context, static_cast<sqlite3_int64>( stats.calls ) );
+          break;
+        case Column::Nanoseconds:
+          sqlite3_result_int64( _context, static_cast<sqlite3_int64>( stats.time.count() ) );
+          break;
+        case Column::Nulls:
+          sqlite3_result_int64( _context, static_cast<sqlite3_int64>( stats.nulls ) );
+          break;
+        case Column::CacheHits:
+          sqlite3_result_int64( _context, static_cast<sqlite3_int64>( stats.cacheHits ) );
+          break;
+        default:
+          sqlite3_result_null( _context );
+          break;
+      }
+      return SQLITE_OK;
+    }
+
+    std::int32_t statsRowid( sqlite3_vtab_cursor *_cursor,
+                             sqlite3_int64 *_rowid ) noexcept {
+
+      *_rowid = static_cast<sqlite3_int64>( reinterpret_cast<StatsCursor *>( _cursor )->row ); // NOSONAR base is the first member
+      return SQLITE_OK;
+    }
+
+    /**
+     * @brief Module of sqlite_functions_stats - eponymous only, as xCreate is empty.
+     * @return Module.
+     */
+    const sqlite3_module &statsModule() noexcept {
+
+      static const sqlite3_module module = [] {
+        sqlite3_module result {};
+        result.xConnect = statsConnect;
+        result.xBestIndex = statsBestIndex;
+        result.xDisconnect = statsDisconnect;
+        result.xOpen = statsOpen;
+        result.xClose = statsClose;
+        result.xFilter = statsFilter;
+        result.xNext = statsNext;
+        result.xEof = statsEof;
+        result.xColumn = statsColumn;
+        result.xRowid = statsRowid;
+        return result;
+      }();
+      return module;
+    }
+  }
+
+  std::vector<FunctionStats> functionStats() {
+
+#ifdef SQLITE_FUNCTION_STATS
+    return shards().stats();
+#else
+    return {};
+#endif
+  }
+
+  void resetFunctionStats() noexcept {
+
+#ifdef SQLITE_FUNCTION_STATS
+    shards().reset();
+#endif
+  }
+
+  std::error_code registerFunctionStats( sqlite3 *_handle ) noexcept {
+
+    const std::int32_t resultCode = sqlite3_create_module_v2( _handle, "sqlite_functions_stats", &statsModule(), nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, sqlite3_errmsg( _handle ) );
+    }
+    return {};
+  }
+
+#ifdef SQLITE_FUNCTION_STATS
+  FunctionCounter::FunctionCounter( SqlFunction _function ) noexcept
+    : m_function( _function ),
+      m_start( std::chrono::steady_clock::now() ) {}
+
+  FunctionCounter::~FunctionCounter() {
+
+    const auto nanoseconds = static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - m_start ).count() );
+    const auto function = static_cast<std::size_t>( m_function );
+    Shard *shard = threadShard();
+    if ( !shard ) {
+
+      shards().retire( function, nanoseconds, m_null, m_cacheHit );
+      return;
+    }
+    Counters &counters = ( *shard )[ function ];
+    bump( counters.calls, 1 );
+    bump( counters.nanoseconds, nanoseconds );
+    if ( m_null ) {
+
+      bump( counters.nulls, 1 );
+    }
+    if ( m_cacheHit ) {
+
+      bump( counters.cacheHits, 1 );
+    }
+  }
+#endif
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstdint> // std::uint8_t, std::uint64_t
+
+/* stl header */
+#include <chrono>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* forward declaration of sqlite3 */
+struct sqlite3;
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The SqlFunction enum.
+   * Sql functions with counters.
+   */
+  enum class SqlFunction : std::uint8_t {
+    Distance, /**< DISTANCE. */
+    Transliteration /**< TRANSLITERATION. */
+  };
+
+  /**
+   * @brief The FunctionStats struct.
+   * Counters of one sql function summed over every thread.
+   */
+  struct FunctionStats {
+
+    /**
+     * @brief Member for the sql name of the function.
+     */
+    std::string_view name {};
+
+    /**
+     * @brief Member for the calls.
+     */
+    std::uint64_t calls = 0;
+
+    /**
+     * @brief Member for the time spent in the function.
+     */
+    std::chrono::nanoseconds time {};
+
+    /**
+     * @brief Member for the calls with a NULL result.
+     */
+    std::uint64_t nulls = 0;
+
+    /**
+     * @brief Member for the calls served by a cache of the function - 0 for functions without cache.
+     */
+    std::uint64_t cacheHits = 0;
+  };
+
+  /**
+   * @brief Counters of every sql function since the last resetFunctionStats.
+   * @return One entry per function - empty, if built without SQLITE_FUNCTION_STATS.
+   */
+  [[nodiscard]] std::vector<FunctionStats> functionStats();
+
+  /**
+   * @brief Start the counters of every sql function from zero.
+   */
+  void resetFunctionStats() noexcept;
+
+  /**
+   * @brief Register the eponymous virtual table sqlite_functions_stats.
+   * SELECT name, calls, nanoseconds, nulls, cache_hits FROM sqlite_functions_stats
+   * @param _handle   Database handle.
+   * @return Result code and message of operation.
+   */
+  std::error_code registerFunctionStats( sqlite3 *_handle ) noexcept;
+
+  /**
+   * @brief The FunctionCounter class.
+   * Count one call of a sql function in the counters of the calling thread - no locking.
+   * Without SQLITE_FUNCTION_STATS every member is empty and inline.
+   */
+  class FunctionCounter {
+
+  public:
+#ifdef SQLITE_FUNCTION_STATS
+    /**
+     * @brief Constructor for FunctionCounter - starts the timer.
+     * @param _function   Sql function of the call.
+     */
+    explicit FunctionCounter( SqlFunction _function ) noexcept;
+
+    /**
+     * @brief Destructor for FunctionCounter - adds the call to the counters.
+     */
+    ~FunctionCounter();
+
+    /**
+     * @brief The call returns NULL.
+     */
+    void null() noexcept { m_null = true; }
+
+    /**
+     * @brief The call is served by a cache.
+     */
+    void cacheHit() noexcept { m_cacheHit = true; }
+#else
+    /**
+     * @brief Constructor for FunctionCounter - does nothing.
+     */
+    explicit FunctionCounter( SqlFunction /*_function*/ ) noexcept {}
+
+    /**
+     * @brief Destructor for FunctionCounter - does nothing.
+     */
+    ~FunctionCounter() = default;
+
+    /**
+     * @brief The call returns NULL - does nothing.
+     */
+    void null() noexcept {}
+
+    /**
+     * @brief The call is served by a cache - does nothing.
+     */
+    void cacheHit() noexcept {}
+#endif
+
+    /**
+     * @brief Delete copy constructor for FunctionCounter.
+     */
+    FunctionCounter( const FunctionCounter & ) = delete;
+
+    /**
+     * @brief Delete move constructor for FunctionCounter.
+     */
+    FunctionCounter( FunctionCounter && ) = delete;
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    FunctionCounter &operator=( const FunctionCounter & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    FunctionCounter &operator=( FunctionCounter && ) = delete;
+
+#ifdef SQLITE_FUNCTION_STATS
+  private:
+    /**
+     * @brief Member for the sql function.
+     */
+    SqlFunction m_function;
+
+    /**
+     * @brief Member for the NULL result.
+     */
+    bool m_null = false;
+
+    /**
+     * @brief Member for the cache hit.
+     */
+    bool m_cacheHit = false;
+
+    /**
+     * @brief Member for the start of the call.
+     */
+    std::chrono::steady_clock::time_point m_start;
+#endif
+  };
+}
@@ -0,0 +1,1347 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::uint32_t, std::uint64_t, std::uint8_t
+#include <cstdlib> // std::free, std::malloc
+#include <cstring> // std::memcpy, std::memset
+
+/* system header */
+#ifdef _WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+#endif
+
+/* stl header */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <tuple> // std::ignore
+#include <utility>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteMemory.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Header in front of every allocation - size class or size of large allocations.
+     */
+    constexpr std::size_t headerSize = sizeof( std::uint64_t );
+
+    /**
+     * @brief Header tag of allocations above memoryPoolMaxSize.
+     */
+    constexpr std::uint64_t largeTag = 0xFF;
+
+    /**
+     * @brief Sizes of the pools - multiples of 16 up to memoryPoolMaxSize.
+     */
+    constexpr std::array<std::uint32_t, 28> sizeClasses = { 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096 };
+
+    /**
+     * @brief Memory requested from malloc to refill a pool.
+     */
+    constexpr std::size_t chunkSize = 64 * 1024;
+
+    /**
+     * @brief Entries of the first slab of a page cache - doubled with every slab up to pageCacheSlabSize.
+     */
+    constexpr std::size_t firstSlabEntries = 16;
+
+    /**
+     * @brief Index of the size class of every size rounded up to 16.
+     * @return Size class by size / 16.
+     */
+    constexpr std::array<std::uint8_t, memoryPoolMaxSize / 16 + 1> makeClassIndex() noexcept {
+
+      std::array<std::uint8_t, memoryPoolMaxSize / 16 + 1> index {};
+      std::size_t sizeClass = 0;
+      for ( std::size_t i = 0; i < index.size(); ++i ) {
+
+        while ( sizeClasses[ sizeClass ] < i * 16 ) {
+
+          ++sizeClass;
+        }
+        index[ i ] = static_cast<std::uint8_t>( sizeClass );
+      }
+      return index;
+    }
+
+    /**
+     * @brief Size class by size / 16.
+     */
+    constexpr std::array<std::uint8_t, memoryPoolMaxSize / 16 + 1> classIndex = makeClassIndex();
+
+    /**
+     * @brief Size class of an allocation.
+     * @param _size   Requested bytes - at most memoryPoolMaxSize.
+     * @return Index of the size class.
+     */
+    constexpr std::size_t sizeClass( std::size_t _size ) noexcept { return classIndex[ ( _size + 15 ) / 16 ]; }
+
+    /**
+     * @brief Blocks moved between a thread cache and its pool at once.
+     * @param _sizeClass   Index of the size class.
+     * @return Blocks per batch.
+     */
+    constexpr std::uint32_t batchSize( std::size_t _sizeClass ) noexcept { return static_cast<std::uint32_t>( std::max<std::size_t>( 4, 8192 / ( sizeClasses[ _sizeClass ] + headerSize ) ) ); }
+
+    /**
+     * @brief Use reserved or transparent huge pages for full slabs.
+     */
+    bool useHugePages = false; // NOSONAR set once before sqlite is initialized
+
+    /**
+     * @brief The FreeList struct.
+     * Blocks linked through their first bytes.
+     */
+    struct FreeList {
+
+      /** @brief Member for the first block. */
+      void *head = nullptr; // NOSONAR raw memory
+
+      /** @brief Member for the last block. */
+      void *tail = nullptr; // NOSONAR raw memory
+
+      /** @brief Member for the number of blocks. */
+      std::uint32_t count = 0;
+    };
+
+    /**
+     * @brief Add a block to the front of a list.
+     * @param _list   Free list.
+     * @param _block   Free block.
+     */
+    void push( FreeList &_list,
+               void *_block ) noexcept { // NOSONAR raw memory
+
+      *static_cast<void **>( _block ) = _list.head;
+      _list.head = _block;
+      if ( !_list.tail ) {
+
+        _list.tail = _block;
+      }
+      ++_list.count;
+    }
+
+    /**
+     * @brief Take the first block of a list.
+     * @param _list   Free list.
+     * @return Block or nullptr, if the list is empty.
+     */
+    void *pop( FreeList &_list ) noexcept { // NOSONAR raw memory
+
+      void *block = _list.head; // NOSONAR raw memory
+      if ( block ) {
+
+        _list.head = *static_cast<void **>( block );
+        if ( !_list.head ) {
+
+          _list.tail = nullptr;
+        }
+        --_list.count;
+      }
+      return block;
+    }
+
+    /**
+     * @brief Take the first blocks of a list.
+     * @param _list   Free list.
+     * @param _count   Blocks to take.
+     * @return Taken blocks.
+     */
+    FreeList take( FreeList &_list,
+                   std::uint32_t _count ) noexcept {
+
+      if ( _count >= _list.count ) {
+
+        return std::exchange( _list, {} );
+      }
+      FreeList taken { _list.head, _list.head, _count };
+      for ( std::uint32_t i = 1; i < _count; ++i ) {
+
+        taken.tail = *static_cast<void **>( taken.tail );
+      }
+      _list.head = *static_cast<void **>( taken.tail );
+      _list.count -= _count;
+      *static_cast<void **>( taken.tail ) = nullptr;
+      return taken;
+    }
+
+    /**
+     * @brief Move all blocks of a list to the front of another one.
+     * @param _list   Free list.
+     * @param _blocks   Blocks to add.
+     */
+    void splice( FreeList &_list,
+                 FreeList _blocks ) noexcept {
+
+      if ( _blocks.count == 0 ) {
+
+        return;
+      }
+      *static_cast<void **>( _blocks.tail ) = _list.head;
+      _list.head = _blocks.head;
+      if ( !_list.tail ) {
+
+        _list.tail = _blocks.tail;
+      }
+      _list.count += _blocks.count;
+    }
+
+    /**
+     * @brief The Counters struct.
+     * Counters of one thread - written only by that thread.
+     */
+    struct Counters {
+
+      /** @brief Member for the allocations. */
+      std::atomic<std::uint64_t> allocations { 0 };
+
+      /** @brief Member for the frees. */
+      std::atomic<std::uint64_t> frees { 0 };
+
+      /** @brief Member for the allocations served by the thread cache. */
+      std::atomic<std::uint64_t> threadCacheHits { 0 };
+
+      /** @brief Member for the allocations above memoryPoolMaxSize. */
+      std::atomic<std::uint64_t> largeAllocations { 0 };
+
+      /** @brief Member for the fetches of a cached page. */
+      std::atomic<std::uint64_t> pageHits { 0 };
+
+      /** @brief Member for the fetches that created a page. */
+      std::atomic<std::uint64_t> pageMisses { 0 };
+
+      /** @brief Member for the recycled pages. */
+      std::atomic<std::uint64_t> pageEvictions { 0 };
+    };
+
+    /**
+     * @brief Increment a counter.
+     * @param _counter   Counter to increment.
+     * @param _owned   Only the calling thread writes the counter - no read-modify-write needed.
+     */
+    void increment( std::atomic<std::uint64_t> &_counter,
+                    bool _owned ) noexcept {
+
+      if ( _owned ) {
+
+        _counter.store( _counter.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      }
+      else {
+
+        _counter.fetch_add( 1, std::memory_order_relaxed );
+      }
+    }
+
+    /**
+     * @brief The Pools class.
+     * Shared pools of the size classes and the counters of all threads.
+     */
+    class Pools {
+
+    public:
+      /**
+       * @brief Take blocks of a size class - the pool is refilled from malloc if empty.
+       * @param _sizeClass   Index of the size class.
+       * @param _count   Blocks to take.
+       * @return Blocks - empty, if out of memory.
+       */
+      FreeList refill( std::size_t _sizeClass,
+                       std::uint32_t _count ) noexcept {
+
+        Pool &pool = m_pools[ _sizeClass ];
+        const std::lock_guard lock( pool.mutex );
+        if ( pool.blocks.count == 0 ) {
+
+          auto *chunk = static_cast<std::uint8_t *>( std::malloc( chunkSize ) ); // NOSONAR pool memory
+          if ( !chunk ) {
+
+            return {};
+          }
+          const std::size_t stride = sizeClasses[ _sizeClass ] + headerSize;
+          for ( std::size_t offset = 0; offset + stride <= chunkSize; offset += stride ) {
+
+            push( pool.blocks, chunk + offset );
+          }
+          m_poolBytes.fetch_add( chunkSize, std::memory_order_relaxed );
+        }
+        return take( pool.blocks, _count );
+      }
+
+      /**
+       * @brief Return blocks to the pool of a size class.
+       * @param _sizeClass   Index of the size class.
+       * @param _blocks   Free blocks.
+       */
+      void release( std::size_t _sizeClass,
+                    FreeList _blocks ) noexcept {
+
+        Pool &pool = m_pools[ _sizeClass ];
+        const std::lock_guard lock( pool.mutex );
+        splice( pool.blocks, _blocks );
+      }
+
+      /**
+       * @brief Add the counters of a thread.
+       * @param _counters   Counters of the thread.
+       */
+      void attach( const Counters &_counters ) noexcept {
+
+        const std::lock_guard lock( m_threadsMutex );
+        try {
+
+          m_threads.push_back( &_counters );
+        }
+        catch ( const std::bad_alloc & ) {
+
+          /* The thread is not counted */
+        }
+      }
+
+      /**
+       * @brief Fold the counters of an ending thread into the retired counters.
+       * @param _counters   Counters of the thread.
+       */
+      void detach( const Counters &_counters ) noexcept {
+
+        const std::lock_guard lock( m_threadsMutex );
+        const auto iterator = std::find( std::begin( m_threads ), std::end( m_threads ), &_counters );
+        if ( iterator == std::end( m_threads ) ) {
+
+          return;
+        }
+        m_threads.erase( iterator );
+        m_retired.allocations.fetch_add( _counters.allocations.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        m_retired.frees.fetch_add( _counters.frees.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        m_retired.threadCacheHits.fetch_add( _counters.threadCacheHits.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        m_retired.largeAllocations.fetch_add( _counters.largeAllocations.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        m_retired.pageHits.fetch_add( _counters.pageHits.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        m_retired.pageMisses.fetch_add( _counters.pageMisses.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+        m_retired.pageEvictions.fetch_add( _counters.pageEvictions.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+      }
+
+      /**
+       * @brief Counters of ended threads - also used by threads without cache.
+       * @return Shared counters.
+       */
+      Counters &retired() noexcept { return m_retired; }
+
+      /**
+       * @brief Account a mapped or unmapped slab.
+       * @param _bytes   Bytes of the slab - negative for unmapped.
+       * @param _huge   Mapped with reserved huge pages.
+       */
+      void slab( std::int64_t _bytes,
+                 bool _huge ) noexcept {
+
+        m_slabBytes.fetch_add( static_cast<std::uint64_t>( _bytes ), std::memory_order_relaxed );
+        if ( _huge && _bytes > 0 ) {
+
+          m_hugePageSlabs.fetch_add( 1, std::memory_order_relaxed );
+        }
+      }
+
+      /**
+       * @brief Summed counters.
+       * @return Memory statistics.
+       */
+      MemoryStats stats() noexcept {
+
+        MemoryStats stats {};
+        const auto add = [ &stats ]( const Counters &_counters ) {
+          stats.allocations += _counters.allocations.load( std::memory_order_relaxed );
+          stats.frees += _counters.frees.load( std::memory_order_relaxed );
+          stats.threadCacheHits += _counters.threadCacheHits.load( std::memory_order_relaxed );
+          stats.largeAllocations += _counters.largeAllocations.load( std::memory_order_relaxed );
+          stats.pageHits += _counters.pageHits.load( std::memory_order_relaxed );
+          stats.pageMisses += _counters.pageMisses.load( std::memory_order_relaxed );
+          stats.pageEvictions += _counters.pageEvictions.load( std::memory_order_relaxed );
+        };
+
+        const std::lock_guard lock( m_threadsMutex );
+        add( m_retired );
+        for ( const Counters *counters : m_threads ) {
+
+          add( *counters );
+        }
+        stats.poolBytes = m_poolBytes.load( std::memory_order_relaxed );
+        stats.slabBytes = m_slabBytes.load( std::memory_order_relaxed );
+        stats.hugePageSlabs = m_hugePageSlabs.load( std::memory_order_relaxed );
+        return stats;
+      }
+
+    private:
+      /**
+       * @brief The Pool struct.
+       */
+      struct Pool {
+
+        /** @brief Member for guarding the blocks. */
+        std::mutex mutex {};
+
+        /** @brief Member for the free blocks. */
+        FreeList blocks {};
+      };
+
+      /**
+       * @brief Member for the pools of the size classes.
+       */
+      std::array<Pool, sizeClasses.size()> m_pools {};
+
+      /**
+       * @brief Member for the bytes taken from malloc.
+       */
+      std::atomic<std::uint64_t> m_poolBytes { 0 };
+
+      /**
+       * @brief Member for the bytes of mapped slabs.
+       */
+      std::atomic<std::uint64_t> m_slabBytes { 0 };
+
+      /**
+       * @brief Member for the slabs with reserved huge pages.
+       */
+      std::atomic<std::uint64_t> m_hugePageSlabs { 0 };
+
+      /**
+       * @brief Member for guarding the counters of the threads.
+       */
+      std::mutex m_threadsMutex {};
+
+      /**
+       * @brief Member for the counters of the running threads.
+       */
+      std::vector<const Counters *> m_threads {};
+
+      /**
+       * @brief Member for the counters of the ended threads.
+       */
+      Counters m_retired {};
+    };
+
+    /**
+     * @brief Shared pools - never destroyed, sqlite may free memory after static destruction.
+     * @return Pools.
+     */
+    Pools &pools() noexcept {
+
+      static Pools *instance = new Pools(); // NOSONAR intentionally leaked
+      return *instance;
+    }
+
+    /**
+     * @brief The thread cache of the calling thread has been destroyed.
+     */
+    thread_local bool threadExited = false; // NOSONAR trivially destructible flag
+
+    /**
+     * @brief The ThreadCache struct.
+     * Free blocks of every size class for one thread - no locking.
+     */
+    struct ThreadCache {
+
+      /**
+       * @brief Constructor for ThreadCache.
+       */
+      ThreadCache() noexcept { pools().attach( counters ); }
+
+      /**
+       * @brief Delete copy constructor for ThreadCache.
+       */
+      ThreadCache( const ThreadCache & ) = delete;
+
+      /**
+       * @brief Delete move constructor for ThreadCache.
+       */
+      ThreadCache( ThreadCache && ) = delete;
+
+      /**
+       * @brief Destructor for ThreadCache - returns the free blocks to the pools.
+       */
+      ~ThreadCache() {
+
+        for ( std::size_t sizeClass = 0; sizeClass < lists.size(); ++sizeClass ) {
+
+          pools().release( sizeClass, std::exchange( lists[ sizeClass ], {} ) );
+        }
+        pools().detach( counters );
+        threadExited = true;
+      }
+
+      /**
+       * @brief Delete copy assign operator.
+       * @return Nothing.
+       */
+      ThreadCache &operator=( const ThreadCache & ) = delete;
+
+      /**
+       * @brief Delete move assign operator.
+       * @return Nothing.
+       */
+      ThreadCache &operator=( ThreadCache && ) = delete;
+
+      /** @brief Member for the free blocks by size class. */
+      std::array<FreeList, sizeClasses.size()> lists {};
+
+      /** @brief Member for the counters of the thread. */
+      Counters counters {};
+    };
+
+    /**
+     * @brief Cache of the calling thread.
+     * @return Thread cache or nullptr, if the thread is ending.
+     */
+    ThreadCache *threadCache() noexcept {
+
+      if ( threadExited ) {
+
+        return nullptr;
+      }
+      thread_local ThreadCache cache {};
+      return &cache;
+    }
+
+    /**
+     * @brief Counters of the calling thread.
+     * @param _cache   Thread cache or nullptr.
+     * @return Counters of the thread or the shared counters.
+     */
+    Counters &counters( ThreadCache *_cache ) noexcept { return _cache ? _cache->counters : pools().retired(); }
+
+    /*
+     * SQLITE_CONFIG_MALLOC
+     */
+    void *poolMalloc( std::int32_t _size ) noexcept { // NOSONAR sqlite api
+
+      ThreadCache *cache = threadCache();
+      increment( counters( cache ).allocations, cache );
+
+      const std::size_t size = _size > 0 ? static_cast<std::size_t>( _size ) : 1;
+      if ( size > memoryPoolMaxSize ) {
+
+        auto *block = static_cast<std::uint64_t *>( std::malloc( size + headerSize ) ); // NOSONAR sqlite memory
+        if ( !block ) {
+
+          return nullptr;
+        }
+        increment( counters( cache ).largeAllocations, cache );
+        *block = ( static_cast<std::uint64_t>( size ) << 8 ) | largeTag;
+        return block + 1;
+      }
+
+      const std::size_t index = sizeClass( size );
+      void *block = nullptr; // NOSONAR raw memory
+      if ( cache ) {
+
+        FreeList &list = cache->lists[ index ];
+        if ( list.count > 0 ) {
+
+          increment( cache->counters.threadCacheHits, true );
+        }
+        else {
+
+          list = pools().refill( index, batchSize( index ) );
+        }
+        block = pop( list );
+      }
+      else {
+
+        FreeList single = pools().refill( index, 1 );
+        block = pop( single );
+      }
+      if ( !block ) {
+
+        return nullptr;
+      }
+      *static_cast<std::uint64_t *>( block ) = index;
+      return static_cast<std::uint8_t *>( block ) + headerSize;
+    }
+
+    void poolFree( void *_memory ) noexcept { // NOSONAR sqlite api
+
+      if ( !_memory ) {
+
+        return;
+      }
+      ThreadCache *cache = threadCache();
+      increment( counters( cache ).frees, cache );
+
+      auto *block = static_cast<std::uint64_t *>( _memory ) - 1;
+      if ( ( *block & largeTag ) == largeTag ) {
+
+        std::free( block ); // NOSONAR sqlite memory
+        return;
+      }
+
+      const std::size_t index = *block;
+      if ( !cache ) {
+
+        FreeList single {};
+        push( single, block );
+        pools().release( index, single );
+        return;
+      }
+      FreeList &list = cache->lists[ index ];
+      push( list, block );
+      if ( list.count >= 2 * batchSize( index ) ) {
+
+        pools().release( index, take( list, batchSize( index ) ) );
+      }
+    }
+
+    std::int32_t poolSize( void *_memory ) noexcept { // NOSONAR sqlite api
+
+      if ( !_memory ) {
+
+        return 0;
+      }
+      const std::uint64_t header = *( static_cast<std::uint64_t *>( _memory ) - 1 );
+      return static_cast<std::int32_t>( ( header & largeTag ) == largeTag ? header >> 8 : sizeClasses[ header ] );
+    }
+
+    void *poolRealloc( void *_memory, // NOSONAR sqlite api
+                       std::int32_t _size ) noexcept {
+
+      const std::int32_t oldSize = poolSize( _memory );
+      const bool small = oldSize <= static_cast<std::int32_t>( memoryPoolMaxSize );
+      if ( small && _size > 0 && _size <= oldSize && sizeClass( static_cast<std::size_t>( _size ) ) == sizeClass( static_cast<std::size_t>( oldSize ) ) ) {
+
+        return _memory;
+      }
+      if ( !small && _size > static_cast<std::int32_t>( memoryPoolMaxSize ) ) {
+
+        /* Large to large - the system allocator may resize in place or remap */
+        auto *block = static_cast<std::uint64_t *>( std::realloc( static_cast<std::uint64_t *>( _memory ) - 1, static_cast<std::size_t>( _size ) + headerSize ) ); // NOSONAR sqlite memory
+        if ( !block ) {
+
+          return nullptr;
+        }
+        *block = ( static_cast<std::uint64_t>( _size ) << 8 ) | largeTag;
+        return block + 1;
+      }
+      void *memory = poolMalloc( _size ); // NOSONAR sqlite api
+      if ( !memory ) {
+
+        return nullptr;
+      }
+      std::memcpy( memory, _memory, static_cast<std::size_t>( std::min( oldSize, _size ) ) );
+      poolFree( _memory );
+      return memory;
+    }
+
+    std::int32_t poolRoundup( std::int32_t _size ) noexcept {
+
+      if ( _size <= 0 || _size > static_cast<std::int32_t>( memoryPoolMaxSize ) ) {
+
+        return ( _size + 7 ) & ~7;
+      }
+      return static_cast<std::int32_t>( sizeClasses[ sizeClass( static_cast<std::size_t>( _size ) ) ] );
+    }
+
+    std::int32_t poolInit( void * ) noexcept { return SQLITE_OK; } // NOSONAR sqlite api
+
+    void poolShutdown( void * ) noexcept {} // NOSONAR sqlite api
+
+    /**
+     * @brief Allocator of sqlite.
+     */
+    const sqlite3_mem_methods poolMethods = {
+      poolMalloc,
+      poolFree,
+      poolRealloc,
+      poolSize,
+      poolRoundup,
+      poolInit,
+      poolShutdown,
+      nullptr
+    };
+
+    /**
+     * @brief Map memory for a slab.
+     * @param _size   Bytes of the slab.
+     * @param _huge   Mapped with reserved huge pages.
+     * @return Memory or nullptr.
+     */
+    std::uint8_t *mapSlab( std::size_t _size,
+                           bool &_huge ) noexcept {
+
+      _huge = false;
+#ifdef _WIN32
+      return static_cast<std::uint8_t *>( VirtualAlloc( nullptr, _size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) );
+#else
+      const bool full = useHugePages && _size == pageCacheSlabSize;
+  #ifdef MAP_HUGETLB
+      if ( full ) {
+
+        if ( void *memory = mmap( nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 ); memory != MAP_FAILED ) { // NOSONAR mmap api
+
+          _huge = true;
+          return static_cast<std::uint8_t *>( memory );
+        }
+      }
+  #endif
+      void *memory = mmap( nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ); // NOSONAR mmap api
+      if ( memory == MAP_FAILED ) {
+
+        return nullptr;
+      }
+  #ifdef MADV_HUGEPAGE
+      if ( full ) {
+
+        madvise( memory, _size, MADV_HUGEPAGE );
+      }
+  #endif
+      return static_cast<std::uint8_t *>( memory );
+#endif
+    }
+
+    /**
+     * @brief Unmap a slab.
+     * @param _memory   Memory of the slab.
+     * @param _size   Bytes of the slab.
+     */
+    void unmapSlab( std::uint8_t *_memory,
+                    std::size_t _size ) noexcept {
+
+#ifdef _WIN32
+      std::ignore = _size;
+      VirtualFree( _memory, 0, MEM_RELEASE );
+#else
+      munmap( _memory, _size );
+#endif
+    }
+
+    /**
+     * @brief The PageEntry struct.
+     * Behind the page buffer and the extra bytes of sqlite in a slab.
+     */
+    struct PageEntry {
+
+      /** @brief Base class - needs to be the first member. */
+      sqlite3_pcache_page page;
+
+      /** @brief Member for the next entry of a hash bucket or the free list. */
+      PageEntry *next;
+
+      /** @brief Member for the previous unpinned entry. */
+      PageEntry *lruPrev;
+
+      /** @brief Member for the next unpinned entry. */
+      PageEntry *lruNext;
+
+      /** @brief Member for the page number. */
+      std::uint32_t key;
+
+      /** @brief Member for the page is in use by sqlite. */
+      bool pinned;
+    };
+
+    /**
+     * @brief The Slab struct.
+     */
+    struct Slab {
+
+      /** @brief Member for the mapped memory. */
+      std::uint8_t *memory = nullptr;
+
+      /** @brief Member for the mapped bytes. */
+      std::size_t size = 0;
+    };
+
+    /**
+     * @brief The PageCache class.
+     * Page cache of one pager - sqlite serializes the calls.
+     */
+    class PageCache {
+
+    public:
+      /**
+       * @brief Constructor for PageCache.
+       * @param _pageSize   Bytes of a page.
+       * @param _extraSize   Extra bytes of sqlite per page.
+       * @param _purgeable   Unpinned pages may be recycled.
+       */
+      PageCache( std::size_t _pageSize,
+                 std::size_t _extraSize,
+                 bool _purgeable ) noexcept
+        : m_pageSize( _pageSize ),
+          m_extraSize( _extraSize ),
+          m_headerOffset( ( _pageSize + _extraSize + alignof( PageEntry ) - 1 ) / alignof( PageEntry ) * alignof( PageEntry ) ),
+          m_stride( ( m_headerOffset + sizeof( PageEntry ) + 63 ) / 64 * 64 ),
+          m_purgeable( _purgeable ) {
+
+        m_lru.lruPrev = &m_lru;
+        m_lru.lruNext = &m_lru;
+      }
+
+      /**
+       * @brief Delete copy constructor for PageCache.
+       */
+      PageCache( const PageCache & ) = delete;
+
+      /**
+       * @brief Delete move constructor for PageCache.
+       */
+      PageCache( PageCache && ) = delete;
+
+      /**
+       * @brief Destructor for PageCache - unmaps the slabs.
+       */
+      ~PageCache() { releaseSlabs(); }
+
+      /**
+       * @brief Delete copy assign operator.
+       * @return Nothing.
+       */
+      PageCache &operator=( const PageCache & ) = delete;
+
+      /**
+       * @brief Delete move assign operator.
+       * @return Nothing.
+       */
+      PageCache &operator=( PageCache && ) = delete;
+
+      /**
+       * @brief Set the maximum number of pages of a purgeable cache.
+       * @param _capacity   Maximum number of pages.
+       */
+      void capacity( std::uint32_t _capacity ) noexcept {
+
+        m_capacity = _capacity;
+        while ( m_purgeable && m_count > m_capacity && m_lru.lruPrev != &m_lru ) {
+
+          discard( m_lru.lruPrev );
+        }
+      }
+
+      /**
+       * @brief Pinned and unpinned pages.
+       * @return Number of pages.
+       */
+      [[nodiscard]] std::uint32_t pageCount() const noexcept { return m_count; }
+
+      /**
+       * @brief Fetch a page and pin it.
+       * @param _key   Page number.
+       * @param _create   0 - do not create, 1 - create if cheap, 2 - create if possible.
+       * @return Page or nullptr.
+       */
+      sqlite3_pcache_page *fetch( std::uint32_t _key,
+                                  std::int32_t _create ) noexcept {
+
+        ThreadCache *cache = threadCache();
+        if ( PageEntry *entry = find( _key ); entry ) {
+
+          if ( !entry->pinned ) {
+
+            unlink( entry );
+            entry->pinned = true;
+          }
+          increment( counters( cache ).pageHits, cache );
+          return &entry->page;
+        }
+        if ( _create == 0 ) {
+
+          return nullptr;
+        }
+
+        PageEntry *entry = nullptr;
+        if ( m_purgeable && m_count >= m_capacity ) {
+
+          if ( m_lru.lruPrev != &m_lru ) {
+
+            /* Recycle the least recently used page */
+            entry = m_lru.lruPrev;
+            unlink( entry );
+            remove( entry );
+            increment( counters( cache ).pageEvictions, cache );
+          }
+          else if ( _create == 1 ) {
+
+            return nullptr;
+          }
+        }
+        if ( !entry ) {
+
+          entry = allocate();
+          if ( !entry ) {
+
+            return nullptr;
+          }
+        }
+        increment( counters( cache ).pageMisses, cache );
+
+        /* Sqlite expects the extra bytes of new pages to be zeroed */
+        std::memset( entry->page.pExtra, 0, m_extraSize );
+        entry->key = _key;
+        entry->pinned = true;
+        insert( entry );
+        return &entry->page;
+      }
+
+      /**
+       * @brief Unpin a page.
+       * @param _page   Page to unpin.
+       * @param _discard   Drop the page from the cache.
+       */
+      void unpin( sqlite3_pcache_page *_page,
+                  bool _discard ) noexcept {
+
+        auto *entry = reinterpret_cast<PageEntry *>( _page ); // NOSONAR sqlite3_pcache_page is the first member
+        entry->pinned = false;
+        if ( _discard || ( m_purgeable && m_count > m_capacity ) ) {
+
+          remove( entry );
+          release( entry );
+          return;
+        }
+
+        /* Most recently used at the front */
+        entry->lruNext = m_lru.lruNext;
+        entry->lruPrev = &m_lru;
+        m_lru.lruNext->lruPrev = entry;
+        m_lru.lruNext = entry;
+      }
+
+      /**
+       * @brief Change the page number of a page.
+       * @param _page   Page to change.
+       * @param _key   New page number.
+       */
+      void rekey( sqlite3_pcache_page *_page,
+                  std::uint32_t _key ) noexcept {
+
+        auto *entry = reinterpret_cast<PageEntry *>( _page ); // NOSONAR sqlite3_pcache_page is the first member
+        if ( PageEntry *other = find( _key ); other && other != entry ) {
+
+          discard( other );
+        }
+        remove( entry );
+        entry->key = _key;
+        insert( entry );
+      }
+
+      /**
+       * @brief Drop the pages from a page number on.
+       * @param _limit   First page number to drop.
+       */
+      void truncate( std::uint32_t _limit ) noexcept {
+
+        for ( PageEntry *&bucket : m_buckets ) {
+
+          PageEntry *entry = bucket;
+          while ( entry ) {
+
+            PageEntry *next = entry->next;
+            if ( entry->key >= _limit ) {
+
+              discard( entry );
+            }
+            entry = next;
+          }
+        }
+      }
+
+      /**
+       * @brief Drop every unpinned page and unmap the slabs of an empty cache.
+       */
+      void shrink() noexcept {
+
+        while ( m_lru.lruPrev != &m_lru ) {
+
+          discard( m_lru.lruPrev );
+        }
+        if ( m_count == 0 ) {
+
+          releaseSlabs();
+        }
+      }
+
+    private:
+      /**
+       * @brief Find a page.
+       * @param _key   Page number.
+       * @return Page or nullptr.
+       */
+      PageEntry *find( std::uint32_t _key ) const noexcept {
+
+        if ( m_buckets.empty() ) {
+
+          return nullptr;
+        }
+        PageEntry *entry = m_buckets[ _key & ( m_buckets.size() - 1 ) ];
+        while ( entry && entry->key != _key ) {
+
+          entry = entry->next;
+        }
+        return entry;
+      }
+
+      /**
+       * @brief Add a page to the hash table - grows the table at one page per bucket.
+       * @param _entry   Page to add.
+       */
+      void insert( PageEntry *_entry ) noexcept {
+
+        if ( m_count >= m_buckets.size() ) {
+
+          try {
+
+            std::vector<PageEntry *> buckets( std::max<std::size_t>( 64, m_buckets.size() * 2 ), nullptr );
+            for ( PageEntry *entry : m_buckets ) {
+
+              while ( entry ) {
+
+                PageEntry *next = entry->next;
+                PageEntry *&bucket = buckets[ entry->key & ( buckets.size() - 1 ) ];
+                entry->next = bucket;
+                bucket = entry;
+                entry = next;
+              }
+            }
+            m_buckets = std::move( buckets );
+          }
+          catch ( const std::bad_alloc & ) {
+
+            /* Longer chains in the current table */
+          }
+        }
+        PageEntry *&bucket = m_buckets[ _entry->key & ( m_buckets.size() - 1 ) ];
+        _entry->next = bucket;
+        bucket = _entry;
+        ++m_count;
+      }
+
+      /**
+       * @brief Remove a page from the hash table.
+       * @param _entry   Page to remove.
+       */
+      void remove( PageEntry *_entry ) noexcept {
+
+        PageEntry **link = &m_buckets[ _entry->key & ( m_buckets.size() - 1 ) ];
+        while ( *link != _entry ) {
+
+          link = &( *link )->next;
+        }
+        *link = _entry->next;
+        --m_count;
+      }
+
+      /**
+       * @brief Remove a page from the unpinned pages.
+       * @param _entry   Unpinned page.
+       */
+      static void unlink( PageEntry *_entry ) noexcept {
+
+        _entry->lruPrev->lruNext = _entry->lruNext;
+        _entry->lruNext->lruPrev = _entry->lruPrev;
+      }
+
+      /**
+       * @brief Drop a page from the cache.
+       * @param _entry   Page to drop.
+       */
+      void discard( PageEntry *_entry ) noexcept {
+
+        if ( !_entry->pinned ) {
+
+          unlink( _entry );
+        }
+        remove( _entry );
+        release( _entry );
+      }
+
+      /**
+       * @brief Take a free entry - maps the next slab if needed.
+       * @return Entry or nullptr.
+       */
+      PageEntry *allocate() noexcept {
+
+        if ( !m_free ) {
+
+          std::size_t size = std::min( m_slabEntries * m_stride, pageCacheSlabSize );
+          size = std::max( ( size + 4095 ) / 4096 * 4096, ( m_stride + 4095 ) / 4096 * 4096 );
+          bool huge = false;
+          std::uint8_t *memory = mapSlab( size, huge );
+          if ( !memory ) {
+
+            return nullptr;
+          }
+          try {
+
+            m_slabs.push_back( { memory, size } );
+          }
+          catch ( const std::bad_alloc & ) {
+
+            unmapSlab( memory, size );
+            return nullptr;
+          }
+          pools().slab( static_cast<std::int64_t>( size ), huge );
+          m_slabEntries *= 2;
+
+          for ( std::size_t offset = 0; offset + m_stride <= size; offset += m_stride ) {
+
+            auto *entry = reinterpret_cast<PageEntry *>( memory + offset + m_headerOffset ); // NOSONAR slab layout
+            entry->page.pBuf = memory + offset;
+            entry->page.pExtra = memory + offset + m_pageSize;
+            release( entry );
+          }
+        }
+        PageEntry *entry = m_free;
+        m_free = entry->next;
+        return entry;
+      }
+
+      /**
+       * @brief Return an entry to the free entries.
+       * @param _entry   Entry of a slab.
+       */
+      void release( PageEntry *_entry ) noexcept {
+
+        _entry->next = m_free;
+        m_free = _entry;
+      }
+
+      /**
+       * @brief Unmap every slab.
+       */
+      void releaseSlabs() noexcept {
+
+        for ( const Slab &slab : m_slabs ) {
+
+          unmapSlab( slab.memory, slab.size );
+          pools().slab( -static_cast<std::int64_t>( slab.size ), false );
+        }
+        m_slabs.clear();
+        m_free = nullptr;
+        m_slabEntries = firstSlabEntries;
+      }
+
+      /**
+       * @brief Member for the bytes of a page.
+       */
+      std::size_t m_pageSize = 0;
+
+      /**
+       * @brief Member for the extra bytes of sqlite per page.
+       */
+      std::size_t m_extraSize = 0;
+
+      /**
+       * @brief Member for the offset of the entry behind page and extra bytes.
+       */
+      std::size_t m_headerOffset = 0;
+
+      /**
+       * @brief Member for the bytes per page in a slab - a multiple of the cache line.
+       */
+      std::size_t m_stride = 0;
+
+      /**
+       * @brief Member for recycling unpinned pages.
+       */
+      bool m_purgeable = true;
+
+      /**
+       * @brief Member for the maximum number of pages.
+       */
+      std::uint32_t m_capacity = 0;
+
+      /**
+       * @brief Member for the number of pages.
+       */
+      std::uint32_t m_count = 0;
+
+      /**
+       * @brief Member for the entries of the next slab.
+       */
+      std::size_t m_slabEntries = firstSlabEntries;
+
+      /**
+       * @brief Member for the mapped slabs.
+       */
+      std::vector<Slab> m_slabs {};
+
+      /**
+       * @brief Member for the free entries.
+       */
+      PageEntry *m_free = nullptr;
+
+      /**
+       * @brief Member for the hash buckets - a power of two.
+       */
+      std::vector<PageEntry *> m_buckets {};
+
+      /**
+       * @brief Member for the sentinel of the unpinned pages - most recently used first.
+       */
+      PageEntry m_lru {};
+    };
+
+    /**
+     * @brief Page cache of a sqlite handle.
+     * @param _cache   Sqlite page cache.
+     * @return Page cache.
+     */
+    PageCache *pageCache( sqlite3_pcache *_cache ) noexcept { return reinterpret_cast<PageCache *>( _cache ); } // NOSONAR opaque sqlite handle
+
+    /*
+     * SQLITE_CONFIG_PCACHE2
+     */
+    std::int32_t pageCacheInit( void * ) noexcept { return SQLITE_OK; } // NOSONAR sqlite api
+
+    void pageCacheShutdown( void * ) noexcept {} // NOSONAR sqlite api
+
+    sqlite3_pcache *pageCacheCreate( std::int32_t _pageSize,
+                                     std::int32_t _extraSize,
+                                     std::int32_t _purgeable ) noexcept {
+
+      auto *cache = new ( std::nothrow ) PageCache( static_cast<std::size_t>( _pageSize ), static_cast<std::size_t>( _extraSize ), _purgeable != 0 ); // NOSONAR owned by sqlite
+      return reinterpret_cast<sqlite3_pcache *>( cache ); // NOSONAR opaque sqlite handle
+    }
+
+    void pageCacheCachesize( sqlite3_pcache *_cache,
+                             std::int32_t _pages ) noexcept {
+
+      pageCache( _cache )->capacity( static_cast<std::uint32_t>( std::max( _pages, 0 ) ) );
+    }
+
+    std::int32_t pageCachePagecount( sqlite3_pcache *_cache ) noexcept { return static_cast<std::int32_t>( pageCache( _cache )->pageCount() ); }
+
+    sqlite3_pcache_page *pageCacheFetch( sqlite3_pcache *_cache,
+                                         std::uint32_t _key,
+                                         std::int32_t _create ) noexcept {
+
+      return pageCache( _cache )->fetch( _key, _create );
+    }
+
+    void pageCacheUnpin( sqlite3_pcache *_cache,
+                         sqlite3_pcache_page *_page,
+                         std::int32_t _discard ) noexcept {
+
+      pageCache( _cache )->unpin( _page, _discard != 0 );
+    }
+
+    void pageCacheRekey( sqlite3_pcache *_cache,
+                         sqlite3_pcache_page *_page,
+                         std::uint32_t,
+                         std::uint32_t _key ) noexcept {
+
+      pageCache( _cache )->rekey( _page, _key );
+    }
+
+    void pageCacheTruncate( sqlite3_pcache *_cache,
+                            std::uint32_t _limit ) noexcept {
+
+      pageCache( _cache )->truncate( _limit );
+    }
+
+    void pageCacheDestroy( sqlite3_pcache *_cache ) noexcept {
+
+      delete pageCache( _cache ); // NOSONAR owned by sqlite
+    }
+
+    void pageCacheShrink( sqlite3_pcache *_cache ) noexcept {
+
+      pageCache( _cache )->shrink();
+    }
+
+    /**
+     * @brief Page cache of sqlite.
+     */
+    const sqlite3_pcache_methods2 pageCacheMethods = {
+      1,
+      nullptr,
+      pageCacheInit,
+      pageCacheShutdown,
+      pageCacheCreate,
+      pageCacheCachesize,
+      pageCachePagecount,
+      pageCacheFetch,
+      pageCacheUnpin,
+      pageCacheRekey,
+      pageCacheTruncate,
+      pageCacheDestroy,
+      pageCacheShrink
+    };
+  }
+
+  std::error_code initializeMemory( const MemoryOptions &_options ) {
+
+    static std::mutex mutex {};
+    const std::lock_guard lock( mutex );
+
+    /* sqlite3_config fails once sqlite is initialized */
+    if ( const std::int32_t resultCode = sqlite3_config( SQLITE_CONFIG_MEMSTATUS, _options.memoryStatus ? 1 : 0 ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, "Memory needs to be initialized before sqlite." );
+    }
+    useHugePages = _options.hugePages;
+    if ( _options.pools ) {
+
+      if ( const std::int32_t resultCode = sqlite3_config( SQLITE_CONFIG_MALLOC, &poolMethods ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode );
+      }
+    }
+    if ( _options.pageCache ) {
+
+      if ( const std::int32_t resultCode = sqlite3_config( SQLITE_CONFIG_PCACHE2, &pageCacheMethods ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode );
+      }
+    }
+    if ( const std::int32_t resultCode = sqlite3_initialize(); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode );
+    }
+    return {};
+  }
+
+  MemoryStats memoryStats() { return pools().stats(); }
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+/* stl header */
+#include <system_error>
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Largest allocation served by the size-class pools - larger ones go to malloc.
+   */
+  constexpr std::size_t memoryPoolMaxSize = 4096;
+
+  /**
+   * @brief Size of a full page cache slab - the size of a huge page.
+   */
+  constexpr std::size_t pageCacheSlabSize = 2 * 1024 * 1024;
+
+  /**
+   * @brief The MemoryOptions struct.
+   */
+  struct MemoryOptions {
+
+    /**
+     * @brief Member for the size-class pools with per-thread caches as sqlite allocator (SQLITE_CONFIG_MALLOC).
+     */
+    bool pools = true;
+
+    /**
+     * @brief Member for the slab page cache (SQLITE_CONFIG_PCACHE2).
+     */
+    bool pageCache = true;
+
+    /**
+     * @brief Member for backing full slabs with huge pages.
+     * Reserved huge pages are used first, transparent huge pages otherwise.
+     */
+    bool hugePages = false;
+
+    /**
+     * @brief Member for the memory statistics of sqlite (SQLITE_CONFIG_MEMSTATUS).
+     * Sqlite serializes every allocation with a mutex for them - sqlite3_status reports no memory without.
+     */
+    bool memoryStatus = true;
+  };
+
+  /**
+   * @brief The MemoryStats struct.
+   * Counters since initializeMemory.
+   */
+  struct MemoryStats {
+
+    /**
+     * @brief Member for the allocations of sqlite.
+     */
+    std::uint64_t allocations = 0;
+
+    /**
+     * @brief Member for the frees of sqlite.
+     */
+    std::uint64_t frees = 0;
+
+    /**
+     * @brief Member for the allocations served by the cache of the calling thread.
+     */
+    std::uint64_t threadCacheHits = 0;
+
+    /**
+     * @brief Member for the allocations above memoryPoolMaxSize.
+     */
+    std::uint64_t largeAllocations = 0;
+
+    /**
+     * @brief Member for the bytes reserved by the size-class pools - never returned to the system.
+     */
+    std::uint64_t poolBytes = 0;
+
+    /**
+     * @brief Member for the fetches of a cached page.
+     */
+    std::uint64_t pageHits = 0;
+
+    /**
+     * @brief Member for the fetches that created a page.
+     */
+    std::uint64_t pageMisses = 0;
+
+    /**
+     * @brief Member for the unpinned pages recycled for other pages.
+     */
+    std::uint64_t pageEvictions = 0;
+
+    /**
+     * @brief Member for the bytes mapped by page cache slabs.
+     */
+    std::uint64_t slabBytes = 0;
+
+    /**
+     * @brief Member for the slabs mapped with reserved huge pages.
+     */
+    std::uint64_t hugePageSlabs = 0;
+  };
+
+  /**
+   * @brief Install the size-class pools and the slab page cache.
+   * Needs to be called before sqlite is initialized - before the first sqlite3_make_unique.
+   * @param _options   Memory options.
+   * @return Result code and message of operation.
+   */
+  std::error_code initializeMemory( const MemoryOptions &_options = {} );
+
+  /**
+   * @brief Allocation statistics of the pools and the page cache.
+   * @return Summed counters of all threads.
+   */
+  [[nodiscard]] MemoryStats memoryStats();
+}
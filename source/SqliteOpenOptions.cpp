@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* stl header */
+#include <chrono>
+
+/* local header */
+#include "SqliteOpenOptions.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Memory-mapped I/O of the presets - 256 MiB.
+     */
+    constexpr std::int64_t presetMmapSize = std::int64_t { 256 } * 1024 * 1024;
+
+    /**
+     * @brief Page cache of the bulk load preset - 256 MiB in KiB.
+     */
+    constexpr std::int64_t bulkLoadCacheSize = -262144;
+
+    /**
+     * @brief Page cache of the read replica and OLTP presets - 64 MiB in KiB.
+     */
+    constexpr std::int64_t presetCacheSize = -65536;
+
+    /**
+     * @brief Lookaside slot size of the OLTP preset.
+     */
+    constexpr std::int32_t oltpLookasideSlotSize = 1200;
+
+    /**
+     * @brief Lookaside slots of the OLTP preset.
+     */
+    constexpr std::int32_t oltpLookasideSlots = 500;
+
+    /**
+     * @brief Busy timeout of the presets.
+     */
+    constexpr std::chrono::milliseconds presetBusyTimeout { 5000 };
+  }
+
+  OpenOptions openOptions( Profile _profile ) {
+
+    OpenOptions options {};
+    options.tempStore = TempStore::Memory;
+    options.busyTimeout = presetBusyTimeout;
+    switch ( _profile ) {
+
+      case Profile::BulkLoad:
+        options.noMutex = true;
+        options.journalMode = JournalMode::Memory;
+        options.synchronous = Synchronous::Off;
+        options.cacheSize = bulkLoadCacheSize;
+        break;
+      case Profile::ReadReplica:
+        options.readOnly = true;
+        options.noMutex = true;
+        options.mmapSize = presetMmapSize;
+        options.cacheSize = presetCacheSize;
+        break;
+      case Profile::Oltp:
+        options.journalMode = JournalMode::Wal;
+        options.synchronous = Synchronous::Normal;
+        options.mmapSize = presetMmapSize;
+        options.cacheSize = presetCacheSize;
+        options.lookasideSlotSize = oltpLookasideSlotSize;
+        options.lookasideSlots = oltpLookasideSlots;
+        break;
+    }
+    return options;
+  }
+}
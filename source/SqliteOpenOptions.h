@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* stl header */
+#include <chrono>
+#include <optional>
+#include <string>
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The JournalMode enum.
+   */
+  enum class JournalMode {
+
+    Default,  /**< Keep the journal mode of the database. */
+    Delete,   /**< Delete the rollback journal after each transaction. */
+    Truncate, /**< Truncate the rollback journal after each transaction. */
+    Persist,  /**< Keep the rollback journal and overwrite its header. */
+    Memory,   /**< Keep the rollback journal in memory. */
+    Wal,      /**< Write-ahead log. */
+    Off       /**< No journal - no rollback on crash. */
+  };
+
+  /**
+   * @brief The Synchronous enum.
+   */
+  enum class Synchronous {
+
+    Default, /**< Keep the compiled in default. */
+    Off,     /**< Hand writes to the os without sync. */
+    Normal,  /**< Sync at critical moments - durable enough with WAL. */
+    Full,    /**< Sync on every commit. */
+    Extra    /**< Sync the directory of the journal too. */
+  };
+
+  /**
+   * @brief The TempStore enum.
+   */
+  enum class TempStore {
+
+    Default, /**< Keep the compiled in default. */
+    File,    /**< Temporary tables and indices in files. */
+    Memory   /**< Temporary tables and indices in memory. */
+  };
+
+  /**
+   * @brief The Profile enum.
+   */
+  enum class Profile {
+
+    BulkLoad,    /**< Single writer loading lots of data - durability is traded for speed. */
+    ReadReplica, /**< Read-only connection with a large page cache and memory-mapped I/O. */
+    Oltp         /**< Many small transactions with WAL and synchronous normal. */
+  };
+
+  /**
+   * @brief The OpenOptions struct.
+   * Unset settings keep the defaults of sqlite.
+   */
+  struct OpenOptions {
+
+    /**
+     * @brief Member for opening the database read-only.
+     */
+    bool readOnly = false;
+
+    /**
+     * @brief Member for creating a missing database - ignored for read-only.
+     */
+    bool create = true;
+
+    /**
+     * @brief Member for interpreting the filename as uri.
+     */
+    bool uri = false;
+
+    /**
+     * @brief Member for the multi-thread mode of the connection (SQLITE_OPEN_NOMUTEX).
+     * The connection must not be used by two threads at the same time.
+     */
+    bool noMutex = false;
+
+    /**
+     * @brief Member for the name of the vfs - empty is the default vfs.
+     */
+    std::string vfs {};
+
+    /**
+     * @brief Member for the journal mode.
+     */
+    JournalMode journalMode = JournalMode::Default;
+
+    /**
+     * @brief Member for the synchronous setting.
+     */
+    Synchronous synchronous = Synchronous::Default;
+
+    /**
+     * @brief Member for the storage of temporary tables.
+     */
+    TempStore tempStore = TempStore::Default;
+
+    /**
+     * @brief Member for the maximum size of memory-mapped I/O in bytes.
+     */
+    std::optional<std::int64_t> mmapSize {};
+
+    /**
+     * @brief Member for the page cache size - positive in pages, negative in KiB.
+     */
+    std::optional<std::int64_t> cacheSize {};
+
+    /**
+     * @brief Member for the size of a lookaside slot in bytes.
+     */
+    std::optional<std::int32_t> lookasideSlotSize {};
+
+    /**
+     * @brief Member for the number of lookaside slots.
+     */
+    std::optional<std::int32_t> lookasideSlots {};
+
+    /**
+     * @brief Member for the time to wait on a locked database.
+     */
+    std::optional<std::chrono::milliseconds> busyTimeout {};
+  };
+
+  /**
+   * @brief Open options of a profile.
+   * @param _profile   Performance profile.
+   * @return Preset open options.
+   */
+  OpenOptions openOptions( Profile _profile );
+}
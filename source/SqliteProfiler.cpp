@@ -0,0 +1,797 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cctype> // std::isalnum, std::isdigit, std::isspace, std::isxdigit, std::toupper
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::uint32_t, std::uint64_t
+
+/* stl header */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* modern.cpp.core */
+#include <Singleton.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteProfiler.h"
+#include "SqliteSlowQueryLog.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Buckets per power of two - the relative error of a percentile is below 1/8.
+     */
+    constexpr std::uint64_t subBuckets = 8;
+
+    /**
+     * @brief Bits of the sub bucket.
+     */
+    constexpr std::uint32_t subBucketBits = 3;
+
+    /**
+     * @brief Buckets for every 64 bit value.
+     */
+    constexpr std::size_t bucketCount = ( 64 - subBucketBits + 1 ) * subBuckets;
+
+    /**
+     * @brief Raw sql texts cached per thread before the cache is cleared.
+     */
+    constexpr std::size_t threadCacheLimit = 4096;
+
+    /**
+     * @brief Running statements tracked per connection before the starts are cleared.
+     */
+    constexpr std::size_t startLimit = 1024;
+
+    /**
+     * @brief Index of the highest set bit.
+     * @param _value   Value greater than 0.
+     * @return Bit index.
+     */
+    constexpr std::uint32_t highestBit( std::uint64_t _value ) noexcept {
+
+      std::uint32_t bit = 0;
+      for ( std::uint32_t shift = 32; shift > 0; shift /= 2 ) {
+
+        if ( _value >> shift ) {
+
+          _value >>= shift;
+          bit += shift;
+        }
+      }
+      return bit;
+    }
+
+    /**
+     * @brief Bucket of a value - linear below subBuckets, logarithmic with linear sub buckets above.
+     * @param _value   Latency in nanoseconds.
+     * @return Bucket index.
+     */
+    constexpr std::size_t bucketIndex( std::uint64_t _value ) noexcept {
+
+      if ( _value < subBuckets ) {
+
+        return static_cast<std::size_t>( _value );
+      }
+      const std::uint32_t bit = highestBit( _value );
+      return static_cast<std::size_t>( ( bit - subBucketBits + 1 ) * subBuckets + ( ( _value >> ( bit - subBucketBits ) ) & ( subBuckets - 1 ) ) );
+    }
+
+    /**
+     * @brief Middle of the values of a bucket.
+     * @param _index   Bucket index.
+     * @return Latency in nanoseconds.
+     */
+    constexpr std::uint64_t bucketValue( std::size_t _index ) noexcept {
+
+      if ( _index < subBuckets ) {
+
+        return _index;
+      }
+      const std::uint64_t shift = _index / subBuckets - 1;
+      const std::uint64_t lower = ( subBuckets + _index % subBuckets ) << shift;
+      return lower + ( ( std::uint64_t { 1 } << shift ) >> 1 );
+    }
+
+    static_assert( bucketIndex( 7 ) == 7 && bucketIndex( 8 ) == 8 && bucketIndex( 15 ) == 15 && bucketIndex( 16 ) == 16 && bucketIndex( ~std::uint64_t { 0 } ) == bucketCount - 1 );
+
+    /**
+     * @brief The Histogram class.
+     * Latency histogram updated without lock.
+     */
+    class Histogram {
+
+    public:
+      /**
+       * @brief Add a latency.
+       * @param _nanoseconds   Latency.
+       */
+      void record( std::uint64_t _nanoseconds ) noexcept {
+
+        m_buckets[ bucketIndex( _nanoseconds ) ].fetch_add( 1, std::memory_order_relaxed );
+        m_count.fetch_add( 1, std::memory_order_relaxed );
+        m_total.fetch_add( _nanoseconds, std::memory_order_relaxed );
+        std::uint64_t max = m_max.load( std::memory_order_relaxed );
+        while ( _nanoseconds > max && !m_max.compare_exchange_weak( max, _nanoseconds, std::memory_order_relaxed ) ) {}
+        std::uint64_t min = m_min.load( std::memory_order_relaxed );
+        while ( _nanoseconds < min && !m_min.compare_exchange_weak( min, _nanoseconds, std::memory_order_relaxed ) ) {}
+      }
+
+      /**
+       * @brief Clear the counters.
+       */
+      void reset() noexcept {
+
+        for ( std::atomic<std::uint64_t> &bucket : m_buckets ) {
+
+          bucket.store( 0, std::memory_order_relaxed );
+        }
+        m_count.store( 0, std::memory_order_relaxed );
+        m_total.store( 0, std::memory_order_relaxed );
+        m_max.store( 0, std::memory_order_relaxed );
+        m_min.store( ~std::uint64_t { 0 }, std::memory_order_relaxed );
+      }
+
+      /**
+       * @brief Profile of the histogram.
+       * @param _fingerprint   Normalized sql.
+       * @return Profile - count 0 if empty.
+       */
+      [[nodiscard]] StatementProfile profile( const std::string &_fingerprint ) const {
+
+        StatementProfile profile { _fingerprint };
+        std::array<std::uint64_t, bucketCount> buckets {};
+        for ( std::size_t i = 0; i < bucketCount; ++i ) {
+
+          buckets[ i ] = m_buckets[ i ].load( std::memory_order_relaxed );
+          profile.count += buckets[ i ];
+        }
+        if ( profile.count == 0 ) {
+
+          return profile;
+        }
+        profile.total = std::chrono::nanoseconds( m_total.load( std::memory_order_relaxed ) );
+        profile.min = std::chrono::nanoseconds( m_min.load( std::memory_order_relaxed ) );
+        profile.max = std::chrono::nanoseconds( m_max.load( std::memory_order_relaxed ) );
+
+        const auto percentile = [ &buckets, &profile ]( std::uint64_t _percent ) {
+          const std::uint64_t rank = ( profile.count * _percent + 99 ) / 100;
+          std::uint64_t seen = 0;
+          for ( std::size_t i = 0; i < bucketCount; ++i ) {
+
+            seen += buckets[ i ];
+            if ( seen >= rank ) {
+
+              return std::clamp( std::chrono::nanoseconds( bucketValue( i ) ), profile.min, profile.max );
+            }
+          }
+          return profile.max;
+        };
+        profile.p50 = percentile( 50 );
+        profile.p90 = percentile( 90 );
+        profile.p99 = percentile( 99 );
+        return profile;
+      }
+
+    private:
+      /**
+       * @brief Member for the counts of the buckets.
+       */
+      std::array<std::atomic<std::uint64_t>, bucketCount> m_buckets {};
+
+      /**
+       * @brief Member for the number of latencies.
+       */
+      std::atomic<std::uint64_t> m_count { 0 };
+
+      /**
+       * @brief Member for the summed latency.
+       */
+      std::atomic<std::uint64_t> m_total { 0 };
+
+      /**
+       * @brief Member for the shortest latency.
+       */
+      std::atomic<std::uint64_t> m_min { ~std::uint64_t { 0 } };
+
+      /**
+       * @brief Member for the longest latency.
+       */
+      std::atomic<std::uint64_t> m_max { 0 };
+    };
+
+    /**
+     * @brief The ConnectionProfile struct.
+     * Trace state of a connection - the connection serializes its trace callbacks, whichever thread runs them.
+     */
+    struct ConnectionProfile {
+
+      /**
+       * @brief The Start struct.
+       * Start of a running statement.
+       */
+      struct Start {
+
+        /** @brief Member for the start time. */
+        std::chrono::steady_clock::time_point time {};
+
+        /** @brief Member for the statement counters at the start - see logSlowQuery. */
+        StatementCounters counters {};
+      };
+
+      /**
+       * @brief Member for the start of running statements.
+       */
+      std::unordered_map<sqlite3_stmt *, Start> starts {};
+    };
+
+    /**
+     * @brief The Profiles class.
+     * Histograms by fingerprint - never removed, so threads can cache them.
+     */
+    class Profiles final : public Singleton<Profiles> {
+
+    public:
+      /**
+       * @brief Histogram of a fingerprint - created on first use.
+       * @param _fingerprint   Normalized sql.
+       * @return Histogram.
+       */
+      Histogram &histogram( const std::string &_fingerprint ) {
+
+        const std::lock_guard lock( m_mutex );
+        std::unique_ptr<Histogram> &histogram = m_histograms[ _fingerprint ];
+        if ( !histogram ) {
+
+          histogram = std::make_unique<Histogram>();
+        }
+        return *histogram;
+      }
+
+      /**
+       * @brief Profiles of all fingerprints.
+       * @return Profiles with a count.
+       */
+      [[nodiscard]] std::vector<StatementProfile> snapshot() {
+
+        std::vector<StatementProfile> profiles {};
+        const std::lock_guard lock( m_mutex );
+        for ( const auto &[ fingerprint, histogram ] : m_histograms ) {
+
+          if ( StatementProfile profile = histogram->profile( fingerprint ); profile.count > 0 ) {
+
+            profiles.emplace_back( std::move( profile ) );
+          }
+        }
+        return profiles;
+      }
+
+      /**
+       * @brief Trace state of a connection - created on first use and cleared on reuse.
+       * @param _handle   Database handle.
+       * @return Connection profile - valid until release.
+       */
+      ConnectionProfile &connection( sqlite3 *_handle ) {
+
+        const std::lock_guard lock( m_mutex );
+        std::unique_ptr<ConnectionProfile> &connection = m_connections[ _handle ];
+        if ( !connection ) {
+
+          connection = std::make_unique<ConnectionProfile>();
+        }
+        connection->starts.clear();
+        return *connection;
+      }
+
+      /**
+       * @brief Drop the trace state of a closed connection.
+       * @param _handle   Database handle.
+       */
+      void release( sqlite3 *_handle ) noexcept {
+
+        const std::lock_guard lock( m_mutex );
+        m_connections.erase( _handle );
+      }
+
+      /**
+       * @brief Clear every histogram.
+       */
+      void reset() noexcept {
+
+        const std::lock_guard lock( m_mutex );
+        for ( auto &[ fingerprint, histogram ] : m_histograms ) {
+
+          histogram->reset();
+        }
+      }
+
+      /**
+       * @brief Member for profiling of new connections.
+       */
+      std::atomic<bool> enabled { false };
+
+    private:
+      /**
+       * @brief Member for guarding the histograms.
+       */
+      std::mutex m_mutex {};
+
+      /**
+       * @brief Member for the histograms by fingerprint.
+       */
+      std::unordered_map<std::string, std::unique_ptr<Histogram>> m_histograms {};
+
+      /**
+       * @brief Member for the trace state by connection.
+       */
+      std::unordered_map<sqlite3 *, std::unique_ptr<ConnectionProfile>> m_connections {};
+    };
+
+    /**
+     * @brief The ThreadProfiles struct.
+     * Per thread state of the trace callback - no locks on the hot path.
+     */
+    struct ThreadProfiles {
+
+      /**
+       * @brief Member for the histograms by raw sql - the views point into texts.
+       */
+      std::unordered_map<std::string_view, Histogram *> histograms {};
+
+      /**
+       * @brief Member for the raw sql texts.
+       */
+      std::deque<std::string> texts {};
+
+      /**
+       * @brief Histogram of a raw sql - normalized only on first use by this thread.
+       * @param _sql   Sql of the statement.
+       * @return Histogram.
+       */
+      Histogram &histogram( std::string_view _sql ) {
+
+        if ( const auto iterator = histograms.find( _sql ); iterator != std::end( histograms ) ) {
+
+          return *iterator->second;
+        }
+        if ( histograms.size() >= threadCacheLimit ) {
+
+          histograms.clear();
+          texts.clear();
+        }
+        Histogram &histogram = Profiles::instance().histogram( normalizeSql( _sql ) );
+        histograms.emplace( texts.emplace_back( _sql ), &histogram );
+        return histogram;
+      }
+    };
+
+    /**
+     * @brief Trace state of the calling thread.
+     * @return Thread profiles.
+     */
+    ThreadProfiles &threadProfiles() {
+
+      thread_local ThreadProfiles profiles {};
+      return profiles;
+    }
+
+    /**
+     * @brief Callback of sqlite3_trace_v2.
+     * @param _type   SQLITE_TRACE_STMT, SQLITE_TRACE_PROFILE or SQLITE_TRACE_CLOSE.
+     * @param _context   Connection profile.
+     * @param _statement   Prepared statement or database handle for SQLITE_TRACE_CLOSE.
+     * @param _data   Sql text for SQLITE_TRACE_STMT and elapsed nanoseconds for SQLITE_TRACE_PROFILE.
+     * @return Always 0.
+     */
+    std::int32_t traceProfile( std::uint32_t _type,
+                               void *_context, // NOSONAR sqlite api
+                               void *_statement, // NOSONAR sqlite api
+                               void *_data ) noexcept { // NOSONAR sqlite api
+
+      const auto now = std::chrono::steady_clock::now();
+      if ( _type == SQLITE_TRACE_CLOSE ) {
+
+        Profiles::instance().release( static_cast<sqlite3 *>( _statement ) );
+        return 0;
+      }
+      auto *statement = static_cast<sqlite3_stmt *>( _statement );
+      std::unordered_map<sqlite3_stmt *, ConnectionProfile::Start> &starts = static_cast<ConnectionProfile *>( _context )->starts;
+      try {
+
+        if ( _type == SQLITE_TRACE_STMT ) {
+
+          /* Trigger programs trace again with a comment - the first start counts, a new run replaces a stale start */
+          if ( std::string_view( static_cast<const char *>( _data ) ).substr( 0, 2 ) == "--" ) {
+
+            starts.try_emplace( statement, ConnectionProfile::Start { now, statementCounters( statement ) } );
+            return 0;
+          }
+          if ( starts.size() >= startLimit ) {
+
+            starts.clear();
+          }
+          starts.insert_or_assign( statement, ConnectionProfile::Start { now, statementCounters( statement ) } );
+          return 0;
+        }
+
+        /* sqlite measures in milliseconds - the start on the connection is more precise */
+        auto elapsed = std::chrono::nanoseconds( *static_cast<const sqlite3_int64 *>( _data ) );
+        StatementCounters counters {};
+        if ( const auto iterator = starts.find( statement ); iterator != std::end( starts ) ) {
+
+          elapsed = now - iterator->second.time;
+          counters = iterator->second.counters;
+          starts.erase( iterator );
+        }
+        if ( const char *sql = sqlite3_sql( statement ); sql ) {
+
+          threadProfiles().histogram( sql ).record( static_cast<std::uint64_t>( elapsed.count() ) );
+        }
+        logSlowQuery( statement, elapsed, counters );
+      }
+      catch ( const std::bad_alloc & ) {
+
+        /* The statement is not profiled */
+      }
+      return 0;
+    }
+
+    /**
+     * @brief Character of an identifier or keyword.
+     * @param _character   Character to check.
+     * @return True, if part of a word - otherwise false.
+     */
+    bool isWord( char _character ) noexcept {
+
+      const auto character = static_cast<unsigned char>( _character );
+      return std::isalnum( character ) || character == '_' || character == '$' || character >= 0x80;
+    }
+
+    /**
+     * @brief Remove a trailing space.
+     * @param _output   Normalized sql.
+     */
+    void trimSpace( std::string &_output ) noexcept {
+
+      if ( !_output.empty() && _output.back() == ' ' ) {
+
+        _output.pop_back();
+      }
+    }
+
+    /**
+     * @brief Append a placeholder - a list of placeholders collapses to one.
+     * @param _output   Normalized sql.
+     */
+    void appendPlaceholder( std::string &_output ) {
+
+      constexpr std::string_view list = "?, ";
+      if ( _output.size() >= list.size() && std::string_view( _output ).substr( _output.size() - list.size() ) == list ) {
+
+        _output.resize( _output.size() - 2 );
+        return;
+      }
+      _output += '?';
+    }
+
+    /**
+     * @brief Escape a string for json.
+     * @param _text   Text to escape.
+     * @param _output   Json output.
+     */
+    void appendJsonString( std::string_view _text,
+                           std::ostream &_output ) {
+
+      _output << '"';
+      for ( const char character : _text ) {
+
+        switch ( character ) {
+
+          case '"':
+            _output << "\\\"";
+            break;
+
+          case '\\':
+            _output << "\\\\";
+            break;
+
+          case '\n':
+            _output << "\\n";
+            break;
+
+          case '\t':
+            _output << "\\t";
+            break;
+
+          default:
+            if ( static_cast<unsigned char>( character ) < 0x20 ) {
+
+              _output << "\\u" << std::hex << std::setw( 4 ) << std::setfill( '0' ) << static_cast<std::int32_t>( character ) << std::dec << std::setfill( ' ' );
+            }
+            else {
+
+              _output << character;
+            }
+            break;
+        }
+      }
+      _output << '"';
+    }
+  }
+
+  std::string normalizeSql( std::string_view _sql ) {
+
+    std::string output {};
+    output.reserve( _sql.size() );
+    std::size_t position = 0;
+    const auto at = [ &_sql ]( std::size_t _position ) { return _position < _sql.size() ? _sql[ _position ] : '\0'; };
+    while ( position < _sql.size() ) {
+
+      const char character = _sql[ position ];
+
+      /* Whitespace and comments */
+      if ( std::isspace( static_cast<unsigned char>( character ) ) || ( character == '-' && at( position + 1 ) == '-' ) || ( character == '/' && at( position + 1 ) == '*' ) ) {
+
+        if ( character == '-' ) {
+
+          position = std::min( _sql.find( '\n', position ), _sql.size() );
+        }
+        else if ( character == '/' ) {
+
+          const std::size_t end = _sql.find( "*/", position + 2 );
+          position = end == std::string_view::npos ? _sql.size() : end + 2;
+        }
+        else {
+
+          ++position;
+        }
+        if ( !output.empty() && output.back() != ' ' && output.back() != '(' ) {
+
+          output += ' ';
+        }
+        continue;
+      }
+
+      /* String and blob literals */
+      if ( character == '\'' || ( ( character == 'x' || character == 'X' ) && at( position + 1 ) == '\'' ) ) {
+
+        position += character == '\'' ? 1 : 2;
+        while ( position < _sql.size() ) {
+
+          if ( _sql[ position ] == '\'' && at( position + 1 ) != '\'' ) {
+
+            break;
+          }
+          position += _sql[ position ] == '\'' ? 2 : 1;
+        }
+        ++position;
+        appendPlaceholder( output );
+        continue;
+      }
+
+      /* Numbers */
+      const bool wordBefore = !output.empty() && isWord( output.back() );
+      if ( !wordBefore && ( std::isdigit( static_cast<unsigned char>( character ) ) || ( character == '.' && std::isdigit( static_cast<unsigned char>( at( position + 1 ) ) ) ) ) ) {
+
+        while ( position < _sql.size() ) {
+
+          const char digit = _sql[ position ];
+          const bool exponentSign = ( digit == '+' || digit == '-' ) && ( _sql[ position - 1 ] == 'e' || _sql[ position - 1 ] == 'E' );
+          if ( !std::isxdigit( static_cast<unsigned char>( digit ) ) && digit != '.' && digit != 'x' && digit != 'X' && digit != '_' && !exponentSign ) {
+
+            break;
+          }
+          ++position;
+        }
+        appendPlaceholder( output );
+        continue;
+      }
+
+      /* Parameters */
+      if ( character == '?' || ( ( character == ':' || character == '@' || character == '$' ) && isWord( at( position + 1 ) ) ) ) {
+
+        ++position;
+        while ( position < _sql.size() && isWord( _sql[ position ] ) ) {
+
+          ++position;
+        }
+        appendPlaceholder( output );
+        continue;
+      }
+
+      /* Quoted identifiers */
+      if ( character == '"' || character == '`' || character == '[' ) {
+
+        const char close = character == '[' ? ']' : character;
+        const std::size_t end = _sql.find( close, position + 1 );
+        const std::size_t next = end == std::string_view::npos ? _sql.size() : end + 1;
+        output.append( _sql.substr( position, next - position ) );
+        position = next;
+        continue;
+      }
+
+      /* Keywords uppercase, identifiers as written */
+      if ( isWord( character ) ) {
+
+        std::size_t end = position;
+        while ( end < _sql.size() && isWord( _sql[ end ] ) ) {
+
+          ++end;
+        }
+        const std::string_view word = _sql.substr( position, end - position );
+        if ( sqlite3_keyword_check( word.data(), static_cast<std::int32_t>( word.size() ) ) ) {
+
+          std::transform( std::begin( word ), std::end( word ), std::back_inserter( output ), []( char _character ) { return static_cast<char>( std::toupper( static_cast<unsigned char>( _character ) ) ); } );
+        }
+        else {
+
+          output.append( word );
+        }
+        position = end;
+        continue;
+      }
+
+      /* Punctuation */
+      if ( character == ',' ) {
+
+        trimSpace( output );
+        output += ", ";
+      }
+      else if ( character == ')' ) {
+
+        trimSpace( output );
+        output += ')';
+
+        /* Rows of a multi-row VALUES collapse to one */
+        constexpr std::string_view rows = "(?), (?)";
+        if ( output.size() >= rows.size() && std::string_view( output ).substr( output.size() - rows.size() ) == rows ) {
+
+          output.resize( output.size() - 5 );
+        }
+      }
+      else if ( character == ';' ) {
+
+        trimSpace( output );
+        output += ';';
+      }
+      else {
+
+        output += character;
+      }
+      ++position;
+    }
+    trimSpace( output );
+    return output;
+  }
+
+  void enableProfiling( bool _enable ) noexcept { Profiles::instance().enabled.store( _enable, std::memory_order_relaxed ); }
+
+  bool profilingEnabled() noexcept { return Profiles::instance().enabled.load( std::memory_order_relaxed ); }
+
+  std::error_code profileConnection( sqlite3 *_handle ) noexcept {
+
+    if ( !_handle ) {
+
+      return makeError( SQLITE_MISUSE, "Database handle is null." );
+    }
+
+    /* The recursive connection mutex keeps trace callbacks away while the starts are cleared */
+    sqlite3_mutex_enter( sqlite3_db_mutex( _handle ) );
+    std::int32_t resultCode = SQLITE_NOMEM;
+    try {
+
+      ConnectionProfile &connection = Profiles::instance().connection( _handle );
+      resultCode = sqlite3_trace_v2( _handle, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_CLOSE, traceProfile, &connection );
+    }
+    catch ( const std::bad_alloc & ) {
+
+      /* The connection is not profiled */
+    }
+    sqlite3_mutex_leave( sqlite3_db_mutex( _handle ) );
+    if ( resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, sqlite3_errmsg( _handle ) );
+    }
+    return {};
+  }
+
+  std::vector<StatementProfile> profileSnapshot() {
+
+    std::vector<StatementProfile> profiles = Profiles::instance().snapshot();
+    std::sort( std::begin( profiles ), std::end( profiles ), []( const StatementProfile &_left, const StatementProfile &_right ) { return _left.total > _right.total; } );
+    return profiles;
+  }
+
+  void resetProfiles() noexcept { Profiles::instance().reset(); }
+
+  std::string profileText( const std::vector<StatementProfile> &_profiles ) {
+
+    using microseconds = std::chrono::duration<double, std::micro>;
+    std::ostringstream output {};
+    output << std::fixed << std::setprecision( 1 );
+    output << std::setw( 10 ) << "COUNT" << std::setw( 12 ) << "TOTAL ms" << std::setw( 10 ) << "MEAN us" << std::setw( 10 ) << "P50 us" << std::setw( 10 ) << "P90 us" << std::setw( 10 ) << "P99 us" << std::setw( 10 ) << "MAX us" << "  SQL" << std::endl;
+    for ( const StatementProfile &profile : _profiles ) {
+
+      const double mean = microseconds( profile.total ).count() / static_cast<double>( std::max<std::uint64_t>( profile.count, 1 ) );
+      output << std::setw( 10 ) << profile.count;
+      output << std::setw( 12 ) << std::chrono::duration<double, std::milli>( profile.total ).count();
+      output << std::setw( 10 ) << mean;
+      output << std::setw( 10 ) << microseconds( profile.p50 ).count();
+      output << std::setw( 10 ) << microseconds( profile.p90 ).count();
+      output << std::setw( 10 ) << microseconds( profile.p99 ).count();
+      output << std::setw( 10 ) << microseconds( profile.max ).count();
+      output << "  " << profile.fingerprint << std::endl;
+    }
+    return output.str();
+  }
+
+  std::string profileJson( const std::vector<StatementProfile> &_profiles ) {
+
+    std::ostringstream output {};
+    output << '[';
+    for ( std::size_t i = 0; i < _profiles.size(); ++i ) {
+
+      const StatementProfile &profile = _profiles[ i ];
+      output << ( i > 0 ? "," : "" ) << "{\"fingerprint\":";
+      appendJsonString( profile.fingerprint, output );
+      output << ",\"count\":" << profile.count;
+      output << ",\"total\":" << profile.total.count();
+      output << ",\"min\":" << profile.min.count();
+      output << ",\"max\":" << profile.max.count();
+      output << ",\"p50\":" << profile.p50.count();
+      output << ",\"p90\":" << profile.p90.count();
+      output << ",\"p99\":" << profile.p99.count() << '}';
+    }
+    output << ']';
+    return output.str();
+  }
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstdint> // std::uint64_t
+
+/* stl header */
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* forward declaration of sqlite3 */
+struct sqlite3;
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The StatementProfile struct.
+   * Latency of all statements with the same fingerprint.
+   */
+  struct StatementProfile {
+
+    /**
+     * @brief Member for the normalized sql - see normalizeSql.
+     */
+    std::string fingerprint {};
+
+    /**
+     * @brief Member for the number of executions.
+     */
+    std::uint64_t count = 0;
+
+    /**
+     * @brief Member for the summed latency.
+     */
+    std::chrono::nanoseconds total {};
+
+    /**
+     * @brief Member for the shortest latency.
+     */
+    std::chrono::nanoseconds min {};
+
+    /**
+     * @brief Member for the longest latency.
+     */
+    std::chrono::nanoseconds max {};
+
+    /**
+     * @brief Member for the median latency - within 1/8 of the exact value.
+     */
+    std::chrono::nanoseconds p50 {};
+
+    /**
+     * @brief Member for the 90th percentile latency.
+     */
+    std::chrono::nanoseconds p90 {};
+
+    /**
+     * @brief Member for the 99th percentile latency.
+     */
+    std::chrono::nanoseconds p99 {};
+  };
+
+  /**
+   * @brief Fingerprint of a sql command.
+   * Literals and parameters become ?, lists of them collapse to one, comments and extra whitespace are dropped and keywords are uppercase.
+   * @param _sql   Sql command.
+   * @return Normalized sql.
+   */
+  [[nodiscard]] std::string normalizeSql( std::string_view _sql );
+
+  /**
+   * @brief Profile every connection of sqlite3_make_unique opened from now on.
+   * @param _enable   Enable or disable profiling.
+   */
+  void enableProfiling( bool _enable = true ) noexcept;
+
+  /**
+   * @brief Profiling of new connections is enabled.
+   * @return True, if enabled - otherwise false.
+   */
+  [[nodiscard]] bool profilingEnabled() noexcept;
+
+  /**
+   * @brief Profile the statements of a connection with sqlite3_trace_v2.
+   * Replaces an existing sqlite3_trace_v2 callback of the connection - a later sqlite3_trace_v2 stops the profiling.
+   * Statements are timed per connection, also if they are stepped and reset on different threads.
+   * Finished statements are passed to logSlowQuery as well.
+   * @param _handle   Database handle.
+   * @return Result code and message of operation.
+   */
+  std::error_code profileConnection( sqlite3 *_handle ) noexcept;
+
+  /**
+   * @brief Latency by fingerprint.
+   * @return Profiles sorted by total latency - longest first.
+   */
+  [[nodiscard]] std::vector<StatementProfile> profileSnapshot();
+
+  /**
+   * @brief Clear the counters of every fingerprint.
+   */
+  void resetProfiles() noexcept;
+
+  /**
+   * @brief Profiles as text table.
+   * @param _profiles   Profiles of profileSnapshot.
+   * @return Text with one line per fingerprint.
+   */
+  [[nodiscard]] std::string profileText( const std::vector<StatementProfile> &_profiles );
+
+  /**
+   * @brief Profiles as json.
+   * @param _profiles   Profiles of profileSnapshot.
+   * @return Json array with one object per fingerprint - latency in nanoseconds.
+   */
+  [[nodiscard]] std::string profileJson( const std::vector<StatementProfile> &_profiles );
+}
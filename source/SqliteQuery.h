@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::byte, std::size_t
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <iterator>
+#include <memory>
+#include <optional>
+#ifdef HAVE_SPAN
+  #include <span>
+#endif
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* sqlite_functions */
+#include "SqliteError.h"
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+#ifdef HAVE_SPAN
+  /**
+   * @brief View of a blob.
+   */
+  using BlobView = std::span<const std::byte>;
+#else
+  /**
+   * @brief The BlobView class.
+   * View of a blob.
+   */
+  class BlobView {
+
+  public:
+    /**
+     * @brief Default constructor for BlobView.
+     */
+    constexpr BlobView() noexcept = default;
+
+    /**
+     * @brief Constructor for BlobView.
+     * @param _data   First byte.
+     * @param _size   Number of bytes.
+     */
+    constexpr BlobView( const std::byte *_data,
+                        std::size_t _size ) noexcept
+      : m_data( _data ),
+        m_size( _size ) {}
+
+    /**
+     * @brief First byte.
+     * @return Pointer to the first byte.
+     */
+    [[nodiscard]] constexpr const std::byte *data() const noexcept { return m_data; }
+
+    /**
+     * @brief Number of bytes.
+     * @return Size of the blob.
+     */
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return m_size; }
+
+    /**
+     * @brief Check for an empty blob.
+     * @return True, if the blob is empty - otherwise false.
+     */
+    [[nodiscard]] constexpr bool empty() const noexcept { return m_size == 0; }
+
+  private:
+    /**
+     * @brief Member for the first byte.
+     */
+    const std::byte *m_data = nullptr;
+
+    /**
+     * @brief Member for the number of bytes.
+     */
+    std::size_t m_size = 0;
+  };
+#endif
+
+  /**
+   * @brief vx (VX APPS) sqlite_utils detail namespace.
+   */
+  namespace detail {
+
+    /**
+     * @brief Check for std::optional.
+     */
+    template <typename T>
+    struct IsOptional : std::false_type {};
+
+    /**
+     * @brief Check for std::optional.
+     */
+    template <typename T>
+    struct IsOptional<std::optional<T>> : std::true_type {};
+
+    /**
+     * @brief Unsupported type for static_assert.
+     */
+    template <typename T>
+    struct Unsupported : std::false_type {};
+
+    /**
+     * @brief Bind a value - views are bound with SQLITE_STATIC, owning strings are copied.
+     * @param _statement   Statement to bind.
+     * @param _index   Parameter index.
+     * @param _value   Value to bind.
+     * @return Result code of the bind.
+     */
+    template <typename T>
+    std::int32_t bindValue( sqlite3_stmt *_statement,
+                            std::int32_t _index,
+                            const T &_value ) noexcept {
+
+      if constexpr ( std::is_same_v<T, std::nullptr_t> || std::is_same_v<T, std::nullopt_t> ) {
+
+        return sqlite3_bind_null( _statement, _index );
+      }
+      else if constexpr ( IsOptional<T>::value ) {
+
+        return _value ? bindValue( _statement, _index, *_value ) : sqlite3_bind_null( _statement, _index );
+      }
+      else if constexpr ( std::is_integral_v<T> ) {
+
+        return sqlite3_bind_int64( _statement, _index, static_cast<sqlite3_int64>( _value ) );
+      }
+      else if constexpr ( std::is_floating_point_v<T> ) {
+
+        return sqlite3_bind_double( _statement, _index, static_cast<double>( _value ) );
+      }
+      else if constexpr ( std::is_same_v<T, std::string_view> ) {
+
+        return sqlite3_bind_text64( _statement, _index, _value.data(), _value.size(), SQLITE_STATIC, SQLITE_UTF8 );
+      }
+      else if constexpr ( std::is_convertible_v<const T &, std::string_view> ) {
+
+        /* Owning strings may be temporaries of the call */
+        const std::string_view text( _value );
+        return sqlite3_bind_text64( _statement, _index, text.data(), text.size(), SQLITE_TRANSIENT, SQLITE_UTF8 );
+      }
+      else if constexpr ( std::is_same_v<T, BlobView> ) {
+
+        return sqlite3_bind_blob64( _statement, _index, _value.data(), _value.size(), SQLITE_STATIC );
+      }
+      else {
+
+        static_assert( Unsupported<T>::value, "Unsupported bind type." );
+        return SQLITE_MISUSE;
+      }
+    }
+
+    /**
+     * @brief Decode a column - views refer to the row until the next step.
+     * @param _statement   Statement with a row.
+     * @param _index   Column index.
+     * @return Column value.
+     */
+    template <typename T>
+    T columnValue( sqlite3_stmt *_statement,
+                   std::int32_t _index ) noexcept( !std::is_same_v<T, std::string> ) {
+
+      if constexpr ( IsOptional<T>::value ) {
+
+        return sqlite3_column_type( _statement, _index ) == SQLITE_NULL ? T {} : T { columnValue<typename T::value_type>( _statement, _index ) };
+      }
+      else if constexpr ( std::is_same_v<T, bool> ) {
+
+        return sqlite3_column_int64( _statement, _index ) != 0;
+      }
+      else if constexpr ( std::is_integral_v<T> ) {
+
+        return static_cast<T>( sqlite3_column_int64( _statement, _index ) );
+      }
+      else if constexpr ( std::is_floating_point_v<T> ) {
+
+        return static_cast<T>( sqlite3_column_double( _statement, _index ) );
+      }
+      else if constexpr ( std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string> ) {
+
+        /* Text before bytes - the conversion may change the size */
+        const auto *text = reinterpret_cast<const char *>( sqlite3_column_text( _statement, _index ) ); // NOSONAR sqlite text is utf-8
+        const auto size = static_cast<std::size_t>( sqlite3_column_bytes( _statement, _index ) );
+        return text ? T( text, size ) : T {};
+      }
+      else if constexpr ( std::is_same_v<T, BlobView> ) {
+
+        const auto *blob = static_cast<const std::byte *>( sqlite3_column_blob( _statement, _index ) );
+        const auto size = static_cast<std::size_t>( sqlite3_column_bytes( _statement, _index ) );
+        return blob ? BlobView( blob, size ) : BlobView {};
+      }
+      else {
+
+        static_assert( Unsupported<T>::value, "Unsupported column type." );
+        return T {};
+      }
+    }
+
+    /**
+     * @brief Bind every argument from parameter index 1.
+     * @param _statement   Statement to bind.
+     * @param _args   Values to bind.
+     * @return Result code of the first failed bind - otherwise SQLITE_OK.
+     */
+    template <typename... Args>
+    std::int32_t bindAll( [[maybe_unused]] sqlite3_stmt *_statement,
+                          const Args &..._args ) noexcept {
+
+      [[maybe_unused]] std::int32_t index = 0;
+      std::int32_t resultCode = SQLITE_OK;
+      ( ( resultCode = resultCode == SQLITE_OK ? bindValue( _statement, ++index, _args ) : resultCode ), ... );
+      return resultCode;
+    }
+
+    /**
+     * @brief Decode a row as tuple.
+     * @param _statement   Statement with a row.
+     * @return Row.
+     */
+    template <typename... Columns, std::size_t... Index>
+    std::tuple<Columns...> row( sqlite3_stmt *_statement,
+                                std::index_sequence<Index...> /* _index */ ) {
+
+      return std::tuple<Columns...> { columnValue<Columns>( _statement, static_cast<std::int32_t>( Index ) )... };
+    }
+  }
+
+  /**
+   * @brief The Rows class.
+   * Single-pass range of the result rows decoded as tuples.
+   * Text and blob views refer to the current row and are invalid after the next step.
+   */
+  template <typename... Columns>
+  class Rows {
+
+  public:
+    /**
+     * @brief The iterator class.
+     */
+    class iterator {
+
+    public:
+      /**
+       * @brief Iterator category.
+       */
+      using iterator_category = std::input_iterator_tag;
+
+      /**
+       * @brief Row type.
+       */
+      using value_type = std::tuple<Columns...>;
+
+      /**
+       * @brief Difference type.
+       */
+      using difference_type = std::ptrdiff_t;
+
+      /**
+       * @brief Pointer type.
+       */
+      using pointer = void;
+
+      /**
+       * @brief Reference type.
+       */
+      using reference = value_type;
+
+      /**
+       * @brief Default constructor for iterator - end of the rows.
+       */
+      iterator() noexcept = default;
+
+      /**
+       * @brief Constructor for iterator.
+       * @param _rows   Rows to step.
+       */
+      explicit iterator( Rows *_rows ) noexcept
+        : m_rows( _rows ) {
+
+        advance();
+      }
+
+      /**
+       * @brief Decode the current row.
+       * @return Row.
+       */
+      reference operator*() const { return detail::row<Columns...>( m_rows->m_statement, std::index_sequence_for<Columns...> {} ); }
+
+      /**
+       * @brief Step to the next row.
+       * @return This iterator.
+       */
+      iterator &operator++() noexcept {
+
+        advance();
+        return *this;
+      }
+
+      /**
+       * @brief Compare iterators.
+       * @param _other   Other iterator.
+       * @return True, if both are at the same position - otherwise false.
+       */
+      bool operator==( const iterator &_other ) const noexcept { return m_rows == _other.m_rows; }
+
+      /**
+       * @brief Compare iterators.
+       * @param _other   Other iterator.
+       * @return True, if both are at different positions - otherwise false.
+       */
+      bool operator!=( const iterator &_other ) const noexcept { return m_rows != _other.m_rows; }
+
+    private:
+      /**
+       * @brief Step the statement - becomes the end at the last row or on error.
+       */
+      void advance() noexcept {
+
+        if ( m_rows && !m_rows->step() ) {
+
+          m_rows = nullptr;
+        }
+      }
+
+      /**
+       * @brief Member for the stepped rows - nullptr at the end.
+       */
+      Rows *m_rows = nullptr;
+    };
+
+    /**
+     * @brief Constructor for Rows of an owned statement.
+     * @param _statement   Prepared and bound statement.
+     * @param _error   Prepare or bind error.
+     */
+    Rows( std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> _statement,
+          std::error_code _error ) noexcept
+      : m_statement( _statement.get() ),
+        m_owned( std::move( _statement ) ),
+        m_error( std::move( _error ) ) {}
+
+    /**
+     * @brief Constructor for Rows of a borrowed statement - reset on destruction.
+     * @param _statement   Prepared and bound statement.
+     * @param _error   Bind error.
+     */
+    Rows( sqlite3_stmt *_statement,
+          std::error_code _error ) noexcept
+      : m_statement( _statement ),
+        m_error( std::move( _error ) ) {}
+
+    /**
+     * @brief Delete copy constructor for Rows.
+     */
+    Rows( const Rows & ) = delete;
+
+    /**
+     * @brief Move constructor for Rows.
+     * @param _rows   Rows to take over.
+     */
+    Rows( Rows &&_rows ) noexcept
+      : m_statement( std::exchange( _rows.m_statement, nullptr ) ),
+        m_owned( std::move( _rows.m_owned ) ),
+        m_error( _rows.m_error ) {}
+
+    /**
+     * @brief Destructor for Rows.
+     */
+    ~Rows() {
+
+      if ( m_statement && !m_owned ) {
+
+        sqlite3_reset( m_statement );
+      }
+    }
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    Rows &operator=( const Rows & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    Rows &operator=( Rows && ) = delete;
+
+    /**
+     * @brief First row - the rows can be iterated once.
+     * @return Iterator of the first row.
+     */
+    iterator begin() noexcept { return m_error ? iterator() : iterator( this ); }
+
+    /**
+     * @brief End of the rows.
+     * @return End iterator.
+     */
+    iterator end() const noexcept { return iterator(); }
+
+    /**
+     * @brief Error of prepare, bind or step.
+     * @return Result code and message of operation.
+     */
+    [[nodiscard]] const std::error_code &error() const noexcept { return m_error; }
+
+  private:
+    /**
+     * @brief Step to the next row.
+     * @return True, if there is a row - otherwise false.
+     */
+    bool step() noexcept {
+
+      const std::int32_t resultCode = sqlite3_step( m_statement );
+      if ( resultCode == SQLITE_ROW ) {
+
+        return true;
+      }
+      if ( resultCode != SQLITE_DONE ) {
+
+        m_error = makeError( resultCode, sqlite3_errmsg( sqlite3_db_handle( m_statement ) ) );
+      }
+      return false;
+    }
+
+    /**
+     * @brief Member for the stepped statement.
+     */
+    sqlite3_stmt *m_statement = nullptr;
+
+    /**
+     * @brief Member for an owned statement.
+     */
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> m_owned {};
+
+    /**
+     * @brief Member for the error.
+     */
+    std::error_code m_error {};
+  };
+
+  /**
+   * @brief Run a query with typed binds and rows.
+   * @param _handle   Database handle.
+   * @param _sql   Sql command.
+   * @param _args   Values for parameters 1 to N.
+   * @return Rows decoded as std::tuple<Columns...>.
+   */
+  template <typename... Columns, typename... Args>
+  Rows<Columns...> query( sqlite3 *_handle,
+                          const std::string &_sql,
+                          const Args &..._args ) {
+
+    std::error_code error {};
+    auto statement = sqlite3_stmt_make_unique( _handle, _sql, error );
+    if ( statement ) {
+
+      if ( const std::int32_t resultCode = detail::bindAll( statement.get(), _args... ); resultCode != SQLITE_OK ) {
+
+        error = makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+    }
+    else if ( !error ) {
+
+      error = makeError( SQLITE_MISUSE, "Sql text holds no statement." );
+    }
+    return { std::move( statement ), error };
+  }
+
+  /**
+   * @brief Run a prepared statement with typed binds and rows.
+   * The statement is reset when the rows are destroyed, so it can be reused - e.g. from the StatementCache.
+   * @param _statement   Prepared statement.
+   * @param _args   Values for parameters 1 to N.
+   * @return Rows decoded as std::tuple<Columns...>.
+   */
+  template <typename... Columns, typename... Args>
+  Rows<Columns...> query( sqlite3_stmt *_statement,
+                          const Args &..._args ) {
+
+    std::error_code error {};
+    if ( const std::int32_t resultCode = detail::bindAll( _statement, _args... ); resultCode != SQLITE_OK ) {
+
+      error = makeError( resultCode, sqlite3_errmsg( sqlite3_db_handle( _statement ) ) );
+    }
+    return { _statement, error };
+  }
+
+  /**
+   * @brief Run a statement without rows with typed binds.
+   * @param _handle   Database handle.
+   * @param _sql   Sql command.
+   * @param _args   Values for parameters 1 to N.
+   * @return Result code and message of operation.
+   */
+  template <typename... Args>
+  std::error_code execute( sqlite3 *_handle,
+                           const std::string &_sql,
+                           const Args &..._args ) {
+
+    auto rows = query<>( _handle, _sql, _args... );
+    for ( auto it = rows.begin(); it != rows.end(); ++it ) {}
+    return rows.error();
+  }
+}
@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t, std::uint8_t
+
+/* stl header */
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteScatterGather.h"
+#include "SqliteUtils.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Bind a query value - it lives until every shard ran the query.
+     * @param _statement   Statement to bind.
+     * @param _index   Parameter index.
+     * @param _value   Value to bind.
+     * @return Result code of the bind.
+     */
+    std::int32_t bindValue( sqlite3_stmt *_statement,
+                            std::int32_t _index,
+                            const ShardValue &_value ) noexcept {
+
+      return std::visit( [ _statement, _index ]( const auto &_content ) {
+        using T = std::decay_t<decltype( _content )>;
+        if constexpr ( std::is_same_v<T, std::int64_t> ) {
+
+          return sqlite3_bind_int64( _statement, _index, _content );
+        }
+        else if constexpr ( std::is_same_v<T, double> ) {
+
+          return sqlite3_bind_double( _statement, _index, _content );
+        }
+        else if constexpr ( std::is_same_v<T, std::string> ) {
+
+          return sqlite3_bind_text64( _statement, _index, _content.data(), _content.size(), SQLITE_STATIC, SQLITE_UTF8 );
+        }
+        else if constexpr ( std::is_same_v<T, std::vector<std::uint8_t>> ) {
+
+          return sqlite3_bind_blob64( _statement, _index, _content.data(), _content.size(), SQLITE_STATIC );
+        }
+        else {
+
+          return sqlite3_bind_null( _statement, _index );
+        }
+      },
+                         _value );
+    }
+
+    /**
+     * @brief Copy a column of the current row.
+     * @param _statement   Statement with a row.
+     * @param _column   Column index.
+     * @return Column value.
+     */
+    ShardValue columnValue( sqlite3_stmt *_statement,
+                            std::int32_t _column ) {
+
+      switch ( sqlite3_column_type( _statement, _column ) ) {
+
+        case SQLITE_INTEGER:
+          return sqlite3_column_int64( _statement, _column );
+        case SQLITE_FLOAT:
+          return sqlite3_column_double( _statement, _column );
+        case SQLITE_TEXT: {
+          const auto *text = reinterpret_cast<const char *>( sqlite3_column_text( _statement, _column ) ); // NOSONAR sqlite text is utf-8
+          return std::string( text, static_cast<std::size_t>( sqlite3_column_bytes( _statement, _column ) ) );
+        }
+        case SQLITE_BLOB: {
+          const auto *blob = static_cast<const std::uint8_t *>( sqlite3_column_blob( _statement, _column ) );
+          return std::vector<std::uint8_t>( blob, blob + sqlite3_column_bytes( _statement, _column ) );
+        }
+        default:
+          return std::monostate {};
+      }
+    }
+
+    /**
+     * @brief Storage class in the sort order of sqlite - NULL, numeric, text, blob.
+     * @param _value   Value to classify.
+     * @return Rank of the storage class.
+     */
+    std::int32_t storageClass( const ShardValue &_value ) noexcept {
+
+      switch ( _value.index() ) {
+
+        case 0:
+          return 0;
+        case 1:
+        case 2:
+          return 1;
+        case 3:
+          return 2;
+        default:
+          return 3;
+      }
+    }
+
+    /**
+     * @brief Compare an integer with a real exactly like sqlite.
+     * @param _integer   Integer value.
+     * @param _real   Real value.
+     * @return Negative, if the integer sorts first - zero, if equal - otherwise positive.
+     */
+    std::int32_t compareIntegerReal( std::int64_t _integer,
+                                     double _real ) noexcept {
+
+      /* Bounds of int64 are exact powers of two as double */
+      constexpr double lower = -9223372036854775808.0;
+      constexpr double upper = 9223372036854775808.0;
+      if ( _real < lower ) {
+
+        return 1;
+      }
+      if ( _real >= upper ) {
+
+        return -1;
+      }
+
+      /* The truncated real is exact - its fraction decides a tie */
+      const auto truncated = static_cast<std::int64_t>( _real );
+      if ( _integer != truncated ) {
+
+        return _integer < truncated ? -1 : 1;
+      }
+      const auto whole = static_cast<double>( truncated );
+      return whole < _real ? -1 : ( _real < whole ? 1 : 0 );
+    }
+
+    /**
+     * @brief Compare two values like ORDER BY with BINARY collation.
+     * @param _left   Left value.
+     * @param _right   Right value.
+     * @return Negative, if left sorts first - zero, if equal - otherwise positive.
+     */
+    std::int32_t compareValues( const ShardValue &_left,
+                                const ShardValue &_right ) noexcept {
+
+      const std::int32_t leftClass = storageClass( _left );
+      const std::int32_t rightClass = storageClass( _right );
+      if ( leftClass != rightClass ) {
+
+        return leftClass < rightClass ? -1 : 1;
+      }
+
+      switch ( leftClass ) {
+
+        case 0:
+          return 0;
+        case 1: {
+          const auto *leftInteger = std::get_if<std::int64_t>( &_left );
+          const auto *rightInteger = std::get_if<std::int64_t>( &_right );
+          const auto *leftReal = std::get_if<double>( &_left );
+          const auto *rightReal = std::get_if<double>( &_right );
+          if ( leftInteger && rightInteger ) {
+
+            return *leftInteger < *rightInteger ? -1 : ( *rightInteger < *leftInteger ? 1 : 0 );
+          }
+          if ( leftInteger ) {
+
+            return compareIntegerReal( *leftInteger, *rightReal );
+          }
+          if ( rightInteger ) {
+
+            return -compareIntegerReal( *rightInteger, *leftReal );
+          }
+          return *leftReal < *rightReal ? -1 : ( *rightReal < *leftReal ? 1 : 0 );
+        }
+        case 2:
+          return std::get<std::string>( _left ).compare( std::get<std::string>( _right ) );
+        default: {
+          const auto &left = std::get<std::vector<std::uint8_t>>( _left );
+          const auto &right = std::get<std::vector<std::uint8_t>>( _right );
+          return left < right ? -1 : ( right < left ? 1 : 0 );
+        }
+      }
+    }
+
+    /**
+     * @brief Sql command without trailing semicolons and white space.
+     * @param _sql   Sql command.
+     * @return Trimmed sql command.
+     */
+    std::string trimSql( const std::string &_sql ) {
+
+      const std::size_t last = _sql.find_last_not_of( " \t\r\n;" );
+      return last == std::string::npos ? std::string {} : _sql.substr( 0, last + 1 );
+    }
+  }
+
+  ScatterGather::ScatterGather( std::vector<std::string> _filenames,
+                                OpenOptions _options ) noexcept
+    : m_filenames( std::move( _filenames ) ),
+      m_options( std::move( _options ) ) {}
+
+  ScatterGather::~ScatterGather() {
+
+    for ( const auto &shard : m_shards ) {
+
+      {
+        const std::lock_guard lock( shard->mutex );
+        shard->stop = true;
+      }
+      shard->start.notify_one();
+    }
+    for ( const auto &shard : m_shards ) {
+
+      if ( shard->thread.joinable() ) {
+
+        shard->thread.join();
+      }
+    }
+  }
+
+  std::error_code ScatterGather::open() {
+
+    const std::lock_guard lock( m_openMutex );
+    if ( m_open ) {
+
+      return makeError( SQLITE_MISUSE, "Shards are already open." );
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards {};
+    for ( const std::string &filename : m_filenames ) {
+
+      std::error_code error {};
+      auto shard = std::make_unique<Shard>();
+      shard->index = shards.size();
+      shard->handle = sqlite3_make_unique( filename, m_options, error );
+      if ( !shard->handle ) {
+
+        return error;
+      }
+      shard->statements = std::make_unique<StatementCache>( shard->handle.get() );
+      shards.emplace_back( std::move( shard ) );
+    }
+
+    m_shards = std::move( shards );
+    for ( const auto &shard : m_shards ) {
+
+      shard->thread = std::thread( [ &shard = *shard ] { run( shard ); } );
+    }
+    m_open = true;
+    return {};
+  }
+
+  std::error_code ScatterGather::query( const std::string &_sql,
+                                        const std::vector<ShardOrder> &_order,
+                                        std::vector<ShardRow> &_rows,
+                                        std::optional<std::size_t> _limit,
+                                        const std::vector<ShardValue> &_params ) {
+
+    _rows.clear();
+    if ( !m_open ) {
+
+      return makeError( SQLITE_MISUSE, "Shards are not open." );
+    }
+
+    /* Sort keys and limit wrap the query - a trailing comment ends at the line break */
+    Query query {};
+    query.subquery = trimSql( _sql );
+    query.sql = query.subquery;
+    if ( !_order.empty() || _limit ) {
+
+      std::string wrapped = "SELECT * FROM (" + query.subquery + "\n)";
+      for ( std::size_t i = 0; i < _order.size(); ++i ) {
+
+        wrapped += i == 0 ? " ORDER BY " : ", ";
+        wrapped += std::to_string( _order[ i ].column + 1 ) + " COLLATE BINARY";
+        wrapped += _order[ i ].descending ? " DESC" : "";
+        query.columns = std::max( query.columns, _order[ i ].column + 1 );
+      }
+      if ( _limit ) {
+
+        wrapped += " LIMIT ?";
+      }
+      query.sql = std::move( wrapped );
+    }
+    query.params = &_params;
+    query.limit = _limit;
+    query.rows.resize( m_shards.size() );
+    query.errors.resize( m_shards.size() );
+    query.pending = m_shards.size();
+
+    /* Scatter */
+    for ( const auto &shard : m_shards ) {
+
+      {
+        const std::lock_guard lock( shard->mutex );
+        shard->queries.push_back( &query );
+      }
+      shard->start.notify_one();
+    }
+
+    /* Gather */
+    {
+      std::unique_lock lock( query.mutex );
+      query.done.wait( lock, [ &query ] { return query.pending == 0; } );
+    }
+
+    for ( const std::error_code &error : query.errors ) {
+
+      if ( error ) {
+
+        return error;
+      }
+    }
+    merge( query.rows, _order, _rows, _limit );
+    return {};
+  }
+
+  void ScatterGather::run( Shard &_shard ) {
+
+    while ( true ) {
+
+      Query *query = nullptr;
+      {
+        std::unique_lock lock( _shard.mutex );
+        _shard.start.wait( lock, [ &_shard ] { return _shard.stop || !_shard.queries.empty(); } );
+        if ( _shard.queries.empty() ) {
+
+          break;
+        }
+        query = _shard.queries.front();
+        _shard.queries.pop_front();
+      }
+
+      execute( _shard, *query );
+
+      /* The query lives until the last shard is done */
+      const std::lock_guard lock( query->mutex );
+      if ( --query->pending == 0 ) {
+
+        query->done.notify_one();
+      }
+    }
+  }
+
+  void ScatterGather::execute( Shard &_shard,
+                               Query &_query ) {
+
+    std::vector<ShardRow> &rows = _query.rows[ _shard.index ];
+    std::error_code &error = _query.errors[ _shard.index ];
+    sqlite3 *handle = _shard.handle.get();
+    const CachedStatement statement = _shard.statements->prepare( _query.sql, error );
+    if ( !statement ) {
+
+      /* Tell a sort key beyond the result columns from a broken query */
+      if ( const auto subquery = sqlite3_stmt_make_unique( handle, _query.subquery ); _query.columns > 0 && subquery && static_cast<std::size_t>( sqlite3_column_count( subquery.get() ) ) < _query.columns ) {
+
+        error = makeError( SQLITE_RANGE, "Order column is out of range." );
+      }
+      return;
+    }
+
+    std::int32_t resultCode = SQLITE_OK;
+    for ( std::size_t i = 0; resultCode == SQLITE_OK && i < _query.params->size(); ++i ) {
+
+      resultCode = bindValue( statement.get(), static_cast<std::int32_t>( i + 1 ), ( *_query.params )[ i ] );
+    }
+    if ( resultCode == SQLITE_OK && _query.limit ) {
+
+      const auto limit = static_cast<std::int64_t>( std::min<std::size_t>( *_query.limit, std::numeric_limits<std::int64_t>::max() ) );
+      resultCode = sqlite3_bind_int64( statement.get(), sqlite3_bind_parameter_count( statement.get() ), limit );
+    }
+    if ( resultCode != SQLITE_OK ) {
+
+      error = makeError( resultCode, sqlite3_errmsg( handle ) );
+      return;
+    }
+
+    const std::int32_t columns = sqlite3_column_count( statement.get() );
+    while ( ( resultCode = sqlite3_step( statement.get() ) ) == SQLITE_ROW ) {
+
+      ShardRow &row = rows.emplace_back();
+      row.reserve( static_cast<std::size_t>( columns ) );
+      for ( std::int32_t column = 0; column < columns; ++column ) {
+
+        row.emplace_back( columnValue( statement.get(), column ) );
+      }
+    }
+    if ( resultCode != SQLITE_DONE ) {
+
+      error = makeError( resultCode, sqlite3_errmsg( handle ) );
+      rows.clear();
+    }
+  }
+
+  void ScatterGather::merge( std::vector<std::vector<ShardRow>> &_parts,
+                             const std::vector<ShardOrder> &_order,
+                             std::vector<ShardRow> &_rows,
+                             std::optional<std::size_t> _limit ) {
+
+    std::size_t total = 0;
+    for ( const std::vector<ShardRow> &part : _parts ) {
+
+      total += part.size();
+    }
+    const std::size_t count = std::min( total, _limit.value_or( total ) );
+    _rows.reserve( count );
+
+    /* Without sort keys the shards are concatenated */
+    if ( _order.empty() ) {
+
+      for ( std::vector<ShardRow> &part : _parts ) {
+
+        for ( std::size_t i = 0; i < part.size() && _rows.size() < count; ++i ) {
+
+          _rows.emplace_back( std::move( part[ i ] ) );
+        }
+      }
+      return;
+    }
+
+    /**
+     * @brief The Cursor struct.
+     * Next row of one shard.
+     */
+    struct Cursor {
+
+      /**
+       * @brief Member for the shard index.
+       */
+      std::size_t shard = 0;
+
+      /**
+       * @brief Member for the row index.
+       */
+      std::size_t position = 0;
+    };
+
+    /* The heap keeps the cursor with the first row on top - ties keep the shard order */
+    const auto after = [ &_parts, &_order ]( const Cursor &_left, const Cursor &_right ) {
+      const ShardRow &left = _parts[ _left.shard ][ _left.position ];
+      const ShardRow &right = _parts[ _right.shard ][ _right.position ];
+      for ( const ShardOrder &key : _order ) {
+
+        if ( const std::int32_t result = compareValues( left[ key.column ], right[ key.column ] ); result != 0 ) {
+
+          return key.descending ? result < 0 : result > 0;
+        }
+      }
+      return _left.shard > _right.shard;
+    };
+
+    std::vector<Cursor> cursors {};
+    cursors.reserve( _parts.size() );
+    for ( std::size_t i = 0; i < _parts.size(); ++i ) {
+
+      if ( !_parts[ i ].empty() ) {
+
+        cursors.push_back( { i, 0 } );
+      }
+    }
+
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype( after )> heap( after, std::move( cursors ) );
+    while ( !heap.empty() && _rows.size() < count ) {
+
+      Cursor cursor = heap.top();
+      heap.pop();
+      _rows.emplace_back( std::move( _parts[ cursor.shard ][ cursor.position ] ) );
+      if ( ++cursor.position < _parts[ cursor.shard ].size() ) {
+
+        heap.push( cursor );
+      }
+    }
+  }
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int64_t, std::uint64_t, std::uint8_t
+
+/* stl header */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <variant>
+#include <vector>
+
+/* sqlite_functions */
+#include "SqliteOpenOptions.h"
+#include "SqliteStatementCache.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Value of a shard query - monostate is NULL, text is UTF-8.
+   */
+  using ShardValue = std::variant<std::monostate, std::int64_t, double, std::string, std::vector<std::uint8_t>>;
+
+  /**
+   * @brief Row of a shard query.
+   */
+  using ShardRow = std::vector<ShardValue>;
+
+  /**
+   * @brief The ShardOrder struct.
+   * Sort key of the merge - every shard sorts the key with BINARY collation, whatever the declared collation is.
+   */
+  struct ShardOrder {
+
+    /**
+     * @brief Member for the column index of the result.
+     */
+    std::size_t column = 0;
+
+    /**
+     * @brief Member for a descending sort.
+     */
+    bool descending = false;
+  };
+
+  /**
+   * @brief The ScatterGather class.
+   * Runs one query on every shard in parallel - one connection and thread per shard.
+   * The sorted partial results are merged with a heap-based k-way merge.
+   * A limit is pushed down to every shard, so no shard returns more rows than the merge needs.
+   * Queries of several threads run concurrently - each shard runs its queries in order.
+   */
+  class ScatterGather {
+
+  public:
+    /**
+     * @brief Constructor for ScatterGather.
+     * @param _filenames   Database filename of each shard.
+     * @param _options   Open options of the shard connections.
+     */
+    explicit ScatterGather( std::vector<std::string> _filenames,
+                            OpenOptions _options = openOptions( Profile::ReadReplica ) ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for ScatterGather.
+     */
+    ScatterGather( const ScatterGather & ) = delete;
+
+    /**
+     * @brief Delete move constructor for ScatterGather.
+     */
+    ScatterGather( ScatterGather && ) = delete;
+
+    /**
+     * @brief Destructor for ScatterGather - stops the shard threads.
+     */
+    ~ScatterGather();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    ScatterGather &operator=( const ScatterGather & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    ScatterGather &operator=( ScatterGather && ) = delete;
+
+    /**
+     * @brief Open the shard connections and start the shard threads.
+     * @return Result code and message of operation.
+     */
+    std::error_code open();
+
+    /**
+     * @brief Run a query on every shard and merge the results.
+     * The query must be one SELECT - with sort keys or limit it runs as subquery of SELECT * FROM (_sql) ORDER BY keys LIMIT ?.
+     * @param _sql   Sql command run on every shard.
+     * @param _order   Sort keys of the merge - empty concatenates the shards.
+     * @param _rows   Merged rows.
+     * @param _limit   Maximum number of merged rows - pushed down as LIMIT to every shard.
+     * @param _params   Values for parameters 1 to N.
+     * @return Result code and message of operation - the first failing shard wins.
+     */
+    std::error_code query( const std::string &_sql,
+                           const std::vector<ShardOrder> &_order,
+                           std::vector<ShardRow> &_rows,
+                           std::optional<std::size_t> _limit = std::nullopt,
+                           const std::vector<ShardValue> &_params = {} );
+
+    /**
+     * @brief Number of shards.
+     * @return Shard count.
+     */
+    [[nodiscard]] std::size_t shards() const noexcept { return m_filenames.size(); }
+
+  private:
+    /**
+     * @brief The Query struct.
+     * One query in flight - shared by every shard.
+     */
+    struct Query {
+
+      /**
+       * @brief Member for the sql command run on every shard.
+       */
+      std::string sql {};
+
+      /**
+       * @brief Member for the sql command of the caller - without trailing semicolons.
+       */
+      std::string subquery {};
+
+      /**
+       * @brief Member for the parameter values.
+       */
+      const std::vector<ShardValue> *params = nullptr;
+
+      /**
+       * @brief Member for the pushed down limit.
+       */
+      std::optional<std::size_t> limit {};
+
+      /**
+       * @brief Member for the number of result columns needed by the sort keys.
+       */
+      std::size_t columns = 0;
+
+      /**
+       * @brief Member for the sorted partial result of each shard.
+       */
+      std::vector<std::vector<ShardRow>> rows {};
+
+      /**
+       * @brief Member for the result code and message of each shard.
+       */
+      std::vector<std::error_code> errors {};
+
+      /**
+       * @brief Member for the lock of the pending shards.
+       */
+      std::mutex mutex {};
+
+      /**
+       * @brief Member for waiting on the shards.
+       */
+      std::condition_variable done {};
+
+      /**
+       * @brief Member for the number of running shards.
+       */
+      std::size_t pending = 0;
+    };
+
+    /**
+     * @brief The Shard struct.
+     */
+    struct Shard {
+
+      /**
+       * @brief Member for the shard index.
+       */
+      std::size_t index = 0;
+
+      /**
+       * @brief Member for the connection.
+       */
+      std::unique_ptr<sqlite3, sqlite3_deleter> handle {};
+
+      /**
+       * @brief Member for the statements of the connection.
+       */
+      std::unique_ptr<StatementCache> statements {};
+
+      /**
+       * @brief Member for the lock of the queries.
+       */
+      std::mutex mutex {};
+
+      /**
+       * @brief Member for waking up the thread.
+       */
+      std::condition_variable start {};
+
+      /**
+       * @brief Member for the queries to run.
+       */
+      std::deque<Query *> queries {};
+
+      /**
+       * @brief Member for stopping the thread.
+       */
+      bool stop = false;
+
+      /**
+       * @brief Member for the thread.
+       */
+      std::thread thread {};
+    };
+
+    /**
+     * @brief Shard thread loop.
+     * @param _shard   Shard of the thread.
+     */
+    static void run( Shard &_shard );
+
+    /**
+     * @brief Run a query on one shard.
+     * @param _shard   Shard to query.
+     * @param _query   Query to run.
+     */
+    static void execute( Shard &_shard,
+                         Query &_query );
+
+    /**
+     * @brief Merge the partial results of the shards.
+     * @param _parts   Sorted partial result of each shard.
+     * @param _order   Sort keys of the merge.
+     * @param _rows   Merged rows.
+     * @param _limit   Maximum number of merged rows.
+     */
+    static void merge( std::vector<std::vector<ShardRow>> &_parts,
+                       const std::vector<ShardOrder> &_order,
+                       std::vector<ShardRow> &_rows,
+                       std::optional<std::size_t> _limit );
+
+    /**
+     * @brief Member for the database filenames.
+     */
+    std::vector<std::string> m_filenames {};
+
+    /**
+     * @brief Member for the open options.
+     */
+    OpenOptions m_options {};
+
+    /**
+     * @brief Member for serializing open.
+     */
+    std::mutex m_openMutex {};
+
+    /**
+     * @brief Member for open shards - set after the shard threads started.
+     */
+    std::atomic<bool> m_open { false };
+
+    /**
+     * @brief Member for the shards.
+     */
+    std::vector<std::unique_ptr<Shard>> m_shards {};
+  };
+}
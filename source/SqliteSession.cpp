@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteSession.h"
+#include "SqliteUtils.h"
+
+namespace vx::sqlite_utils {
+
+  void sqlite3_session_deleter::operator()( sqlite3_session *_session ) const noexcept {
+
+    sqlite3session_delete( _session );
+  }
+
+  Session::Session( sqlite3 *_handle,
+                    const std::string &_schema ) noexcept
+    : m_handle( _handle ),
+      m_schema( _schema ) {}
+
+  std::error_code Session::attach( const std::string &_table ) {
+
+    if ( !m_session ) {
+
+      if ( const std::error_code error = create( m_session ); error ) {
+
+        return error;
+      }
+    }
+
+    if ( const std::int32_t resultCode = sqlite3session_attach( m_session.get(), _table.empty() ? nullptr : _table.c_str() ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+    }
+    m_tables.push_back( _table );
+    return {};
+  }
+
+  std::error_code Session::checkpoint( std::vector<std::uint8_t> &_changeset ) {
+
+    _changeset.clear();
+    if ( !m_session ) {
+
+      return makeError( SQLITE_MISUSE, "No table attached to session." );
+    }
+
+    /* No write of another thread between attaching the next session and taking the changeset of this one */
+    sqlite3_mutex *mutex = sqlite3_db_mutex( m_handle );
+    sqlite3_mutex_enter( mutex );
+
+    /* A session accumulates since creation - the next one records from here on */
+    std::unique_ptr<sqlite3_session, sqlite3_session_deleter> next {};
+    if ( const std::error_code error = create( next ); error ) {
+
+      sqlite3_mutex_leave( mutex );
+      return error;
+    }
+
+    std::int32_t size = 0;
+    void *changeset = nullptr;
+    const std::int32_t resultCode = sqlite3session_changeset( m_session.get(), &size, &changeset );
+    if ( resultCode == SQLITE_OK ) {
+
+      m_session = std::move( next );
+    }
+    sqlite3_mutex_leave( mutex );
+    if ( resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode );
+    }
+
+    const std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> data( static_cast<std::uint8_t *>( changeset ) );
+    if ( data && size > 0 ) {
+
+      _changeset.assign( data.get(), data.get() + size );
+    }
+    return {};
+  }
+
+  std::error_code Session::create( std::unique_ptr<sqlite3_session, sqlite3_session_deleter> &_session ) const {
+
+    sqlite3_session *session = nullptr;
+    if ( const std::int32_t resultCode = sqlite3session_create( m_handle, m_schema.c_str(), &session ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+    }
+    _session.reset( session );
+
+    for ( const std::string &table : m_tables ) {
+
+      if ( const std::int32_t resultCode = sqlite3session_attach( _session.get(), table.empty() ? nullptr : table.c_str() ); resultCode != SQLITE_OK ) {
+
+        _session.reset();
+        return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+      }
+    }
+    return {};
+  }
+
+  namespace {
+
+    /**
+     * @brief Conflict callback for sqlite3changeset_apply.
+     * @param _context   Conflict resolution.
+     * @param _conflict   Conflict type.
+     * @return Conflict action.
+     */
+    std::int32_t conflictCallback( void *_context, // NOSONAR more meaningful than void
+                                   std::int32_t _conflict,
+                                   [[maybe_unused]] sqlite3_changeset_iter *_iterator ) noexcept {
+
+      switch ( *static_cast<const Conflict *>( _context ) ) {
+
+        case Conflict::Abort:
+          return SQLITE_CHANGESET_ABORT;
+        case Conflict::Omit:
+          return SQLITE_CHANGESET_OMIT;
+        case Conflict::Replace:
+          return _conflict == SQLITE_CHANGESET_DATA || _conflict == SQLITE_CHANGESET_CONFLICT ? SQLITE_CHANGESET_REPLACE : SQLITE_CHANGESET_OMIT;
+      }
+      return SQLITE_CHANGESET_ABORT;
+    }
+  }
+
+  std::error_code applyChangeset( sqlite3 *_handle,
+                                  const std::vector<std::uint8_t> &_changeset,
+                                  Conflict _conflict ) {
+
+    if ( _changeset.empty() ) {
+
+      return {};
+    }
+
+    /* sqlite3changeset_apply does not modify the changeset */
+    if ( const std::int32_t resultCode = sqlite3changeset_apply( _handle, static_cast<std::int32_t>( _changeset.size() ), const_cast<std::uint8_t *>( _changeset.data() ), nullptr, conflictCallback, &_conflict ); resultCode != SQLITE_OK ) { // NOSONAR sqlite api is not const correct
+
+      return makeError( resultCode, sqlite3_errmsg( _handle ) );
+    }
+    return {};
+  }
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstdint> // std::uint8_t
+
+/* stl header */
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/* forward declation of sqlite3 */
+struct sqlite3;
+struct sqlite3_session;
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The Conflict enum.
+   */
+  enum class Conflict {
+
+    Abort,  /**< Abort the apply and roll back every change of the changeset. */
+    Omit,   /**< Skip the conflicting change. */
+    Replace /**< Overwrite the conflicting row - omit, if replacing is not possible. */
+  };
+
+  /**
+   * @brief The sqlite3_session_deleter class.
+   */
+  struct sqlite3_session_deleter {
+
+    /**
+     * @brief Sqlite3 session operator ().
+     * @param _session   To sqlite3session_delete.
+     */
+    void operator()( sqlite3_session *_session ) const noexcept;
+  };
+
+  /**
+   * @brief The Session class.
+   * Records the changes of tables within one schema as changesets between checkpoints.
+   * Only tables with a PRIMARY KEY are recorded.
+   */
+  class Session {
+
+  public:
+    /**
+     * @brief Constructor for Session.
+     * @param _handle   Database handle.
+     * @param _schema   Recorded schema - default is main.
+     */
+    explicit Session( sqlite3 *_handle,
+                      const std::string &_schema = "main" ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for Session.
+     */
+    Session( const Session & ) = delete;
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    Session &operator=( const Session & ) = delete;
+
+    /**
+     * @brief Start recording a table.
+     * @param _table   Table name - empty records every table of the schema.
+     * @return Result code and message of operation.
+     */
+    std::error_code attach( const std::string &_table = {} );
+
+    /**
+     * @brief Take the changeset since the last checkpoint and start a new one.
+     * The next session is attached before the changeset is taken under the connection mutex - no write falls between two changesets.
+     * @param _changeset   Changes since the last checkpoint - empty if nothing changed.
+     * @return Result code and message of operation.
+     */
+    std::error_code checkpoint( std::vector<std::uint8_t> &_changeset );
+
+  private:
+    /**
+     * @brief Create a session and attach the recorded tables.
+     * @param _session   Created session - empty on error.
+     * @return Result code and message of operation.
+     */
+    std::error_code create( std::unique_ptr<sqlite3_session, sqlite3_session_deleter> &_session ) const;
+
+    /**
+     * @brief Member for the database handle.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the recorded schema.
+     */
+    std::string m_schema {};
+
+    /**
+     * @brief Member for the recorded tables - empty name for every table.
+     */
+    std::vector<std::string> m_tables {};
+
+    /**
+     * @brief Member for the session.
+     */
+    std::unique_ptr<sqlite3_session, sqlite3_session_deleter> m_session {};
+  };
+
+  /**
+   * @brief Apply a changeset within one transaction.
+   * @param _handle   Database handle.
+   * @param _changeset   Changeset from Session::checkpoint.
+   * @param _conflict   Conflict resolution.
+   * @return Result code and message of operation.
+   */
+  std::error_code applyChangeset( sqlite3 *_handle,
+                                  const std::vector<std::uint8_t> &_changeset,
+                                  Conflict _conflict = Conflict::Replace );
+}
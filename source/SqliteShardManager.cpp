@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple> // std::ignore
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteShardManager.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Run a statement on a schema name.
+     * @param _handle   Database handle.
+     * @param _format   Sql command with %w for the quoted schema name.
+     * @param _name   Schema name.
+     * @return Result code and message of operation.
+     */
+    std::error_code executeOnSchema( sqlite3 *_handle,
+                                     const char *_format,
+                                     std::string_view _name ) {
+
+      const std::unique_ptr<char, sqlite3_str_deleter> sql( sqlite3_mprintf( _format, static_cast<std::int32_t>( _name.size() ), _name.data() ) );
+      if ( const std::int32_t resultCode = sqlite3_exec( _handle, sql.get(), nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+      return {};
+    }
+
+    /**
+     * @brief Error of an unknown shard.
+     * @return Result code and message of operation.
+     */
+    std::error_code unknownShard() {
+
+      return makeError( SQLITE_ERROR, "Unknown shard." );
+    }
+  }
+
+  ShardManager::ShardManager( sqlite3 *_handle,
+                              std::size_t _capacity )
+    : m_handle( _handle ) {
+
+    /* Schemas attached by others take slots of the limit */
+    std::size_t foreign = 0;
+    for ( std::int32_t i = 2; sqlite3_db_name( m_handle, i ); ++i ) {
+
+      ++foreign;
+    }
+    const auto limit = static_cast<std::size_t>( std::max( 0, sqlite3_limit( m_handle, SQLITE_LIMIT_ATTACHED, -1 ) ) );
+    const std::size_t free = limit > foreign ? limit - foreign : 0;
+    m_capacity = _capacity == 0 ? free : std::min( _capacity, free );
+  }
+
+  ShardManager::~ShardManager() {
+
+    for ( const std::string_view name : m_lru ) {
+
+      std::ignore = executeOnSchema( m_handle, "DETACH DATABASE \"%.*w\"", name );
+    }
+  }
+
+  std::error_code ShardManager::addFile( const std::string &_name,
+                                         const std::string &_filename ) {
+
+    return add( _name, _filename, false );
+  }
+
+  std::error_code ShardManager::addDump( const std::string &_name,
+                                         const std::string &_filename ) {
+
+    return add( _name, _filename, true );
+  }
+
+  std::error_code ShardManager::attach( const std::string &_name ) {
+
+    const auto shard = m_shards.find( _name );
+    if ( shard == m_shards.end() ) {
+
+      return unknownShard();
+    }
+
+    if ( shard->second.attached ) {
+
+      ++m_metrics.hits;
+      m_lru.splice( m_lru.begin(), m_lru, shard->second.position );
+      return {};
+    }
+
+    ++m_metrics.misses;
+    while ( m_lru.size() >= m_capacity ) {
+
+      if ( const std::error_code error = evict(); error ) {
+
+        return error;
+      }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::string_view name = shard->first;
+    if ( shard->second.dump ) {
+
+      if ( std::error_code error = executeOnSchema( m_handle, "ATTACH DATABASE ':memory:' AS \"%.*w\"", name ); error ) {
+
+        return error;
+      }
+      if ( const std::error_code error = importDump( m_handle, shard->first, shard->second.filename ); error ) {
+
+        std::ignore = executeOnSchema( m_handle, "DETACH DATABASE \"%.*w\"", name );
+        return error;
+      }
+    }
+    else {
+
+      const std::unique_ptr<char, sqlite3_str_deleter> sql( sqlite3_mprintf( "ATTACH DATABASE %Q AS \"%w\"", shard->second.filename.c_str(), shard->first.c_str() ) );
+      if ( const std::int32_t resultCode = sqlite3_exec( m_handle, sql.get(), nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+      }
+    }
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start );
+    m_metrics.attachTime += time;
+    m_metrics.maxAttachTime = std::max( m_metrics.maxAttachTime, time );
+
+    shard->second.attached = true;
+    shard->second.position = m_lru.insert( m_lru.begin(), name );
+    return {};
+  }
+
+  std::error_code ShardManager::prewarm( const std::vector<std::string> &_names ) {
+
+    /* Attach the coldest first, so the hottest ends up most recently used */
+    const std::size_t count = std::min( _names.size(), m_capacity );
+    for ( std::size_t i = count; i > 0; --i ) {
+
+      const std::string &name = _names[ i - 1 ];
+      if ( std::error_code error = attach( name ); error ) {
+
+        return error;
+      }
+      if ( std::error_code error = executeOnSchema( m_handle, "SELECT COUNT(*) FROM \"%.*w\".sqlite_schema", name ); error ) {
+
+        return error;
+      }
+    }
+    return {};
+  }
+
+  std::error_code ShardManager::detach( const std::string &_name ) {
+
+    const auto shard = m_shards.find( _name );
+    if ( shard == m_shards.end() ) {
+
+      return unknownShard();
+    }
+    if ( !shard->second.attached ) {
+
+      return {};
+    }
+    return detachShard( shard->first, shard->second );
+  }
+
+  bool ShardManager::attached( const std::string &_name ) const noexcept {
+
+    const auto shard = m_shards.find( _name );
+    return shard != m_shards.end() && shard->second.attached;
+  }
+
+  std::error_code ShardManager::add( const std::string &_name,
+                                     const std::string &_filename,
+                                     bool _dump ) {
+
+    if ( _name.empty() || _name == "main" || _name == "temp" ) {
+
+      return makeError( SQLITE_MISUSE, "Invalid shard name." );
+    }
+
+    const auto shard = m_shards.find( _name );
+    if ( shard != m_shards.end() && shard->second.attached ) {
+
+      return makeError( SQLITE_BUSY, "Shard is attached." );
+    }
+
+    Shard &entry = m_shards[ _name ];
+    entry.filename = _filename;
+    entry.dump = _dump;
+    return {};
+  }
+
+  std::error_code ShardManager::evict() {
+
+    /* A shard with running statements is locked - try the next colder one */
+    std::error_code error {};
+    for ( auto name = m_lru.rbegin(); name != m_lru.rend(); ++name ) {
+
+      Shard &shard = m_shards.find( std::string( *name ) )->second;
+      if ( error = detachShard( *name, shard ); !error ) {
+
+        ++m_metrics.evictions;
+        return {};
+      }
+    }
+
+    if ( !error ) {
+
+      error = makeError( SQLITE_FULL, "No shard to detach." );
+    }
+    return error;
+  }
+
+  std::error_code ShardManager::detachShard( std::string_view _name,
+                                             Shard &_shard ) {
+
+    if ( std::error_code error = executeOnSchema( m_handle, "DETACH DATABASE \"%.*w\"", _name ); error ) {
+
+      return error;
+    }
+    m_lru.erase( _shard.position );
+    _shard.attached = false;
+    return {};
+  }
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+/* stl header */
+#include <chrono>
+#include <list>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+/* sqlite_functions */
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The ShardMetrics struct.
+   */
+  struct ShardMetrics {
+
+    /**
+     * @brief Member for the requests of an attached shard.
+     */
+    std::uint64_t hits = 0;
+
+    /**
+     * @brief Member for the requests that attached a shard.
+     */
+    std::uint64_t misses = 0;
+
+    /**
+     * @brief Member for the shards detached to make room.
+     */
+    std::uint64_t evictions = 0;
+
+    /**
+     * @brief Member for the summed attach time - including the import of dumps.
+     */
+    std::chrono::nanoseconds attachTime {};
+
+    /**
+     * @brief Member for the longest attach time.
+     */
+    std::chrono::nanoseconds maxAttachTime {};
+  };
+
+  /**
+   * @brief The ShardManager class.
+   * Maps logical shard names to database files or dumps and attaches them on demand under their name.
+   * The least recently used shards are detached to stay below the attach limit of the connection.
+   * A shard with a running statement is never detached.
+   * The manager is bound to its connection and not thread-safe.
+   */
+  class ShardManager {
+
+  public:
+    /**
+     * @brief Constructor for ShardManager.
+     * @param _handle   Database handle.
+     * @param _capacity   Maximum number of attached shards - 0 uses every free attach slot.
+     */
+    explicit ShardManager( sqlite3 *_handle,
+                           std::size_t _capacity = 0 );
+
+    /**
+     * @brief Delete copy constructor for ShardManager.
+     */
+    ShardManager( const ShardManager & ) = delete;
+
+    /**
+     * @brief Delete move constructor for ShardManager.
+     */
+    ShardManager( ShardManager && ) = delete;
+
+    /**
+     * @brief Destructor for ShardManager - detaches the attached shards.
+     */
+    ~ShardManager();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    ShardManager &operator=( const ShardManager & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    ShardManager &operator=( ShardManager && ) = delete;
+
+    /**
+     * @brief Register a shard stored in a database file.
+     * @param _name   Schema name of the shard.
+     * @param _filename   Database filename.
+     * @return Result code and message of operation.
+     */
+    std::error_code addFile( const std::string &_name,
+                             const std::string &_filename );
+
+    /**
+     * @brief Register a shard stored in a dump - imported into memory on every attach.
+     * @param _name   Schema name of the shard.
+     * @param _filename   Dump filename.
+     * @return Result code and message of operation.
+     */
+    std::error_code addDump( const std::string &_name,
+                             const std::string &_filename );
+
+    /**
+     * @brief Attach a shard if needed and mark it as most recently used.
+     * @param _name   Schema name of the shard.
+     * @return Result code and message of operation.
+     */
+    std::error_code attach( const std::string &_name );
+
+    /**
+     * @brief Attach hot shards ahead and load their schema.
+     * The first name ends up most recently used - names beyond the capacity are skipped.
+     * @param _names   Schema names of the shards, hottest first.
+     * @return Result code and message of operation.
+     */
+    std::error_code prewarm( const std::vector<std::string> &_names );
+
+    /**
+     * @brief Detach a shard.
+     * @param _name   Schema name of the shard.
+     * @return Result code and message of operation.
+     */
+    std::error_code detach( const std::string &_name );
+
+    /**
+     * @brief Check for an attached shard.
+     * @param _name   Schema name of the shard.
+     * @return True, if the shard is attached - otherwise false.
+     */
+    [[nodiscard]] bool attached( const std::string &_name ) const noexcept;
+
+    /**
+     * @brief Number of attached shards.
+     * @return Attached shards.
+     */
+    [[nodiscard]] std::size_t size() const noexcept { return m_lru.size(); }
+
+    /**
+     * @brief Maximum number of attached shards.
+     * @return Capacity.
+     */
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_capacity; }
+
+    /**
+     * @brief Counters of the manager.
+     * @return Metrics.
+     */
+    [[nodiscard]] ShardMetrics metrics() const noexcept { return m_metrics; }
+
+  private:
+    /**
+     * @brief The Shard struct.
+     */
+    struct Shard {
+
+      /**
+       * @brief Member for the database or dump filename.
+       */
+      std::string filename {};
+
+      /**
+       * @brief Member for a shard stored in a dump.
+       */
+      bool dump = false;
+
+      /**
+       * @brief Member for an attached shard.
+       */
+      bool attached = false;
+
+      /**
+       * @brief Member for the position in the LRU list.
+       */
+      std::list<std::string_view>::iterator position {};
+    };
+
+    /**
+     * @brief Register a shard.
+     * @param _name   Schema name of the shard.
+     * @param _filename   Database or dump filename.
+     * @param _dump   Shard stored in a dump.
+     * @return Result code and message of operation.
+     */
+    std::error_code add( const std::string &_name,
+                         const std::string &_filename,
+                         bool _dump );
+
+    /**
+     * @brief Detach the least recently used shard without running statements.
+     * @return Result code and message of operation.
+     */
+    std::error_code evict();
+
+    /**
+     * @brief Detach a shard by name.
+     * @param _name   Schema name of the shard.
+     * @param _shard   Shard to detach.
+     * @return Result code and message of operation.
+     */
+    std::error_code detachShard( std::string_view _name,
+                                 Shard &_shard );
+
+    /**
+     * @brief Member for the database handle.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the maximum number of attached shards.
+     */
+    std::size_t m_capacity = 0;
+
+    /**
+     * @brief Member for the registered shards.
+     */
+    std::unordered_map<std::string, Shard> m_shards {};
+
+    /**
+     * @brief Member for the attached shards - most recently used first.
+     */
+    std::list<std::string_view> m_lru {};
+
+    /**
+     * @brief Member for the metrics.
+     */
+    ShardMetrics m_metrics {};
+  };
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <istream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteSharedMemory.h"
+
+namespace vx::sqlite_utils {
+
+  SharedMemoryDatabase::SharedMemoryDatabase( std::string _name ) noexcept
+    : m_name( std::move( _name ) ),
+      m_uri( "file:/" + m_name + "?vfs=memdb" ) {}
+
+  std::error_code SharedMemoryDatabase::open() {
+
+    if ( m_handle ) {
+
+      return makeError( SQLITE_MISUSE, "Database is already open." );
+    }
+
+    /* The name is the path of the uri */
+    if ( m_name.empty() || m_name.find_first_of( "/?#%" ) != std::string::npos ) {
+
+      return makeError( SQLITE_MISUSE, "Invalid name of shared memory database." );
+    }
+
+    OpenOptions options {};
+    options.uri = true;
+    std::error_code error {};
+    m_handle = sqlite3_make_unique( m_uri, options, error );
+    return error;
+  }
+
+  std::error_code SharedMemoryDatabase::importDump( const std::string &_filename ) {
+
+    std::error_code error {};
+    const auto source { sqlite3_make_unique( ":memory:", error ) };
+    if ( !source ) {
+
+      return error;
+    }
+    if ( error = sqlite_utils::importDump( source.get(), "main", _filename ); error ) {
+
+      return error;
+    }
+    return copyFrom( source.get() );
+  }
+
+  std::error_code SharedMemoryDatabase::importDump( std::istream &_input,
+                                                    std::size_t _sizeHint ) {
+
+    std::error_code error {};
+    const auto source { sqlite3_make_unique( ":memory:", error ) };
+    if ( !source ) {
+
+      return error;
+    }
+    if ( error = sqlite_utils::importDump( source.get(), "main", _input, _sizeHint ); error ) {
+
+      return error;
+    }
+    return copyFrom( source.get() );
+  }
+
+  std::unique_ptr<sqlite3, sqlite3_deleter> SharedMemoryDatabase::connect( std::error_code &_error,
+                                                                           bool _readOnly ) const noexcept {
+
+    if ( !m_handle ) {
+
+      _error = makeError( SQLITE_MISUSE, "Database is not open." );
+      return nullptr;
+    }
+
+    OpenOptions options {};
+    options.uri = true;
+    options.create = false;
+    options.readOnly = _readOnly;
+    options.noMutex = true;
+    options.cacheSize = sharedMemoryCacheSize;
+    return sqlite3_make_unique( m_uri, options, _error );
+  }
+
+  std::error_code SharedMemoryDatabase::copyFrom( sqlite3 *_source ) {
+
+    if ( !m_handle ) {
+
+      return makeError( SQLITE_MISUSE, "Database is not open." );
+    }
+
+    /* One step copies every page while the destination is locked */
+    sqlite3_backup *backup = sqlite3_backup_init( m_handle.get(), "main", _source, "main" );
+    if ( !backup ) {
+
+      return makeError( sqlite3_errcode( m_handle.get() ), sqlite3_errmsg( m_handle.get() ) );
+    }
+    const std::int32_t stepCode = sqlite3_backup_step( backup, -1 );
+    if ( const std::int32_t resultCode = sqlite3_backup_finish( backup ); stepCode != SQLITE_DONE || resultCode != SQLITE_OK ) {
+
+      return makeError( stepCode != SQLITE_DONE ? stepCode : resultCode, sqlite3_errmsg( m_handle.get() ) );
+    }
+    return {};
+  }
+}
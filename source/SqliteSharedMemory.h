@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int64_t
+
+/* stl header */
+#include <istream>
+#include <memory>
+#include <string>
+#include <system_error>
+
+/* sqlite_functions */
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Page cache of a connection to a shared in-memory database - negative values are KiB.
+   * The pages already live in memory, so a small cache keeps the copies per connection low.
+   */
+  constexpr std::int64_t sharedMemoryCacheSize = -256;
+
+  /**
+   * @brief The SharedMemoryDatabase class.
+   * Named in-memory database of the memdb vfs that every connection of the process can open.
+   * The database lives as long as the anchor connection of this object or any other connection.
+   */
+  class SharedMemoryDatabase {
+
+  public:
+    /**
+     * @brief Constructor for SharedMemoryDatabase.
+     * @param _name   Name of the database - unique per process.
+     */
+    explicit SharedMemoryDatabase( std::string _name ) noexcept;
+
+    /**
+     * @brief Open or create the database with the anchor connection.
+     * @return Result code and message of operation.
+     */
+    std::error_code open();
+
+    /**
+     * @brief Import sql dump once - replaces the content for every connection.
+     * The dump is verified and loaded into a private database and copied with the backup api.
+     * @param _filename   Database filename.
+     * @return Result code and message of operation.
+     */
+    std::error_code importDump( const std::string &_filename );
+
+    /**
+     * @brief Import sql dump from a stream once - replaces the content for every connection.
+     * @param _input   Stream to read until its end.
+     * @param _sizeHint   Expected size of the dump to allocate upfront - 0 if unknown.
+     * @return Result code and message of operation.
+     */
+    std::error_code importDump( std::istream &_input,
+                                std::size_t _sizeHint = 0 );
+
+    /**
+     * @brief Open another connection that sees the same pages.
+     * The connection belongs to one thread.
+     * @param _error   Result code and message of operation.
+     * @param _readOnly   Open read-only.
+     * @return Database handle or nullptr.
+     */
+    std::unique_ptr<sqlite3, sqlite3_deleter> connect( std::error_code &_error,
+                                                       bool _readOnly = true ) const noexcept;
+
+    /**
+     * @brief Uri of the database for sqlite3_open_v2 with SQLITE_OPEN_URI.
+     * @return Uri with the memdb vfs.
+     */
+    [[nodiscard]] const std::string &uri() const noexcept { return m_uri; }
+
+    /**
+     * @brief Anchor connection.
+     * @return Database handle or nullptr, if not open.
+     */
+    [[nodiscard]] sqlite3 *get() const noexcept { return m_handle.get(); }
+
+  private:
+    /**
+     * @brief Copy a private database into the shared one.
+     * @param _source   Database handle of the private database.
+     * @return Result code and message of operation.
+     */
+    std::error_code copyFrom( sqlite3 *_source );
+
+    /**
+     * @brief Member for the name.
+     */
+    std::string m_name {};
+
+    /**
+     * @brief Member for the uri.
+     */
+    std::string m_uri {};
+
+    /**
+     * @brief Member for the anchor connection.
+     */
+    std::unique_ptr<sqlite3, sqlite3_deleter> m_handle {};
+  };
+}
@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::ptrdiff_t, std::size_t
+#include <cstdint> // std::int32_t, std::int64_t, std::uint64_t
+#include <ctime> // std::gmtime, std::time_t, std::tm
+
+/* stl header */
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* modern.cpp.core */
+#include <Singleton.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteSlowQueryLog.h"
+#include "SqliteUtils.h"
+
+namespace vx::sqlite_utils {
+
+  static_assert( ( slowQueryCapacity & ( slowQueryCapacity - 1 ) ) == 0, "slowQueryCapacity must be a power of two" );
+
+  namespace {
+
+    /**
+     * @brief Time between two writes of the writer thread without wake up.
+     */
+    constexpr std::chrono::milliseconds writeInterval { 100 };
+
+    /**
+     * @brief Size of a cache line - producer and consumer positions are kept apart.
+     */
+    constexpr std::size_t cacheLineSize = 64;
+
+    /**
+     * @brief Connections for EXPLAIN QUERY PLAN kept open by the writer thread.
+     */
+    constexpr std::size_t explainConnectionLimit = 8;
+
+    /**
+     * @brief The Ring class.
+     * Bounded queue for many producers and one consumer after Dmitry Vyukov - producers never wait.
+     */
+    class Ring {
+
+    public:
+      /**
+       * @brief Constructor for Ring.
+       */
+      Ring() noexcept {
+
+        for ( std::size_t index = 0; index < m_slots.size(); ++index ) {
+
+          m_slots[ index ].sequence.store( index, std::memory_order_relaxed );
+        }
+      }
+
+      /**
+       * @brief Add a slow query.
+       * @param _query   Slow query to move into the ring.
+       * @return True, if added - false, if full.
+       */
+      bool push( SlowQuery &&_query ) noexcept {
+
+        std::size_t position = m_tail.load( std::memory_order_relaxed );
+        while ( true ) {
+
+          Slot &slot = m_slots[ position & ( slowQueryCapacity - 1 ) ];
+          const std::size_t sequence = slot.sequence.load( std::memory_order_acquire );
+          const auto difference = static_cast<std::ptrdiff_t>( sequence - position );
+          if ( difference == 0 ) {
+
+            if ( m_tail.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) ) {
+
+              slot.query = std::move( _query );
+              slot.sequence.store( position + 1, std::memory_order_release );
+              return true;
+            }
+          }
+          else if ( difference < 0 ) {
+
+            return false;
+          }
+          else {
+
+            position = m_tail.load( std::memory_order_relaxed );
+          }
+        }
+      }
+
+      /**
+       * @brief Take the oldest slow query - only one consumer at a time.
+       * @param _query   Slow query taken.
+       * @return True, if taken - false, if empty.
+       */
+      bool pop( SlowQuery &_query ) noexcept {
+
+        Slot &slot = m_slots[ m_head & ( slowQueryCapacity - 1 ) ];
+        if ( slot.sequence.load( std::memory_order_acquire ) != m_head + 1 ) {
+
+          return false;
+        }
+        _query = std::move( slot.query );
+        slot.sequence.store( m_head + slowQueryCapacity, std::memory_order_release );
+        ++m_head;
+        return true;
+      }
+
+    private:
+      /**
+       * @brief The Slot struct.
+       * One entry with the position it is ready for.
+       */
+      struct Slot {
+
+        /** @brief Member for the position - equal for push, one more for pop. */
+        std::atomic<std::size_t> sequence { 0 };
+
+        /** @brief Member for the slow query. */
+        SlowQuery query {};
+      };
+
+      /**
+       * @brief Member for the entries.
+       */
+      std::array<Slot, slowQueryCapacity> m_slots {};
+
+      /**
+       * @brief Member for the next push position.
+       */
+      alignas( cacheLineSize ) std::atomic<std::size_t> m_tail { 0 };
+
+      /**
+       * @brief Member for the next pop position - consumer only.
+       */
+      alignas( cacheLineSize ) std::size_t m_head = 0;
+    };
+
+    /**
+     * @brief Plan of a statement as indented tree.
+     * @param _handle   Read-only connection to the database file of the statement.
+     * @param _sql   Sql of the statement.
+     * @return One line per plan node - empty, if the plan is not available.
+     */
+    std::string explainPlan( sqlite3 *_handle,
+                             const std::string &_sql ) {
+
+      const auto statement = sqlite3_stmt_make_unique( _handle, "EXPLAIN QUERY PLAN " + _sql );
+      if ( !statement ) {
+
+        return {};
+      }
+      std::string plan {};
+      std::vector<std::pair<std::int32_t, std::size_t>> depths {};
+      while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {
+
+        const std::int32_t id = sqlite3_column_int( statement.get(), 0 );
+        const std::int32_t parent = sqlite3_column_int( statement.get(), 1 );
+        const auto *detail = reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 3 ) ); // NOSONAR sqlite api
+        std::size_t depth = 0;
+        for ( const auto &[ node, nodeDepth ] : depths ) {
+
+          if ( node == parent ) {
+
+            depth = nodeDepth + 1;
+          }
+        }
+        depths.emplace_back( id, depth );
+        plan.append( depth * 2, ' ' ).append( detail ? detail : "" ).append( 1, '\n' );
+      }
+      return plan;
+    }
+
+    /**
+     * @brief The SlowQueryLog class.
+     * Ring buffer, writer thread and log file of the slow queries.
+     */
+    class SlowQueryLog final : public Singleton<SlowQueryLog> {
+
+    public:
+      /**
+       * @brief Destructor for SlowQueryLog - stops a running writer thread.
+       */
+      ~SlowQueryLog() { stop(); }
+
+      /**
+       * @brief Start the writer thread.
+       * @param _options   Threshold and destination.
+       * @return Result code and message of operation.
+       */
+      std::error_code start( SlowQueryOptions _options ) {
+
+        const std::lock_guard control( m_controlMutex );
+        if ( m_thread.joinable() ) {
+
+          return makeError( SQLITE_MISUSE, "Slow query log is already running" );
+        }
+        if ( !_options.callback && _options.filename.empty() ) {
+
+          return makeError( SQLITE_MISUSE, "Slow query log needs a callback or a filename" );
+        }
+        if ( !_options.callback ) {
+
+          m_file.open( _options.filename, std::ios::out | std::ios::app | std::ios::binary );
+          if ( !m_file.is_open() ) {
+
+            return makeError( SQLITE_CANTOPEN, "Cannot open slow query log: " + _options.filename );
+          }
+          std::error_code error {};
+          const std::uintmax_t size = std::filesystem::file_size( _options.filename, error );
+          m_fileSize = error ? 0 : static_cast<std::uint64_t>( size );
+        }
+
+        /* Queries pushed after the last stop */
+        SlowQuery stale {};
+        while ( ring.pop( stale ) ) {}
+
+        m_options = std::move( _options );
+        threshold.store( m_options.threshold.count(), std::memory_order_relaxed );
+        m_stop = false;
+        m_thread = std::thread( [ this ] { run(); } );
+        active.store( true, std::memory_order_release );
+        return {};
+      }
+
+      /**
+       * @brief Write the queued slow queries and join the writer thread.
+       */
+      void stop() noexcept {
+
+        const std::lock_guard control( m_controlMutex );
+        if ( !m_thread.joinable() ) {
+
+          return;
+        }
+        active.store( false, std::memory_order_relaxed );
+        {
+          const std::lock_guard lock( m_mutex );
+          m_stop = true;
+        }
+        m_condition.notify_all();
+        m_thread.join();
+        m_file.close();
+        m_explainConnections.clear();
+        m_options = {};
+      }
+
+      /**
+       * @brief Wake the writer thread - no lock, a missed wake up waits for writeInterval.
+       */
+      void notify() noexcept { m_condition.notify_one(); }
+
+      /**
+       * @brief Member for queued slow queries.
+       */
+      Ring ring {};
+
+      /**
+       * @brief Member for a running log.
+       */
+      std::atomic<bool> active { false };
+
+      /**
+       * @brief Member for the threshold in nanoseconds.
+       */
+      std::atomic<std::int64_t> threshold { 0 };
+
+      /**
+       * @brief Member for the dropped slow queries.
+       */
+      std::atomic<std::uint64_t> dropped { 0 };
+
+    private:
+      /**
+       * @brief Writer thread loop - writes until stopped and the ring is empty.
+       */
+      void run() {
+
+        while ( true ) {
+
+          bool stop = false;
+          {
+            std::unique_lock lock( m_mutex );
+            stop = m_condition.wait_for( lock, writeInterval, [ this ] { return m_stop; } );
+          }
+          SlowQuery query {};
+          while ( ring.pop( query ) ) {
+
+            if ( m_options.explain ) {
+
+              query.plan = explain( query );
+            }
+            write( query );
+          }
+          if ( m_file.is_open() ) {
+
+            m_file.flush();
+          }
+          if ( stop ) {
+
+            break;
+          }
+        }
+      }
+
+      /**
+       * @brief Plan of a slow query - off the hot path on a read-only connection of the writer thread.
+       * @param _query   Slow query.
+       * @return One line per plan node - empty for in-memory databases or if the plan is not available.
+       */
+      std::string explain( const SlowQuery &_query ) {
+
+        if ( _query.database.empty() ) {
+
+          return {};
+        }
+        std::unique_ptr<sqlite3, sqlite3_deleter> &connection = m_explainConnections[ _query.database ];
+        if ( !connection ) {
+
+          sqlite3 *handle = nullptr;
+          const std::int32_t resultCode = sqlite3_open_v2( _query.database.c_str(), &handle, SQLITE_OPEN_READONLY, nullptr );
+          connection.reset( handle );
+          if ( resultCode != SQLITE_OK ) {
+
+            m_explainConnections.erase( _query.database );
+            return {};
+          }
+          sqlite3_busy_timeout( handle, static_cast<std::int32_t>( writeInterval.count() ) );
+        }
+        std::string plan = explainPlan( connection.get(), _query.sql );
+        if ( m_explainConnections.size() > explainConnectionLimit ) {
+
+          m_explainConnections.clear();
+        }
+        return plan;
+      }
+
+      /**
+       * @brief Hand a slow query to the callback or append it to the log file.
+       * @param _query   Slow query.
+       */
+      void write( const SlowQuery &_query ) {
+
+        if ( m_options.callback ) {
+
+          m_options.callback( _query );
+          return;
+        }
+        const std::string text = slowQueryText( _query );
+        if ( m_fileSize > 0 && m_fileSize + text.size() > m_options.maxFileSize ) {
+
+          rotate();
+        }
+        m_file << text;
+        m_fileSize += text.size();
+      }
+
+      /**
+       * @brief Move filename.N-1 to filename.N down to filename to filename.1 and start a new file.
+       */
+      void rotate() {
+
+        m_file.close();
+        std::error_code error {};
+        if ( m_options.maxFiles == 0 ) {
+
+          std::filesystem::remove( m_options.filename, error );
+        }
+        for ( std::size_t index = m_options.maxFiles; index > 0; --index ) {
+
+          const std::string from = index == 1 ? m_options.filename : m_options.filename + '.' + std::to_string( index - 1 );
+          std::filesystem::rename( from, m_options.filename + '.' + std::to_string( index ), error );
+        }
+        m_file.open( m_options.filename, std::ios::out | std::ios::trunc | std::ios::binary );
+        m_fileSize = 0;
+      }
+
+      /**
+       * @brief Member for serializing start and stop.
+       */
+      std::mutex m_controlMutex {};
+
+      /**
+       * @brief Member for the options of the running log.
+       */
+      SlowQueryOptions m_options {};
+
+      /**
+       * @brief Member for the log file.
+       */
+      std::ofstream m_file {};
+
+      /**
+       * @brief Member for the size of the log file.
+       */
+      std::uint64_t m_fileSize = 0;
+
+      /**
+       * @brief Member for the read-only connections of EXPLAIN QUERY PLAN by database filename - writer thread only.
+       */
+      std::unordered_map<std::string, std::unique_ptr<sqlite3, sqlite3_deleter>> m_explainConnections {};
+
+      /**
+       * @brief Member for the lock of the stop flag.
+       */
+      std::mutex m_mutex {};
+
+      /**
+       * @brief Member for waking the writer thread.
+       */
+      std::condition_variable m_condition {};
+
+      /**
+       * @brief Member for stopping the writer thread.
+       */
+      bool m_stop = false;
+
+      /**
+       * @brief Member for the writer thread.
+       */
+      std::thread m_thread {};
+    };
+
+  }
+
+  std::error_code startSlowQueryLog( SlowQueryOptions _options ) { return SlowQueryLog::instance().start( std::move( _options ) ); }
+
+  void stopSlowQueryLog() noexcept { SlowQueryLog::instance().stop(); }
+
+  std::uint64_t slowQueriesDropped() noexcept { return SlowQueryLog::instance().dropped.load( std::memory_order_relaxed ); }
+
+  StatementCounters statementCounters( sqlite3_stmt *_statement ) noexcept {
+
+    const auto counter = [ _statement ]( std::int32_t _operation ) { return static_cast<std::int64_t>( sqlite3_stmt_status( _statement, _operation, 0 ) ); };
+    StatementCounters counters {};
+    counters.fullScanSteps = counter( SQLITE_STMTSTATUS_FULLSCAN_STEP );
+    counters.sorts = counter( SQLITE_STMTSTATUS_SORT );
+    counters.autoIndexes = counter( SQLITE_STMTSTATUS_AUTOINDEX );
+    counters.vmSteps = counter( SQLITE_STMTSTATUS_VM_STEP );
+    return counters;
+  }
+
+  void logSlowQuery( sqlite3_stmt *_statement,
+                     std::chrono::nanoseconds _elapsed,
+                     const StatementCounters &_start ) noexcept {
+
+    SlowQueryLog &log = SlowQueryLog::instance();
+    if ( !log.active.load( std::memory_order_acquire ) || !_statement || _elapsed.count() < log.threshold.load( std::memory_order_relaxed ) || sqlite3_stmt_isexplain( _statement ) != 0 ) {
+
+      return;
+    }
+
+    try {
+
+      /* Counters of this run only - the statement keeps its own counters */
+      const StatementCounters counters = statementCounters( _statement );
+      SlowQuery query {};
+      query.time = std::chrono::system_clock::now();
+      query.elapsed = _elapsed;
+      if ( const char *filename = sqlite3_db_filename( sqlite3_db_handle( _statement ), "main" ); filename ) {
+
+        query.database = filename;
+      }
+      if ( const std::unique_ptr<char, sqlite3_str_deleter> expanded { sqlite3_expanded_sql( _statement ) }; expanded ) {
+
+        query.sql = expanded.get();
+      }
+      else if ( const char *sql = sqlite3_sql( _statement ); sql ) {
+
+        query.sql = sql;
+      }
+      query.fullScanSteps = counters.fullScanSteps - _start.fullScanSteps;
+      query.sorts = counters.sorts - _start.sorts;
+      query.autoIndexes = counters.autoIndexes - _start.autoIndexes;
+      query.vmSteps = counters.vmSteps - _start.vmSteps;
+      if ( !log.ring.push( std::move( query ) ) ) {
+
+        log.dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+      }
+      log.notify();
+    }
+    catch ( const std::bad_alloc & ) {
+
+      log.dropped.fetch_add( 1, std::memory_order_relaxed );
+    }
+  }
+
+  std::string slowQueryText( const SlowQuery &_query ) {
+
+    const std::time_t seconds = std::chrono::system_clock::to_time_t( _query.time );
+    std::tm time {};
+#ifdef _WIN32
+    gmtime_s( &time, &seconds );
+#else
+    gmtime_r( &seconds, &time );
+#endif
+    const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>( _query.time.time_since_epoch() ).count() % 1000;
+
+    std::ostringstream output {};
+    output << "# Time: " << std::put_time( &time, "%Y-%m-%dT%H:%M:%S" ) << '.' << std::setw( 3 ) << std::setfill( '0' ) << milliseconds << 'Z' << '\n';
+    if ( !_query.database.empty() ) {
+
+      output << "# Database: " << _query.database << '\n';
+    }
+    output << "# Elapsed: " << std::fixed << std::setprecision( 3 ) << std::chrono::duration<double, std::milli>( _query.elapsed ).count() << " ms";
+    output << "  Full scan steps: " << _query.fullScanSteps;
+    output << "  Sorts: " << _query.sorts;
+    output << "  Auto indexes: " << _query.autoIndexes;
+    output << "  VM steps: " << _query.vmSteps << '\n';
+    if ( !_query.plan.empty() ) {
+
+      output << "# Plan:" << '\n';
+      std::istringstream plan( _query.plan );
+      for ( std::string line {}; std::getline( plan, line ); ) {
+
+        output << "#   " << line << '\n';
+      }
+    }
+    output << _query.sql << ( !_query.sql.empty() && _query.sql.back() == ';' ? "" : ";" ) << '\n';
+    return output.str();
+  }
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int64_t, std::uint64_t
+
+/* stl header */
+#include <chrono>
+#include <functional>
+#include <string>
+#include <system_error>
+
+/* forward declaration of sqlite3_stmt */
+struct sqlite3_stmt;
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Entries of the slow-query ring buffer - further slow queries are dropped while it is full.
+   */
+  constexpr std::size_t slowQueryCapacity = 1024;
+
+  /**
+   * @brief The StatementCounters struct.
+   * Counters of sqlite3_stmt_status - read without reset.
+   */
+  struct StatementCounters {
+
+    /**
+     * @brief Member for the forward steps of full table scans - SQLITE_STMTSTATUS_FULLSCAN_STEP.
+     */
+    std::int64_t fullScanSteps = 0;
+
+    /**
+     * @brief Member for the sort operations - SQLITE_STMTSTATUS_SORT.
+     */
+    std::int64_t sorts = 0;
+
+    /**
+     * @brief Member for the rows inserted into automatic indexes - SQLITE_STMTSTATUS_AUTOINDEX.
+     */
+    std::int64_t autoIndexes = 0;
+
+    /**
+     * @brief Member for the virtual machine steps - SQLITE_STMTSTATUS_VM_STEP.
+     */
+    std::int64_t vmSteps = 0;
+  };
+
+  /**
+   * @brief The SlowQuery struct.
+   * One run of a statement above the threshold.
+   */
+  struct SlowQuery {
+
+    /**
+     * @brief Member for the end of the run.
+     */
+    std::chrono::system_clock::time_point time {};
+
+    /**
+     * @brief Member for the latency of the run.
+     */
+    std::chrono::nanoseconds elapsed {};
+
+    /**
+     * @brief Member for the filename of the main database - empty for in-memory databases.
+     */
+    std::string database {};
+
+    /**
+     * @brief Member for the sql with bound parameters - see sqlite3_expanded_sql.
+     */
+    std::string sql {};
+
+    /**
+     * @brief Member for the forward steps of full table scans - SQLITE_STMTSTATUS_FULLSCAN_STEP.
+     */
+    std::int64_t fullScanSteps = 0;
+
+    /**
+     * @brief Member for the sort operations - SQLITE_STMTSTATUS_SORT.
+     */
+    std::int64_t sorts = 0;
+
+    /**
+     * @brief Member for the rows inserted into automatic indexes - SQLITE_STMTSTATUS_AUTOINDEX.
+     */
+    std::int64_t autoIndexes = 0;
+
+    /**
+     * @brief Member for the virtual machine steps - SQLITE_STMTSTATUS_VM_STEP.
+     */
+    std::int64_t vmSteps = 0;
+
+    /**
+     * @brief Member for the EXPLAIN QUERY PLAN output - one indented line per plan node.
+     * Empty for in-memory and temporary databases and for sql the committed schema of the file cannot prepare.
+     */
+    std::string plan {};
+  };
+
+  /**
+   * @brief The SlowQueryOptions struct.
+   * Threshold and destination of the slow-query log.
+   */
+  struct SlowQueryOptions {
+
+    /**
+     * @brief Member for the latency from which a run is logged.
+     */
+    std::chrono::nanoseconds threshold = std::chrono::milliseconds( 100 );
+
+    /**
+     * @brief Member for running EXPLAIN QUERY PLAN in the writer thread on a read-only connection to the database file of a slow query.
+     */
+    bool explain = true;
+
+    /**
+     * @brief Member for the callback of every slow query - called from the writer thread instead of writing the file.
+     */
+    std::function<void( const SlowQuery &_query )> callback {};
+
+    /**
+     * @brief Member for the log file - used without callback.
+     */
+    std::string filename {};
+
+    /**
+     * @brief Member for the size from which the log file is rotated.
+     */
+    std::uint64_t maxFileSize = 16 * 1024 * 1024;
+
+    /**
+     * @brief Member for the rotated files kept as filename.1 to filename.maxFiles.
+     */
+    std::size_t maxFiles = 4;
+  };
+
+  /**
+   * @brief Start logging the slow queries of profiled connections - see enableProfiling and profileConnection.
+   * Only the trace callback of the profiler feeds the log - statements of other connections are not seen.
+   * @param _options   Threshold and destination.
+   * @return Result code and message of operation.
+   */
+  std::error_code startSlowQueryLog( SlowQueryOptions _options );
+
+  /**
+   * @brief Write the queued slow queries and stop the writer thread.
+   */
+  void stopSlowQueryLog() noexcept;
+
+  /**
+   * @brief Slow queries dropped because the ring buffer was full.
+   * @return Dropped queries since the start of the process.
+   */
+  [[nodiscard]] std::uint64_t slowQueriesDropped() noexcept;
+
+  /**
+   * @brief Counters of a statement without resetting them.
+   * @param _statement   Prepared statement.
+   * @return Counters since the statement was prepared.
+   */
+  [[nodiscard]] StatementCounters statementCounters( sqlite3_stmt *_statement ) noexcept;
+
+  /**
+   * @brief Queue a finished run, if it is above the threshold.
+   * Called by the trace callback of the profiler with the counters at the start of the run - the counters are never reset.
+   * @param _statement   Finished statement.
+   * @param _elapsed   Latency of the run.
+   * @param _start   Counters at the start of the run - see statementCounters.
+   */
+  void logSlowQuery( sqlite3_stmt *_statement,
+                     std::chrono::nanoseconds _elapsed,
+                     const StatementCounters &_start = {} ) noexcept;
+
+  /**
+   * @brief Slow query as log text.
+   * @param _query   Slow query.
+   * @return Comment lines with time, latency, counters and plan followed by the sql.
+   */
+  [[nodiscard]] std::string slowQueryText( const SlowQuery &_query );
+}
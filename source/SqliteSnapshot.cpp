@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* stl header */
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteSharedMemory.h"
+#include "SqliteSnapshot.h"
+
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief The SnapshotGeneration struct.
+   * One memdb image with its idle read-only connections.
+   */
+  struct SnapshotGeneration {
+
+    /**
+     * @brief Constructor for SnapshotGeneration.
+     * @param _name   Name of the memdb image.
+     * @param _number   Number of the generation.
+     * @param _alive   Number of living generations.
+     */
+    SnapshotGeneration( std::string _name,
+                        std::uint64_t _number,
+                        std::shared_ptr<std::atomic<std::size_t>> _alive ) noexcept
+      : number( _number ),
+        database( std::move( _name ) ),
+        alive( std::move( _alive ) ) {
+
+      alive->fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    /**
+     * @brief Delete copy constructor for SnapshotGeneration.
+     */
+    SnapshotGeneration( const SnapshotGeneration & ) = delete;
+
+    /**
+     * @brief Delete move constructor for SnapshotGeneration.
+     */
+    SnapshotGeneration( SnapshotGeneration && ) = delete;
+
+    /**
+     * @brief Destructor for SnapshotGeneration - closes the connections and frees the image.
+     */
+    ~SnapshotGeneration() {
+
+      idle.clear();
+      alive->fetch_sub( 1, std::memory_order_relaxed );
+    }
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    SnapshotGeneration &operator=( const SnapshotGeneration & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    SnapshotGeneration &operator=( SnapshotGeneration && ) = delete;
+
+    /**
+     * @brief Member for the number of the generation.
+     */
+    std::uint64_t number = 0;
+
+    /**
+     * @brief Member for the memdb image - the anchor connection keeps it alive.
+     */
+    SharedMemoryDatabase database;
+
+    /**
+     * @brief Member for the lock of the idle connections.
+     */
+    std::mutex mutex {};
+
+    /**
+     * @brief Member for the idle read-only connections.
+     */
+    std::vector<std::unique_ptr<sqlite3, sqlite3_deleter>> idle {};
+
+    /**
+     * @brief Member for the number of living generations.
+     */
+    std::shared_ptr<std::atomic<std::size_t>> alive {};
+  };
+
+  namespace {
+
+#ifdef __cpp_lib_atomic_shared_ptr
+    /**
+     * @brief Read the current generation.
+     * @param _current   Current generation.
+     * @return Pinned generation.
+     */
+    std::shared_ptr<SnapshotGeneration> loadCurrent( const std::atomic<std::shared_ptr<SnapshotGeneration>> &_current ) noexcept {
+
+      return _current.load( std::memory_order_acquire );
+    }
+
+    /**
+     * @brief Publish a generation.
+     * @param _current   Current generation.
+     * @param _generation   New generation.
+     */
+    void storeCurrent( std::atomic<std::shared_ptr<SnapshotGeneration>> &_current,
+                       std::shared_ptr<SnapshotGeneration> _generation ) noexcept {
+
+      _current.store( std::move( _generation ), std::memory_order_release );
+    }
+#else
+    /**
+     * @brief Read the current generation.
+     * @param _current   Current generation.
+     * @return Pinned generation.
+     */
+    std::shared_ptr<SnapshotGeneration> loadCurrent( const std::shared_ptr<SnapshotGeneration> &_current ) noexcept {
+
+      return std::atomic_load_explicit( &_current, std::memory_order_acquire );
+    }
+
+    /**
+     * @brief Publish a generation.
+     * @param _current   Current generation.
+     * @param _generation   New generation.
+     */
+    void storeCurrent( std::shared_ptr<SnapshotGeneration> &_current,
+                       std::shared_ptr<SnapshotGeneration> _generation ) noexcept {
+
+      std::atomic_store_explicit( &_current, std::move( _generation ), std::memory_order_release );
+    }
+#endif
+  }
+
+  SnapshotLease::SnapshotLease( std::shared_ptr<SnapshotGeneration> _generation,
+                                std::unique_ptr<sqlite3, sqlite3_deleter> _handle ) noexcept
+    : m_generation( std::move( _generation ) ),
+      m_handle( std::move( _handle ) ) {}
+
+  SnapshotLease::~SnapshotLease() {
+
+    release();
+  }
+
+  SnapshotLease &SnapshotLease::operator=( SnapshotLease &&_lease ) noexcept {
+
+    if ( this != &_lease ) {
+
+      release();
+      m_generation = std::move( _lease.m_generation );
+      m_handle = std::move( _lease.m_handle );
+    }
+    return *this;
+  }
+
+  std::uint64_t SnapshotLease::generation() const noexcept {
+
+    return m_generation ? m_generation->number : 0;
+  }
+
+  void SnapshotLease::release() noexcept {
+
+    if ( m_generation && m_handle ) {
+
+      const std::lock_guard lock( m_generation->mutex );
+      m_generation->idle.emplace_back( std::move( m_handle ) );
+    }
+    m_handle.reset();
+
+    /* The last lease of an old generation frees its image */
+    m_generation.reset();
+  }
+
+  SnapshotManager::SnapshotManager( std::string _name )
+    : m_name( std::move( _name ) ),
+      m_alive( std::make_shared<std::atomic<std::size_t>>( 0 ) ),
+      m_thread( [ this ] { run(); } ) {}
+
+  SnapshotManager::~SnapshotManager() {
+
+    {
+      const std::lock_guard lock( m_mutex );
+      m_stop = true;
+    }
+    m_condition.notify_all();
+    if ( m_thread.joinable() ) {
+
+      m_thread.join();
+    }
+  }
+
+  std::error_code SnapshotManager::load( const std::string &_filename ) {
+
+    const std::lock_guard lock( m_loadMutex );
+
+    /* Build the image aside - readers keep using the current generation */
+    const std::uint64_t number = m_built + 1;
+    auto generation = std::make_shared<SnapshotGeneration>( m_name + "-" + std::to_string( number ), number, m_alive );
+    if ( const std::error_code error = generation->database.open(); error ) {
+
+      return error;
+    }
+    if ( const std::error_code error = generation->database.importDump( _filename ); error ) {
+
+      return error;
+    }
+
+    m_built = number;
+    storeCurrent( m_current, std::move( generation ) );
+    return {};
+  }
+
+  std::future<std::error_code> SnapshotManager::loadAsync( std::string _filename ) {
+
+    std::promise<std::error_code> promise {};
+    std::future<std::error_code> result = promise.get_future();
+    {
+      const std::lock_guard lock( m_mutex );
+      m_queue.emplace_back( std::move( _filename ), std::move( promise ) );
+    }
+    m_condition.notify_one();
+    return result;
+  }
+
+  SnapshotLease SnapshotManager::acquire( std::error_code &_error ) const {
+
+    std::shared_ptr<SnapshotGeneration> generation = loadCurrent( m_current );
+    if ( !generation ) {
+
+      _error = makeError( SQLITE_MISUSE, "No snapshot loaded." );
+      return {};
+    }
+
+    std::unique_ptr<sqlite3, sqlite3_deleter> handle {};
+    {
+      const std::lock_guard lock( generation->mutex );
+      if ( !generation->idle.empty() ) {
+
+        handle = std::move( generation->idle.back() );
+        generation->idle.pop_back();
+      }
+    }
+    if ( !handle ) {
+
+      handle = generation->database.connect( _error );
+      if ( !handle ) {
+
+        return {};
+      }
+    }
+    return { std::move( generation ), std::move( handle ) };
+  }
+
+  std::uint64_t SnapshotManager::generation() const noexcept {
+
+    const std::shared_ptr<SnapshotGeneration> generation = loadCurrent( m_current );
+    return generation ? generation->number : 0;
+  }
+
+  void SnapshotManager::run() {
+
+    while ( true ) {
+
+      std::pair<std::string, std::promise<std::error_code>> job {};
+      {
+        std::unique_lock lock( m_mutex );
+        m_condition.wait( lock, [ this ] { return m_stop || !m_queue.empty(); } );
+        if ( m_queue.empty() ) {
+
+          break;
+        }
+        job = std::move( m_queue.front() );
+        m_queue.pop_front();
+      }
+      job.second.set_value( load( job.first ) );
+    }
+  }
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+/* stl header */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+/* sqlite_functions */
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Immutable image of one loaded dump - defined by the snapshot manager.
+   */
+  struct SnapshotGeneration;
+
+  /**
+   * @brief The SnapshotLease class.
+   * Pins a generation and holds one of its read-only connections.
+   * The connection is returned to its generation on destruction.
+   */
+  class SnapshotLease {
+
+  public:
+    /**
+     * @brief Default constructor for SnapshotLease.
+     */
+    SnapshotLease() noexcept = default;
+
+    /**
+     * @brief Constructor for SnapshotLease.
+     * @param _generation   Pinned generation.
+     * @param _handle   Connection to the generation.
+     */
+    SnapshotLease( std::shared_ptr<SnapshotGeneration> _generation,
+                   std::unique_ptr<sqlite3, sqlite3_deleter> _handle ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for SnapshotLease.
+     */
+    SnapshotLease( const SnapshotLease & ) = delete;
+
+    /**
+     * @brief Move constructor for SnapshotLease.
+     * @param _lease   Lease to take over.
+     */
+    SnapshotLease( SnapshotLease &&_lease ) noexcept = default;
+
+    /**
+     * @brief Destructor for SnapshotLease - returns the connection and unpins the generation.
+     */
+    ~SnapshotLease();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    SnapshotLease &operator=( const SnapshotLease & ) = delete;
+
+    /**
+     * @brief Move assign operator.
+     * @param _lease   Lease to take over.
+     * @return This lease.
+     */
+    SnapshotLease &operator=( SnapshotLease &&_lease ) noexcept;
+
+    /**
+     * @brief Leased connection.
+     * @return Database handle or nullptr.
+     */
+    [[nodiscard]] sqlite3 *get() const noexcept { return m_handle.get(); }
+
+    /**
+     * @brief Check for a leased connection.
+     * @return True, if a connection is leased - otherwise false.
+     */
+    explicit operator bool() const noexcept { return m_handle != nullptr; }
+
+    /**
+     * @brief Number of the pinned generation.
+     * @return Generation starting at 1 - 0 without lease.
+     */
+    [[nodiscard]] std::uint64_t generation() const noexcept;
+
+    /**
+     * @brief Return the connection and unpin the generation early.
+     */
+    void release() noexcept;
+
+  private:
+    /**
+     * @brief Member for the pinned generation.
+     */
+    std::shared_ptr<SnapshotGeneration> m_generation {};
+
+    /**
+     * @brief Member for the leased connection.
+     */
+    std::unique_ptr<sqlite3, sqlite3_deleter> m_handle {};
+  };
+
+  /**
+   * @brief The SnapshotManager class.
+   * Publishes read-mostly data as immutable in-memory generations.
+   * A new dump is imported into a fresh memdb image and published with an atomic pointer swap.
+   * Readers pin the current generation by reference count and never wait for a load.
+   * A generation is freed when it is no longer current and its last lease is gone.
+   */
+  class SnapshotManager {
+
+  public:
+    /**
+     * @brief Constructor for SnapshotManager - starts the load thread.
+     * @param _name   Name of the memdb images - unique per process.
+     */
+    explicit SnapshotManager( std::string _name );
+
+    /**
+     * @brief Delete copy constructor for SnapshotManager.
+     */
+    SnapshotManager( const SnapshotManager & ) = delete;
+
+    /**
+     * @brief Delete move constructor for SnapshotManager.
+     */
+    SnapshotManager( SnapshotManager && ) = delete;
+
+    /**
+     * @brief Destructor for SnapshotManager - runs the queued loads and stops the load thread.
+     */
+    ~SnapshotManager();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    SnapshotManager &operator=( const SnapshotManager & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    SnapshotManager &operator=( SnapshotManager && ) = delete;
+
+    /**
+     * @brief Import a dump into a new generation and publish it.
+     * @param _filename   Database filename of the dump.
+     * @return Result code and message of operation - the current generation stays on error.
+     */
+    std::error_code load( const std::string &_filename );
+
+    /**
+     * @brief Import a dump in the load thread and publish it.
+     * @param _filename   Database filename of the dump.
+     * @return Future with result code and message of operation.
+     */
+    std::future<std::error_code> loadAsync( std::string _filename );
+
+    /**
+     * @brief Lease a connection to the current generation.
+     * @param _error   Result code and message of operation.
+     * @return Lease or empty lease on error.
+     */
+    SnapshotLease acquire( std::error_code &_error ) const;
+
+    /**
+     * @brief Number of the current generation.
+     * @return Generation starting at 1 - 0 before the first load.
+     */
+    [[nodiscard]] std::uint64_t generation() const noexcept;
+
+    /**
+     * @brief Number of generations in memory - the current one and pinned old ones.
+     * @return Living generations.
+     */
+    [[nodiscard]] std::size_t generations() const noexcept { return m_alive->load( std::memory_order_relaxed ); }
+
+  private:
+    /**
+     * @brief Load thread loop.
+     */
+    void run();
+
+    /**
+     * @brief Member for the name of the memdb images.
+     */
+    std::string m_name {};
+
+    /**
+     * @brief Member for the number of living generations - shared with the generations.
+     */
+    std::shared_ptr<std::atomic<std::size_t>> m_alive {};
+
+    /**
+     * @brief Member for serializing the loads.
+     */
+    std::mutex m_loadMutex {};
+
+    /**
+     * @brief Member for the number of built generations.
+     */
+    std::uint64_t m_built = 0;
+
+#ifdef __cpp_lib_atomic_shared_ptr
+    /**
+     * @brief Member for the current generation.
+     */
+    std::atomic<std::shared_ptr<SnapshotGeneration>> m_current {};
+#else
+    /**
+     * @brief Member for the current generation - accessed with std::atomic_load and std::atomic_store.
+     */
+    std::shared_ptr<SnapshotGeneration> m_current {};
+#endif
+
+    /**
+     * @brief Member for the queued loads.
+     */
+    std::deque<std::pair<std::string, std::promise<std::error_code>>> m_queue {};
+
+    /**
+     * @brief Member for the lock of the queue.
+     */
+    std::mutex m_mutex {};
+
+    /**
+     * @brief Member for waking the load thread.
+     */
+    std::condition_variable m_condition {};
+
+    /**
+     * @brief Member for stopping the load thread.
+     */
+    bool m_stop = false;
+
+    /**
+     * @brief Member for the load thread.
+     */
+    std::thread m_thread {};
+  };
+}
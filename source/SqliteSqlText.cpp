@@ -0,0 +1,771 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cmath>   // std::isinf, std::isnan
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteSqlText.h"
+#include "SqliteUtils.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Capacity of the export buffer.
+     */
+    constexpr std::size_t writerCapacity = std::size_t { 1024 } * 1024;
+
+    /**
+     * @brief Size of a chunk read by the import.
+     */
+    constexpr std::size_t readChunkSize = std::size_t { 64 } * 1024;
+
+    /**
+     * @brief Size of the buffer for a number literal.
+     */
+    constexpr std::size_t numberBufferSize = 32;
+
+    /**
+     * @brief Hex digits for blob literals.
+     */
+    constexpr std::string_view hexDigits = "0123456789abcdef";
+
+    /**
+     * @brief Bits of a hex digit.
+     */
+    constexpr std::uint32_t bitsPerHexDigit = 4;
+
+    /**
+     * @brief Mask of a hex digit.
+     */
+    constexpr std::uint32_t hexDigitMask = 0x0F;
+
+    /**
+     * @brief The BufferedWriter class.
+     * Collects the sql text in one reused buffer - no allocation per row.
+     */
+    class BufferedWriter {
+
+    public:
+      /**
+       * @brief Constructor for BufferedWriter.
+       * @param _output   Stream to write to.
+       */
+      explicit BufferedWriter( std::ostream &_output )
+        : m_output( _output ) {
+
+        m_buffer.reserve( writerCapacity );
+      }
+
+      /**
+       * @brief Append text.
+       * @param _text   Text to append.
+       */
+      void append( std::string_view _text ) {
+
+        if ( m_buffer.size() + _text.size() > writerCapacity ) {
+
+          flush();
+        }
+        if ( _text.size() > writerCapacity ) {
+
+          m_output.write( _text.data(), static_cast<std::streamsize>( _text.size() ) );
+          return;
+        }
+        m_buffer.append( _text );
+      }
+
+      /**
+       * @brief Append a character.
+       * @param _character   Character to append.
+       */
+      void append( char _character ) {
+
+        if ( m_buffer.size() == writerCapacity ) {
+
+          flush();
+        }
+        m_buffer.push_back( _character );
+      }
+
+      /**
+       * @brief Write the buffer to the stream.
+       * @return True, if the stream is fine - otherwise false.
+       */
+      bool flush() {
+
+        m_output.write( m_buffer.data(), static_cast<std::streamsize>( m_buffer.size() ) );
+        m_buffer.clear();
+        return m_output.good();
+      }
+
+    private:
+      /**
+       * @brief Member for the stream to write to.
+       */
+      std::ostream &m_output;
+
+      /**
+       * @brief Member for the buffer.
+       */
+      std::string m_buffer {};
+    };
+
+    /**
+     * @brief Append a column value as sql literal.
+     * @param _writer   Writer to append to.
+     * @param _statement   Statement with a row.
+     * @param _column   Column index.
+     */
+    void appendValue( BufferedWriter &_writer,
+                      sqlite3_stmt *_statement,
+                      std::int32_t _column ) {
+
+      std::array<char, numberBufferSize> number {};
+      switch ( sqlite3_column_type( _statement, _column ) ) {
+
+        case SQLITE_INTEGER:
+          sqlite3_snprintf( static_cast<std::int32_t>( number.size() ), number.data(), "%lld", sqlite3_column_int64( _statement, _column ) );
+          _writer.append( std::string_view( number.data() ) );
+          break;
+        case SQLITE_FLOAT: {
+          const double value = sqlite3_column_double( _statement, _column );
+          if ( std::isnan( value ) ) {
+
+            _writer.append( "NULL" );
+          }
+          else if ( std::isinf( value ) ) {
+
+            _writer.append( value < 0 ? "-1e999" : "1e999" );
+          }
+          else {
+
+            sqlite3_snprintf( static_cast<std::int32_t>( number.size() ), number.data(), "%!.17g", value );
+            _writer.append( std::string_view( number.data() ) );
+          }
+          break;
+        }
+        case SQLITE_TEXT: {
+          const auto *text = reinterpret_cast<const char *>( sqlite3_column_text( _statement, _column ) ); // NOSONAR sqlite text is utf-8
+          const std::string_view view( text, static_cast<std::size_t>( sqlite3_column_bytes( _statement, _column ) ) );
+          _writer.append( '\'' );
+          for ( std::size_t start = 0; start < view.size(); ) {
+
+            const std::size_t quote = std::min( view.find( '\'', start ), view.size() );
+            _writer.append( view.substr( start, quote - start ) );
+            if ( quote < view.size() ) {
+
+              _writer.append( "''" );
+            }
+            start = quote + 1;
+          }
+          _writer.append( '\'' );
+          break;
+        }
+        case SQLITE_BLOB: {
+          const auto *blob = static_cast<const std::uint8_t *>( sqlite3_column_blob( _statement, _column ) );
+          const auto size = static_cast<std::size_t>( sqlite3_column_bytes( _statement, _column ) );
+          _writer.append( "X'" );
+          for ( std::size_t i = 0; i < size; ++i ) {
+
+            _writer.append( hexDigits[ blob[ i ] >> bitsPerHexDigit ] );
+            _writer.append( hexDigits[ blob[ i ] & hexDigitMask ] );
+          }
+          _writer.append( '\'' );
+          break;
+        }
+        default:
+          _writer.append( "NULL" );
+          break;
+      }
+    }
+
+    /**
+     * @brief Append the rows of a table as multi-row INSERT statements.
+     * @param _writer   Writer to append to.
+     * @param _handle   Database handle.
+     * @param _schema   Export schema.
+     * @param _table   Table name.
+     * @param _rowsPerInsert   Maximum number of rows per INSERT statement.
+     * @return Result code and message of operation.
+     */
+    std::error_code appendRows( BufferedWriter &_writer,
+                                sqlite3 *_handle,
+                                const std::string &_schema,
+                                const std::string &_table,
+                                std::size_t _rowsPerInsert ) {
+
+      /* Generated and hidden columns are computed by the importing database */
+      std::error_code error {};
+      const auto xinfo = sqlite3_stmt_make_unique( _handle, "SELECT name FROM pragma_table_xinfo(?1, ?2) WHERE hidden = 0 ORDER BY cid", error );
+      if ( !xinfo ) {
+
+        return error;
+      }
+      sqlite3_bind_text( xinfo.get(), 1, _table.c_str(), -1, SQLITE_STATIC );
+      sqlite3_bind_text( xinfo.get(), 2, _schema.c_str(), -1, SQLITE_STATIC );
+      std::string columnList {};
+      std::int32_t resultCode = SQLITE_OK;
+      while ( ( resultCode = sqlite3_step( xinfo.get() ) ) == SQLITE_ROW ) {
+
+        const std::unique_ptr<char, sqlite3_str_deleter> column( sqlite3_mprintf( "%s\"%w\"", columnList.empty() ? "" : ",", reinterpret_cast<const char *>( sqlite3_column_text( xinfo.get(), 0 ) ) ) ); // NOSONAR sqlite text is utf-8
+        columnList += column.get();
+      }
+      if ( resultCode != SQLITE_DONE ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+      if ( columnList.empty() ) {
+
+        return {};
+      }
+
+      const std::unique_ptr<char, sqlite3_str_deleter> select( sqlite3_mprintf( "SELECT %s FROM \"%w\".\"%w\"", columnList.c_str(), _schema.c_str(), _table.c_str() ) );
+      const std::unique_ptr<char, sqlite3_str_deleter> insert( sqlite3_mprintf( "INSERT INTO \"%w\"(%s) VALUES", _table.c_str(), columnList.c_str() ) );
+      const auto statement = sqlite3_stmt_make_unique( _handle, select.get(), error );
+      if ( !statement ) {
+
+        return error;
+      }
+
+      const std::int32_t columns = sqlite3_column_count( statement.get() );
+      std::size_t rows = 0;
+      while ( ( resultCode = sqlite3_step( statement.get() ) ) == SQLITE_ROW ) {
+
+        _writer.append( rows == 0 ? std::string_view( insert.get() ) : std::string_view( "," ) );
+        _writer.append( '(' );
+        for ( std::int32_t column = 0; column < columns; ++column ) {
+
+          if ( column > 0 ) {
+
+            _writer.append( ',' );
+          }
+          appendValue( _writer, statement.get(), column );
+        }
+        _writer.append( ')' );
+        if ( ++rows == _rowsPerInsert ) {
+
+          _writer.append( ";\n" );
+          rows = 0;
+        }
+      }
+      if ( rows > 0 ) {
+
+        _writer.append( ";\n" );
+      }
+      if ( resultCode != SQLITE_DONE ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+      return {};
+    }
+
+    /**
+     * @brief Check for a transaction statement.
+     * @param _sql   Statement text.
+     * @return True, if the statement begins or ends a transaction - otherwise false.
+     */
+    bool isTransactionStatement( std::string_view _sql ) {
+
+      const std::size_t start = _sql.find_first_not_of( " \t\r\n" );
+      if ( start == std::string_view::npos ) {
+
+        return false;
+      }
+      _sql.remove_prefix( start );
+      for ( const std::string_view keyword : { std::string_view( "BEGIN" ), std::string_view( "COMMIT" ), std::string_view( "END" ), std::string_view( "ROLLBACK" ) } ) {
+
+        if ( _sql.size() < keyword.size() || sqlite3_strnicmp( _sql.data(), keyword.data(), static_cast<std::int32_t>( keyword.size() ) ) != 0 ) {
+
+          continue;
+        }
+        if ( _sql.size() == keyword.size() || std::string_view( " \t\r\n;" ).find( _sql[ keyword.size() ] ) != std::string_view::npos ) {
+
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /**
+     * @brief The TextImport class.
+     * Executes statements in large transactions with reused transaction statements.
+     */
+    class TextImport {
+
+    public:
+      /**
+       * @brief Constructor for TextImport.
+       * @param _handle   Database handle.
+       * @param _statementsPerTransaction   Number of statements per transaction.
+       */
+      TextImport( sqlite3 *_handle,
+                  std::size_t _statementsPerTransaction )
+        : m_handle( _handle ),
+          m_statementsPerTransaction( std::max( std::size_t { 1 }, _statementsPerTransaction ) ),
+          m_begin( sqlite3_stmt_make_unique( _handle, "BEGIN" ) ),
+          m_commit( sqlite3_stmt_make_unique( _handle, "COMMIT" ) ) {}
+
+      /**
+       * @brief Delete copy constructor for TextImport.
+       */
+      TextImport( const TextImport & ) = delete;
+
+      /**
+       * @brief Delete copy assign operator.
+       * @return Nothing.
+       */
+      TextImport &operator=( const TextImport & ) = delete;
+
+      /**
+       * @brief Execute every statement of the sql text.
+       * @param _sql   Complete statements.
+       * @return Result code and message of operation.
+       */
+      std::error_code execute( std::string_view _sql ) {
+
+        while ( !_sql.empty() ) {
+
+          sqlite3_stmt *statementHandle = nullptr;
+          const char *tail = nullptr;
+          if ( const std::int32_t resultCode = sqlite3_prepare_v2( m_handle, _sql.data(), static_cast<std::int32_t>( _sql.size() ), &statementHandle, &tail ); resultCode != SQLITE_OK ) {
+
+            return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+          }
+          const std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> statement { statementHandle };
+          const std::string_view text( _sql.data(), static_cast<std::size_t>( tail - _sql.data() ) );
+          _sql.remove_prefix( text.size() );
+
+          /* Whitespace, comments and transactions of the sql text */
+          if ( !statement || isTransactionStatement( text ) ) {
+
+            continue;
+          }
+
+          if ( !m_transaction ) {
+
+            if ( const std::error_code error = step( m_begin.get() ); error ) {
+
+              return error;
+            }
+            m_transaction = true;
+          }
+          if ( const std::error_code error = step( statement.get() ); error ) {
+
+            return error;
+          }
+          if ( ++m_statements % m_statementsPerTransaction == 0 ) {
+
+            if ( const std::error_code error = commit(); error ) {
+
+              return error;
+            }
+          }
+        }
+        return {};
+      }
+
+      /**
+       * @brief Commit the running transaction.
+       * @return Result code and message of operation.
+       */
+      std::error_code commit() {
+
+        if ( !m_transaction ) {
+
+          return {};
+        }
+        m_transaction = false;
+        return step( m_commit.get() );
+      }
+
+      /**
+       * @brief Roll back the running transaction.
+       */
+      void rollback() {
+
+        if ( m_transaction && sqlite3_get_autocommit( m_handle ) == 0 ) {
+
+          sqlite3_exec( m_handle, "ROLLBACK", nullptr, nullptr, nullptr );
+        }
+        m_transaction = false;
+      }
+
+    private:
+      /**
+       * @brief Step a statement until it is done and reset it.
+       * @param _statement   Statement to step.
+       * @return Result code and message of operation.
+       */
+      std::error_code step( sqlite3_stmt *_statement ) {
+
+        if ( !_statement ) {
+
+          return makeError( SQLITE_ERROR, sqlite3_errmsg( m_handle ) );
+        }
+
+        std::int32_t resultCode = SQLITE_OK;
+        while ( ( resultCode = sqlite3_step( _statement ) ) == SQLITE_ROW ) {}
+        sqlite3_reset( _statement );
+        if ( resultCode != SQLITE_DONE ) {
+
+          return makeError( resultCode, sqlite3_errmsg( m_handle ) );
+        }
+        return {};
+      }
+
+      /**
+       * @brief Member for the database handle.
+       */
+      sqlite3 *m_handle = nullptr;
+
+      /**
+       * @brief Member for the number of statements per transaction.
+       */
+      std::size_t m_statementsPerTransaction = 0;
+
+      /**
+       * @brief Member for the number of executed statements.
+       */
+      std::size_t m_statements = 0;
+
+      /**
+       * @brief Member for a running transaction.
+       */
+      bool m_transaction = false;
+
+      /**
+       * @brief Member for the reused BEGIN statement.
+       */
+      std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> m_begin {};
+
+      /**
+       * @brief Member for the reused COMMIT statement.
+       */
+      std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> m_commit {};
+    };
+
+    /**
+     * @brief The StatementScanner class.
+     * Finds the end of complete statements in a growing sql text - every byte is scanned once.
+     * Only a semicolon outside of literals and comments is verified with sqlite3_complete, which covers trigger bodies.
+     */
+    class StatementScanner {
+
+    public:
+      /**
+       * @brief End of the last complete statement.
+       * The caller removes the complete statements from the front of the text before the next call.
+       * @param _sql   Pending sql text.
+       * @return Size of the complete statements - 0 if there is none.
+       */
+      std::size_t complete( std::string &_sql ) {
+
+        std::size_t end = 0;
+        std::size_t position = m_scanned;
+        for ( ; position < _sql.size(); ++position ) {
+
+          const char current = _sql[ position ];
+          const bool last = position + 1 == _sql.size();
+          switch ( m_state ) {
+            case State::Code:
+              if ( current == '\'' ) {
+
+                m_state = State::Quote;
+                m_close = '\'';
+              }
+              else if ( current == '"' || current == '`' ) {
+
+                m_state = State::Quote;
+                m_close = current;
+              }
+              else if ( current == '[' ) {
+
+                m_state = State::Quote;
+                m_close = ']';
+              }
+              else if ( current == '-' || current == '/' ) {
+
+                /* Comment start may be split between two chunks */
+                if ( last ) {
+
+                  m_scanned = position - end;
+                  return end;
+                }
+                if ( current == '-' && _sql[ position + 1 ] == '-' ) {
+
+                  m_state = State::LineComment;
+                  ++position;
+                }
+                else if ( current == '/' && _sql[ position + 1 ] == '*' ) {
+
+                  m_state = State::BlockComment;
+                  ++position;
+                }
+              }
+              else if ( current == ';' && isComplete( _sql, end, position + 1 ) ) {
+
+                end = position + 1;
+              }
+              break;
+            case State::Quote:
+              if ( current == m_close ) {
+
+                m_state = State::Code;
+              }
+              break;
+            case State::LineComment:
+              if ( current == '\n' ) {
+
+                m_state = State::Code;
+              }
+              break;
+            case State::BlockComment:
+              if ( current == '*' ) {
+
+                if ( last ) {
+
+                  m_scanned = position - end;
+                  return end;
+                }
+                if ( _sql[ position + 1 ] == '/' ) {
+
+                  m_state = State::Code;
+                  ++position;
+                }
+              }
+              break;
+          }
+        }
+        m_scanned = position - end;
+        return end;
+      }
+
+    private:
+      /**
+       * @brief Scanner state.
+       */
+      enum class State {
+        Code,
+        Quote,
+        LineComment,
+        BlockComment
+      };
+
+      /**
+       * @brief Check a statement candidate with sqlite3_complete.
+       * @param _sql   Pending sql text.
+       * @param _begin   Start of the candidate.
+       * @param _end   End of the candidate - behind the semicolon.
+       * @return True, if the candidate is a complete statement - otherwise false.
+       */
+      static bool isComplete( std::string &_sql,
+                              std::size_t _begin,
+                              std::size_t _end ) {
+
+        /* sqlite3_complete needs a terminated string */
+        const char next = _end < _sql.size() ? _sql[ _end ] : '\0';
+        if ( _end < _sql.size() ) {
+
+          _sql[ _end ] = '\0';
+        }
+        const bool complete = sqlite3_complete( _sql.c_str() + _begin ) != 0;
+        if ( _end < _sql.size() ) {
+
+          _sql[ _end ] = next;
+        }
+        return complete;
+      }
+
+      /**
+       * @brief Member for the scanned size behind the last complete statement.
+       */
+      std::size_t m_scanned = 0;
+
+      /**
+       * @brief Member for the scanner state at the scanned size.
+       */
+      State m_state = State::Code;
+
+      /**
+       * @brief Member for the closing character of the current quote.
+       */
+      char m_close = '\0';
+    };
+  }
+
+  std::error_code exportSqlText( sqlite3 *_handle,
+                                 const std::string &_schema,
+                                 std::ostream &_output,
+                                 std::size_t _rowsPerInsert ) {
+
+    const std::unique_ptr<char, sqlite3_str_deleter> sql( sqlite3_mprintf( "SELECT type, name, sql FROM \"%w\".sqlite_schema WHERE sql NOT NULL AND name NOT LIKE 'sqlite\\_%%' ESCAPE '\\' AND name NOT IN (SELECT name FROM pragma_table_list WHERE schema = %Q AND type = 'shadow') ORDER BY type != 'table', rowid", _schema.c_str(), _schema.c_str() ) );
+
+    /* Every table is read from the same snapshot */
+    if ( const std::int32_t resultCode = sqlite3_exec( _handle, "SAVEPOINT vx_export_sql_text", nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode, sqlite3_errmsg( _handle ) );
+    }
+    const auto finish = [ _handle ]( const std::error_code &_error ) {
+      sqlite3_exec( _handle, "RELEASE vx_export_sql_text", nullptr, nullptr, nullptr );
+      return _error;
+    };
+
+    std::error_code error {};
+    auto statement = sqlite3_stmt_make_unique( _handle, sql.get(), error );
+    if ( !statement ) {
+
+      return finish( error );
+    }
+
+    BufferedWriter writer( _output );
+    writer.append( "BEGIN TRANSACTION;\n" );
+    std::int32_t resultCode = SQLITE_OK;
+    while ( ( resultCode = sqlite3_step( statement.get() ) ) == SQLITE_ROW ) {
+
+      const std::string_view type( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ) ); // NOSONAR sqlite text is utf-8
+      const std::string name( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 1 ) ) );     // NOSONAR sqlite text is utf-8
+      const std::string_view create( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 2 ) ) ); // NOSONAR sqlite text is utf-8
+      writer.append( create );
+      writer.append( ";\n" );
+
+      /* Content of virtual tables lives in their shadow tables */
+      if ( type == "table" && sqlite3_strnicmp( create.data(), "CREATE VIRTUAL", 14 ) != 0 ) {
+
+        if ( error = appendRows( writer, _handle, _schema, name, std::max( std::size_t { 1 }, _rowsPerInsert ) ); error ) {
+
+          return finish( error );
+        }
+      }
+    }
+    if ( resultCode != SQLITE_DONE ) {
+
+      return finish( makeError( resultCode, sqlite3_errmsg( _handle ) ) );
+    }
+    statement.reset();
+
+    /* AUTOINCREMENT counters */
+    const std::unique_ptr<char, sqlite3_str_deleter> sequence( sqlite3_mprintf( "SELECT 1 FROM \"%w\".sqlite_schema WHERE name = 'sqlite_sequence'", _schema.c_str() ) );
+    if ( const auto hasSequence = sqlite3_stmt_make_unique( _handle, sequence.get(), error ); hasSequence && sqlite3_step( hasSequence.get() ) == SQLITE_ROW ) {
+
+      writer.append( "DELETE FROM sqlite_sequence;\n" );
+      if ( error = appendRows( writer, _handle, _schema, "sqlite_sequence", std::max( std::size_t { 1 }, _rowsPerInsert ) ); error ) {
+
+        return finish( error );
+      }
+    }
+    sqlite3_exec( _handle, "RELEASE vx_export_sql_text", nullptr, nullptr, nullptr );
+
+    writer.append( "COMMIT;\n" );
+    if ( !writer.flush() ) {
+
+      return makeError( SQLITE_IOERR, "Unable to write the export." );
+    }
+    return {};
+  }
+
+  std::error_code importSqlText( sqlite3 *_handle,
+                                 std::istream &_input,
+                                 std::size_t _statementsPerTransaction ) {
+
+    /* Turn off sync during the import and restore it afterwards */
+    std::int32_t synchronous = -1;
+    if ( const auto query = sqlite3_stmt_make_unique( _handle, "PRAGMA synchronous" ); query && sqlite3_step( query.get() ) == SQLITE_ROW ) {
+
+      synchronous = sqlite3_column_int( query.get(), 0 );
+    }
+    sqlite3_exec( _handle, "PRAGMA synchronous = OFF", nullptr, nullptr, nullptr );
+    const auto restore = [ _handle, synchronous ]( const std::error_code &_error ) {
+      if ( synchronous >= 0 ) {
+
+        const std::unique_ptr<char, sqlite3_str_deleter> pragma( sqlite3_mprintf( "PRAGMA synchronous = %d", synchronous ) );
+        sqlite3_exec( _handle, pragma.get(), nullptr, nullptr, nullptr );
+      }
+      return _error;
+    };
+
+    TextImport import( _handle, _statementsPerTransaction );
+    StatementScanner scanner {};
+    std::string pending {};
+    pending.reserve( readChunkSize * 2 );
+    std::vector<char> chunk( readChunkSize );
+    while ( _input ) {
+
+      _input.read( chunk.data(), static_cast<std::streamsize>( chunk.size() ) );
+      pending.append( chunk.data(), static_cast<std::size_t>( _input.gcount() ) );
+
+      if ( const std::size_t complete = scanner.complete( pending ); complete > 0 ) {
+
+        if ( const std::error_code error = import.execute( std::string_view( pending.data(), complete ) ); error ) {
+
+          import.rollback();
+          return restore( error );
+        }
+        pending.erase( 0, complete );
+      }
+    }
+    if ( _input.bad() ) {
+
+      import.rollback();
+      return restore( makeError( SQLITE_IOERR, "Cannot read data from stream." ) );
+    }
+
+    /* Remaining text is either whitespace or an incomplete statement that fails to prepare */
+    if ( const std::error_code error = import.execute( pending ); error ) {
+
+      import.rollback();
+      return restore( error );
+    }
+    if ( const std::error_code error = import.commit(); error ) {
+
+      import.rollback();
+      return restore( error );
+    }
+    return restore( {} );
+  }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+
+/* stl header */
+#include <iosfwd>
+#include <string>
+#include <system_error>
+
+/* forward declation of sqlite3 */
+struct sqlite3;
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Default number of rows per INSERT statement of a sql text export.
+   */
+  constexpr std::size_t sqlTextRowsPerInsert = 256;
+
+  /**
+   * @brief Default number of statements per transaction of a sql text import.
+   */
+  constexpr std::size_t sqlTextStatementsPerTransaction = 1024;
+
+  /**
+   * @brief Export a schema as portable sql text like the .dump command of the sqlite shell.
+   * Tables are written as CREATE statements followed by multi-row INSERT statements, then indexes, triggers and views.
+   * Every table is read within one savepoint, generated columns are left to the importing database.
+   * @param _handle   Database handle.
+   * @param _schema   Export shema - default is main.
+   * @param _output   Stream to write the sql text to.
+   * @param _rowsPerInsert   Maximum number of rows per INSERT statement.
+   * @return Result code and message of operation.
+   */
+  std::error_code exportSqlText( sqlite3 *_handle,
+                                 const std::string &_schema,
+                                 std::ostream &_output,
+                                 std::size_t _rowsPerInsert = sqlTextRowsPerInsert );
+
+  /**
+   * @brief Import sql text statement by statement.
+   * Statements are executed in large transactions with synchronous turned off during the import.
+   * Transaction statements of the sql text are skipped.
+   * @param _handle   Database handle.
+   * @param _input   Stream to read the sql text from.
+   * @param _statementsPerTransaction   Number of statements per transaction.
+   * @return Result code and message of operation.
+   */
+  std::error_code importSqlText( sqlite3 *_handle,
+                                 std::istream &_input,
+                                 std::size_t _statementsPerTransaction = sqlTextStatementsPerTransaction );
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::uint32_t
+
+/* stl header */
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteStatementCache.h"
+
+namespace vx::sqlite_utils {
+
+  CachedStatement::CachedStatement( sqlite3_stmt *_statement,
+                                    bool *_leased ) noexcept
+    : m_statement( _statement ),
+      m_leased( _leased ) {}
+
+  CachedStatement::CachedStatement( std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> _statement ) noexcept
+    : m_statement( _statement.get() ),
+      m_owned( std::move( _statement ) ) {}
+
+  CachedStatement::CachedStatement( CachedStatement &&_statement ) noexcept
+    : m_statement( std::exchange( _statement.m_statement, nullptr ) ),
+      m_leased( std::exchange( _statement.m_leased, nullptr ) ),
+      m_owned( std::move( _statement.m_owned ) ) {}
+
+  CachedStatement::~CachedStatement() {
+
+    release();
+  }
+
+  CachedStatement &CachedStatement::operator=( CachedStatement &&_statement ) noexcept {
+
+    if ( this != &_statement ) {
+
+      release();
+      m_statement = std::exchange( _statement.m_statement, nullptr );
+      m_leased = std::exchange( _statement.m_leased, nullptr );
+      m_owned = std::move( _statement.m_owned );
+    }
+    return *this;
+  }
+
+  void CachedStatement::release() noexcept {
+
+    if ( m_leased ) {
+
+      sqlite3_reset( m_statement );
+      sqlite3_clear_bindings( m_statement );
+      *m_leased = false;
+    }
+    m_statement = nullptr;
+    m_leased = nullptr;
+    m_owned.reset();
+  }
+
+  StatementCache::StatementCache( sqlite3 *_handle,
+                                  std::size_t _capacity ) noexcept
+    : m_handle( _handle ),
+      m_capacity( _capacity ) {}
+
+  CachedStatement StatementCache::prepare( std::string_view _sql,
+                                           std::error_code &_error ) {
+
+    _error.clear();
+    if ( const auto found = m_lookup.find( _sql ); found != m_lookup.end() ) {
+
+      Entry &entry = *found->second;
+      if ( !entry.leased ) {
+
+        ++m_metrics.hits;
+        m_entries.splice( m_entries.begin(), m_entries, found->second );
+        entry.leased = true;
+        return { entry.statement.get(), &entry.leased };
+      }
+
+      /* Already leased - a short-lived statement of its own */
+      ++m_metrics.misses;
+      auto statement = compile( _sql, 0, _error );
+      return statement ? CachedStatement( std::move( statement ) ) : CachedStatement();
+    }
+
+    ++m_metrics.misses;
+    if ( m_entries.size() >= m_capacity && !evict() ) {
+
+      auto statement = compile( _sql, 0, _error );
+      return statement ? CachedStatement( std::move( statement ) ) : CachedStatement();
+    }
+
+    auto statement = compile( _sql, SQLITE_PREPARE_PERSISTENT, _error );
+    if ( !statement ) {
+
+      return {};
+    }
+    m_entries.push_front( { std::string( _sql ), std::move( statement ), true } );
+    Entry &entry = m_entries.front();
+    m_lookup.emplace( entry.sql, m_entries.begin() );
+    return { entry.statement.get(), &entry.leased };
+  }
+
+  std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> StatementCache::compile( std::string_view _sql,
+                                                                               std::uint32_t _flags,
+                                                                               std::error_code &_error ) const {
+
+    sqlite3_stmt *statementHandle = nullptr;
+    const std::int32_t resultCode = sqlite3_prepare_v3( m_handle, _sql.data(), static_cast<std::int32_t>( _sql.size() ), _flags, &statementHandle, nullptr );
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> statement { statementHandle };
+    if ( resultCode != SQLITE_OK ) {
+
+      _error = makeError( resultCode, sqlite3_errmsg( m_handle ) );
+      statement.reset();
+    }
+    else if ( !statement ) {
+
+      _error = makeError( SQLITE_MISUSE, "Sql text holds no statement." );
+    }
+    return statement;
+  }
+
+  bool StatementCache::evict() noexcept {
+
+    for ( auto entry = m_entries.end(); entry != m_entries.begin(); ) {
+
+      --entry;
+      if ( !entry->leased ) {
+
+        m_lookup.erase( entry->sql );
+        m_entries.erase( entry );
+        ++m_metrics.evictions;
+        return true;
+      }
+    }
+    return false;
+  }
+}
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+/* stl header */
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+
+/* sqlite_functions */
+#include "SqliteUtils.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Default number of cached statements per connection.
+   */
+  constexpr std::size_t statementCacheCapacity = 64;
+
+  /**
+   * @brief The CacheMetrics struct.
+   */
+  struct CacheMetrics {
+
+    /**
+     * @brief Member for the lookups served from the cache.
+     */
+    std::uint64_t hits = 0;
+
+    /**
+     * @brief Member for the lookups that prepared a statement.
+     */
+    std::uint64_t misses = 0;
+
+    /**
+     * @brief Member for the statements evicted from the cache.
+     */
+    std::uint64_t evictions = 0;
+
+    /**
+     * @brief Ratio of lookups served from the cache.
+     * @return Hit rate between 0 and 1.
+     */
+    [[nodiscard]] double hitRate() const noexcept { return hits + misses == 0 ? 0.0 : static_cast<double>( hits ) / static_cast<double>( hits + misses ); }
+  };
+
+  /**
+   * @brief The CachedStatement class.
+   * Resets the statement and clears its bindings on destruction.
+   */
+  class CachedStatement {
+
+  public:
+    /**
+     * @brief Default constructor for CachedStatement.
+     */
+    CachedStatement() noexcept = default;
+
+    /**
+     * @brief Constructor for CachedStatement of a cached statement.
+     * @param _statement   Cached statement.
+     * @param _leased   Lease flag of the cache entry.
+     */
+    CachedStatement( sqlite3_stmt *_statement,
+                     bool *_leased ) noexcept;
+
+    /**
+     * @brief Constructor for CachedStatement of an uncached statement.
+     * @param _statement   Statement owned by the lease.
+     */
+    explicit CachedStatement( std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> _statement ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for CachedStatement.
+     */
+    CachedStatement( const CachedStatement & ) = delete;
+
+    /**
+     * @brief Move constructor for CachedStatement.
+     * @param _statement   Statement to take over.
+     */
+    CachedStatement( CachedStatement &&_statement ) noexcept;
+
+    /**
+     * @brief Destructor for CachedStatement - returns the statement.
+     */
+    ~CachedStatement();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    CachedStatement &operator=( const CachedStatement & ) = delete;
+
+    /**
+     * @brief Move assign operator.
+     * @param _statement   Statement to take over.
+     * @return This statement.
+     */
+    CachedStatement &operator=( CachedStatement &&_statement ) noexcept;
+
+    /**
+     * @brief Leased statement.
+     * @return Statement handle or nullptr.
+     */
+    [[nodiscard]] sqlite3_stmt *get() const noexcept { return m_statement; }
+
+    /**
+     * @brief Check for a leased statement.
+     * @return True, if a statement is leased - otherwise false.
+     */
+    explicit operator bool() const noexcept { return m_statement != nullptr; }
+
+  private:
+    /**
+     * @brief Reset the statement and return it.
+     */
+    void release() noexcept;
+
+    /**
+     * @brief Member for the statement.
+     */
+    sqlite3_stmt *m_statement = nullptr;
+
+    /**
+     * @brief Member for the lease flag of the cache entry.
+     */
+    bool *m_leased = nullptr;
+
+    /**
+     * @brief Member for a statement that did not fit into the cache.
+     */
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> m_owned {};
+  };
+
+  /**
+   * @brief The StatementCache class.
+   * LRU cache of statements prepared with SQLITE_PREPARE_PERSISTENT for one connection.
+   * The cache is not thread-safe and must outlive its leases and be destroyed before the connection.
+   */
+  class StatementCache {
+
+  public:
+    /**
+     * @brief Constructor for StatementCache.
+     * @param _handle   Database handle.
+     * @param _capacity   Maximum number of cached statements.
+     */
+    explicit StatementCache( sqlite3 *_handle,
+                             std::size_t _capacity = statementCacheCapacity ) noexcept;
+
+    /**
+     * @brief Delete copy constructor for StatementCache.
+     */
+    StatementCache( const StatementCache & ) = delete;
+
+    /**
+     * @brief Move constructor for StatementCache.
+     */
+    StatementCache( StatementCache && ) noexcept = default;
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    StatementCache &operator=( const StatementCache & ) = delete;
+
+    /**
+     * @brief Move assign operator.
+     * @return This cache.
+     */
+    StatementCache &operator=( StatementCache && ) noexcept = default;
+
+    /**
+     * @brief Lease a statement for sql text.
+     * Leased statements are not shared - a second lease of the same text gets an uncached statement.
+     * @param _sql   Sql command.
+     * @param _error   Error code.
+     * @return Leased statement - empty on error.
+     */
+    CachedStatement prepare( std::string_view _sql,
+                             std::error_code &_error );
+
+    /**
+     * @brief Number of cached statements.
+     * @return Cached statements.
+     */
+    [[nodiscard]] std::size_t size() const noexcept { return m_entries.size(); }
+
+    /**
+     * @brief Counters of the cache.
+     * @return Hits, misses and evictions.
+     */
+    [[nodiscard]] CacheMetrics metrics() const noexcept { return m_metrics; }
+
+  private:
+    /**
+     * @brief The Entry struct.
+     */
+    struct Entry {
+
+      /**
+       * @brief Member for the sql text - the lookup key refers to it.
+       */
+      std::string sql {};
+
+      /**
+       * @brief Member for the prepared statement.
+       */
+      std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> statement {};
+
+      /**
+       * @brief Member for a leased statement.
+       */
+      bool leased = false;
+    };
+
+    /**
+     * @brief Prepare a statement.
+     * @param _sql   Sql command.
+     * @param _flags   Prepare flags.
+     * @param _error   Error code.
+     * @return Statement or nullptr on error.
+     */
+    std::unique_ptr<sqlite3_stmt, sqlite3_stmt_deleter> compile( std::string_view _sql,
+                                                                 std::uint32_t _flags,
+                                                                 std::error_code &_error ) const;
+
+    /**
+     * @brief Evict the least recently used entry that is not leased.
+     * @return True, if an entry was evicted - otherwise false.
+     */
+    bool evict() noexcept;
+
+    /**
+     * @brief Member for the database handle.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the maximum number of cached statements.
+     */
+    std::size_t m_capacity = 0;
+
+    /**
+     * @brief Member for the entries - most recently used first.
+     */
+    std::list<Entry> m_entries {};
+
+    /**
+     * @brief Member for the lookup by sql text without copy.
+     */
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_lookup {};
+
+    /**
+     * @brief Member for the counters.
+     */
+    CacheMetrics m_metrics {};
+  };
+}
@@ -0,0 +1,657 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::uint64_t
+
+/* stl header */
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* modern.cpp.core */
+#include <Singleton.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteTrackingVfs.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Tracking granularity - the smallest possible page size.
+     */
+    constexpr std::uint64_t blockSize = 512;
+
+    /**
+     * @brief Bits per bitmap word.
+     */
+    constexpr std::uint64_t bitsPerWord = 64;
+
+    /**
+     * @brief Pages of a block bitmap.
+     * @param _bitmap   Bitmap - one bit per block.
+     * @param _pageSize   Page size of the database.
+     * @return Sorted page numbers starting at 1.
+     */
+    std::vector<std::uint32_t> bitmapPages( const std::vector<std::uint64_t> &_bitmap,
+                                            std::uint32_t _pageSize ) {
+
+      std::vector<std::uint32_t> result {};
+      for ( std::size_t word = 0; word < _bitmap.size(); ++word ) {
+
+        if ( _bitmap[ word ] == 0 ) {
+
+          continue;
+        }
+        for ( std::uint64_t bit = 0; bit < bitsPerWord; ++bit ) {
+
+          if ( ( ( _bitmap[ word ] >> bit ) & 1 ) == 0 ) {
+
+            continue;
+          }
+          const std::uint64_t block = word * bitsPerWord + bit;
+          const auto page = static_cast<std::uint32_t>( block * blockSize / _pageSize + 1 );
+          if ( result.empty() || result.back() != page ) {
+
+            result.push_back( page );
+          }
+        }
+      }
+      return result;
+    }
+
+    /**
+     * @brief The DirtyBlocks class.
+     * Bitmap of written blocks of one database file.
+     */
+    class DirtyBlocks {
+
+    public:
+      /**
+       * @brief Mark a written range.
+       * @param _offset   Write offset.
+       * @param _amount   Written bytes.
+       */
+      void mark( std::uint64_t _offset,
+                 std::uint64_t _amount ) {
+
+        if ( _amount == 0 ) {
+
+          return;
+        }
+
+        const std::uint64_t first = _offset / blockSize;
+        const std::uint64_t last = ( _offset + _amount - 1 ) / blockSize;
+        const std::lock_guard lock( m_mutex );
+        if ( const auto words = static_cast<std::size_t>( last / bitsPerWord + 1 ); m_bitmap.size() < words ) {
+
+          m_bitmap.resize( words );
+        }
+        for ( std::uint64_t block = first; block <= last; ++block ) {
+
+          m_bitmap[ static_cast<std::size_t>( block / bitsPerWord ) ] |= std::uint64_t { 1 } << ( block % bitsPerWord );
+        }
+      }
+
+      /**
+       * @brief Written pages.
+       * @param _pageSize   Page size of the database.
+       * @return Sorted page numbers starting at 1.
+       */
+      [[nodiscard]] std::vector<std::uint32_t> pages( std::uint32_t _pageSize ) const {
+
+        const std::lock_guard lock( m_mutex );
+        return bitmapPages( m_bitmap, _pageSize );
+      }
+
+      /**
+       * @brief Written pages - the bitmap is swapped for an empty one.
+       * Blocks written afterwards are tracked for the next call.
+       * @param _pageSize   Page size of the database.
+       * @return Sorted page numbers starting at 1.
+       */
+      [[nodiscard]] std::vector<std::uint32_t> take( std::uint32_t _pageSize ) {
+
+        std::vector<std::uint64_t> bitmap {};
+        {
+          const std::lock_guard lock( m_mutex );
+          bitmap.swap( m_bitmap );
+        }
+        return bitmapPages( bitmap, _pageSize );
+      }
+
+      /**
+       * @brief Forget every written block.
+       */
+      void reset() {
+
+        const std::lock_guard lock( m_mutex );
+        m_bitmap.clear();
+      }
+
+    private:
+      /**
+       * @brief Member for guarding the bitmap.
+       */
+      mutable std::mutex m_mutex {};
+
+      /**
+       * @brief Member for the bitmap - one bit per block.
+       */
+      std::vector<std::uint64_t> m_bitmap {};
+    };
+
+    /**
+     * @brief The TrackingRegistry class.
+     * Tracked database files by full path - outlives the connections.
+     */
+    class TrackingRegistry final : public Singleton<TrackingRegistry> {
+
+    public:
+      /**
+       * @brief Tracking of a database file - created on demand.
+       * @param _filename   Full path of the database file.
+       * @return Tracking of the database file.
+       */
+      [[nodiscard]] DirtyBlocks *acquire( const std::string &_filename ) {
+
+        const std::lock_guard lock( m_mutex );
+        std::unique_ptr<DirtyBlocks> &blocks = m_files[ _filename ];
+        if ( !blocks ) {
+
+          blocks = std::make_unique<DirtyBlocks>();
+        }
+        return blocks.get();
+      }
+
+      /**
+       * @brief Tracking of a database file.
+       * @param _filename   Full path of the database file.
+       * @return Tracking of the database file or nullptr, if not tracked.
+       */
+      [[nodiscard]] DirtyBlocks *find( const std::string &_filename ) const {
+
+        const std::lock_guard lock( m_mutex );
+        const auto iterator = m_files.find( _filename );
+        return iterator == std::cend( m_files ) ? nullptr : iterator->second.get();
+      }
+
+    private:
+      /**
+       * @brief Member for guarding the tracked files.
+       */
+      mutable std::mutex m_mutex {};
+
+      /**
+       * @brief Member for the tracked files.
+       */
+      std::map<std::string, std::unique_ptr<DirtyBlocks>> m_files {};
+    };
+
+    /**
+     * @brief The TrackingFile struct.
+     * Followed in memory by the file of the underlying vfs.
+     */
+    struct TrackingFile {
+
+      /** @brief Base class - needs to be the first member. */
+      sqlite3_file base;
+
+      /** @brief Tracking of the main database file - nullptr for other files. */
+      DirtyBlocks *blocks;
+
+      /** @brief File of the underlying vfs. */
+      sqlite3_file *real;
+    };
+
+    /**
+     * @brief Underlying file of a tracking file.
+     * @param _file   Tracking file.
+     * @return File of the underlying vfs.
+     */
+    sqlite3_file *realFile( sqlite3_file *_file ) noexcept { return reinterpret_cast<TrackingFile *>( _file )->real; } // NOSONAR sqlite3_file is the first member
+
+    /**
+     * @brief Underlying vfs of the tracking vfs.
+     * @param _vfs   Tracking vfs.
+     * @return Underlying vfs.
+     */
+    sqlite3_vfs *realVfs( sqlite3_vfs *_vfs ) noexcept { return static_cast<sqlite3_vfs *>( _vfs->pAppData ); }
+
+    /*
+     * Io methods forward to the underlying file - only xWrite of the main database file is tracked.
+     */
+    std::int32_t trackingClose( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xClose( real );
+    }
+
+    std::int32_t trackingRead( sqlite3_file *_file,
+                               void *_buffer, // NOSONAR sqlite api
+                               std::int32_t _amount,
+                               sqlite3_int64 _offset ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xRead( real, _buffer, _amount, _offset );
+    }
+
+    std::int32_t trackingWrite( sqlite3_file *_file,
+                                const void *_buffer, // NOSONAR sqlite api
+                                std::int32_t _amount,
+                                sqlite3_int64 _offset ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      const std::int32_t resultCode = real->pMethods->xWrite( real, _buffer, _amount, _offset );
+      if ( DirtyBlocks *blocks = reinterpret_cast<TrackingFile *>( _file )->blocks; resultCode == SQLITE_OK && blocks ) { // NOSONAR sqlite3_file is the first member
+
+        try {
+
+          blocks->mark( static_cast<std::uint64_t>( _offset ), static_cast<std::uint64_t>( _amount ) );
+        }
+        catch ( const std::bad_alloc & ) {
+
+          return SQLITE_IOERR_NOMEM;
+        }
+      }
+      return resultCode;
+    }
+
+    std::int32_t trackingTruncate( sqlite3_file *_file,
+                                   sqlite3_int64 _size ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xTruncate( real, _size );
+    }
+
+    std::int32_t trackingSync( sqlite3_file *_file,
+                               std::int32_t _flags ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xSync( real, _flags );
+    }
+
+    std::int32_t trackingFileSize( sqlite3_file *_file,
+                                   sqlite3_int64 *_size ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xFileSize( real, _size );
+    }
+
+    std::int32_t trackingLock( sqlite3_file *_file,
+                               std::int32_t _lock ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xLock( real, _lock );
+    }
+
+    std::int32_t trackingUnlock( sqlite3_file *_file,
+                                 std::int32_t _lock ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xUnlock( real, _lock );
+    }
+
+    std::int32_t trackingCheckReservedLock( sqlite3_file *_file,
+                                            std::int32_t *_result ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xCheckReservedLock( real, _result );
+    }
+
+    std::int32_t trackingFileControl( sqlite3_file *_file,
+                                      std::int32_t _operation,
+                                      void *_argument ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xFileControl( real, _operation, _argument );
+    }
+
+    std::int32_t trackingSectorSize( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xSectorSize( real );
+    }
+
+    std::int32_t trackingDeviceCharacteristics( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xDeviceCharacteristics( real );
+    }
+
+    std::int32_t trackingShmMap( sqlite3_file *_file,
+                                 std::int32_t _region,
+                                 std::int32_t _size,
+                                 std::int32_t _extend,
+                                 void volatile **_memory ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xShmMap( real, _region, _size, _extend, _memory );
+    }
+
+    std::int32_t trackingShmLock( sqlite3_file *_file,
+                                  std::int32_t _offset,
+                                  std::int32_t _count,
+                                  std::int32_t _flags ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xShmLock( real, _offset, _count, _flags );
+    }
+
+    void trackingShmBarrier( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      real->pMethods->xShmBarrier( real );
+    }
+
+    std::int32_t trackingShmUnmap( sqlite3_file *_file,
+                                   std::int32_t _delete ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xShmUnmap( real, _delete );
+    }
+
+    std::int32_t trackingFetch( sqlite3_file *_file,
+                                sqlite3_int64 _offset,
+                                std::int32_t _amount,
+                                void **_pointer ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xFetch( real, _offset, _amount, _pointer );
+    }
+
+    std::int32_t trackingUnfetch( sqlite3_file *_file,
+                                  sqlite3_int64 _offset,
+                                  void *_pointer ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xUnfetch( real, _offset, _pointer );
+    }
+
+    /**
+     * @brief Io methods of the tracking vfs - version 3 like the unix and win32 vfs.
+     */
+    const sqlite3_io_methods trackingIoMethods = {
+      3,
+      trackingClose,
+      trackingRead,
+      trackingWrite,
+      trackingTruncate,
+      trackingSync,
+      trackingFileSize,
+      trackingLock,
+      trackingUnlock,
+      trackingCheckReservedLock,
+      trackingFileControl,
+      trackingSectorSize,
+      trackingDeviceCharacteristics,
+      trackingShmMap,
+      trackingShmLock,
+      trackingShmBarrier,
+      trackingShmUnmap,
+      trackingFetch,
+      trackingUnfetch
+    };
+
+    /*
+     * Vfs methods forward to the underlying vfs - xOpen wraps the file.
+     */
+    std::int32_t trackingOpen( sqlite3_vfs *_vfs,
+                               const char *_name,
+                               sqlite3_file *_file,
+                               std::int32_t _flags,
+                               std::int32_t *_outFlags ) noexcept {
+
+      auto *file = reinterpret_cast<TrackingFile *>( _file ); // NOSONAR sqlite3_file is the first member
+      file->base.pMethods = nullptr;
+      file->blocks = nullptr;
+      file->real = reinterpret_cast<sqlite3_file *>( file + 1 ); // NOSONAR underlying file follows in the same allocation
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      const std::int32_t resultCode = real->xOpen( real, _name, file->real, _flags, _outFlags );
+      if ( resultCode != SQLITE_OK || !file->real->pMethods ) {
+
+        return resultCode;
+      }
+
+      if ( ( _flags & SQLITE_OPEN_MAIN_DB ) != 0 && _name ) {
+
+        try {
+
+          file->blocks = TrackingRegistry::instance().acquire( _name );
+        }
+        catch ( const std::bad_alloc & ) {
+
+          file->real->pMethods->xClose( file->real );
+          return SQLITE_NOMEM;
+        }
+      }
+      file->base.pMethods = &trackingIoMethods;
+      return resultCode;
+    }
+
+    std::int32_t trackingDelete( sqlite3_vfs *_vfs,
+                                 const char *_name,
+                                 std::int32_t _syncDirectory ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xDelete( real, _name, _syncDirectory );
+    }
+
+    std::int32_t trackingAccess( sqlite3_vfs *_vfs,
+                                 const char *_name,
+                                 std::int32_t _flags,
+                                 std::int32_t *_result ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xAccess( real, _name, _flags, _result );
+    }
+
+    std::int32_t trackingFullPathname( sqlite3_vfs *_vfs,
+                                       const char *_name,
+                                       std::int32_t _size,
+                                       char *_output ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xFullPathname( real, _name, _size, _output );
+    }
+
+    void *trackingDlOpen( sqlite3_vfs *_vfs,
+                          const char *_filename ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xDlOpen( real, _filename );
+    }
+
+    void trackingDlError( sqlite3_vfs *_vfs,
+                          std::int32_t _size,
+                          char *_message ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      real->xDlError( real, _size, _message );
+    }
+
+    void ( *trackingDlSym( sqlite3_vfs *_vfs,
+                           void *_library, // NOSONAR sqlite api
+                           const char *_symbol ) noexcept )( void ) {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xDlSym( real, _library, _symbol );
+    }
+
+    void trackingDlClose( sqlite3_vfs *_vfs,
+                          void *_library ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      real->xDlClose( real, _library );
+    }
+
+    std::int32_t trackingRandomness( sqlite3_vfs *_vfs,
+                                     std::int32_t _size,
+                                     char *_output ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xRandomness( real, _size, _output );
+    }
+
+    std::int32_t trackingSleep( sqlite3_vfs *_vfs,
+                                std::int32_t _microseconds ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xSleep( real, _microseconds );
+    }
+
+    std::int32_t trackingCurrentTime( sqlite3_vfs *_vfs,
+                                      double *_time ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xCurrentTime( real, _time );
+    }
+
+    std::int32_t trackingGetLastError( sqlite3_vfs *_vfs,
+                                       std::int32_t _size,
+                                       char *_message ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xGetLastError ? real->xGetLastError( real, _size, _message ) : 0;
+    }
+
+    std::int32_t trackingCurrentTimeInt64( sqlite3_vfs *_vfs,
+                                           sqlite3_int64 *_time ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xCurrentTimeInt64( real, _time );
+    }
+  }
+
+  std::error_code registerTrackingVfs( bool _makeDefault ) {
+
+    static std::mutex mutex {};
+    const std::lock_guard lock( mutex );
+
+    if ( sqlite3_vfs *registered = sqlite3_vfs_find( trackingVfsName.data() ); registered ) {
+
+      if ( const std::int32_t resultCode = sqlite3_vfs_register( registered, _makeDefault ? 1 : 0 ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode );
+      }
+      return {};
+    }
+
+    sqlite3_vfs *real = sqlite3_vfs_find( nullptr );
+    if ( !real || real->iVersion < 2 ) {
+
+      return makeError( SQLITE_ERROR, "No default vfs to track." );
+    }
+
+    /* Registered vfs need to live until the process ends */
+    static sqlite3_vfs vfs {};
+    vfs.iVersion = 2;
+    vfs.szOsFile = static_cast<std::int32_t>( sizeof( TrackingFile ) ) + real->szOsFile;
+    vfs.mxPathname = real->mxPathname;
+    vfs.zName = trackingVfsName.data();
+    vfs.pAppData = real;
+    vfs.xOpen = trackingOpen;
+    vfs.xDelete = trackingDelete;
+    vfs.xAccess = trackingAccess;
+    vfs.xFullPathname = trackingFullPathname;
+    vfs.xDlOpen = trackingDlOpen;
+    vfs.xDlError = trackingDlError;
+    vfs.xDlSym = trackingDlSym;
+    vfs.xDlClose = trackingDlClose;
+    vfs.xRandomness = trackingRandomness;
+    vfs.xSleep = trackingSleep;
+    vfs.xCurrentTime = trackingCurrentTime;
+    vfs.xGetLastError = trackingGetLastError;
+    vfs.xCurrentTimeInt64 = trackingCurrentTimeInt64;
+
+    if ( const std::int32_t resultCode = sqlite3_vfs_register( &vfs, _makeDefault ? 1 : 0 ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode );
+    }
+    return {};
+  }
+
+  std::optional<std::vector<std::uint32_t>> dirtyPages( const std::string &_filename,
+                                                        std::uint32_t _pageSize ) {
+
+    const DirtyBlocks *blocks = TrackingRegistry::instance().find( _filename );
+    if ( !blocks || _pageSize == 0 ) {
+
+      return std::nullopt;
+    }
+    return blocks->pages( _pageSize );
+  }
+
+  std::optional<std::vector<std::uint32_t>> takeDirtyPages( const std::string &_filename,
+                                                            std::uint32_t _pageSize ) {
+
+    DirtyBlocks *blocks = TrackingRegistry::instance().find( _filename );
+    if ( !blocks || _pageSize == 0 ) {
+
+      return std::nullopt;
+    }
+    return blocks->take( _pageSize );
+  }
+
+  void restoreDirtyPages( const std::string &_filename,
+                          const std::vector<std::uint32_t> &_pages,
+                          std::uint32_t _pageSize ) {
+
+    DirtyBlocks *blocks = TrackingRegistry::instance().find( _filename );
+    if ( !blocks ) {
+
+      return;
+    }
+    for ( const std::uint32_t page : _pages ) {
+
+      blocks->mark( static_cast<std::uint64_t>( page - 1 ) * _pageSize, _pageSize );
+    }
+  }
+
+  void resetDirtyPages( const std::string &_filename ) {
+
+    if ( DirtyBlocks *blocks = TrackingRegistry::instance().find( _filename ); blocks ) {
+
+      blocks->reset();
+    }
+  }
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstdint> // std::uint32_t
+
+/* stl header */
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Name of the dirty page tracking vfs.
+   */
+  constexpr std::string_view trackingVfsName = "vx_tracking";
+
+  /**
+   * @brief Register the dirty page tracking vfs on top of the default vfs.
+   * Open a database with vfs=vx_tracking to record the written pages of its main database file.
+   * @param _makeDefault   Use the tracking vfs for every following sqlite3_open.
+   * @return Result code and message of operation.
+   */
+  std::error_code registerTrackingVfs( bool _makeDefault = false );
+
+  /**
+   * @brief Pages written since the last reset.
+   * @param _filename   Full path of the database file - see sqlite3_db_filename.
+   * @param _pageSize   Page size of the database.
+   * @return Sorted page numbers starting at 1 or nullopt, if the file is not tracked.
+   */
+  [[nodiscard]] std::optional<std::vector<std::uint32_t>> dirtyPages( const std::string &_filename,
+                                                                      std::uint32_t _pageSize );
+
+  /**
+   * @brief Pages written since the last reset - tracking restarts with an empty bitmap.
+   * The bitmap is swapped under the tracking mutex, a write after the call is part of the next call.
+   * @param _filename   Full path of the database file - see sqlite3_db_filename.
+   * @param _pageSize   Page size of the database.
+   * @return Sorted page numbers starting at 1 or nullopt, if the file is not tracked.
+   */
+  [[nodiscard]] std::optional<std::vector<std::uint32_t>> takeDirtyPages( const std::string &_filename,
+                                                                          std::uint32_t _pageSize );
+
+  /**
+   * @brief Mark taken pages as written again - e.g. after a failed export.
+   * @param _filename   Full path of the database file - see sqlite3_db_filename.
+   * @param _pages   Page numbers starting at 1.
+   * @param _pageSize   Page size of the database.
+   */
+  void restoreDirtyPages( const std::string &_filename,
+                          const std::vector<std::uint32_t> &_pages,
+                          std::uint32_t _pageSize );
+
+  /**
+   * @brief Forget every written page.
+   * @param _filename   Full path of the database file - see sqlite3_db_filename.
+   */
+  void resetDirtyPages( const std::string &_filename );
+}
@@ -0,0 +1,1404 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_IO_URING
+/* c header */
+  #include <cerrno> // errno, EINTR
+  #include <cstdint> // std::int32_t, std::uint32_t, std::uint64_t, std::uint8_t, std::uintptr_t
+  #include <cstdlib> // std::aligned_alloc, std::free, std::strtol
+  #include <cstring> // std::memcpy, std::memset
+
+/* system header */
+  #include <dirent.h>
+  #include <fcntl.h>
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+
+/* stl header */
+  #include <algorithm>
+  #include <array>
+  #include <map>
+  #include <memory>
+  #include <mutex>
+  #include <new>
+  #include <optional>
+  #include <string_view>
+  #include <system_error>
+  #include <tuple> // std::ignore
+  #include <utility>
+
+/* sqlite header */
+  #include <sqlite3.h>
+
+/* modern.cpp.core */
+  #include <Singleton.h>
+
+/* local header */
+  #include "SqliteError.h"
+  #include "SqliteUringVfs.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Submission queue entries per file - two read-ahead windows and one synchronous io.
+     */
+    constexpr std::uint32_t ringEntries = 4;
+
+    /**
+     * @brief Alignment of buffers, offsets and sizes for O_DIRECT.
+     */
+    constexpr std::size_t directAlignment = 4096;
+
+    /**
+     * @brief Tag of synchronous io - read-ahead windows use their index.
+     */
+    constexpr std::uint64_t syncTag = 2;
+
+    /**
+     * @brief Sequential reads in a row before the read-ahead starts.
+     */
+    constexpr std::uint32_t readAheadStreak = 2;
+
+    /**
+     * @brief Round up to the direct io alignment.
+     * @param _size   Size to round.
+     * @return Aligned size.
+     */
+    constexpr std::size_t alignUp( std::size_t _size ) noexcept { return ( _size + directAlignment - 1 ) / directAlignment * directAlignment; }
+
+    /**
+     * @brief The aligned_deleter struct.
+     */
+    struct aligned_deleter {
+
+      /**
+       * @brief Aligned operator ().
+       * @param _what   To std::free.
+       */
+      void operator()( std::uint8_t *_what ) const noexcept { std::free( _what ); } // NOSONAR allocated with std::aligned_alloc
+    };
+
+    /**
+     * @brief Buffer aligned for O_DIRECT.
+     */
+    using AlignedBuffer = std::unique_ptr<std::uint8_t, aligned_deleter>;
+
+    /**
+     * @brief The Ring class.
+     * Minimal io_uring with one submitter - the connection that owns the file.
+     */
+    class Ring {
+
+    public:
+      /**
+       * @brief Default constructor for Ring.
+       */
+      Ring() noexcept = default;
+
+      /**
+       * @brief Delete copy constructor for Ring.
+       */
+      Ring( const Ring & ) = delete;
+
+      /**
+       * @brief Delete move constructor for Ring.
+       */
+      Ring( Ring && ) = delete;
+
+      /**
+       * @brief Destructor for Ring - unmaps the queues and closes the ring.
+       */
+      ~Ring() {
+
+        if ( m_sqes != MAP_FAILED ) {
+
+          munmap( m_sqes, m_sqesSize );
+        }
+        if ( m_cqRing != MAP_FAILED && m_cqRing != m_sqRing ) {
+
+          munmap( m_cqRing, m_cqSize );
+        }
+        if ( m_sqRing != MAP_FAILED ) {
+
+          munmap( m_sqRing, m_sqSize );
+        }
+        if ( m_fd >= 0 ) {
+
+          close( m_fd );
+        }
+      }
+
+      /**
+       * @brief Delete copy assign operator.
+       * @return Nothing.
+       */
+      Ring &operator=( const Ring & ) = delete;
+
+      /**
+       * @brief Delete move assign operator.
+       * @return Nothing.
+       */
+      Ring &operator=( Ring && ) = delete;
+
+      /**
+       * @brief Set up the ring and map its queues.
+       * @param _entries   Submission queue entries.
+       * @return True, if io_uring is available - otherwise false.
+       */
+      bool open( std::uint32_t _entries ) noexcept {
+
+        io_uring_params params {};
+        const long fd = syscall( __NR_io_uring_setup, _entries, &params );
+        if ( fd < 0 ) {
+
+          return false;
+        }
+        m_fd = static_cast<int>( fd );
+
+        m_sqSize = params.sq_off.array + params.sq_entries * sizeof( std::uint32_t );
+        m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+        const bool singleMmap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+        if ( singleMmap ) {
+
+          m_sqSize = std::max( m_sqSize, m_cqSize );
+          m_cqSize = m_sqSize;
+        }
+        m_sqRing = mmap( nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING );
+        if ( m_sqRing == MAP_FAILED ) {
+
+          return false;
+        }
+        m_cqRing = singleMmap ? m_sqRing : mmap( nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING );
+        if ( m_cqRing == MAP_FAILED ) {
+
+          return false;
+        }
+        m_sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+        m_sqes = mmap( nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES );
+        if ( m_sqes == MAP_FAILED ) {
+
+          return false;
+        }
+
+        auto *sq = static_cast<std::uint8_t *>( m_sqRing );
+        auto *cq = static_cast<std::uint8_t *>( m_cqRing );
+        m_sqHead = reinterpret_cast<std::uint32_t *>( sq + params.sq_off.head ); // NOSONAR kernel ring layout
+        m_sqTail = reinterpret_cast<std::uint32_t *>( sq + params.sq_off.tail ); // NOSONAR kernel ring layout
+        m_sqMask = *reinterpret_cast<std::uint32_t *>( sq + params.sq_off.ring_mask ); // NOSONAR kernel ring layout
+        m_sqArray = reinterpret_cast<std::uint32_t *>( sq + params.sq_off.array ); // NOSONAR kernel ring layout
+        m_cqHead = reinterpret_cast<std::uint32_t *>( cq + params.cq_off.head ); // NOSONAR kernel ring layout
+        m_cqTail = reinterpret_cast<std::uint32_t *>( cq + params.cq_off.tail ); // NOSONAR kernel ring layout
+        m_cqMask = *reinterpret_cast<std::uint32_t *>( cq + params.cq_off.ring_mask ); // NOSONAR kernel ring layout
+        m_cqes = reinterpret_cast<io_uring_cqe *>( cq + params.cq_off.cqes ); // NOSONAR kernel ring layout
+        m_entries = params.sq_entries;
+        return true;
+      }
+
+      /**
+       * @brief Queue a read or write - submitted with the next enter.
+       * @param _opcode   IORING_OP_READ or IORING_OP_WRITE.
+       * @param _fd   File descriptor.
+       * @param _buffer   Data buffer.
+       * @param _length   Bytes to transfer.
+       * @param _offset   File offset.
+       * @param _tag   Tag of the completion.
+       * @return True, if queued - otherwise false, if the queue is full.
+       */
+      bool push( std::uint8_t _opcode,
+                 std::int32_t _fd,
+                 const void *_buffer, // NOSONAR kernel api
+                 std::size_t _length,
+                 std::uint64_t _offset,
+                 std::uint64_t _tag ) noexcept {
+
+        const std::uint32_t tail = *m_sqTail;
+        if ( tail - __atomic_load_n( m_sqHead, __ATOMIC_ACQUIRE ) >= m_entries ) {
+
+          return false;
+        }
+        const std::uint32_t index = tail & m_sqMask;
+        io_uring_sqe *sqe = static_cast<io_uring_sqe *>( m_sqes ) + index;
+        std::memset( sqe, 0, sizeof( io_uring_sqe ) );
+        sqe->opcode = _opcode;
+        sqe->fd = _fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>( _buffer ); // NOSONAR kernel api
+        sqe->len = static_cast<std::uint32_t>( _length );
+        sqe->off = _offset;
+        sqe->user_data = _tag;
+        m_sqArray[ index ] = index;
+        __atomic_store_n( m_sqTail, tail + 1, __ATOMIC_RELEASE );
+        ++m_queued;
+        return true;
+      }
+
+      /**
+       * @brief Submit the queued entries and wait for completions.
+       * @param _wait   Completions to wait for.
+       * @return 0 or negative errno.
+       */
+      std::int32_t enter( std::uint32_t _wait ) noexcept {
+
+        while ( true ) {
+
+          const long submitted = syscall( __NR_io_uring_enter, m_fd, m_queued, _wait, _wait > 0 ? IORING_ENTER_GETEVENTS : 0U, nullptr, 0 );
+          if ( submitted >= 0 ) {
+
+            m_queued -= std::min( m_queued, static_cast<std::uint32_t>( submitted ) );
+            return 0;
+          }
+          if ( errno != EINTR ) {
+
+            return -errno;
+          }
+        }
+      }
+
+      /**
+       * @brief Take a completion.
+       * @param _tag   Tag of the completion.
+       * @param _result   Transferred bytes or negative errno.
+       * @return True, if a completion was available - otherwise false.
+       */
+      bool pop( std::uint64_t &_tag,
+                std::int32_t &_result ) noexcept {
+
+        const std::uint32_t head = *m_cqHead;
+        if ( head == __atomic_load_n( m_cqTail, __ATOMIC_ACQUIRE ) ) {
+
+          return false;
+        }
+        const io_uring_cqe &cqe = m_cqes[ head & m_cqMask ];
+        _tag = cqe.user_data;
+        _result = cqe.res;
+        __atomic_store_n( m_cqHead, head + 1, __ATOMIC_RELEASE );
+        return true;
+      }
+
+    private:
+      /** @brief Member for the ring file descriptor. */
+      std::int32_t m_fd = -1;
+
+      /** @brief Member for the mapped submission ring. */
+      void *m_sqRing = MAP_FAILED; // NOSONAR mmap api
+
+      /** @brief Member for the size of the submission ring. */
+      std::size_t m_sqSize = 0;
+
+      /** @brief Member for the mapped completion ring. */
+      void *m_cqRing = MAP_FAILED; // NOSONAR mmap api
+
+      /** @brief Member for the size of the completion ring. */
+      std::size_t m_cqSize = 0;
+
+      /** @brief Member for the mapped submission entries. */
+      void *m_sqes = MAP_FAILED; // NOSONAR mmap api
+
+      /** @brief Member for the size of the submission entries. */
+      std::size_t m_sqesSize = 0;
+
+      /** @brief Member for the submission head - written by the kernel. */
+      std::uint32_t *m_sqHead = nullptr;
+
+      /** @brief Member for the submission tail. */
+      std::uint32_t *m_sqTail = nullptr;
+
+      /** @brief Member for the submission index mask. */
+      std::uint32_t m_sqMask = 0;
+
+      /** @brief Member for the submission index array. */
+      std::uint32_t *m_sqArray = nullptr;
+
+      /** @brief Member for the completion head. */
+      std::uint32_t *m_cqHead = nullptr;
+
+      /** @brief Member for the completion tail - written by the kernel. */
+      std::uint32_t *m_cqTail = nullptr;
+
+      /** @brief Member for the completion index mask. */
+      std::uint32_t m_cqMask = 0;
+
+      /** @brief Member for the completion entries. */
+      io_uring_cqe *m_cqes = nullptr;
+
+      /** @brief Member for the number of submission entries. */
+      std::uint32_t m_entries = 0;
+
+      /** @brief Member for the queued but not submitted entries. */
+      std::uint32_t m_queued = 0;
+    };
+
+    /**
+     * @brief The Descriptors struct.
+     * File descriptors of one inode shared by every io_uring file of the process.
+     * Closing any descriptor would drop the posix locks of the unix vfs on the inode - see DescriptorRegistry::sweep.
+     */
+    struct Descriptors {
+
+      /** @brief Member for the buffered file descriptor. */
+      std::int32_t fd = -1;
+
+      /** @brief Member for the O_DIRECT file descriptor - -1 if not opened or not supported. */
+      std::int32_t directFd = -1;
+
+      /** @brief Member for the open attempt of the O_DIRECT file descriptor. */
+      bool directTried = false;
+
+      /** @brief Member for the number of files using the descriptors. */
+      std::size_t references = 0;
+    };
+
+    /**
+     * @brief Inode of a file.
+     */
+    using Inode = std::pair<dev_t, ino_t>;
+
+    /**
+     * @brief Open a file descriptor - read-write if possible.
+     * @param _name   Full path of the file.
+     * @param _flags   Additional open flags.
+     * @return File descriptor or -1.
+     */
+    std::int32_t openDescriptor( const char *_name,
+                                 std::int32_t _flags ) noexcept {
+
+      std::int32_t fd = ::open( _name, O_RDWR | O_CLOEXEC | _flags ); // NOSONAR posix api
+      if ( fd < 0 && ( errno == EACCES || errno == EROFS ) ) {
+
+        fd = ::open( _name, O_RDONLY | O_CLOEXEC | _flags ); // NOSONAR posix api
+      }
+      return fd;
+    }
+
+    /**
+     * @brief Check for other descriptors of the process on an inode - e.g. of the unix vfs.
+     * @param _inode   Inode of the file.
+     * @param _descriptors   Own descriptors of the file.
+     * @return True, if another descriptor refers to the inode or the check fails.
+     */
+    bool openedElsewhere( const Inode &_inode,
+                          const Descriptors &_descriptors ) noexcept {
+
+      DIR *directory = opendir( "/proc/self/fd" );
+      if ( !directory ) {
+
+        return true;
+      }
+      const std::int32_t own = dirfd( directory );
+      bool found = false;
+      while ( const dirent *entry = readdir( directory ) ) {
+
+        char *end = nullptr;
+        const long fd = std::strtol( entry->d_name, &end, 10 );
+        if ( end == entry->d_name || *end != '\0' || fd == own || fd == _descriptors.fd || fd == _descriptors.directFd ) {
+
+          continue;
+        }
+        struct stat status {};
+        if ( fstat( static_cast<std::int32_t>( fd ), &status ) == 0 && status.st_dev == _inode.first && status.st_ino == _inode.second ) {
+
+          found = true;
+          break;
+        }
+      }
+      closedir( directory );
+      return found;
+    }
+
+    /**
+     * @brief The DescriptorRegistry class.
+     * Shared file descriptors by inode - closed once no file uses them and no other descriptor of the process refers to the inode.
+     */
+    class DescriptorRegistry final : public Singleton<DescriptorRegistry> {
+
+    public:
+      /**
+       * @brief Descriptors of a file - opened on demand.
+       * @param _name   Full path of the file.
+       * @param _direct   Open the O_DIRECT descriptor too.
+       * @return Inode and descriptors or nullopt, if the file cannot be opened.
+       */
+      [[nodiscard]] std::optional<std::pair<Inode, Descriptors>> acquire( const char *_name,
+                                                                          bool _direct ) {
+
+        /* Look up by path - opening and closing a second descriptor would drop locks */
+        struct stat status {};
+        if ( stat( _name, &status ) != 0 ) {
+
+          return std::nullopt;
+        }
+        const Inode inode { status.st_dev, status.st_ino };
+
+        const std::lock_guard lock( m_mutex );
+        Descriptors &descriptors = m_files[ inode ];
+        if ( descriptors.fd < 0 ) {
+
+          descriptors.fd = openDescriptor( _name, 0 );
+          if ( descriptors.fd < 0 ) {
+
+            m_files.erase( inode );
+            return std::nullopt;
+          }
+        }
+        if ( _direct && !descriptors.directTried ) {
+
+          /* tmpfs and others reject O_DIRECT - io stays buffered */
+          descriptors.directTried = true;
+          descriptors.directFd = openDescriptor( _name, O_DIRECT );
+        }
+        ++descriptors.references;
+        const std::pair<Inode, Descriptors> result { inode, descriptors };
+        sweep();
+        return result;
+      }
+
+      /**
+       * @brief Release the descriptors of a file.
+       * @param _inode   Inode of the file.
+       */
+      void release( const Inode &_inode ) noexcept {
+
+        const std::lock_guard lock( m_mutex );
+        const auto iterator = m_files.find( _inode );
+        if ( iterator != std::end( m_files ) ) {
+
+          --iterator->second.references;
+        }
+        sweep();
+      }
+
+    private:
+      /**
+       * @brief Close the unused descriptors.
+       * Closing drops every posix lock of the process on the inode - also those of unix vfs connections.
+       * Unused descriptors stay open while another descriptor refers to the inode and are closed by a later acquire or release.
+       */
+      void sweep() noexcept {
+
+        for ( auto iterator = std::begin( m_files ); iterator != std::end( m_files ); ) {
+
+          if ( iterator->second.references > 0 || openedElsewhere( iterator->first, iterator->second ) ) {
+
+            ++iterator;
+            continue;
+          }
+          close( iterator->second.fd );
+          if ( iterator->second.directFd >= 0 ) {
+
+            close( iterator->second.directFd );
+          }
+          iterator = m_files.erase( iterator );
+        }
+      }
+
+      /**
+       * @brief Member for guarding the descriptors.
+       */
+      std::mutex m_mutex {};
+
+      /**
+       * @brief Member for the descriptors by inode.
+       */
+      std::map<Inode, Descriptors> m_files {};
+    };
+
+    /**
+     * @brief The Window struct.
+     * Read-ahead window of a sequential scan.
+     */
+    struct Window {
+
+      /** @brief Member for the aligned buffer. */
+      AlignedBuffer buffer {};
+
+      /** @brief Member for the file offset - -1 if empty. */
+      sqlite3_int64 offset = -1;
+
+      /** @brief Member for the valid bytes - less than the capacity at the end of file. */
+      std::size_t size = 0;
+
+      /** @brief Member for a read in flight. */
+      bool pending = false;
+    };
+
+    /**
+     * @brief The UringState struct.
+     * Io state of a main database file.
+     */
+    struct UringState {
+
+      /** @brief Member for the ring. */
+      Ring ring {};
+
+      /** @brief Member for the inode of the shared descriptors. */
+      Inode inode {};
+
+      /** @brief Member for the buffered file descriptor. */
+      std::int32_t fd = -1;
+
+      /** @brief Member for the O_DIRECT file descriptor or -1. */
+      std::int32_t directFd = -1;
+
+      /** @brief Member for the read-ahead windows. */
+      std::array<Window, 2> windows {};
+
+      /** @brief Member for the capacity of each window. */
+      std::size_t windowCapacity = 0;
+
+      /** @brief Member for the end of the last read. */
+      sqlite3_int64 lastEnd = -1;
+
+      /** @brief Member for the sequential reads in a row. */
+      std::uint32_t streak = 0;
+
+      /** @brief Member for the aligned bounce buffer of O_DIRECT. */
+      AlignedBuffer bounce {};
+
+      /** @brief Member for the capacity of the bounce buffer. */
+      std::size_t bounceCapacity = 0;
+
+      /** @brief Member for the completion of the synchronous io. */
+      bool syncDone = false;
+
+      /** @brief Member for the result of the synchronous io. */
+      std::int32_t syncResult = 0;
+    };
+
+    /**
+     * @brief The UringFile struct.
+     * Followed in memory by the file of the underlying vfs.
+     */
+    struct UringFile {
+
+      /** @brief Base class - needs to be the first member. */
+      sqlite3_file base;
+
+      /** @brief Io state of the main database file - nullptr for other files. */
+      UringState *state;
+
+      /** @brief File of the underlying vfs. */
+      sqlite3_file *real;
+    };
+
+    /**
+     * @brief The UringVfs struct.
+     * Application data of a registered io_uring vfs.
+     */
+    struct UringVfs {
+
+      /** @brief Underlying vfs. */
+      sqlite3_vfs *real;
+
+      /** @brief Open the O_DIRECT descriptor. */
+      bool direct;
+    };
+
+    /**
+     * @brief Allocate an aligned buffer.
+     * @param _size   Minimum size.
+     * @return Buffer or nullptr.
+     */
+    AlignedBuffer allocateAligned( std::size_t _size ) noexcept {
+
+      return AlignedBuffer( static_cast<std::uint8_t *>( std::aligned_alloc( directAlignment, alignUp( _size ) ) ) );
+    }
+
+    /**
+     * @brief Record a completion.
+     * @param _state   Io state.
+     * @param _tag   Tag of the completion.
+     * @param _result   Transferred bytes or negative errno.
+     */
+    void complete( UringState &_state,
+                   std::uint64_t _tag,
+                   std::int32_t _result ) noexcept {
+
+      if ( _tag < _state.windows.size() ) {
+
+        Window &window = _state.windows[ _tag ];
+        window.pending = false;
+        window.size = _result > 0 ? static_cast<std::size_t>( _result ) : 0;
+        return;
+      }
+      _state.syncDone = true;
+      _state.syncResult = _result;
+    }
+
+    /**
+     * @brief Reap completions until a condition holds.
+     * @param _state   Io state.
+     * @param _done   Condition to wait for.
+     * @return 0 or negative errno.
+     */
+    template <typename Done>
+    std::int32_t drain( UringState &_state,
+                        Done _done ) noexcept {
+
+      while ( !_done() ) {
+
+        std::uint64_t tag = 0;
+        std::int32_t result = 0;
+        if ( _state.ring.pop( tag, result ) ) {
+
+          complete( _state, tag, result );
+          continue;
+        }
+        if ( const std::int32_t error = _state.ring.enter( 1 ); error < 0 ) {
+
+          return error;
+        }
+      }
+      return 0;
+    }
+
+    /**
+     * @brief Wait for the read-ahead windows in flight and forget them.
+     * @param _state   Io state.
+     */
+    void invalidate( UringState &_state ) noexcept {
+
+      std::ignore = drain( _state, [ &_state ] { return !_state.windows[ 0 ].pending && !_state.windows[ 1 ].pending; } );
+      for ( Window &window : _state.windows ) {
+
+        window.offset = -1;
+        window.size = 0;
+      }
+    }
+
+    /**
+     * @brief Descriptor for a transfer - O_DIRECT if buffer, offset and size are aligned.
+     * @param _state   Io state.
+     * @param _buffer   Data buffer.
+     * @param _length   Bytes to transfer.
+     * @param _offset   File offset.
+     * @return File descriptor.
+     */
+    std::int32_t descriptor( const UringState &_state,
+                             const void *_buffer, // NOSONAR sqlite api
+                             std::size_t _length,
+                             sqlite3_int64 _offset ) noexcept {
+
+      const bool aligned = reinterpret_cast<std::uintptr_t>( _buffer ) % directAlignment == 0 && _length % directAlignment == 0 && static_cast<std::uint64_t>( _offset ) % directAlignment == 0; // NOSONAR alignment check
+      return _state.directFd >= 0 && aligned ? _state.directFd : _state.fd;
+    }
+
+    /**
+     * @brief Synchronous read or write through the ring.
+     * @param _state   Io state.
+     * @param _opcode   IORING_OP_READ or IORING_OP_WRITE.
+     * @param _buffer   Data buffer.
+     * @param _length   Bytes to transfer.
+     * @param _offset   File offset.
+     * @return Transferred bytes - less at the end of file - or negative errno.
+     */
+    sqlite3_int64 transfer( UringState &_state,
+                            std::uint8_t _opcode,
+                            std::uint8_t *_buffer,
+                            std::size_t _length,
+                            sqlite3_int64 _offset ) noexcept {
+
+      const std::int32_t fd = descriptor( _state, _buffer, _length, _offset );
+      std::size_t done = 0;
+      while ( done < _length ) {
+
+        _state.syncDone = false;
+        if ( !_state.ring.push( _opcode, fd, _buffer + done, _length - done, static_cast<std::uint64_t>( _offset ) + done, syncTag ) ) {
+
+          return -EBUSY;
+        }
+        if ( const std::int32_t error = drain( _state, [ &_state ] { return _state.syncDone; } ); error < 0 ) {
+
+          return error;
+        }
+        if ( _state.syncResult == -EINTR || _state.syncResult == -EAGAIN ) {
+
+          continue;
+        }
+        if ( _state.syncResult <= 0 ) {
+
+          return _state.syncResult < 0 ? _state.syncResult : static_cast<sqlite3_int64>( done );
+        }
+        done += static_cast<std::size_t>( _state.syncResult );
+      }
+      return static_cast<sqlite3_int64>( done );
+    }
+
+    /**
+     * @brief Synchronous transfer of caller memory - bounced through an aligned buffer for O_DIRECT.
+     * @param _state   Io state.
+     * @param _opcode   IORING_OP_READ or IORING_OP_WRITE.
+     * @param _buffer   Data buffer of sqlite.
+     * @param _length   Bytes to transfer.
+     * @param _offset   File offset.
+     * @return Transferred bytes or negative errno.
+     */
+    sqlite3_int64 transferBounced( UringState &_state,
+                                   std::uint8_t _opcode,
+                                   std::uint8_t *_buffer,
+                                   std::size_t _length,
+                                   sqlite3_int64 _offset ) noexcept {
+
+      const bool alignedRange = _length % directAlignment == 0 && static_cast<std::uint64_t>( _offset ) % directAlignment == 0;
+      if ( _state.directFd < 0 || !alignedRange ) {
+
+        return transfer( _state, _opcode, _buffer, _length, _offset );
+      }
+
+      if ( _state.bounceCapacity < _length ) {
+
+        _state.bounce = allocateAligned( _length );
+        _state.bounceCapacity = _state.bounce ? _length : 0;
+        if ( !_state.bounce ) {
+
+          return -ENOMEM;
+        }
+      }
+      if ( _opcode == IORING_OP_WRITE ) {
+
+        std::memcpy( _state.bounce.get(), _buffer, _length );
+      }
+      const sqlite3_int64 result = transfer( _state, _opcode, _state.bounce.get(), _length, _offset );
+      if ( _opcode == IORING_OP_READ && result > 0 ) {
+
+        std::memcpy( _buffer, _state.bounce.get(), static_cast<std::size_t>( result ) );
+      }
+      return result;
+    }
+
+    /**
+     * @brief Queue the read of a window.
+     * @param _state   Io state.
+     * @param _index   Window index.
+     * @param _offset   File offset of the window.
+     * @return True, if queued - otherwise false.
+     */
+    bool readWindow( UringState &_state,
+                     std::size_t _index,
+                     sqlite3_int64 _offset ) noexcept {
+
+      Window &window = _state.windows[ _index ];
+      const std::int32_t fd = descriptor( _state, window.buffer.get(), _state.windowCapacity, _offset );
+      if ( !_state.ring.push( IORING_OP_READ, fd, window.buffer.get(), _state.windowCapacity, static_cast<std::uint64_t>( _offset ), _index ) ) {
+
+        return false;
+      }
+      window.offset = _offset;
+      window.size = 0;
+      window.pending = true;
+      return true;
+    }
+
+    /**
+     * @brief Start the read-ahead of a sequential scan - the second window is read in background.
+     * @param _state   Io state.
+     * @param _offset   File offset of the first window.
+     * @param _amount   Size of a read - usually the page size.
+     * @return True, if the first window is read - otherwise false.
+     */
+    bool startReadAhead( UringState &_state,
+                         sqlite3_int64 _offset,
+                         std::size_t _amount ) noexcept {
+
+      invalidate( _state );
+      if ( const std::size_t capacity = alignUp( _amount * uringReadAheadPages ); capacity > _state.windowCapacity ) {
+
+        for ( Window &window : _state.windows ) {
+
+          window.buffer = allocateAligned( capacity );
+          if ( !window.buffer ) {
+
+            _state.windowCapacity = 0;
+            return false;
+          }
+        }
+        _state.windowCapacity = capacity;
+      }
+
+      const auto next = _offset + static_cast<sqlite3_int64>( _state.windowCapacity );
+      if ( !readWindow( _state, 0, _offset ) ) {
+
+        return false;
+      }
+      std::ignore = readWindow( _state, 1, next );
+      return drain( _state, [ &_state ] { return !_state.windows[ 0 ].pending; } ) == 0;
+    }
+
+    /**
+     * @brief Keep the other window one ahead of the consumed window.
+     * @param _state   Io state.
+     * @param _index   Index of the consumed window.
+     */
+    void continueReadAhead( UringState &_state,
+                            std::size_t _index ) noexcept {
+
+      const Window &current = _state.windows[ _index ];
+      Window &other = _state.windows[ 1 - _index ];
+      const auto next = current.offset + static_cast<sqlite3_int64>( _state.windowCapacity );
+      if ( _state.streak < readAheadStreak || other.pending || other.offset == next || current.size < _state.windowCapacity ) {
+
+        return;
+      }
+      if ( readWindow( _state, 1 - _index, next ) ) {
+
+        std::ignore = _state.ring.enter( 0 );
+      }
+    }
+
+    /**
+     * @brief Serve a read from a window.
+     * @param _state   Io state.
+     * @param _buffer   Data buffer.
+     * @param _amount   Bytes to read.
+     * @param _offset   File offset.
+     * @return True, if the window held the data - otherwise false.
+     */
+    bool readFromWindow( UringState &_state,
+                         void *_buffer, // NOSONAR sqlite api
+                         std::size_t _amount,
+                         sqlite3_int64 _offset ) noexcept {
+
+      for ( std::size_t index = 0; index < _state.windows.size(); ++index ) {
+
+        Window &window = _state.windows[ index ];
+        const sqlite3_int64 end = _offset + static_cast<sqlite3_int64>( _amount );
+        if ( window.offset < 0 || _offset < window.offset || end > window.offset + static_cast<sqlite3_int64>( _state.windowCapacity ) ) {
+
+          continue;
+        }
+        if ( window.pending && drain( _state, [ &window ] { return !window.pending; } ) < 0 ) {
+
+          return false;
+        }
+        if ( end > window.offset + static_cast<sqlite3_int64>( window.size ) ) {
+
+          return false;
+        }
+        std::memcpy( _buffer, window.buffer.get() + ( _offset - window.offset ), _amount );
+        continueReadAhead( _state, index );
+        return true;
+      }
+      return false;
+    }
+
+    /**
+     * @brief Io state of a file.
+     * @param _file   Io_uring file.
+     * @return Io state or nullptr.
+     */
+    UringState *uringState( sqlite3_file *_file ) noexcept { return reinterpret_cast<UringFile *>( _file )->state; } // NOSONAR sqlite3_file is the first member
+
+    /**
+     * @brief Underlying file of an io_uring file.
+     * @param _file   Io_uring file.
+     * @return File of the underlying vfs.
+     */
+    sqlite3_file *realFile( sqlite3_file *_file ) noexcept { return reinterpret_cast<UringFile *>( _file )->real; } // NOSONAR sqlite3_file is the first member
+
+    /**
+     * @brief Underlying vfs of the io_uring vfs.
+     * @param _vfs   Io_uring vfs.
+     * @return Underlying vfs.
+     */
+    sqlite3_vfs *realVfs( sqlite3_vfs *_vfs ) noexcept { return static_cast<UringVfs *>( _vfs->pAppData )->real; }
+
+    /*
+     * Io methods of the main database file use the ring - everything else forwards to the underlying file.
+     */
+    std::int32_t uringClose( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      UringState *state = uringState( _file );
+      if ( state ) {
+
+        invalidate( *state );
+      }
+
+      /* Locks are released before the shared descriptors may be closed */
+      const std::int32_t resultCode = real->pMethods->xClose( real );
+      if ( state ) {
+
+        DescriptorRegistry::instance().release( state->inode );
+        delete state; // NOSONAR owned by the sqlite file
+        reinterpret_cast<UringFile *>( _file )->state = nullptr; // NOSONAR sqlite3_file is the first member
+      }
+      return resultCode;
+    }
+
+    std::int32_t uringRead( sqlite3_file *_file,
+                            void *_buffer, // NOSONAR sqlite api
+                            std::int32_t _amount,
+                            sqlite3_int64 _offset ) noexcept {
+
+      UringState *state = uringState( _file );
+      if ( !state ) {
+
+        sqlite3_file *real = realFile( _file );
+        return real->pMethods->xRead( real, _buffer, _amount, _offset );
+      }
+
+      const auto amount = static_cast<std::size_t>( _amount );
+      state->streak = _offset == state->lastEnd ? state->streak + 1 : 0;
+      state->lastEnd = _offset + _amount;
+      if ( readFromWindow( *state, _buffer, amount, _offset ) ) {
+
+        return SQLITE_OK;
+      }
+      if ( state->streak >= readAheadStreak && startReadAhead( *state, _offset, amount ) && readFromWindow( *state, _buffer, amount, _offset ) ) {
+
+        return SQLITE_OK;
+      }
+
+      const sqlite3_int64 result = transferBounced( *state, IORING_OP_READ, static_cast<std::uint8_t *>( _buffer ), amount, _offset );
+      if ( result < 0 ) {
+
+        return SQLITE_IOERR_READ;
+      }
+      if ( result < _amount ) {
+
+        /* Sqlite expects the rest to be zeroed */
+        std::memset( static_cast<std::uint8_t *>( _buffer ) + result, 0, static_cast<std::size_t>( _amount - result ) );
+        return SQLITE_IOERR_SHORT_READ;
+      }
+      return SQLITE_OK;
+    }
+
+    std::int32_t uringWrite( sqlite3_file *_file,
+                             const void *_buffer, // NOSONAR sqlite api
+                             std::int32_t _amount,
+                             sqlite3_int64 _offset ) noexcept {
+
+      UringState *state = uringState( _file );
+      if ( !state ) {
+
+        sqlite3_file *real = realFile( _file );
+        return real->pMethods->xWrite( real, _buffer, _amount, _offset );
+      }
+
+      invalidate( *state );
+      auto *buffer = const_cast<std::uint8_t *>( static_cast<const std::uint8_t *>( _buffer ) ); // NOSONAR only read by the kernel
+      const sqlite3_int64 result = transferBounced( *state, IORING_OP_WRITE, buffer, static_cast<std::size_t>( _amount ), _offset );
+      if ( result == -ENOSPC || ( result >= 0 && result < _amount ) ) {
+
+        return SQLITE_FULL;
+      }
+      return result < 0 ? SQLITE_IOERR_WRITE : SQLITE_OK;
+    }
+
+    std::int32_t uringTruncate( sqlite3_file *_file,
+                                sqlite3_int64 _size ) noexcept {
+
+      if ( UringState *state = uringState( _file ); state ) {
+
+        invalidate( *state );
+      }
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xTruncate( real, _size );
+    }
+
+    std::int32_t uringSync( sqlite3_file *_file,
+                            std::int32_t _flags ) noexcept {
+
+      /* fsync of the unix vfs covers every descriptor of the inode */
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xSync( real, _flags );
+    }
+
+    std::int32_t uringFileSize( sqlite3_file *_file,
+                                sqlite3_int64 *_size ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xFileSize( real, _size );
+    }
+
+    std::int32_t uringLock( sqlite3_file *_file,
+                            std::int32_t _lock ) noexcept {
+
+      /* Other connections may change the file between transactions */
+      if ( UringState *state = uringState( _file ); state ) {
+
+        invalidate( *state );
+      }
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xLock( real, _lock );
+    }
+
+    std::int32_t uringUnlock( sqlite3_file *_file,
+                              std::int32_t _lock ) noexcept {
+
+      if ( UringState *state = uringState( _file ); state ) {
+
+        invalidate( *state );
+      }
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xUnlock( real, _lock );
+    }
+
+    std::int32_t uringCheckReservedLock( sqlite3_file *_file,
+                                         std::int32_t *_result ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xCheckReservedLock( real, _result );
+    }
+
+    std::int32_t uringFileControl( sqlite3_file *_file,
+                                   std::int32_t _operation,
+                                   void *_argument ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xFileControl( real, _operation, _argument );
+    }
+
+    std::int32_t uringSectorSize( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xSectorSize( real );
+    }
+
+    std::int32_t uringDeviceCharacteristics( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xDeviceCharacteristics( real );
+    }
+
+    std::int32_t uringShmMap( sqlite3_file *_file,
+                              std::int32_t _region,
+                              std::int32_t _size,
+                              std::int32_t _extend,
+                              void volatile **_memory ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xShmMap( real, _region, _size, _extend, _memory );
+    }
+
+    std::int32_t uringShmLock( sqlite3_file *_file,
+                               std::int32_t _offset,
+                               std::int32_t _count,
+                               std::int32_t _flags ) noexcept {
+
+      /* WAL read transactions start and end with shm locks */
+      if ( UringState *state = uringState( _file ); state ) {
+
+        invalidate( *state );
+      }
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xShmLock( real, _offset, _count, _flags );
+    }
+
+    void uringShmBarrier( sqlite3_file *_file ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      real->pMethods->xShmBarrier( real );
+    }
+
+    std::int32_t uringShmUnmap( sqlite3_file *_file,
+                                std::int32_t _delete ) noexcept {
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xShmUnmap( real, _delete );
+    }
+
+    std::int32_t uringFetch( sqlite3_file *_file,
+                             sqlite3_int64 _offset,
+                             std::int32_t _amount,
+                             void **_pointer ) noexcept { // NOSONAR sqlite api
+
+      /* Memory mapped pages would bypass the ring and see stale O_DIRECT writes */
+      if ( uringState( _file ) ) {
+
+        *_pointer = nullptr;
+        return SQLITE_OK;
+      }
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xFetch( real, _offset, _amount, _pointer );
+    }
+
+    std::int32_t uringUnfetch( sqlite3_file *_file,
+                               sqlite3_int64 _offset,
+                               void *_pointer ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_file *real = realFile( _file );
+      return real->pMethods->xUnfetch( real, _offset, _pointer );
+    }
+
+    /**
+     * @brief Io methods of the io_uring vfs - version 3 like the unix vfs.
+     */
+    const sqlite3_io_methods uringIoMethods = {
+      3,
+      uringClose,
+      uringRead,
+      uringWrite,
+      uringTruncate,
+      uringSync,
+      uringFileSize,
+      uringLock,
+      uringUnlock,
+      uringCheckReservedLock,
+      uringFileControl,
+      uringSectorSize,
+      uringDeviceCharacteristics,
+      uringShmMap,
+      uringShmLock,
+      uringShmBarrier,
+      uringShmUnmap,
+      uringFetch,
+      uringUnfetch
+    };
+
+    /*
+     * Vfs methods forward to the underlying vfs - xOpen adds a ring to main database files.
+     */
+    std::int32_t uringOpen( sqlite3_vfs *_vfs,
+                            const char *_name,
+                            sqlite3_file *_file,
+                            std::int32_t _flags,
+                            std::int32_t *_outFlags ) noexcept {
+
+      auto *file = reinterpret_cast<UringFile *>( _file ); // NOSONAR sqlite3_file is the first member
+      file->base.pMethods = nullptr;
+      file->state = nullptr;
+      file->real = reinterpret_cast<sqlite3_file *>( file + 1 ); // NOSONAR underlying file follows in the same allocation
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      const std::int32_t resultCode = real->xOpen( real, _name, file->real, _flags, _outFlags );
+      if ( resultCode != SQLITE_OK || !file->real->pMethods ) {
+
+        return resultCode;
+      }
+
+      /* Without a ring or descriptor the file stays with the unix vfs */
+      if ( ( _flags & SQLITE_OPEN_MAIN_DB ) != 0 && _name ) {
+
+        auto *state = new ( std::nothrow ) UringState(); // NOSONAR owned by the sqlite file
+        if ( !state ) {
+
+          file->real->pMethods->xClose( file->real );
+          return SQLITE_NOMEM;
+        }
+        std::optional<std::pair<Inode, Descriptors>> descriptors {};
+        if ( state->ring.open( ringEntries ) ) {
+
+          try {
+
+            descriptors = DescriptorRegistry::instance().acquire( _name, static_cast<UringVfs *>( _vfs->pAppData )->direct );
+          }
+          catch ( const std::bad_alloc & ) {
+
+            descriptors = std::nullopt;
+          }
+        }
+        if ( descriptors ) {
+
+          state->inode = descriptors->first;
+          state->fd = descriptors->second.fd;
+          state->directFd = descriptors->second.directFd;
+          file->state = state;
+        }
+        else {
+
+          delete state; // NOSONAR owned by the sqlite file
+        }
+      }
+      file->base.pMethods = &uringIoMethods;
+      return resultCode;
+    }
+
+    std::int32_t uringDelete( sqlite3_vfs *_vfs,
+                              const char *_name,
+                              std::int32_t _syncDirectory ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xDelete( real, _name, _syncDirectory );
+    }
+
+    std::int32_t uringAccess( sqlite3_vfs *_vfs,
+                              const char *_name,
+                              std::int32_t _flags,
+                              std::int32_t *_result ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xAccess( real, _name, _flags, _result );
+    }
+
+    std::int32_t uringFullPathname( sqlite3_vfs *_vfs,
+                                    const char *_name,
+                                    std::int32_t _size,
+                                    char *_output ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xFullPathname( real, _name, _size, _output );
+    }
+
+    void *uringDlOpen( sqlite3_vfs *_vfs,
+                       const char *_filename ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xDlOpen( real, _filename );
+    }
+
+    void uringDlError( sqlite3_vfs *_vfs,
+                       std::int32_t _size,
+                       char *_message ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      real->xDlError( real, _size, _message );
+    }
+
+    void ( *uringDlSym( sqlite3_vfs *_vfs,
+                        void *_library, // NOSONAR sqlite api
+                        const char *_symbol ) noexcept )( void ) {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xDlSym( real, _library, _symbol );
+    }
+
+    void uringDlClose( sqlite3_vfs *_vfs,
+                       void *_library ) noexcept { // NOSONAR sqlite api
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      real->xDlClose( real, _library );
+    }
+
+    std::int32_t uringRandomness( sqlite3_vfs *_vfs,
+                                  std::int32_t _size,
+                                  char *_output ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xRandomness( real, _size, _output );
+    }
+
+    std::int32_t uringSleep( sqlite3_vfs *_vfs,
+                             std::int32_t _microseconds ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xSleep( real, _microseconds );
+    }
+
+    std::int32_t uringCurrentTime( sqlite3_vfs *_vfs,
+                                   double *_time ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xCurrentTime( real, _time );
+    }
+
+    std::int32_t uringGetLastError( sqlite3_vfs *_vfs,
+                                    std::int32_t _size,
+                                    char *_message ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xGetLastError ? real->xGetLastError( real, _size, _message ) : 0;
+    }
+
+    std::int32_t uringCurrentTimeInt64( sqlite3_vfs *_vfs,
+                                        sqlite3_int64 *_time ) noexcept {
+
+      sqlite3_vfs *real = realVfs( _vfs );
+      return real->xCurrentTimeInt64( real, _time );
+    }
+
+    /**
+     * @brief Fill a vfs that forwards to the underlying vfs.
+     * @param _vfs   Vfs to fill.
+     * @param _name   Name of the vfs.
+     * @param _data   Application data with the underlying vfs.
+     */
+    void fillVfs( sqlite3_vfs &_vfs,
+                  std::string_view _name,
+                  UringVfs &_data ) noexcept {
+
+      _vfs.iVersion = 2;
+      _vfs.szOsFile = static_cast<std::int32_t>( sizeof( UringFile ) ) + _data.real->szOsFile;
+      _vfs.mxPathname = _data.real->mxPathname;
+      _vfs.zName = _name.data();
+      _vfs.pAppData = &_data;
+      _vfs.xOpen = uringOpen;
+      _vfs.xDelete = uringDelete;
+      _vfs.xAccess = uringAccess;
+      _vfs.xFullPathname = uringFullPathname;
+      _vfs.xDlOpen = uringDlOpen;
+      _vfs.xDlError = uringDlError;
+      _vfs.xDlSym = uringDlSym;
+      _vfs.xDlClose = uringDlClose;
+      _vfs.xRandomness = uringRandomness;
+      _vfs.xSleep = uringSleep;
+      _vfs.xCurrentTime = uringCurrentTime;
+      _vfs.xGetLastError = uringGetLastError;
+      _vfs.xCurrentTimeInt64 = uringCurrentTimeInt64;
+    }
+  }
+
+  std::error_code registerUringVfs( bool _makeDefault ) {
+
+    static std::mutex mutex {};
+    const std::lock_guard lock( mutex );
+
+    if ( sqlite3_vfs *registered = sqlite3_vfs_find( uringVfsName.data() ); registered ) {
+
+      if ( const std::int32_t resultCode = sqlite3_vfs_register( registered, _makeDefault ? 1 : 0 ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode );
+      }
+      return {};
+    }
+
+    sqlite3_vfs *real = sqlite3_vfs_find( "unix" );
+    if ( !real || real->iVersion < 3 ) {
+
+      return makeError( SQLITE_ERROR, "No unix vfs for io_uring." );
+    }
+    if ( Ring probe {}; !probe.open( ringEntries ) ) {
+
+      return makeError( SQLITE_ERROR, "io_uring is not available." );
+    }
+
+    /* Registered vfs need to live until the process ends */
+    static UringVfs bufferedData { real, false };
+    static UringVfs directData { real, true };
+    static sqlite3_vfs bufferedVfs {};
+    static sqlite3_vfs directVfs {};
+    fillVfs( bufferedVfs, uringVfsName, bufferedData );
+    fillVfs( directVfs, uringDirectVfsName, directData );
+
+    if ( const std::int32_t resultCode = sqlite3_vfs_register( &directVfs, 0 ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode );
+    }
+    if ( const std::int32_t resultCode = sqlite3_vfs_register( &bufferedVfs, _makeDefault ? 1 : 0 ); resultCode != SQLITE_OK ) {
+
+      return makeError( resultCode );
+    }
+    return {};
+  }
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#ifdef HAVE_IO_URING
+/* c header */
+  #include <cstddef> // std::size_t
+
+/* stl header */
+  #include <string_view>
+  #include <system_error>
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Name of the io_uring vfs.
+   */
+  constexpr std::string_view uringVfsName = "vx_uring";
+
+  /**
+   * @brief Name of the io_uring vfs with O_DIRECT for aligned page io.
+   */
+  constexpr std::string_view uringDirectVfsName = "vx_uring_direct";
+
+  /**
+   * @brief Pages per read-ahead window of sequential scans.
+   */
+  constexpr std::size_t uringReadAheadPages = 32;
+
+  /**
+   * @brief Register the io_uring vfs on top of the default unix vfs.
+   * Reads and writes of the main database file go through one io_uring per file.
+   * Sequential reads are served from two read-ahead windows - the next one is read while the current one is consumed.
+   * Journals, WAL and locking stay with the unix vfs. Select it with OpenOptions::vfs.
+   * The vfs with O_DIRECT falls back to buffered io on file systems without O_DIRECT like tmpfs.
+   * Closing a descriptor drops every posix lock of the process on the file, so the shared descriptors of a file stay open
+   * while another descriptor of the process refers to it - e.g. a connection on the default vfs - and are closed later.
+   * @param _makeDefault   Use the io_uring vfs for every following sqlite3_open.
+   * @return Result code and message of operation.
+   */
+  std::error_code registerUringVfs( bool _makeDefault = false );
+}
+#endif
@@ -34,18 +34,32 @@
 #include <cstring> // std::memcpy
 
 /* stl header */
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iosfwd>
 #include <iostream>
+#include <istream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
+#include <set>
 #ifdef HAVE_SPAN
   #include <span>
 #endif
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <thread>
+#include <tuple> // std::ignore
+#include <utility>
 #include <vector>
 
 /* sqlite header */
@@ -62,10 +76,15 @@
 #ifdef _WIN32
   #include <Logger.h>
 #endif
+#include <Singleton.h>
 #include <StringUtils.h>
 
 /* local header */
+#include "SqliteChecksum.h"
 #include "SqliteError.h"
+#include "SqliteFunctionStats.h"
+#include "SqliteProfiler.h"
+#include "SqliteTrackingVfs.h"
 #include "SqliteUtils.h"
 
 namespace std { // NOSONAR
@@ -142,8 +161,7 @@ namespace vx::sqlite_utils {
     if ( resultCode != SQLITE_OK ) {
 
       _error.clear();
-      SqliteErrorCategory::instance().setMessage( sqlite3_errmsg( handle ) );
-      _error = { resultCode, SqliteErrorCategory::instance() };
+      _error = makeError( resultCode, sqlite3_errmsg( handle ) );
 
 #ifdef DEBUG
       std::cout << "RESULT CODE: (" << resultCode << ")" << std::endl;
@@ -152,6 +170,107 @@ namespace vx::sqlite_utils {
 #endif
       database.reset();
     }
+    else if ( profilingEnabled() ) {
+
+      std::ignore = profileConnection( handle );
+    }
+
+    return database;
+  }
+
+  std::unique_ptr<sqlite3, sqlite3_deleter> sqlite3_make_unique( const std::string &_filename,
+                                                                 const OpenOptions &_options,
+                                                                 std::error_code &_error ) noexcept {
+
+    std::int32_t flags = _options.readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE;
+    if ( !_options.readOnly && _options.create ) {
+
+      flags |= SQLITE_OPEN_CREATE;
+    }
+    if ( _options.uri ) {
+
+      flags |= SQLITE_OPEN_URI;
+    }
+    if ( _options.noMutex ) {
+
+      flags |= SQLITE_OPEN_NOMUTEX;
+    }
+
+    sqlite3 *handle = nullptr;
+    std::int32_t resultCode = sqlite3_open_v2( _filename.c_str(), &handle, flags, _options.vfs.empty() ? nullptr : _options.vfs.c_str() );
+    std::unique_ptr<sqlite3, sqlite3_deleter> database { handle };
+    const auto fail = [ &database, &_error ]( std::int32_t _resultCode ) {
+      _error.clear();
+      _error = makeError( _resultCode, database ? sqlite3_errmsg( database.get() ) : sqlite3_errstr( _resultCode ) );
+
+#ifdef DEBUG
+      std::cout << "RESULT CODE: (" << _resultCode << ")" << std::endl;
+      std::cout << "ERROR: '" << _error.message() << "'" << std::endl;
+      std::cout << std::endl;
+#endif
+      database.reset();
+      return std::unique_ptr<sqlite3, sqlite3_deleter> {};
+    };
+    if ( resultCode != SQLITE_OK ) {
+
+      return fail( resultCode );
+    }
+
+    /* Lookaside must be configured before the connection allocates */
+    if ( _options.lookasideSlotSize || _options.lookasideSlots ) {
+
+      constexpr std::int32_t defaultSlotSize = 1200;
+      constexpr std::int32_t defaultSlots = 100;
+      resultCode = sqlite3_db_config( handle, SQLITE_DBCONFIG_LOOKASIDE, nullptr, _options.lookasideSlotSize.value_or( defaultSlotSize ), _options.lookasideSlots.value_or( defaultSlots ) );
+      if ( resultCode != SQLITE_OK ) {
+
+        return fail( resultCode );
+      }
+    }
+    if ( _options.busyTimeout ) {
+
+      sqlite3_busy_timeout( handle, static_cast<std::int32_t>( _options.busyTimeout->count() ) );
+    }
+
+    constexpr std::array<const char *, 7> journalModes { nullptr, "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF" };
+    constexpr std::array<const char *, 5> synchronousModes { nullptr, "OFF", "NORMAL", "FULL", "EXTRA" };
+    constexpr std::array<const char *, 3> tempStores { nullptr, "FILE", "MEMORY" };
+    std::array<std::unique_ptr<char, sqlite3_str_deleter>, 5> pragmas {};
+    if ( const char *mode = journalModes.at( static_cast<std::size_t>( _options.journalMode ) ); mode ) {
+
+      pragmas[ 0 ].reset( sqlite3_mprintf( "PRAGMA journal_mode = %s", mode ) );
+    }
+    if ( const char *mode = synchronousModes.at( static_cast<std::size_t>( _options.synchronous ) ); mode ) {
+
+      pragmas[ 1 ].reset( sqlite3_mprintf( "PRAGMA synchronous = %s", mode ) );
+    }
+    if ( const char *store = tempStores.at( static_cast<std::size_t>( _options.tempStore ) ); store ) {
+
+      pragmas[ 2 ].reset( sqlite3_mprintf( "PRAGMA temp_store = %s", store ) );
+    }
+    if ( _options.mmapSize ) {
+
+      pragmas[ 3 ].reset( sqlite3_mprintf( "PRAGMA mmap_size = %lld", static_cast<sqlite3_int64>( *_options.mmapSize ) ) );
+    }
+    if ( _options.cacheSize ) {
+
+      pragmas[ 4 ].reset( sqlite3_mprintf( "PRAGMA cache_size = %lld", static_cast<sqlite3_int64>( *_options.cacheSize ) ) );
+    }
+    for ( const auto &pragma : pragmas ) {
+
+      if ( pragma ) {
+
+        resultCode = sqlite3_exec( handle, pragma.get(), nullptr, nullptr, nullptr );
+        if ( resultCode != SQLITE_OK ) {
+
+          return fail( resultCode );
+        }
+      }
+    }
+    if ( profilingEnabled() ) {
+
+      std::ignore = profileConnection( handle );
+    }
 
     return database;
   }
@@ -173,8 +292,7 @@ namespace vx::sqlite_utils {
     if ( resultCode != SQLITE_OK ) {
 
       _error.clear();
-      SqliteErrorCategory::instance().setMessage( sqlite3_errmsg( _handle ) );
-      _error = { resultCode, SqliteErrorCategory::instance() };
+      _error = makeError( resultCode, sqlite3_errmsg( _handle ) );
 
 #ifdef DEBUG
       std::cout << "RESULT CODE: (" << resultCode << ")" << std::endl;
@@ -186,103 +304,1211 @@ namespace vx::sqlite_utils {
     return statement;
   }
 
+  namespace {
+
+    /**
+     * @brief Bits of a byte.
+     */
+    constexpr std::size_t bitsPerByte = 8;
+
+    /**
+     * @brief Mask of the lowest byte.
+     */
+    constexpr std::uint64_t byteMask = 0xFF;
+
+    /**
+     * @brief Append a little endian integer.
+     * @param _buffer   Buffer to append to.
+     * @param _value   Value to append.
+     * @param _bytes   Number of bytes to append.
+     */
+    void appendInteger( std::string &_buffer,
+                        std::uint64_t _value,
+                        std::size_t _bytes ) {
+
+      for ( std::size_t i = 0; i < _bytes; ++i ) {
+
+        _buffer.push_back( static_cast<char>( ( _value >> ( i * bitsPerByte ) ) & byteMask ) );
+      }
+    }
+
+    /**
+     * @brief Read a little endian integer.
+     * @param _buffer   Buffer to read from.
+     * @param _offset   Read position - advanced by the read bytes.
+     * @param _bytes   Number of bytes to read.
+     * @return Value or nullopt, if the buffer is too small.
+     */
+    std::optional<std::uint64_t> readInteger( std::string_view _buffer,
+                                              std::size_t &_offset,
+                                              std::size_t _bytes ) {
+
+      if ( _buffer.size() < _bytes || _offset > _buffer.size() - _bytes ) {
+
+        return std::nullopt;
+      }
+
+      std::uint64_t value = 0;
+      for ( std::size_t i = 0; i < _bytes; ++i ) {
+
+        value |= static_cast<std::uint64_t>( static_cast<unsigned char>( _buffer[ _offset + i ] ) ) << ( i * bitsPerByte );
+      }
+      _offset += _bytes;
+      return value;
+    }
+
+    /**
+     * @brief Read a little endian integer.
+     * @param _buffer   Buffer to read from.
+     * @param _offset   Read position - advanced by the read bytes.
+     * @param _bytes   Number of bytes to read.
+     * @return Value or nullopt, if the buffer is too small.
+     */
+    std::optional<std::uint64_t> readInteger( const std::vector<char> &_buffer,
+                                              std::size_t &_offset,
+                                              std::size_t _bytes ) {
+
+      return readInteger( std::string_view( _buffer.data(), _buffer.size() ), _offset, _bytes );
+    }
+
+    /**
+     * @brief Read a serialized database from file.
+     * @param _filename   Database filename.
+     * @param _dump   Read data.
+     * @return Result code and message of operation.
+     */
+    std::error_code readDump( const std::string &_filename,
+                              std::vector<char> &_dump ) {
+
+      if ( std::error_code errorCode {}; !std::filesystem::exists( _filename, errorCode ) || errorCode ) {
+
+        return makeError( SQLITE_IOERR, "File not found." );
+      }
+
+      std::ifstream input( _filename, std::ios::in | std::ios::binary );
+      if ( !input.is_open() ) {
+
+        return makeError( SQLITE_IOERR, "Cannot open file for import." );
+      }
+      if ( !input.eof() && !input.fail() ) {
+
+        input.seekg( 0, std::ios_base::end );
+        const std::streampos size = input.tellg();
+        _dump.resize( static_cast<std::size_t>( size ) );
+
+        input.seekg( 0, std::ios_base::beg );
+        input.read( _dump.data(), size );
+      }
+      try {
+
+        input.close();
+      }
+      catch ( const std::ofstream::failure &_exception ) {
+
+        std::cout << _exception.what() << std::endl;
+        return makeError( SQLITE_IOERR, "Unable to close the import file." );
+      }
+
+      return {};
+    }
+
+    /**
+     * @brief The ConnectionLock class.
+     * Holds the connection mutex - no-op for connections without mutex.
+     */
+    class ConnectionLock {
+
+    public:
+      /**
+       * @brief ConnectionLock constructor.
+       * @param _handle   Database handle.
+       */
+      explicit ConnectionLock( sqlite3 *_handle )
+        : m_mutex( sqlite3_db_mutex( _handle ) ) {
+
+        sqlite3_mutex_enter( m_mutex );
+      }
+
+      /**
+       * @brief ConnectionLock destructor.
+       */
+      ~ConnectionLock() { sqlite3_mutex_leave( m_mutex ); }
+
+      /**
+       * @brief Delete copy constructor.
+       */
+      ConnectionLock( const ConnectionLock & ) = delete;
+
+      /**
+       * @brief Delete copy assignment.
+       */
+      ConnectionLock &operator=( const ConnectionLock & ) = delete;
+
+    private:
+      /**
+       * @brief Member for the connection mutex.
+       */
+      sqlite3_mutex *m_mutex = nullptr;
+    };
+
+    /**
+     * @brief Write serialized data sequentially to file.
+     * @param _parts   Serialized data parts in file order.
+     * @param _filename   Database filename.
+     * @param _append   Append to an existing file.
+     * @return Result code and message of operation.
+     */
+    std::error_code writeDump( const std::vector<std::string_view> &_parts,
+                               const std::string &_filename,
+                               bool _append = false ) {
+
+      std::ofstream output( _filename, std::ios::out | std::ios::binary | ( _append ? std::ios::app : std::ios::trunc ) );
+      if ( !output.is_open() ) {
+
+        return makeError( SQLITE_IOERR, "Cannot open file for export." );
+      }
+      try {
+
+        for ( const std::string_view part : _parts ) {
+
+          output.write( part.data(), static_cast<std::streamsize>( part.size() ) );
+        }
+        output.close();
+      }
+      catch ( const std::ofstream::failure &_exception ) {
+
+        std::cout << _exception.what() << std::endl;
+        return makeError( SQLITE_IOERR, "Unable to write or close the export file." );
+      }
+
+      return {};
+    }
+
+    /**
+     * @brief Deserialize a database from a copy of the dump.
+     * @param _handle   Database handle.
+     * @param _schema   Import schema.
+     * @param _data   Serialized database.
+     * @param _size   Size of serialized database.
+     * @return Result code and message of operation.
+     */
+    std::error_code deserializeDump( sqlite3 *_handle,
+                                     const std::string &_schema,
+                                     const char *_data,
+                                     std::size_t _size ) {
+
+      if ( _size == 0 ) {
+
+        return makeError( SQLITE_IOERR, "Cannot read data from file." );
+      }
+
+      auto *databuffer( static_cast<std::uint8_t *>( sqlite3_malloc64( sizeof( std::uint8_t ) * _size ) ) );
+      if ( !databuffer ) {
+
+        return makeError( SQLITE_NOMEM, "Cannot allocate memory for import." );
+      }
+      std::memcpy( databuffer, _data, _size );
+
+      if ( const std::int32_t resultCode = sqlite3_deserialize( _handle, _schema.c_str(), databuffer, static_cast<sqlite3_int64>( _size ), static_cast<sqlite3_int64>( _size ), SQLITE_DESERIALIZE_RESIZEABLE | SQLITE_DESERIALIZE_FREEONCLOSE ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+
+      return {};
+    }
+
+    /**
+     * @brief Magic of a checked dump.
+     */
+    constexpr std::string_view snapshotMagic = "SQLFSNAP";
+
+    /**
+     * @brief Version of the checked dump format.
+     */
+    constexpr std::uint32_t snapshotVersion = 1;
+
+    /**
+     * @brief Bytes covered by one checksum.
+     */
+    constexpr std::size_t snapshotBlockSize = std::size_t { 256 } * 1024;
+
+    /**
+     * @brief Offset of the page size within the database header.
+     */
+    constexpr std::size_t pageSizeOffset = 16;
+
+    /**
+     * @brief Page size that is stored as 1 within the database header.
+     */
+    constexpr std::uint32_t maximumPageSize = 65536;
+
+    /**
+     * @brief Checksums of every block - calculated in parallel.
+     * @param _data   Serialized database.
+     * @param _size   Size of serialized database.
+     * @return CRC32C per block.
+     */
+    std::vector<std::uint32_t> blockChecksums( const std::uint8_t *_data,
+                                               std::size_t _size ) {
+
+      const std::size_t blocks = ( _size + snapshotBlockSize - 1 ) / snapshotBlockSize;
+      std::vector<std::uint32_t> checksums( blocks );
+      const auto checksum = [ _data, _size, &checksums ]( std::size_t _first,
+                                                          std::size_t _last ) {
+        for ( std::size_t block = _first; block < _last; ++block ) {
+
+          const std::size_t offset = block * snapshotBlockSize;
+          checksums[ block ] = crc32c( _data + offset, std::min( snapshotBlockSize, _size - offset ) );
+        }
+      };
+
+      const std::size_t workers = std::min( std::max( std::size_t { 1 }, static_cast<std::size_t>( std::thread::hardware_concurrency() ) ), std::max( std::size_t { 1 }, blocks ) );
+      const std::size_t blocksPerWorker = ( blocks + workers - 1 ) / workers;
+      std::vector<std::future<void>> parts {};
+      for ( std::size_t worker = 1; worker < workers; ++worker ) {
+
+        parts.push_back( std::async( std::launch::async, checksum, std::min( blocks, worker * blocksPerWorker ), std::min( blocks, ( worker + 1 ) * blocksPerWorker ) ) );
+      }
+      checksum( 0, std::min( blocks, blocksPerWorker ) );
+      for ( auto &part : parts ) {
+
+        part.get();
+      }
+      return checksums;
+    }
+
+    /**
+     * @brief Create the header of a checked dump.
+     * @param _data   Serialized database.
+     * @param _size   Size of serialized database.
+     * @return Header to write in front of the serialized database.
+     */
+    std::string snapshotHeader( const std::uint8_t *_data,
+                                std::size_t _size ) {
+
+      std::uint32_t pageSize = 0;
+      if ( _size > pageSizeOffset + 1 ) {
+
+        pageSize = static_cast<std::uint32_t>( _data[ pageSizeOffset ] << bitsPerByte | _data[ pageSizeOffset + 1 ] );
+        pageSize = pageSize == 1 ? maximumPageSize : pageSize;
+      }
+
+      const std::vector<std::uint32_t> checksums = blockChecksums( _data, _size );
+      std::string header( snapshotMagic );
+      appendInteger( header, snapshotVersion, sizeof( std::uint32_t ) );
+      appendInteger( header, pageSize, sizeof( std::uint32_t ) );
+      appendInteger( header, pageSize == 0 ? 0 : _size / pageSize, sizeof( std::uint32_t ) );
+      appendInteger( header, snapshotBlockSize, sizeof( std::uint32_t ) );
+      appendInteger( header, checksums.size(), sizeof( std::uint32_t ) );
+      appendInteger( header, _size, sizeof( std::uint64_t ) );
+      for ( const std::uint32_t checksum : checksums ) {
+
+        appendInteger( header, checksum, sizeof( std::uint32_t ) );
+      }
+      appendInteger( header, crc32c( reinterpret_cast<const std::uint8_t *>( header.data() ), header.size() ), sizeof( std::uint32_t ) ); // NOSONAR byte access to char data
+      return header;
+    }
+
+    /**
+     * @brief Verify a checked dump before sqlite touches it.
+     * Dumps without header are passed through unchecked.
+     * @param _data   Dump.
+     * @param _size   Size of dump.
+     * @param _offset   Offset of the serialized database within the dump.
+     * @return Result code and message of operation.
+     */
+    std::error_code verifySnapshot( const char *_data,
+                                    std::size_t _size,
+                                    std::size_t &_offset ) {
+
+      const std::string_view dump( _data, _size );
+      _offset = 0;
+      if ( dump.size() < snapshotMagic.size() || std::string_view( dump.data(), snapshotMagic.size() ) != snapshotMagic ) {
+
+        return {};
+      }
+
+      std::size_t position = snapshotMagic.size();
+      const std::optional version = readInteger( dump, position, sizeof( std::uint32_t ) );
+      const std::optional pageSize = readInteger( dump, position, sizeof( std::uint32_t ) );
+      const std::optional pageCount = readInteger( dump, position, sizeof( std::uint32_t ) );
+      const std::optional blockSize = readInteger( dump, position, sizeof( std::uint32_t ) );
+      const std::optional blockCount = readInteger( dump, position, sizeof( std::uint32_t ) );
+      const std::optional size = readInteger( dump, position, sizeof( std::uint64_t ) );
+      if ( !version || *version != snapshotVersion || !pageSize || !pageCount || !blockSize || *blockSize != snapshotBlockSize || !blockCount || !size ) {
+
+        return makeError( SQLITE_NOTADB, "Unsupported dump version." );
+      }
+
+      std::vector<std::uint32_t> checksums {};
+      for ( std::uint64_t block = 0; block < *blockCount; ++block ) {
+
+        const std::optional checksum = readInteger( dump, position, sizeof( std::uint32_t ) );
+        if ( !checksum ) {
+
+          return makeError( SQLITE_CORRUPT, "Dump header is corrupt." );
+        }
+        checksums.push_back( static_cast<std::uint32_t>( *checksum ) );
+      }
+      const std::uint32_t calculated = crc32c( reinterpret_cast<const std::uint8_t *>( dump.data() ), position ); // NOSONAR byte access to char data
+      if ( const std::optional headerChecksum = readInteger( dump, position, sizeof( std::uint32_t ) ); !headerChecksum || *headerChecksum != calculated ) {
+
+        return makeError( SQLITE_CORRUPT, "Dump header is corrupt." );
+      }
+
+      if ( *size != dump.size() - position || *size != *pageSize * *pageCount || *blockCount != ( *size + snapshotBlockSize - 1 ) / snapshotBlockSize ) {
+
+        return makeError( SQLITE_CORRUPT, "Dump is truncated." );
+      }
+
+      if ( blockChecksums( reinterpret_cast<const std::uint8_t *>( _data + position ), static_cast<std::size_t>( *size ) ) != checksums ) { // NOSONAR byte access to char data
+
+        return makeError( SQLITE_CORRUPT, "Dump checksum mismatch." );
+      }
+
+      _offset = position;
+      return {};
+    }
+
+    /**
+     * @brief Magic of an incremental export record.
+     */
+    constexpr std::string_view deltaMagic = "SQLFDLTA";
+
+    /**
+     * @brief Size of the sqlite database header.
+     */
+    constexpr std::size_t databaseHeaderSize = 100;
+
+    /**
+     * @brief Version of the incremental export format.
+     */
+    constexpr std::uint32_t deltaVersion = 1;
+
+    /**
+     * @brief Attempts of an incremental export to find the database unchanged between checkpoint and write lock.
+     */
+    constexpr std::int32_t incrementalAttempts = 8;
+
+    /**
+     * @brief The DumpWriter class.
+     * Dedicated io thread writing serialized databases for exportDumpAsync.
+     */
+    class DumpWriter final : public Singleton<DumpWriter> {
+
+    public:
+      /**
+       * @brief Default constructor for DumpWriter.
+       */
+      DumpWriter()
+        : m_thread( [ this ] { run(); } ) {}
+
+      /**
+       * @brief Default destructor for DumpWriter.
+       * Pending exports are written before the io thread stops.
+       */
+      ~DumpWriter() {
+
+        {
+          const std::lock_guard lock( m_mutex );
+          m_stop = true;
+        }
+        m_condition.notify_all();
+        if ( m_thread.joinable() ) {
+
+          m_thread.join();
+        }
+      }
+
+      /**
+       * @brief Delete copy constructor.
+       */
+      DumpWriter( const DumpWriter & ) = delete;
+
+      /**
+       * @brief Delete move constructor.
+       */
+      DumpWriter( DumpWriter && ) = delete;
+
+      /**
+       * @brief Delete copy assign.
+       * @return Nothing.
+       */
+      DumpWriter &operator=( const DumpWriter & ) = delete;
+
+      /**
+       * @brief Delete move assign.
+       * @return Nothing.
+       */
+      DumpWriter &operator=( DumpWriter && ) = delete;
+
+      /**
+       * @brief Reserve the export slot of a schema.
+       * @param _handle   Database handle.
+       * @param _schema   Export schema.
+       * @param _backpressure   Wait for or reject a running export.
+       * @return True, if the slot is reserved - otherwise false.
+       */
+      [[nodiscard]] bool acquire( const sqlite3 *_handle,
+                                  const std::string &_schema,
+                                  Backpressure _backpressure ) {
+
+        std::unique_lock lock( m_mutex );
+        const auto key = std::make_pair( _handle, _schema );
+        if ( _backpressure == Backpressure::Reject && m_inFlight.find( key ) != std::cend( m_inFlight ) ) {
+
+          return false;
+        }
+        m_condition.wait( lock, [ this, &key ] { return m_inFlight.find( key ) == std::cend( m_inFlight ); } );
+        m_inFlight.insert( key );
+        return true;
+      }
+
+      /**
+       * @brief Release the export slot of a schema.
+       * @param _handle   Database handle.
+       * @param _schema   Export schema.
+       */
+      void release( const sqlite3 *_handle,
+                    const std::string &_schema ) {
+
+        {
+          const std::lock_guard lock( m_mutex );
+          m_inFlight.erase( std::make_pair( _handle, _schema ) );
+        }
+        m_condition.notify_all();
+      }
+
+      /**
+       * @brief Queue a serialized database for writing.
+       * @param _handle   Database handle.
+       * @param _schema   Export schema.
+       * @param _dump   Serialized database.
+       * @param _size   Size of serialized database.
+       * @param _filename   Database filename.
+       * @return Future with result code and message of operation.
+       */
+      std::future<std::error_code> submit( const sqlite3 *_handle,
+                                           const std::string &_schema,
+                                           std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> _dump,
+                                           std::size_t _size,
+                                           const std::string &_filename ) {
+
+        Job job { std::make_pair( _handle, _schema ), std::move( _dump ), _size, _filename, {} };
+        std::future<std::error_code> result = job.promise.get_future();
+        {
+          const std::lock_guard lock( m_mutex );
+          m_jobs.push_back( std::move( job ) );
+        }
+        m_condition.notify_all();
+        return result;
+      }
+
+    private:
+      /**
+       * @brief The Job struct.
+       */
+      struct Job {
+
+        /** @brief Database handle and schema. */
+        std::pair<const sqlite3 *, std::string> key {};
+
+        /** @brief Serialized database. */
+        std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> dump {};
+
+        /** @brief Size of serialized database. */
+        std::size_t size = 0;
+
+        /** @brief Database filename. */
+        std::string filename {};
+
+        /** @brief Result of operation. */
+        std::promise<std::error_code> promise {};
+      };
+
+      /**
+       * @brief Io thread loop.
+       */
+      void run() {
+
+        std::unique_lock lock( m_mutex );
+        while ( true ) {
+
+          m_condition.wait( lock, [ this ] { return m_stop || !m_jobs.empty(); } );
+          if ( m_jobs.empty() ) {
+
+            return;
+          }
+
+          Job job = std::move( m_jobs.front() );
+          m_jobs.pop_front();
+          lock.unlock();
+
+          const std::string header = snapshotHeader( job.dump.get(), job.size );
+          const std::error_code result = writeDump( { header, std::string_view( reinterpret_cast<const char *>( job.dump.get() ), job.size ) }, job.filename ); // NOSONAR char access to byte data
+          job.dump.reset();
+
+          lock.lock();
+          m_inFlight.erase( job.key );
+          m_condition.notify_all();
+          job.promise.set_value( result );
+        }
+      }
+
+      /**
+       * @brief Member for guarding jobs and running exports.
+       */
+      std::mutex m_mutex {};
+
+      /**
+       * @brief Member for waking up the io thread and waiting exports.
+       */
+      std::condition_variable m_condition {};
+
+      /**
+       * @brief Member for queued jobs.
+       */
+      std::deque<Job> m_jobs {};
+
+      /**
+       * @brief Member for running exports.
+       */
+      std::set<std::pair<const sqlite3 *, std::string>> m_inFlight {};
+
+      /**
+       * @brief Member for stopping the io thread.
+       */
+      bool m_stop = false;
+
+      /**
+       * @brief Member for the io thread - needs to be the last member.
+       */
+      std::thread m_thread;
+    };
+  }
+
   std::error_code importDump( sqlite3 *_handle,
                               const std::string &_schema,
                               const std::string &_filename ) {
 
-    if ( std::error_code errorCode {}; !std::filesystem::exists( _filename, errorCode ) || errorCode ) {
+    std::error_code errorCode {};
+    const std::uintmax_t size = std::filesystem::file_size( _filename, errorCode );
+    if ( errorCode ) {
 
-      SqliteErrorCategory::instance().setMessage( "File not found." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+      return makeError( SQLITE_IOERR, "File not found." );
     }
 
-    std::vector<char> dump {};
     std::ifstream input( _filename, std::ios::in | std::ios::binary );
     if ( !input.is_open() ) {
 
-      SqliteErrorCategory::instance().setMessage( "Cannot open file for import." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+      return makeError( SQLITE_IOERR, "Cannot open file for import." );
+    }
+    return importDump( _handle, _schema, input, static_cast<std::size_t>( size ) );
+  }
+
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              std::istream &_input,
+                              std::size_t _sizeHint ) {
+
+    /* Read straight into a sqlite buffer that is adopted by the database */
+    std::size_t capacity = std::max( _sizeHint, dumpChunkSize );
+    std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> buffer( static_cast<std::uint8_t *>( sqlite3_malloc64( capacity ) ) );
+    std::size_t size = 0;
+    while ( buffer && _input ) {
+
+      if ( size == capacity ) {
+
+        /* The size hint was exact - do not double the buffer to read nothing */
+        if ( _input.peek() == std::istream::traits_type::eof() ) {
+
+          break;
+        }
+        auto *grown = static_cast<std::uint8_t *>( sqlite3_realloc64( buffer.get(), capacity * 2 ) );
+        if ( !grown ) {
+
+          buffer.reset();
+          break;
+        }
+        std::ignore = buffer.release();
+        buffer.reset( grown );
+        capacity *= 2;
+      }
+      _input.read( reinterpret_cast<char *>( buffer.get() + size ), static_cast<std::streamsize>( std::min( dumpChunkSize, capacity - size ) ) ); // NOSONAR char access to byte data
+      size += static_cast<std::size_t>( _input.gcount() );
     }
-    if ( !input.eof() && !input.fail() ) {
 
-      input.seekg( 0, std::ios_base::end );
-      const std::streampos size = input.tellg();
-      dump.resize( static_cast<std::size_t>( size ) );
+    if ( !buffer ) {
+
+      return makeError( SQLITE_NOMEM, "Cannot allocate memory for import." );
+    }
+    if ( _input.bad() ) {
 
-      input.seekg( 0, std::ios_base::beg );
-      input.read( dump.data(), size );
+      return makeError( SQLITE_IOERR, "Cannot read data from stream." );
     }
-    try {
 
-      input.close();
+    /* The database adopts the whole allocation - give the unused capacity back */
+    if ( size > 0 && size < capacity ) {
+
+      if ( auto *shrunk = static_cast<std::uint8_t *>( sqlite3_realloc64( buffer.get(), size ) ); shrunk ) {
+
+        std::ignore = buffer.release();
+        buffer.reset( shrunk );
+      }
     }
-    catch ( const std::ofstream::failure &_exception ) {
+    return importDump( _handle, _schema, std::move( buffer ), size );
+  }
+
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> _buffer,
+                              std::size_t _size ) {
 
-      std::cout << _exception.what() << std::endl;
-      SqliteErrorCategory::instance().setMessage( "Unable to close the import file." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+    if ( !_buffer || _size == 0 ) {
+
+      return makeError( SQLITE_IOERR, "Cannot read data from file." );
     }
 
-    std::vector<std::uint8_t> converted( std::cbegin( dump ), std::cend( dump ) );
-    if ( converted.empty() ) {
+    std::size_t offset = 0;
+    if ( const std::error_code error = verifySnapshot( reinterpret_cast<const char *>( _buffer.get() ), _size, offset ); error ) { // NOSONAR char access to byte data
 
-      SqliteErrorCategory::instance().setMessage( "Cannot read data from file." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+      return error;
     }
 
-    auto *databuffer( static_cast<std::uint8_t *>( sqlite3_malloc64( sizeof( std::uint8_t ) * converted.size() ) ) );
-    std::memcpy( databuffer, converted.data(), converted.size() );
+    /* Move the image in front of the header - no second allocation */
+    if ( offset > 0 ) {
+
+      std::memmove( _buffer.get(), _buffer.get() + offset, _size - offset );
+      _size -= offset;
+    }
 
-    if ( const std::int32_t resultCode = sqlite3_deserialize( _handle, _schema.c_str(), databuffer, static_cast<sqlite3_int64>( converted.size() ), static_cast<sqlite3_int64>( converted.size() ), SQLITE_DESERIALIZE_RESIZEABLE | SQLITE_DESERIALIZE_FREEONCLOSE ); resultCode != SQLITE_OK ) {
+    /* Ownership is passed to sqlite - even on failure */
+    const auto capacity = static_cast<sqlite3_int64>( sqlite3_msize( _buffer.get() ) );
+    if ( const std::int32_t resultCode = sqlite3_deserialize( _handle, _schema.c_str(), _buffer.release(), static_cast<sqlite3_int64>( _size ), std::max( capacity, static_cast<sqlite3_int64>( _size ) ), SQLITE_DESERIALIZE_RESIZEABLE | SQLITE_DESERIALIZE_FREEONCLOSE ); resultCode != SQLITE_OK ) {
 
-      SqliteErrorCategory::instance().setMessage( sqlite3_errmsg( _handle ) );
-      return { resultCode, SqliteErrorCategory::instance() };
+      return makeError( resultCode, sqlite3_errmsg( _handle ) );
     }
 
     return {};
   }
 
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              const std::uint8_t *_data,
+                              std::size_t _size ) {
+
+    std::size_t offset = 0;
+    if ( const std::error_code error = verifySnapshot( reinterpret_cast<const char *>( _data ), _size, offset ); error ) { // NOSONAR char access to byte data
+
+      return error;
+    }
+    return deserializeDump( _handle, _schema, reinterpret_cast<const char *>( _data + offset ), _size - offset ); // NOSONAR char access to byte data
+  }
+
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              const std::string &_filename,
+                              const std::vector<std::string> &_deltas ) {
+
+    std::vector<char> dump {};
+    if ( const std::error_code error = readDump( _filename, dump ); error ) {
+
+      return error;
+    }
+
+    std::size_t offset = 0;
+    if ( const std::error_code error = verifySnapshot( dump.data(), dump.size(), offset ); error ) {
+
+      return error;
+    }
+    dump.erase( std::begin( dump ), std::begin( dump ) + static_cast<std::ptrdiff_t>( offset ) );
+
+    /* Page size of the database header - big endian, 1 stands for 65536 */
+    std::uint64_t basePageSize = 0;
+    if ( dump.size() >= databaseHeaderSize ) {
+
+      basePageSize = static_cast<std::uint64_t>( static_cast<unsigned char>( dump[ 16 ] ) ) << 8 | static_cast<unsigned char>( dump[ 17 ] );
+      basePageSize = basePageSize == 1 ? 65536 : basePageSize;
+    }
+
+    for ( const std::string &deltaFilename : _deltas ) {
+
+      std::vector<char> delta {};
+      if ( const std::error_code error = readDump( deltaFilename, delta ); error ) {
+
+        return error;
+      }
+
+      /* A delta file holds one record per incremental export */
+      std::size_t position = 0;
+      while ( position < delta.size() ) {
+
+        if ( delta.size() - position < deltaMagic.size() || std::string_view( delta.data() + position, deltaMagic.size() ) != deltaMagic ) {
+
+          return makeError( SQLITE_NOTADB, "Not an incremental export." );
+        }
+        position += deltaMagic.size();
+
+        const std::optional version = readInteger( delta, position, sizeof( std::uint32_t ) );
+        const std::optional pageSize = readInteger( delta, position, sizeof( std::uint32_t ) );
+        const std::optional pageCount = readInteger( delta, position, sizeof( std::uint32_t ) );
+        const std::optional count = readInteger( delta, position, sizeof( std::uint32_t ) );
+        if ( !version || *version != deltaVersion || !pageSize || *pageSize == 0 || !pageCount || !count ) {
+
+          return makeError( SQLITE_NOTADB, "Unsupported incremental export version." );
+        }
+        if ( *pageSize != basePageSize ) {
+
+          return makeError( SQLITE_CORRUPT, "Incremental export does not match the page size of the dump." );
+        }
+
+        dump.resize( static_cast<std::size_t>( *pageCount * *pageSize ) );
+        for ( std::uint64_t i = 0; i < *count; ++i ) {
+
+          const std::optional page = readInteger( delta, position, sizeof( std::uint32_t ) );
+          if ( !page || *page == 0 || *page > *pageCount || delta.size() - position < *pageSize ) {
+
+            return makeError( SQLITE_CORRUPT, "Incremental export is corrupt." );
+          }
+          std::memcpy( dump.data() + ( *page - 1 ) * *pageSize, delta.data() + position, static_cast<std::size_t>( *pageSize ) );
+          position += static_cast<std::size_t>( *pageSize );
+        }
+      }
+    }
+
+    return deserializeDump( _handle, _schema, dump.data(), dump.size() );
+  }
+
   std::error_code exportDump( sqlite3 *_handle,
                               const std::string &_schema,
                               const std::string &_filename ) {
 
-    /* Dump database */
+    std::ofstream output( _filename, std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( !output.is_open() ) {
+
+      return makeError( SQLITE_IOERR, "Cannot open file for export." );
+    }
+
+    /* Header and chunks go straight from the serialized database into the file */
+    if ( const std::error_code error = exportDump( _handle, _schema, [ &output ]( const char *_data, std::size_t _size ) {
+           output.write( _data, static_cast<std::streamsize>( _size ) );
+           return output.good();
+         } );
+         error ) {
+
+      return error;
+    }
+
+    output.close();
+    if ( output.fail() ) {
+
+      return makeError( SQLITE_IOERR, "Unable to write or close the export file." );
+    }
+    return {};
+  }
+
+  std::error_code exportDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              const std::function<bool( const char *, std::size_t )> &_writer,
+                              std::size_t _chunkSize ) {
+
+    /* Deserialized databases are exported without copy - the connection mutex keeps the image untouched while writing */
+    std::optional<ConnectionLock> lock( std::in_place, _handle );
     sqlite3_int64 serializationSize = 0;
-    const std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> dump( sqlite3_serialize( _handle, _schema.c_str(), &serializationSize, 0 ) );
+    std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> copy {};
+    const std::uint8_t *dump = sqlite3_serialize( _handle, _schema.c_str(), &serializationSize, SQLITE_SERIALIZE_NOCOPY );
+    if ( !dump ) {
+
+      copy.reset( sqlite3_serialize( _handle, _schema.c_str(), &serializationSize, 0 ) );
+      dump = copy.get();
+      lock.reset();
+    }
     if ( !dump || serializationSize == 0 ) {
 
-      SqliteErrorCategory::instance().setMessage( "Export empty or invalid." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+      return makeError( SQLITE_IOERR, "Export empty or invalid." );
     }
 
-#ifdef HAVE_SPAN
-    const std::span spanDump( dump.get(), static_cast<std::size_t>( serializationSize ) );
-    std::vector<char> converted( std::begin( spanDump ), std::end( spanDump ) );
-#else
-    std::vector<char> converted( dump.get(), dump.get() + serializationSize );
-#endif
-    if ( converted.empty() ) {
+    const auto size = static_cast<std::size_t>( serializationSize );
+    const std::string header = snapshotHeader( dump, size );
+    bool written = _writer( header.data(), header.size() );
+    const std::size_t chunkSize = std::max( std::size_t { 1 }, _chunkSize );
+    for ( std::size_t offset = 0; written && offset < size; offset += chunkSize ) {
 
-      SqliteErrorCategory::instance().setMessage( "Export not convertable." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+      written = _writer( reinterpret_cast<const char *>( dump + offset ), std::min( chunkSize, size - offset ) ); // NOSONAR char access to byte data
     }
+    if ( !written ) {
 
-    std::ofstream output( _filename, std::ios::out | std::ios::binary );
-    if ( !output.is_open() ) {
+      return makeError( SQLITE_IOERR, "Unable to write the export." );
+    }
+    return {};
+  }
+
+  std::error_code exportDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              std::vector<std::uint8_t> &_buffer ) {
+
+    _buffer.clear();
+    return exportDump(
+        _handle, _schema, [ &_buffer ]( const char *_data, std::size_t _size ) {
+          _buffer.insert( std::end( _buffer ), _data, _data + _size );
+          return true;
+        },
+        std::numeric_limits<std::size_t>::max() );
+  }
+
+  std::future<std::error_code> exportDumpAsync( sqlite3 *_handle,
+                                                const std::string &_schema,
+                                                const std::string &_filename,
+                                                Backpressure _backpressure ) {
+
+    DumpWriter &writer = DumpWriter::instance();
+    if ( !writer.acquire( _handle, _schema, _backpressure ) ) {
 
-      SqliteErrorCategory::instance().setMessage( "Cannot open file for export." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+      std::promise<std::error_code> result {};
+      result.set_value( makeError( SQLITE_BUSY, "Export of schema already in progress." ) );
+      return result.get_future();
     }
-    try {
 
-      output.write( converted.data(), static_cast<std::streamsize>( converted.size() ) );
-      output.close();
+    /* Dump database - the only part that needs the connection */
+    sqlite3_int64 serializationSize = 0;
+    std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> dump( sqlite3_serialize( _handle, _schema.c_str(), &serializationSize, 0 ) );
+    if ( !dump || serializationSize == 0 ) {
+
+      writer.release( _handle, _schema );
+      std::promise<std::error_code> result {};
+      result.set_value( makeError( SQLITE_IOERR, "Export empty or invalid." ) );
+      return result.get_future();
     }
-    catch ( const std::ofstream::failure &_exception ) {
 
-      std::cout << _exception.what() << std::endl;
-      SqliteErrorCategory::instance().setMessage( "Unable to write or close the export file." );
-      return { SQLITE_IOERR, SqliteErrorCategory::instance() };
+    return writer.submit( _handle, _schema, std::move( dump ), static_cast<std::size_t>( serializationSize ), _filename );
+  }
+
+  std::error_code exportIncremental( sqlite3 *_handle,
+                                     const std::string &_schema,
+                                     const std::string &_filename ) {
+
+    const char *databaseFilename = sqlite3_db_filename( _handle, _schema.c_str() );
+    if ( !databaseFilename || *databaseFilename == '\0' ) {
+
+      return makeError( SQLITE_MISUSE, "Incremental export needs a database file." );
+    }
+
+    const std::unique_ptr<char, sqlite3_str_deleter> versionSql( sqlite3_mprintf( "PRAGMA \"%w\".data_version", _schema.c_str() ) );
+    const auto dataVersion = [ _handle, &versionSql ]() -> std::optional<sqlite3_int64> {
+      const auto statement = sqlite3_stmt_make_unique( _handle, versionSql.get() );
+      if ( !statement || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+        return std::nullopt;
+      }
+      return sqlite3_column_int64( statement.get(), 0 );
+    };
+
+    /* Checkpoint, then hold the write lock - without a commit in between the database file stays untouched until the delta is written */
+    for ( std::int32_t attempt = 1;; ++attempt ) {
+
+      const std::optional version = dataVersion();
+
+      /* Move committed wal frames into the database file - no effect in rollback journal mode */
+      if ( const std::int32_t resultCode = sqlite3_wal_checkpoint_v2( _handle, _schema.c_str(), SQLITE_CHECKPOINT_FULL, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+      if ( const std::int32_t resultCode = sqlite3_exec( _handle, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
+      if ( version && version == dataVersion() ) {
+
+        break;
+      }
+      sqlite3_exec( _handle, "COMMIT", nullptr, nullptr, nullptr );
+      if ( attempt == incrementalAttempts ) {
+
+        return makeError( SQLITE_BUSY, "Database changed during the incremental export." );
+      }
+    }
+    const auto finish = [ _handle ]( const std::error_code &_error ) {
+      sqlite3_exec( _handle, "COMMIT", nullptr, nullptr, nullptr );
+      return _error;
+    };
+
+    const std::unique_ptr<char, sqlite3_str_deleter> sql( sqlite3_mprintf( "SELECT page_size, page_count FROM \"%w\".pragma_page_size, \"%w\".pragma_page_count", _schema.c_str(), _schema.c_str() ) );
+    std::error_code error {};
+    const auto statement = sqlite3_stmt_make_unique( _handle, sql.get(), error );
+    if ( !statement ) {
+
+      return finish( error );
+    }
+    if ( const std::int32_t resultCode = sqlite3_step( statement.get() ); resultCode != SQLITE_ROW ) {
+
+      return finish( makeError( resultCode, sqlite3_errmsg( _handle ) ) );
+    }
+    const auto pageSize = static_cast<std::uint32_t>( sqlite3_column_int64( statement.get(), 0 ) );
+    const auto pageCount = static_cast<std::uint32_t>( sqlite3_column_int64( statement.get(), 1 ) );
+
+    sqlite3_file *file = nullptr;
+    if ( const std::int32_t resultCode = sqlite3_file_control( _handle, _schema.c_str(), SQLITE_FCNTL_FILE_POINTER, &file ); resultCode != SQLITE_OK || !file || !file->pMethods ) {
+
+      return finish( makeError( SQLITE_IOERR, "Cannot access the database file." ) );
+    }
+
+    /* Taken before the first page is read - a failed export marks the pages again */
+    const std::optional pages = takeDirtyPages( databaseFilename, pageSize );
+    if ( !pages ) {
+
+      return finish( makeError( SQLITE_MISUSE, "Database is not opened with the tracking vfs." ) );
+    }
+    const auto fail = [ &finish, &databaseFilename, &pages, pageSize ]( const std::error_code &_error ) {
+      restoreDirtyPages( databaseFilename, *pages, pageSize );
+      return finish( _error );
+    };
+
+    /* Pages beyond the end of a shrunken database are gone */
+    const auto last = std::upper_bound( std::cbegin( *pages ), std::cend( *pages ), pageCount );
+    std::string record( deltaMagic );
+    record.reserve( record.size() + sizeof( std::uint32_t ) * 4 + static_cast<std::size_t>( std::distance( std::cbegin( *pages ), last ) ) * ( sizeof( std::uint32_t ) + pageSize ) );
+    appendInteger( record, deltaVersion, sizeof( std::uint32_t ) );
+    appendInteger( record, pageSize, sizeof( std::uint32_t ) );
+    appendInteger( record, pageCount, sizeof( std::uint32_t ) );
+    appendInteger( record, static_cast<std::uint64_t>( std::distance( std::cbegin( *pages ), last ) ), sizeof( std::uint32_t ) );
+    std::vector<char> page( pageSize );
+    for ( auto iterator = std::cbegin( *pages ); iterator != last; ++iterator ) {
+
+      if ( const std::int32_t resultCode = file->pMethods->xRead( file, page.data(), static_cast<std::int32_t>( pageSize ), static_cast<sqlite3_int64>( *iterator - 1 ) * pageSize ); resultCode != SQLITE_OK ) {
+
+        return fail( makeError( resultCode ) );
+      }
+      appendInteger( record, *iterator, sizeof( std::uint32_t ) );
+      record.append( page.data(), page.size() );
+    }
+
+    if ( error = writeDump( { record }, _filename, true ); error ) {
+
+      return fail( error );
+    }
+    return finish( {} );
+  }
+
+  namespace {
+
+    /**
+     * @brief Magic of a dump container.
+     */
+    constexpr std::string_view containerMagic = "SQLFDUMP";
+
+    /**
+     * @brief Version of the dump container format.
+     */
+    constexpr std::uint32_t containerVersion = 2;
+
+    /**
+     * @brief The ContainerEntry struct.
+     */
+    struct ContainerEntry {
+
+      /** @brief Schema name. */
+      std::string schema {};
+
+      /** @brief Offset of the checked dump within the container. */
+      std::uint64_t offset = 0;
+
+      /** @brief Size of the checked dump - snapshot header and serialized database. */
+      std::uint64_t size = 0;
+    };
+
+    /**
+     * @brief List the schemas of a database handle - without temp.
+     * @param _handle   Database handle.
+     * @return Schema names in PRAGMA database_list order.
+     */
+    std::vector<std::string> schemaList( sqlite3 *_handle ) {
+
+      std::vector<std::string> schemas {};
+      const auto statement = sqlite3_stmt_make_unique( _handle, "PRAGMA database_list" );
+      if ( !statement ) {
+
+        return schemas;
+      }
+      while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {
+
+        const std::optional schema = string_utils::fromUnsignedChar( sqlite3_column_text( statement.get(), 1 ) );
+        if ( schema && *schema != "temp" ) {
+
+          schemas.push_back( *schema );
+        }
+      }
+      return schemas;
+    }
+  }
+
+  std::error_code exportDumpContainer( sqlite3 *_handle,
+                                       const std::string &_filename ) {
+
+    const std::vector<std::string> schemas = schemaList( _handle );
+    if ( schemas.empty() ) {
+
+      return makeError( SQLITE_ERROR, "No schema to export." );
+    }
+
+    /* Dump every schema with its own checksummed header - serialization is guarded by the connection anyway */
+    std::vector<std::unique_ptr<std::uint8_t, sqlite3_generic_deleter>> dumps {};
+    std::vector<std::string> snapshotHeaders {};
+    std::vector<ContainerEntry> entries {};
+    dumps.reserve( schemas.size() );
+    snapshotHeaders.reserve( schemas.size() );
+    entries.reserve( schemas.size() );
+    for ( const std::string &schema : schemas ) {
+
+      sqlite3_int64 serializationSize = 0;
+      dumps.emplace_back( sqlite3_serialize( _handle, schema.c_str(), &serializationSize, 0 ) );
+      if ( !dumps.back() || serializationSize == 0 ) {
+
+        return makeError( SQLITE_IOERR, "Export empty or invalid." );
+      }
+      snapshotHeaders.push_back( snapshotHeader( dumps.back().get(), static_cast<std::size_t>( serializationSize ) ) );
+      entries.push_back( { schema, 0, snapshotHeaders.back().size() + static_cast<std::uint64_t>( serializationSize ) } );
+    }
+
+    /* Table of contents with trailing checksum */
+    std::uint64_t offset = containerMagic.size() + sizeof( std::uint32_t ) * 3;
+    for ( const ContainerEntry &entry : entries ) {
+
+      offset += sizeof( std::uint32_t ) + entry.schema.size() + sizeof( std::uint64_t ) * 2;
+    }
+    std::string header( containerMagic );
+    appendInteger( header, containerVersion, sizeof( std::uint32_t ) );
+    appendInteger( header, entries.size(), sizeof( std::uint32_t ) );
+    for ( ContainerEntry &entry : entries ) {
+
+      entry.offset = offset;
+      offset += entry.size;
+      appendInteger( header, entry.schema.size(), sizeof( std::uint32_t ) );
+      header += entry.schema;
+      appendInteger( header, entry.offset, sizeof( std::uint64_t ) );
+      appendInteger( header, entry.size, sizeof( std::uint64_t ) );
+    }
+    appendInteger( header, crc32c( reinterpret_cast<const std::uint8_t *>( header.data() ), header.size() ), sizeof( std::uint32_t ) ); // NOSONAR byte access to char data
+
+    /* One sequential stream */
+    std::vector<std::string_view> parts { header };
+    for ( std::size_t i = 0; i < dumps.size(); ++i ) {
+
+      parts.emplace_back( snapshotHeaders.at( i ) );
+      parts.emplace_back( reinterpret_cast<const char *>( dumps.at( i ).get() ), entries.at( i ).size - snapshotHeaders.at( i ).size() ); // NOSONAR char access to byte data
+    }
+    return writeDump( parts, _filename );
+  }
+
+  std::error_code importDumpContainer( sqlite3 *_handle,
+                                       const std::string &_filename ) {
+
+    std::vector<char> container {};
+    if ( const std::error_code error = readDump( _filename, container ); error ) {
+
+      return error;
+    }
+
+    if ( container.size() < containerMagic.size() || std::string_view( container.data(), containerMagic.size() ) != containerMagic ) {
+
+      return makeError( SQLITE_NOTADB, "Not a dump container." );
+    }
+
+    std::size_t position = containerMagic.size();
+    const std::optional version = readInteger( container, position, sizeof( std::uint32_t ) );
+    const std::optional count = readInteger( container, position, sizeof( std::uint32_t ) );
+    if ( !version || *version != containerVersion || !count ) {
+
+      return makeError( SQLITE_NOTADB, "Unsupported dump container version." );
+    }
+
+    std::vector<ContainerEntry> entries {};
+    for ( std::uint64_t i = 0; i < *count; ++i ) {
+
+      const std::optional length = readInteger( container, position, sizeof( std::uint32_t ) );
+      if ( !length || *length > container.size() - position ) {
+
+        return makeError( SQLITE_CORRUPT, "Dump container table of contents is corrupt." );
+      }
+      ContainerEntry entry {};
+      entry.schema.assign( container.data() + position, static_cast<std::size_t>( *length ) );
+      position += static_cast<std::size_t>( *length );
+      const std::optional offset = readInteger( container, position, sizeof( std::uint64_t ) );
+      const std::optional size = readInteger( container, position, sizeof( std::uint64_t ) );
+      if ( !offset || !size || *size == 0 || *offset > container.size() || *size > container.size() - *offset ) {
+
+        return makeError( SQLITE_CORRUPT, "Dump container table of contents is corrupt." );
+      }
+      entry.offset = *offset;
+      entry.size = *size;
+      entries.push_back( std::move( entry ) );
+    }
+    const std::uint32_t calculated = crc32c( reinterpret_cast<const std::uint8_t *>( container.data() ), position ); // NOSONAR byte access to char data
+    if ( const std::optional checksum = readInteger( container, position, sizeof( std::uint32_t ) ); !checksum || *checksum != calculated ) {
+
+      return makeError( SQLITE_CORRUPT, "Dump container table of contents is corrupt." );
+    }
+
+    /* Verify and copy every schema into its own sqlite buffer in parallel */
+    using Copy = std::pair<std::error_code, std::unique_ptr<std::uint8_t, sqlite3_generic_deleter>>;
+    std::vector<std::future<Copy>> copies {};
+    copies.reserve( entries.size() );
+    for ( ContainerEntry &entry : entries ) {
+
+      copies.push_back( std::async( std::launch::async, [ &container, &entry ] {
+        const char *data = container.data() + entry.offset;
+        std::size_t offset = 0;
+        if ( const std::error_code error = verifySnapshot( data, static_cast<std::size_t>( entry.size ), offset ); error || offset == 0 ) {
+
+          return Copy { error ? error : makeError( SQLITE_CORRUPT, "Dump container entry has no checksum." ), nullptr };
+        }
+        entry.size -= offset;
+        std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> databuffer( static_cast<std::uint8_t *>( sqlite3_malloc64( entry.size ) ) );
+        if ( !databuffer ) {
+
+          return Copy { makeError( SQLITE_NOMEM, "Cannot allocate memory for import." ), nullptr };
+        }
+        std::memcpy( databuffer.get(), data + offset, static_cast<std::size_t>( entry.size ) );
+        return Copy { std::error_code {}, std::move( databuffer ) };
+      } ) );
+    }
+    std::vector<std::unique_ptr<std::uint8_t, sqlite3_generic_deleter>> buffers {};
+    buffers.reserve( copies.size() );
+    std::error_code copyError {};
+    for ( auto &copy : copies ) {
+
+      auto [ error, buffer ] = copy.get();
+      if ( error && !copyError ) {
+
+        copyError = error;
+      }
+      buffers.push_back( std::move( buffer ) );
+    }
+
+    /* Nothing is attached before every schema is verified */
+    if ( copyError ) {
+
+      return copyError;
+    }
+
+    const std::vector<std::string> attached = schemaList( _handle );
+    for ( std::size_t i = 0; i < entries.size(); ++i ) {
+
+      const ContainerEntry &entry = entries.at( i );
+
+      if ( std::find( std::cbegin( attached ), std::cend( attached ), entry.schema ) == std::cend( attached ) ) {
+
+        const std::unique_ptr<char, sqlite3_str_deleter> sql( sqlite3_mprintf( "ATTACH DATABASE ':memory:' AS \"%w\"", entry.schema.c_str() ) );
+        if ( const std::int32_t resultCode = sqlite3_exec( _handle, sql.get(), nullptr, nullptr, nullptr ); resultCode != SQLITE_OK ) {
+
+          return makeError( resultCode, sqlite3_errmsg( _handle ) );
+        }
+      }
+
+      /* Ownership is passed to sqlite - even on failure */
+      if ( const std::int32_t resultCode = sqlite3_deserialize( _handle, entry.schema.c_str(), buffers.at( i ).release(), static_cast<sqlite3_int64>( entry.size ), static_cast<sqlite3_int64>( entry.size ), SQLITE_DESERIALIZE_RESIZEABLE | SQLITE_DESERIALIZE_FREEONCLOSE ); resultCode != SQLITE_OK ) {
+
+        return makeError( resultCode, sqlite3_errmsg( _handle ) );
+      }
     }
 
     return {};
@@ -301,6 +1527,8 @@ namespace vx::sqlite_utils {
                  std::int32_t _argc,
                  sqlite3_value **_argv ) noexcept {
 
+    FunctionCounter counter( SqlFunction::Distance );
+
     /* Parameter count mismatch */
 #if __cplusplus > 201703L && ( defined __GNUC__ && __GNUC__ >= 10 || defined _MSC_VER && _MSC_VER >= 1926 || defined __clang__ && __clang_major__ >= 10 )
     const std::span args( _argv, static_cast<std::size_t>( _argc ) );
@@ -312,6 +1540,7 @@ namespace vx::sqlite_utils {
 #ifdef DEBUG
       std::cout << "DISTANCE: Parameter mismatch." << std::endl;
 #endif
+      counter.null();
       sqlite3_result_null( _context );
       return;
     }
@@ -325,6 +1554,7 @@ namespace vx::sqlite_utils {
   #ifdef DEBUG
         std::cout << "DISTANCE: Parameter mismatch." << std::endl;
   #endif
+        counter.null();
         sqlite3_result_null( _context );
         return;
       }
@@ -334,6 +1564,7 @@ namespace vx::sqlite_utils {
 
       if ( sqlite3_value_type( _argv[ x ] ) == SQLITE_NULL ) {
 
+        counter.null();
         sqlite3_result_null( _context );
         return;
       }
@@ -351,13 +1582,21 @@ namespace vx::sqlite_utils {
     const double latitude2 = sqlite3_value_double( _argv[ 2 ] );
     const double longitude2 = sqlite3_value_double( _argv[ 3 ] );
 #endif
-    sqlite3_result_double( _context, std::acos( sin( latitude1 / halfCircleDegree * pi() ) * std::sin( latitude2 / halfCircleDegree * pi() ) + std::cos( latitude1 / halfCircleDegree * pi() ) * std::cos( latitude2 / halfCircleDegree * pi() ) * std::cos( ( longitude2 / halfCircleDegree * pi() ) - ( longitude1 / halfCircleDegree * pi() ) ) ) * earthBlubKm );
+    const double result = std::acos( sin( latitude1 / halfCircleDegree * pi() ) * std::sin( latitude2 / halfCircleDegree * pi() ) + std::cos( latitude1 / halfCircleDegree * pi() ) * std::cos( latitude2 / halfCircleDegree * pi() ) * std::cos( ( longitude2 / halfCircleDegree * pi() ) - ( longitude1 / halfCircleDegree * pi() ) ) ) * earthBlubKm;
+    if ( std::isnan( result ) ) {
+
+      /* sqlite stores NaN as NULL */
+      counter.null();
+    }
+    sqlite3_result_double( _context, result );
   }
 
   void transliteration( sqlite3_context *_context,
                         std::int32_t _argc,
                         sqlite3_value **_argv ) {
 
+    FunctionCounter counter( SqlFunction::Transliteration );
+
 #if __cplusplus > 201703L && ( defined __GNUC__ && __GNUC__ >= 10 || defined _MSC_VER && _MSC_VER >= 1926 || defined __clang__ && __clang_major__ >= 10 )
     const std::span args( _argv, static_cast<std::size_t>( _argc ) );
     if ( args.size() != 1 && ( sqlite3_value_type( args[ 0 ] ) == SQLITE_NULL ) ) {
@@ -368,6 +1607,7 @@ namespace vx::sqlite_utils {
 #ifdef DEBUG
       std::cout << "TRANSLITERATION: Parameter mismatch." << std::endl;
 #endif
+      counter.null();
       sqlite3_result_null( _context );
       return;
     }
@@ -397,6 +1637,7 @@ namespace vx::sqlite_utils {
 #ifdef DEBUG
       std::cout << "TRANSLITERATION: Cannot create transliterator." << std::endl;
 #endif
+      counter.null();
       sqlite3_result_null( _context );
       return;
     }
@@ -31,12 +31,20 @@
 #pragma once
 
 /* c header */
-#include <cstdint> // std::int32_t
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::uint8_t
 
 /* stl header */
+#include <functional>
+#include <future>
+#include <iosfwd>
 #include <memory>
 #include <string>
 #include <system_error>
+#include <vector>
+
+/* sqlite_functions */
+#include "SqliteOpenOptions.h"
 
 /* forward declation of sqlite3 */
 struct sqlite3;
@@ -49,6 +57,11 @@ struct sqlite3_value;
  */
 namespace vx::sqlite_utils {
 
+  /**
+   * @brief Default chunk size for streamed import and export.
+   */
+  constexpr std::size_t dumpChunkSize = std::size_t { 64 } * 1024;
+
   /**
    * @brief The Result enum.
    */
@@ -58,6 +71,15 @@ namespace vx::sqlite_utils {
     Message /**< Result message. */
   };
 
+  /**
+   * @brief The Backpressure enum.
+   */
+  enum class Backpressure {
+
+    Block, /**< Wait until the running export of the same schema is finished. */
+    Reject /**< Return immediately with busy if an export of the same schema is running. */
+  };
+
   /**
    * @brief The sqlite3_deleter class.
    */
@@ -122,6 +144,18 @@ namespace vx::sqlite_utils {
   std::unique_ptr<sqlite3, sqlite3_deleter> sqlite3_make_unique( const std::string &_filename,
                                                                  std::error_code &_error ) noexcept;
 
+  /**
+   * @brief Create sqlite3_open_v2 unique pointer with open options.
+   * The lookaside and the busy timeout are set before the PRAGMAs of the options.
+   * @param _filename   Database filename.
+   * @param _options   Open flags and connection settings.
+   * @param _error   Error code.
+   * @return Unique pointer for sqlite3 handle or nullptr on error.
+   */
+  std::unique_ptr<sqlite3, sqlite3_deleter> sqlite3_make_unique( const std::string &_filename,
+                                                                 const OpenOptions &_options,
+                                                                 std::error_code &_error ) noexcept;
+
   /**
    * @brief Create sqlite3_stmt unique pointer.
    * @param _handle   Database handle.
@@ -144,6 +178,7 @@ namespace vx::sqlite_utils {
 
   /**
    * @brief Import sql dump.
+   * The checksums of the dump header are verified before sqlite touches the data.
    * @param _handle   Database handle.
    * @param _schema   Import shema - default is main.
    * @param _filename   Database filename.
@@ -153,8 +188,62 @@ namespace vx::sqlite_utils {
                               const std::string &_schema,
                               const std::string &_filename );
 
+  /**
+   * @brief Import sql dump from a stream - also non-seekable ones like pipes.
+   * The stream is read in chunks directly into the buffer that is adopted by the database - trimmed to the size of the dump.
+   * @param _handle   Database handle.
+   * @param _schema   Import shema - default is main.
+   * @param _input   Stream to read until its end.
+   * @param _sizeHint   Expected size of the dump to allocate upfront - 0 if unknown.
+   * @return Result code and message of operation.
+   */
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              std::istream &_input,
+                              std::size_t _sizeHint = 0 );
+
+  /**
+   * @brief Import sql dump by adopting the buffer without copying.
+   * @param _handle   Database handle.
+   * @param _schema   Import shema - default is main.
+   * @param _buffer   Dump allocated with sqlite3_malloc64 - owned by the database afterwards.
+   * @param _size   Size of dump.
+   * @return Result code and message of operation.
+   */
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              std::unique_ptr<std::uint8_t, sqlite3_generic_deleter> _buffer,
+                              std::size_t _size );
+
+  /**
+   * @brief Import sql dump from a copy of caller memory.
+   * @param _handle   Database handle.
+   * @param _schema   Import shema - default is main.
+   * @param _data   Dump.
+   * @param _size   Size of dump.
+   * @return Result code and message of operation.
+   */
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              const std::uint8_t *_data,
+                              std::size_t _size );
+
+  /**
+   * @brief Import sql dump and replay incremental exports on top.
+   * @param _handle   Database handle.
+   * @param _schema   Import shema - default is main.
+   * @param _filename   Database filename of the base dump.
+   * @param _deltas   Filenames of incremental exports in export order.
+   * @return Result code and message of operation.
+   */
+  std::error_code importDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              const std::string &_filename,
+                              const std::vector<std::string> &_deltas );
+
   /**
    * @brief Export sql dump.
+   * The dump starts with a header carrying page size, page count and CRC32C checksums.
    * @param _handle   Database handle.
    * @param _schema   Export shema - default is main.
    * @param _filename   Database filename.
@@ -164,6 +253,81 @@ namespace vx::sqlite_utils {
                               const std::string &_schema,
                               const std::string &_filename );
 
+  /**
+   * @brief Export sql dump through a writer in fixed-size chunks.
+   * Deserialized databases are written without copy, the connection mutex is held until the writer returned the last chunk.
+   * Other threads using the connection wait meanwhile - the writer may use the connection itself.
+   * @param _handle   Database handle.
+   * @param _schema   Export shema - default is main.
+   * @param _writer   Called with header and chunks in order - return false to abort.
+   * @param _chunkSize   Maximum size of a chunk.
+   * @return Result code and message of operation.
+   */
+  std::error_code exportDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              const std::function<bool( const char *, std::size_t )> &_writer,
+                              std::size_t _chunkSize = dumpChunkSize );
+
+  /**
+   * @brief Export sql dump into a buffer.
+   * @param _handle   Database handle.
+   * @param _schema   Export shema - default is main.
+   * @param _buffer   Buffer to fill - previous content is dropped.
+   * @return Result code and message of operation.
+   */
+  std::error_code exportDump( sqlite3 *_handle,
+                              const std::string &_schema,
+                              std::vector<std::uint8_t> &_buffer );
+
+  /**
+   * @brief Export sql dump in background.
+   * The database is serialized within the calling thread, the file is written by a dedicated io thread.
+   * Only one export per database handle and schema is in flight at the same time.
+   * @param _handle   Database handle.
+   * @param _schema   Export shema - default is main.
+   * @param _filename   Database filename.
+   * @param _backpressure   Behavior if an export of the same schema is already running.
+   * @return Future with result code and message of operation.
+   */
+  std::future<std::error_code> exportDumpAsync( sqlite3 *_handle,
+                                                const std::string &_schema,
+                                                const std::string &_filename,
+                                                Backpressure _backpressure = Backpressure::Block );
+
+  /**
+   * @brief Append the pages written since the last incremental export to a delta file.
+   * The database needs to be opened with the tracking vfs - see registerTrackingVfs.
+   * The wal is checkpointed and the write lock is held until the delta is written, writers wait meanwhile.
+   * @param _handle   Database handle.
+   * @param _schema   Export shema - default is main.
+   * @param _filename   Delta filename.
+   * @return Result code and message of operation.
+   */
+  std::error_code exportIncremental( sqlite3 *_handle,
+                                     const std::string &_schema,
+                                     const std::string &_filename );
+
+  /**
+   * @brief Import every schema of a dump container.
+   * The table of contents and the checksums of every schema are verified before the first schema is attached.
+   * Schemas that are not yet known are attached as in-memory databases.
+   * @param _handle   Database handle.
+   * @param _filename   Container filename.
+   * @return Result code and message of operation.
+   */
+  std::error_code importDumpContainer( sqlite3 *_handle,
+                                       const std::string &_filename );
+
+  /**
+   * @brief Export every schema of PRAGMA database_list - except temp - into one dump container.
+   * Every schema is stored with the CRC32C header of exportDump.
+   * @param _handle   Database handle.
+   * @param _filename   Container filename.
+   * @return Result code and message of operation.
+   */
+  std::error_code exportDumpContainer( sqlite3 *_handle,
+                                       const std::string &_filename );
+
   /**
    * @brief Calculate the location distance as sql command.
    * @param _context   SQLite3 context.
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* stl header */
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <tuple> // std::ignore
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* local header */
+#include "SqliteError.h"
+#include "SqliteWriteQueue.h"
+
+namespace vx::sqlite_utils {
+
+  namespace {
+
+    /**
+     * @brief Bind a queued value - it lives until the write ran.
+     * @param _statement   Statement to bind.
+     * @param _index   Parameter index.
+     * @param _value   Value to bind.
+     * @return Result code of the bind.
+     */
+    std::int32_t bindValue( sqlite3_stmt *_statement,
+                            std::int32_t _index,
+                            const WriteValue &_value ) noexcept {
+
+      return std::visit( [ _statement, _index ]( const auto &_content ) {
+        using T = std::decay_t<decltype( _content )>;
+        if constexpr ( std::is_same_v<T, std::int64_t> ) {
+
+          return sqlite3_bind_int64( _statement, _index, _content );
+        }
+        else if constexpr ( std::is_same_v<T, double> ) {
+
+          return sqlite3_bind_double( _statement, _index, _content );
+        }
+        else if constexpr ( std::is_same_v<T, std::string> ) {
+
+          return sqlite3_bind_text64( _statement, _index, _content.data(), _content.size(), SQLITE_STATIC, SQLITE_UTF8 );
+        }
+        else {
+
+          return sqlite3_bind_null( _statement, _index );
+        }
+      },
+                         _value );
+    }
+
+    /**
+     * @brief Step a statement until it is done and reset it.
+     * @param _handle   Database handle.
+     * @param _statement   Statement to step.
+     * @return Result code and message of operation.
+     */
+    std::error_code stepStatement( sqlite3 *_handle,
+                                   sqlite3_stmt *_statement ) {
+
+      if ( !_statement ) {
+
+        return makeError( SQLITE_ERROR, sqlite3_errmsg( _handle ) );
+      }
+
+      std::int32_t resultCode = SQLITE_OK;
+      while ( ( resultCode = sqlite3_step( _statement ) ) == SQLITE_ROW ) {}
+      if ( resultCode != SQLITE_DONE ) {
+
+        const std::error_code error = makeError( resultCode, sqlite3_errmsg( _handle ) );
+        sqlite3_reset( _statement );
+        return error;
+      }
+      sqlite3_reset( _statement );
+      return {};
+    }
+  }
+
+  WriteQueue::WriteQueue( sqlite3 *_handle,
+                          std::size_t _groupSize,
+                          std::chrono::microseconds _groupLatency )
+    : m_handle( _handle ),
+      m_groupSize( std::max( std::size_t { 1 }, _groupSize ) ),
+      m_groupLatency( _groupLatency ),
+      m_statements( _handle ),
+      m_head( new Node ),
+      m_tail( m_head ),
+      m_thread( [ this ] { run(); } ) {}
+
+  WriteQueue::~WriteQueue() {
+
+    {
+      const std::lock_guard lock( m_mutex );
+      m_stop = true;
+    }
+    m_condition.notify_all();
+    if ( m_thread.joinable() ) {
+
+      m_thread.join();
+    }
+    delete m_head;
+  }
+
+  std::future<std::error_code> WriteQueue::submit( Work _work ) {
+
+    auto *node = new Node;
+    node->work = std::move( _work );
+    std::future<std::error_code> result = node->promise.get_future();
+    push( node );
+    return result;
+  }
+
+  std::future<std::error_code> WriteQueue::submit( std::string _sql,
+                                                   std::vector<WriteValue> _values ) {
+
+    return submit( [ this, sql = std::move( _sql ), values = std::move( _values ) ]( sqlite3 *_handle ) -> std::error_code {
+      std::error_code error {};
+      const CachedStatement statement = m_statements.prepare( sql, error );
+      if ( !statement ) {
+
+        return error;
+      }
+
+      const auto parameters = static_cast<std::size_t>( sqlite3_bind_parameter_count( statement.get() ) );
+      if ( parameters == 0 ? !values.empty() : values.size() % parameters != 0 ) {
+
+        return makeError( SQLITE_MISUSE, "Values are not a multiple of the parameter count." );
+      }
+
+      const std::size_t sets = parameters == 0 ? 1 : values.size() / parameters;
+      for ( std::size_t set = 0; set < sets; ++set ) {
+
+        for ( std::size_t parameter = 0; parameter < parameters; ++parameter ) {
+
+          if ( const std::int32_t resultCode = bindValue( statement.get(), static_cast<std::int32_t>( parameter + 1 ), values[ set * parameters + parameter ] ); resultCode != SQLITE_OK ) {
+
+            return makeError( resultCode, sqlite3_errmsg( _handle ) );
+          }
+        }
+        if ( error = stepStatement( _handle, statement.get() ); error ) {
+
+          return error;
+        }
+      }
+      return {};
+    } );
+  }
+
+  void WriteQueue::push( Node *_node ) noexcept {
+
+    Node *previous = m_tail.exchange( _node, std::memory_order_acq_rel );
+    previous->next.store( _node );
+    if ( m_sleeping.load() ) {
+
+      const std::lock_guard lock( m_mutex );
+      m_condition.notify_one();
+    }
+  }
+
+  bool WriteQueue::pop( Work &_work,
+                        std::promise<std::error_code> &_promise ) noexcept {
+
+    Node *next = m_head->next.load( std::memory_order_acquire );
+    if ( !next ) {
+
+      return false;
+    }
+
+    /* The popped node becomes the new stub */
+    _work = std::move( next->work );
+    _promise = std::move( next->promise );
+    delete m_head;
+    m_head = next;
+    return true;
+  }
+
+  bool WriteQueue::pending() const noexcept {
+
+    return m_head->next.load() != nullptr;
+  }
+
+  bool WriteQueue::wait( std::chrono::steady_clock::time_point _deadline ) {
+
+    m_sleeping = true;
+    {
+      std::unique_lock lock( m_mutex );
+      if ( _deadline == std::chrono::steady_clock::time_point::max() ) {
+
+        m_condition.wait( lock, [ this ] { return pending() || m_stop; } );
+      }
+      else {
+
+        m_condition.wait_until( lock, _deadline, [ this ] { return pending() || m_stop; } );
+      }
+    }
+    m_sleeping = false;
+    return pending();
+  }
+
+  void WriteQueue::run() {
+
+    const auto begin = sqlite3_stmt_make_unique( m_handle, "BEGIN IMMEDIATE" );
+    const auto commit = sqlite3_stmt_make_unique( m_handle, "COMMIT" );
+    const auto savepoint = sqlite3_stmt_make_unique( m_handle, "SAVEPOINT vx_write" );
+    const auto release = sqlite3_stmt_make_unique( m_handle, "RELEASE vx_write" );
+    const auto rollbackTo = sqlite3_stmt_make_unique( m_handle, "ROLLBACK TO vx_write" );
+
+    std::vector<std::pair<std::promise<std::error_code>, std::error_code>> group {};
+    group.reserve( m_groupSize );
+    Work work {};
+    std::promise<std::error_code> promise {};
+    while ( true ) {
+
+      if ( !pop( work, promise ) ) {
+
+        if ( m_stop && !pending() ) {
+
+          break;
+        }
+        wait( std::chrono::steady_clock::time_point::max() );
+        continue;
+      }
+
+      /* One transaction per group - bounded by count and latency */
+      const std::error_code groupError = stepStatement( m_handle, begin.get() );
+      const auto deadline = std::chrono::steady_clock::now() + m_groupLatency;
+
+      /* Without a transaction only the current write fails - the queued writes start a new group */
+      bool ended = static_cast<bool>( groupError );
+      do {
+
+        std::error_code result = groupError;
+        if ( !result ) {
+
+          if ( result = stepStatement( m_handle, savepoint.get() ); !result ) {
+
+            try {
+
+              result = work( m_handle );
+            }
+            catch ( ... ) {
+
+              result = makeError( SQLITE_ABORT, "Write threw an exception." );
+            }
+
+            /* A failed write may roll back the whole transaction - e.g. SQLITE_FULL or ON CONFLICT ROLLBACK */
+            if ( sqlite3_get_autocommit( m_handle ) != 0 ) {
+
+              ended = true;
+            }
+            else {
+
+              if ( result ) {
+
+                std::ignore = stepStatement( m_handle, rollbackTo.get() );
+              }
+              std::ignore = stepStatement( m_handle, release.get() );
+            }
+          }
+        }
+        if ( ended && result ) {
+
+          /* Earlier writes of the group were part of the rolled back transaction */
+          for ( auto &entry : group ) {
+
+            if ( !entry.second ) {
+
+              entry.second = makeError( SQLITE_ABORT, "Transaction rolled back by a failed write of the group." );
+            }
+          }
+        }
+        group.emplace_back( std::move( promise ), result );
+        work = nullptr;
+      } while ( !ended && group.size() < m_groupSize && ( pop( work, promise ) || ( std::chrono::steady_clock::now() < deadline && wait( deadline ) && pop( work, promise ) ) ) );
+
+      /* The remaining writes start a new group */
+      std::error_code commitError = groupError;
+      if ( !groupError && !ended ) {
+
+        if ( commitError = stepStatement( m_handle, commit.get() ); commitError && sqlite3_get_autocommit( m_handle ) == 0 ) {
+
+          sqlite3_exec( m_handle, "ROLLBACK", nullptr, nullptr, nullptr );
+        }
+      }
+      m_commits.fetch_add( 1, std::memory_order_relaxed );
+      m_writes.fetch_add( group.size(), std::memory_order_relaxed );
+      for ( auto &[ result, error ] : group ) {
+
+        result.set_value( error ? error : commitError );
+      }
+      group.clear();
+    }
+  }
+}
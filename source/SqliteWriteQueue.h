@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+
+/* stl header */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <variant>
+#include <vector>
+
+/* sqlite_functions */
+#include "SqliteStatementCache.h"
+
+/**
+ * @brief vx (VX APPS) sqlite_utils namespace.
+ */
+namespace vx::sqlite_utils {
+
+  /**
+   * @brief Default maximum number of writes per group commit.
+   */
+  constexpr std::size_t writeGroupSize = 1024;
+
+  /**
+   * @brief Default maximum time a group stays open for more writes.
+   */
+  constexpr std::chrono::microseconds writeGroupLatency { 2000 };
+
+  /**
+   * @brief Value of a queued statement batch - monostate is NULL, text is UTF-8.
+   */
+  using WriteValue = std::variant<std::monostate, std::int64_t, double, std::string>;
+
+  /**
+   * @brief The WriteQueue class.
+   * Producers submit writes to a lock-free queue and one writer thread commits them in groups.
+   * Each write runs in its own savepoint, so a failed write does not roll back its group.
+   * A write that rolls back the whole transaction fails the earlier writes of its group, the following writes start a new group.
+   * The futures are completed after the commit of the group.
+   * The connection belongs to the writer thread until the queue is destroyed.
+   */
+  class WriteQueue {
+
+  public:
+    /**
+     * @brief Write with the connection of the writer thread.
+     */
+    using Work = std::function<std::error_code( sqlite3 * )>;
+
+    /**
+     * @brief Constructor for WriteQueue - starts the writer thread.
+     * @param _handle   Database handle.
+     * @param _groupSize   Maximum number of writes per commit.
+     * @param _groupLatency   Maximum time a group waits for more writes.
+     */
+    explicit WriteQueue( sqlite3 *_handle,
+                         std::size_t _groupSize = writeGroupSize,
+                         std::chrono::microseconds _groupLatency = writeGroupLatency );
+
+    /**
+     * @brief Delete copy constructor for WriteQueue.
+     */
+    WriteQueue( const WriteQueue & ) = delete;
+
+    /**
+     * @brief Delete move constructor for WriteQueue.
+     */
+    WriteQueue( WriteQueue && ) = delete;
+
+    /**
+     * @brief Destructor for WriteQueue - commits the pending writes and stops the writer thread.
+     */
+    ~WriteQueue();
+
+    /**
+     * @brief Delete copy assign operator.
+     * @return Nothing.
+     */
+    WriteQueue &operator=( const WriteQueue & ) = delete;
+
+    /**
+     * @brief Delete move assign operator.
+     * @return Nothing.
+     */
+    WriteQueue &operator=( WriteQueue && ) = delete;
+
+    /**
+     * @brief Submit a write.
+     * @param _work   Write to run in the writer thread.
+     * @return Future of the result - ready after the commit of the group.
+     */
+    std::future<std::error_code> submit( Work _work );
+
+    /**
+     * @brief Submit a prepared-statement batch.
+     * The statement runs once per parameter set - values hold all sets one after another.
+     * Statements are cached by the writer thread.
+     * @param _sql   Sql command with parameters.
+     * @param _values   Parameter values - owned by the queue until the write ran.
+     * @return Future of the result - ready after the commit of the group.
+     */
+    std::future<std::error_code> submit( std::string _sql,
+                                         std::vector<WriteValue> _values );
+
+    /**
+     * @brief Number of commits.
+     * @return Committed groups.
+     */
+    [[nodiscard]] std::uint64_t commits() const noexcept { return m_commits.load( std::memory_order_relaxed ); }
+
+    /**
+     * @brief Number of writes.
+     * @return Written submissions.
+     */
+    [[nodiscard]] std::uint64_t writes() const noexcept { return m_writes.load( std::memory_order_relaxed ); }
+
+  private:
+    /**
+     * @brief The Node struct.
+     */
+    struct Node {
+
+      /**
+       * @brief Member for the next node.
+       */
+      std::atomic<Node *> next { nullptr };
+
+      /**
+       * @brief Member for the write.
+       */
+      Work work {};
+
+      /**
+       * @brief Member for the result.
+       */
+      std::promise<std::error_code> promise {};
+    };
+
+    /**
+     * @brief Push a node - called by any thread.
+     * @param _node   Node to push.
+     */
+    void push( Node *_node ) noexcept;
+
+    /**
+     * @brief Pop a node - called by the writer thread.
+     * @param _work   Popped write.
+     * @param _promise   Popped result.
+     * @return True, if a write was queued - otherwise false.
+     */
+    bool pop( Work &_work,
+              std::promise<std::error_code> &_promise ) noexcept;
+
+    /**
+     * @brief Check for queued writes.
+     * @return True, if a write is queued - otherwise false.
+     */
+    [[nodiscard]] bool pending() const noexcept;
+
+    /**
+     * @brief Wait for a write.
+     * @param _deadline   Latest wake up.
+     * @return True, if a write is queued - otherwise false.
+     */
+    bool wait( std::chrono::steady_clock::time_point _deadline );
+
+    /**
+     * @brief Writer thread loop.
+     */
+    void run();
+
+    /**
+     * @brief Member for the database handle.
+     */
+    sqlite3 *m_handle = nullptr;
+
+    /**
+     * @brief Member for the maximum number of writes per commit.
+     */
+    std::size_t m_groupSize = 0;
+
+    /**
+     * @brief Member for the maximum time a group waits for more writes.
+     */
+    std::chrono::microseconds m_groupLatency {};
+
+    /**
+     * @brief Member for the statements of queued batches - used by the writer thread only.
+     */
+    StatementCache m_statements;
+
+    /**
+     * @brief Member for the head of the queue - owned by the writer thread.
+     */
+    Node *m_head = nullptr;
+
+    /**
+     * @brief Member for the tail of the queue.
+     */
+    std::atomic<Node *> m_tail { nullptr };
+
+    /**
+     * @brief Member for a sleeping writer thread.
+     */
+    std::atomic<bool> m_sleeping { false };
+
+    /**
+     * @brief Member for stopping the writer thread.
+     */
+    std::atomic<bool> m_stop { false };
+
+    /**
+     * @brief Member for the number of commits.
+     */
+    std::atomic<std::uint64_t> m_commits { 0 };
+
+    /**
+     * @brief Member for the number of writes.
+     */
+    std::atomic<std::uint64_t> m_writes { 0 };
+
+    /**
+     * @brief Member for the lock of the sleeping writer thread.
+     */
+    std::mutex m_mutex {};
+
+    /**
+     * @brief Member for waking the writer thread.
+     */
+    std::condition_variable m_condition {};
+
+    /**
+     * @brief Member for the writer thread.
+     */
+    std::thread m_thread {};
+  };
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+#ifdef HAVE_COROUTINE
+/* sqlite header */
+  #include <sqlite3.h>
+
+/* stl header */
+  #include <atomic>
+  #include <chrono>
+  #include <coroutine>
+  #include <deque>
+  #include <exception>
+  #include <filesystem>
+  #include <future>
+  #include <mutex>
+  #include <string>
+  #include <string_view>
+  #include <system_error>
+  #include <thread>
+  #include <variant>
+
+/* sqlite_functions */
+  #include <SqliteAsync.h>
+  #include <SqliteUtils.h>
+#endif
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+#ifdef HAVE_COROUTINE
+  /**
+   * @brief Database filename of the running test - ctest runs the tests in parallel processes.
+   * @return Database filename.
+   */
+  std::string databaseFilename() {
+
+    return "async_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + ".db";
+  }
+
+  /**
+   * @brief The Task struct.
+   * Coroutine that starts immediately and is not awaited.
+   */
+  struct Task {
+
+    /**
+     * @brief The promise_type struct.
+     */
+    struct promise_type {
+
+      Task get_return_object() noexcept { return {}; }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+  };
+
+  /**
+   * @brief Run a query and hand over the result.
+   * @param _executor   Executor to run the query.
+   * @param _sql   Sql command.
+   * @param _params   Query parameters.
+   * @param _token   Cancellation of the query.
+   * @param _result   Result of the query.
+   * @return Task of the coroutine.
+   */
+  Task run( sqlite_utils::AsyncExecutor &_executor,
+            std::string _sql,
+            std::vector<sqlite_utils::AsyncValue> _params,
+            sqlite_utils::CancelToken _token,
+            std::promise<sqlite_utils::AsyncResult> &_result ) {
+
+    _result.set_value( co_await _executor.query( std::move( _sql ), std::move( _params ), std::move( _token ) ) );
+  }
+
+  /**
+   * @brief Create the database of the tests.
+   */
+  void createDatabase() {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( databaseFilename(), error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), "DROP TABLE IF EXISTS cities; CREATE TABLE cities (id INTEGER PRIMARY KEY, city TEXT, latitude REAL, flag BLOB); INSERT INTO cities VALUES(1, 'Munich', 48.1375, X'0102'), (2, 'Tokyo', 35.6839, NULL)", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+  }
+
+  TEST( Async, Query ) {
+
+    createDatabase();
+    {
+      sqlite_utils::AsyncExecutor executor( databaseFilename(), 2 );
+      const std::error_code error = executor.open();
+      if ( error ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+
+      std::promise<sqlite_utils::AsyncResult> promise {};
+      run( executor, "SELECT id, city, latitude, flag FROM cities WHERE id >= ? ORDER BY id", { std::int64_t { 1 } }, {}, promise );
+      const sqlite_utils::AsyncResult result = promise.get_future().get();
+      EXPECT_FALSE( result.error );
+      ASSERT_EQ( result.rows.size(), 2 );
+      EXPECT_EQ( std::get<std::int64_t>( result.rows[ 0 ][ 0 ] ), 1 );
+      EXPECT_EQ( std::get<std::string>( result.rows[ 0 ][ 1 ] ), "Munich" );
+      EXPECT_DOUBLE_EQ( std::get<double>( result.rows[ 0 ][ 2 ] ), 48.1375 );
+      EXPECT_EQ( std::get<std::vector<std::uint8_t>>( result.rows[ 0 ][ 3 ] ), std::vector<std::uint8_t>( { 1, 2 } ) );
+      EXPECT_TRUE( std::holds_alternative<std::monostate>( result.rows[ 1 ][ 3 ] ) );
+
+      /* Many small queries */
+      constexpr std::size_t queries = 200;
+      std::vector<std::promise<sqlite_utils::AsyncResult>> promises( queries );
+      for ( std::size_t i = 0; i < queries; ++i ) {
+
+        run( executor, "SELECT city FROM cities WHERE id = ?", { static_cast<std::int64_t>( i % 2 + 1 ) }, {}, promises[ i ] );
+      }
+      for ( std::size_t i = 0; i < queries; ++i ) {
+
+        const sqlite_utils::AsyncResult row = promises[ i ].get_future().get();
+        EXPECT_FALSE( row.error );
+        EXPECT_EQ( std::get<std::string>( row.rows.at( 0 ).at( 0 ) ), i % 2 == 0 ? "Munich" : "Tokyo" );
+      }
+
+      std::promise<sqlite_utils::AsyncResult> invalid {};
+      run( executor, "SELECT FROM", {}, {}, invalid );
+      EXPECT_EQ( invalid.get_future().get().error.value(), SQLITE_ERROR );
+    }
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( Async, Cancel ) {
+
+    createDatabase();
+    {
+      sqlite_utils::AsyncExecutor executor( databaseFilename(), 1 );
+      const std::error_code error = executor.open();
+      EXPECT_FALSE( error );
+
+      /* Cancelled before it runs */
+      sqlite_utils::CancelToken queued {};
+      queued.cancel();
+      std::promise<sqlite_utils::AsyncResult> skipped {};
+      run( executor, "SELECT 1", {}, queued, skipped );
+      EXPECT_EQ( skipped.get_future().get().error.value(), SQLITE_INTERRUPT );
+
+      /* Interrupted while it runs */
+      sqlite_utils::CancelToken running {};
+      std::promise<sqlite_utils::AsyncResult> endless {};
+      auto result = endless.get_future();
+      run( executor, "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n) SELECT COUNT(*) FROM n", {}, running, endless );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+      running.cancel();
+      EXPECT_EQ( result.get().error.value(), SQLITE_INTERRUPT );
+
+      /* The connection keeps working */
+      std::promise<sqlite_utils::AsyncResult> after {};
+      run( executor, "SELECT COUNT(*) FROM cities", {}, {}, after );
+      const sqlite_utils::AsyncResult count = after.get_future().get();
+      EXPECT_FALSE( count.error );
+      EXPECT_EQ( std::get<std::int64_t>( count.rows.at( 0 ).at( 0 ) ), 2 );
+    }
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( Async, Resume ) {
+
+    createDatabase();
+    {
+      /* Coroutines are handed to the loop of this thread */
+      std::mutex mutex {};
+      std::deque<std::coroutine_handle<>> loop {};
+      sqlite_utils::AsyncExecutor executor( databaseFilename(), 1, {}, [ &mutex, &loop ]( std::coroutine_handle<> _handle ) {
+        const std::lock_guard lock( mutex );
+        loop.push_back( _handle );
+      } );
+      const std::error_code error = executor.open();
+      EXPECT_FALSE( error );
+
+      std::promise<sqlite_utils::AsyncResult> promise {};
+      auto result = promise.get_future();
+      run( executor, "SELECT city FROM cities WHERE id = 2", {}, {}, promise );
+      while ( result.wait_for( std::chrono::milliseconds( 1 ) ) != std::future_status::ready ) {
+
+        std::coroutine_handle<> handle {};
+        {
+          const std::lock_guard lock( mutex );
+          if ( !loop.empty() ) {
+
+            handle = loop.front();
+            loop.pop_front();
+          }
+        }
+        if ( handle ) {
+
+          handle.resume();
+        }
+      }
+      EXPECT_EQ( std::get<std::string>( result.get().rows.at( 0 ).at( 0 ) ), "Tokyo" );
+    }
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( Async, NotOpen ) {
+
+    sqlite_utils::AsyncExecutor executor( databaseFilename(), 1 );
+    std::promise<sqlite_utils::AsyncResult> promise {};
+    run( executor, "SELECT 1", {}, {}, promise );
+    EXPECT_EQ( promise.get_future().get().error.value(), SQLITE_MISUSE );
+  }
+#endif
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteBulkLoader.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view createTable = "CREATE TABLE cities (id INTEGER, city TEXT, latitude REAL)";
+
+  TEST( BulkLoader, RowMajor ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    /* Few host parameters to get full and tail statements */
+    sqlite3_limit( database.get(), SQLITE_LIMIT_VARIABLE_NUMBER, 30 );
+
+    sqlite_utils::BulkLoader loader( database.get(), "cities", 3, 7 );
+    const std::vector<sqlite_utils::BulkValue> values { std::int64_t { 1 }, std::string_view( "Munich" ), 48.1375,
+                                                        std::int64_t { 2 }, std::string_view( "O'Higgins" ), -48.46,
+                                                        std::int64_t { 3 }, std::monostate {}, std::monostate {} };
+    for ( std::int32_t i = 0; i < 5; ++i ) {
+
+      error = loader.insert( values );
+      EXPECT_FALSE( error );
+    }
+    error = loader.finish();
+    EXPECT_FALSE( error );
+    EXPECT_EQ( loader.rows(), 15 );
+    EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT COUNT(*), SUM(id), COUNT(city), (SELECT city FROM cities WHERE id = 2) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 15 );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 1 ), 30 );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 2 ), 10 );
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 3 ) ), "O'Higgins" ); // NOSONAR sqlite text is utf-8
+  }
+
+  TEST( BulkLoader, Columnar ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    constexpr std::size_t rows = 50001;
+    std::vector<std::int64_t> ids( rows );
+    std::vector<std::string_view> cities( rows, "City" );
+    std::vector<double> latitudes( rows, 0.5 );
+    for ( std::size_t i = 0; i < rows; ++i ) {
+
+      ids[ i ] = static_cast<std::int64_t>( i );
+    }
+
+    {
+      sqlite_utils::BulkLoader loader( database.get(), "cities", 3 );
+      error = loader.insert( { sqlite_utils::BulkColumnView<std::int64_t> { ids.data(), ids.size() },
+                               sqlite_utils::BulkColumnView<std::string_view> { cities.data(), cities.size() },
+                               sqlite_utils::BulkColumnView<double> { latitudes.data(), latitudes.size() } } );
+      EXPECT_FALSE( error );
+    }
+
+    /* The destructor commits */
+    EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT COUNT(*), SUM(id), SUM(latitude) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int64( statement.get(), 0 ), static_cast<sqlite3_int64>( rows ) );
+    EXPECT_EQ( sqlite3_column_int64( statement.get(), 1 ), static_cast<sqlite3_int64>( rows * ( rows - 1 ) / 2 ) );
+    EXPECT_DOUBLE_EQ( sqlite3_column_double( statement.get(), 2 ), static_cast<double>( rows ) * 0.5 );
+  }
+
+  TEST( BulkLoader, CallerTransaction ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    resultCode = sqlite3_exec( database.get(), "BEGIN", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+    {
+      sqlite_utils::BulkLoader loader( database.get(), "cities", 3, 1 );
+      error = loader.insert( { std::int64_t { 1 }, std::string_view( "Tokyo" ), 35.6839 } );
+      EXPECT_FALSE( error );
+    }
+
+    /* The transaction of the caller is left alone */
+    EXPECT_EQ( sqlite3_get_autocommit( database.get() ), 0 );
+    resultCode = sqlite3_exec( database.get(), "ROLLBACK", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+  }
+
+  TEST( BulkLoader, FailedInsert ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    std::int32_t resultCode = sqlite3_exec( database.get(), "CREATE TABLE cities (id INTEGER PRIMARY KEY, city TEXT)", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    const auto count = [ &database ]() {
+      std::error_code countError {};
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT COUNT(*) FROM cities", countError );
+      return sqlite3_step( statement.get() ) == SQLITE_ROW ? sqlite3_column_int( statement.get(), 0 ) : -1;
+    };
+
+    {
+      sqlite_utils::BulkLoader loader( database.get(), "cities", 2, 4 );
+      error = loader.insert( { std::int64_t { 1 }, std::string_view( "Munich" ), std::int64_t { 2 }, std::string_view( "Berlin" ),
+                               std::int64_t { 3 }, std::string_view( "Hamburg" ), std::int64_t { 4 }, std::string_view( "Cologne" ) } );
+      EXPECT_FALSE( error );
+      error = loader.insert( { std::int64_t { 5 }, std::string_view( "Bonn" ) } );
+      EXPECT_FALSE( error );
+
+      /* The duplicate rolls back the rows since the last commit */
+      error = loader.insert( { std::int64_t { 6 }, std::string_view( "Essen" ), std::int64_t { 1 }, std::string_view( "Munich" ) } );
+      EXPECT_EQ( error.value(), SQLITE_CONSTRAINT );
+      EXPECT_EQ( loader.rows(), 4 );
+      EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+      EXPECT_EQ( count(), 4 );
+
+      /* The loader keeps working in a new transaction */
+      error = loader.insert( { std::int64_t { 7 }, std::string_view( "Dresden" ) } );
+      EXPECT_FALSE( error );
+    }
+
+    EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+    EXPECT_EQ( count(), 5 );
+  }
+
+  TEST( BulkLoader, Misuse ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    sqlite_utils::BulkLoader loader( database.get(), "cities", 3 );
+    error = loader.insert( { std::int64_t { 1 }, std::string_view( "Tokyo" ) } );
+    EXPECT_EQ( error.value(), SQLITE_MISUSE );
+
+    const std::vector<double> latitudes { 1.0, 2.0 };
+    const std::vector<std::int64_t> ids { 1 };
+    error = loader.insert( { sqlite_utils::BulkColumnView<std::int64_t> { ids.data(), ids.size() },
+                             sqlite_utils::BulkColumnView<double> { latitudes.data(), latitudes.size() },
+                             sqlite_utils::BulkColumnView<double> { latitudes.data(), latitudes.size() } } );
+    EXPECT_EQ( error.value(), SQLITE_MISUSE );
+
+    sqlite_utils::BulkLoader missing( database.get(), "villages", 3 );
+    error = missing.insert( { std::int64_t { 1 }, std::string_view( "Tokyo" ), 35.6839 } );
+    EXPECT_TRUE( error );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::uint8_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* stl header */
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteChecksum.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  TEST( Checksum, Crc32c ) {
+
+    constexpr std::string_view check = "123456789";
+    const std::vector<std::uint8_t> data( std::cbegin( check ), std::cend( check ) );
+    EXPECT_EQ( sqlite_utils::crc32c( data.data(), data.size() ), 0xE3069283 );
+
+    const std::vector<std::uint8_t> zeros( 32, 0 );
+    EXPECT_EQ( sqlite_utils::crc32c( zeros.data(), zeros.size() ), 0x8A9136AA );
+
+    EXPECT_EQ( sqlite_utils::crc32c( nullptr, 0 ), 0U );
+  }
+
+  TEST( Checksum, Continue ) {
+
+    std::vector<std::uint8_t> data( 1031 );
+    std::iota( std::begin( data ), std::end( data ), std::uint8_t { 0 } );
+
+    /* Unaligned parts give the same result as the whole */
+    const std::uint32_t whole = sqlite_utils::crc32c( data.data(), data.size() );
+    const std::uint32_t first = sqlite_utils::crc32c( data.data(), 13 );
+    EXPECT_EQ( sqlite_utils::crc32c( data.data() + 13, data.size() - 13, first ), whole );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::uint64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteConnectionPool.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  /**
+   * @brief Database filename of the running test - ctest runs the tests in parallel processes.
+   * @return Database filename.
+   */
+  std::string databaseFilename() {
+
+    return "connection_pool_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + ".db";
+  }
+
+  /**
+   * @brief Remove the database with its WAL files.
+   */
+  void removeDatabase() {
+
+    std::filesystem::remove( databaseFilename() + "-wal" );
+    std::filesystem::remove( databaseFilename() + "-shm" );
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  /**
+   * @brief Function registered by the pool setup.
+   * @param _context   Sqlite context.
+   */
+  void answer( sqlite3_context *_context,
+               [[maybe_unused]] std::int32_t _argc,
+               [[maybe_unused]] sqlite3_value **_argv ) {
+
+    sqlite3_result_int( _context, 42 );
+  }
+
+  TEST( ConnectionPool, ReadWrite ) {
+
+    removeDatabase();
+    {
+      sqlite_utils::ConnectionPool pool( databaseFilename(), 2, []( sqlite3 *_handle ) -> std::error_code {
+        const std::int32_t resultCode = sqlite3_create_function( _handle, "ANSWER", 0, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, answer, nullptr, nullptr );
+        return { resultCode, std::generic_category() };
+      } );
+      EXPECT_FALSE( pool.read() );
+      EXPECT_FALSE( pool.write() );
+
+      std::error_code error = pool.open();
+      if ( error ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+
+      {
+        const sqlite_utils::Lease writer = pool.write();
+        EXPECT_TRUE( writer );
+        const std::int32_t resultCode = sqlite3_exec( writer.get(), "CREATE TABLE cities (city TEXT, latitude REAL, longitude REAL); INSERT INTO cities VALUES('Munich', 48.1375, 11.575)", nullptr, nullptr, nullptr );
+        EXPECT_EQ( resultCode, SQLITE_OK );
+      }
+
+      const sqlite_utils::Lease reader = pool.read();
+      EXPECT_TRUE( reader );
+      EXPECT_EQ( sqlite3_db_readonly( reader.get(), "main" ), 1 );
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( reader.get(), "SELECT city, ANSWER() FROM cities", error );
+      EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+      EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ), "Munich" ); // NOSONAR sqlite text is utf-8
+      EXPECT_EQ( sqlite3_column_int( statement.get(), 1 ), 42 );
+
+      const auto journal = sqlite_utils::sqlite3_stmt_make_unique( reader.get(), "PRAGMA journal_mode", error );
+      EXPECT_EQ( sqlite3_step( journal.get() ), SQLITE_ROW );
+      EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( journal.get(), 0 ) ), "wal" ); // NOSONAR sqlite text is utf-8
+
+      /* Both readers are distinct connections */
+      const sqlite_utils::Lease second = pool.read();
+      EXPECT_TRUE( second );
+      EXPECT_NE( reader.get(), second.get() );
+
+      const sqlite_utils::PoolMetrics metrics = pool.metrics();
+      EXPECT_EQ( metrics.leases, 3 );
+      EXPECT_EQ( metrics.waits, 0 );
+    }
+    removeDatabase();
+  }
+
+  TEST( ConnectionPool, Contention ) {
+
+    removeDatabase();
+    {
+      sqlite_utils::ConnectionPool pool( databaseFilename(), 2 );
+      const std::error_code error = pool.open();
+      if ( error ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+
+      constexpr std::uint64_t threads = 8;
+      constexpr std::uint64_t leasesPerThread = 500;
+      std::vector<std::atomic<bool>> leased( 2 );
+      std::atomic<bool> shared { false };
+      std::vector<sqlite3 *> handles {};
+      {
+        const sqlite_utils::Lease first = pool.read();
+        const sqlite_utils::Lease second = pool.read();
+        handles = { first.get(), second.get() };
+      }
+
+      std::vector<std::thread> workers {};
+      for ( std::uint64_t i = 0; i < threads; ++i ) {
+
+        workers.emplace_back( [ &pool, &leased, &shared, &handles ]() {
+          for ( std::uint64_t j = 0; j < leasesPerThread; ++j ) {
+
+            const sqlite_utils::Lease reader = pool.read();
+            const std::size_t slot = reader.get() == handles[ 0 ] ? 0 : 1;
+            if ( leased[ slot ].exchange( true ) ) {
+
+              shared = true;
+            }
+            sqlite3_exec( reader.get(), "SELECT 1", nullptr, nullptr, nullptr );
+            leased[ slot ] = false;
+          }
+        } );
+      }
+      for ( std::thread &worker : workers ) {
+
+        worker.join();
+      }
+
+      /* A connection is never leased twice at the same time */
+      EXPECT_FALSE( shared );
+      const sqlite_utils::PoolMetrics metrics = pool.metrics();
+      EXPECT_EQ( metrics.leases, threads * leasesPerThread + 2 );
+      EXPECT_GE( metrics.waitTime, metrics.maxWaitTime );
+    }
+    removeDatabase();
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+/* sqlite_functions */
+#include <SqliteDatabaseStats.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view databaseFilename = "database_stats.db";
+
+  constexpr std::string_view create = "CREATE TABLE numbers (id INTEGER PRIMARY KEY, payload TEXT); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 2000) INSERT INTO numbers SELECT i, printf('%0100d', i) FROM n";
+
+  constexpr std::string_view scan = "SELECT count(*) FROM numbers WHERE length(payload) = 100";
+
+  /**
+   * @brief Single integer of a query.
+   * @param _database   Database connection.
+   * @param _sql   Sql command.
+   * @return Value of the first column or -1 on error.
+   */
+  std::int64_t scalar( sqlite3 *_database,
+                       std::string_view _sql ) {
+
+    const auto statement { sqlite_utils::sqlite3_stmt_make_unique( _database, std::string( _sql ) ) };
+    if ( !statement || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  TEST( DatabaseStats, Delta ) {
+
+    std::filesystem::remove( databaseFilename );
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( std::string( databaseFilename ), error ) };
+      ASSERT_FALSE( error );
+      ASSERT_EQ( sqlite3_exec( database.get(), create.data(), nullptr, nullptr, nullptr ), SQLITE_OK );
+    }
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( std::string( databaseFilename ), error ) };
+      ASSERT_FALSE( error );
+
+      /* Cold scan reads the pages from the file */
+      const sqlite_utils::DatabaseStats before = sqlite_utils::databaseStats( database.get() );
+      EXPECT_EQ( scalar( database.get(), scan ), 2000 );
+      const sqlite_utils::DatabaseStats cold = sqlite_utils::databaseStats( database.get() );
+      EXPECT_GT( sqlite_utils::databaseStatsDelta( before, cold ).cacheMiss, 0 );
+      EXPECT_GT( cold.cacheUsed, 0 );
+      EXPECT_GT( cold.schemaUsed, 0 );
+      EXPECT_GT( cold.memoryUsed, 0 );
+      EXPECT_GE( cold.memoryHighwater, cold.memoryUsed );
+
+      /* Warm scan is served by the page cache */
+      EXPECT_EQ( scalar( database.get(), scan ), 2000 );
+      const sqlite_utils::DatabaseStats warm = sqlite_utils::databaseStats( database.get() );
+      const sqlite_utils::DatabaseStats delta = sqlite_utils::databaseStatsDelta( cold, warm );
+      EXPECT_EQ( delta.cacheMiss, 0 );
+      EXPECT_GT( delta.cacheHit, 0 );
+      EXPECT_EQ( delta.cacheUsed, warm.cacheUsed );
+      EXPECT_EQ( delta.time, warm.time );
+
+      /* Global counters only */
+      EXPECT_EQ( sqlite_utils::databaseStats( nullptr ).cacheUsed, 0 );
+    }
+    std::filesystem::remove( databaseFilename );
+  }
+
+  TEST( DatabaseStats, Table ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    ASSERT_FALSE( error );
+    ASSERT_FALSE( sqlite_utils::registerDatabaseStats( database.get() ) );
+    ASSERT_EQ( sqlite3_exec( database.get(), create.data(), nullptr, nullptr, nullptr ), SQLITE_OK );
+
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM sqlite_database_stats" ), 18 );
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM sqlite_database_stats WHERE type = 'counter'" ), 7 );
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM sqlite_database_stats WHERE scope = 'global'" ), 6 );
+    EXPECT_GT( scalar( database.get(), "SELECT value FROM sqlite_database_stats WHERE name = 'schema_used'" ), 0 );
+    EXPECT_GT( scalar( database.get(), "SELECT value FROM sqlite_database_stats WHERE name = 'memory_used'" ), 0 );
+  }
+
+  TEST( DatabaseStats, Sampler ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    ASSERT_FALSE( error );
+    ASSERT_EQ( sqlite3_exec( database.get(), create.data(), nullptr, nullptr, nullptr ), SQLITE_OK );
+
+    std::atomic<std::int32_t> samples { 0 };
+    std::atomic<std::int64_t> hits { 0 };
+    {
+      const sqlite_utils::DatabaseStatsSampler sampler( database.get(), std::chrono::milliseconds( 5 ), [ &samples, &hits ]( const sqlite_utils::DatabaseStats &, const sqlite_utils::DatabaseStats &_delta ) {
+        hits += _delta.cacheHit;
+        ++samples;
+      } );
+
+      /* Queries of the connection meanwhile - opened in serialized mode */
+      const auto start = std::chrono::steady_clock::now();
+      while ( samples < 3 && std::chrono::steady_clock::now() - start < std::chrono::seconds( 10 ) ) {
+
+        EXPECT_EQ( scalar( database.get(), scan ), 2000 );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      }
+      EXPECT_GT( sampler.latest().cacheHit, 0 );
+    }
+    EXPECT_GE( samples, 3 );
+
+    /* Sum of the deltas is at most the final counter */
+    EXPECT_GT( hits, 0 );
+    EXPECT_LE( hits, sqlite_utils::databaseStats( database.get() ).cacheHit );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
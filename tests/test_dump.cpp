@@ -38,11 +38,22 @@
 #include <sqlite3.h>
 
 /* stl header */
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
 #include <string_view>
+#include <vector>
 #include <system_error>
 
 /* sqlite_functions */
+#include <SqliteTrackingVfs.h>
 #include <SqliteUtils.h>
 
 using ::testing::InitGoogleTest;
@@ -64,6 +75,16 @@ namespace vx {
 
   constexpr std::string_view exportFilename = "dump.sql";
 
+  /**
+   * @brief Filename of the running test - ctest runs the tests in parallel processes.
+   * @param _suffix   Filename suffix.
+   * @return Filename.
+   */
+  std::string testFilename( std::string_view _suffix ) {
+
+    return "dump_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + std::string( _suffix );
+  }
+
   TEST( Dump, Export ) {
 
     /* Open database */
@@ -146,6 +167,356 @@ namespace vx {
     EXPECT_TRUE( std::filesystem::remove( exportFilename ) );
     EXPECT_FALSE( std::filesystem::exists( exportFilename ) );
   }
+
+  TEST( Dump, ExportAsync ) {
+
+    const std::string asyncFilename = testFilename( ".sql" );
+
+    /* Open database */
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    if ( !database ) {
+
+      GTEST_FAIL() << "ERROR: '" << sqlite3_errmsg( database.get() ) << "'";
+    }
+
+    /* Create table */
+    const std::string sql = "CREATE TABLE cities (city STRING, latitude REAL, longitude REAL); INSERT INTO cities VALUES('Munich', 48.1375, 11.575)";
+    std::int32_t resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      GTEST_FAIL() << "RESULT CODE: (" << resultCode << ") ERROR: '" << sqlite3_errmsg( database.get() ) << "' SQL: '" << sql << "'";
+    }
+
+    std::future<std::error_code> first = sqlite_utils::exportDumpAsync( database.get(), "main", asyncFilename );
+    std::future<std::error_code> second = sqlite_utils::exportDumpAsync( database.get(), "main", asyncFilename );
+    EXPECT_FALSE( first.get() );
+    EXPECT_FALSE( second.get() );
+
+    /* Modifications after the call are not part of the export */
+    std::future<std::error_code> third = sqlite_utils::exportDumpAsync( database.get(), "main", asyncFilename );
+    resultCode = sqlite3_exec( database.get(), "INSERT INTO cities VALUES('Tokyo', 35.6839, 139.7744)", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+    EXPECT_FALSE( third.get() );
+
+    const auto imported { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDump( imported.get(), "main", asyncFilename );
+    EXPECT_FALSE( error );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( imported.get(), "SELECT COUNT(city) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 1 );
+
+    EXPECT_TRUE( std::filesystem::remove( asyncFilename ) );
+  }
+
+  TEST( Dump, ExportAsyncInvalidSchema ) {
+
+    const std::string asyncFilename = testFilename( ".sql" );
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    std::future<std::error_code> result = sqlite_utils::exportDumpAsync( database.get(), "unknown", asyncFilename, sqlite_utils::Backpressure::Reject );
+    EXPECT_TRUE( result.get() );
+    EXPECT_FALSE( std::filesystem::exists( asyncFilename ) );
+  }
+
+  TEST( Dump, Container ) {
+
+    const std::string containerFilename = testFilename( "_container.sql" );
+    const std::string dumpFilename = testFilename( ".sql" );
+
+    /* Open database */
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    if ( !database ) {
+
+      GTEST_FAIL() << "ERROR: '" << sqlite3_errmsg( database.get() ) << "'";
+    }
+
+    const std::string sql = "CREATE TABLE cities (city STRING, latitude REAL, longitude REAL);"
+                            "INSERT INTO cities VALUES('Munich', 48.1375, 11.575);"
+                            "ATTACH DATABASE ':memory:' AS second;"
+                            "CREATE TABLE second.cities (city STRING, latitude REAL, longitude REAL);"
+                            "INSERT INTO second.cities VALUES('Berlin', 52.5167, 13.3833);"
+                            "INSERT INTO second.cities VALUES('Paris', 48.8566, 2.3522);"
+                            "ATTACH DATABASE ':memory:' AS third;"
+                            "CREATE TABLE third.cities (city STRING, latitude REAL, longitude REAL);"
+                            "INSERT INTO third.cities VALUES('Alexandria', 31.2, 29.9167);"
+                            "INSERT INTO third.cities VALUES('Boston', 42.3188, -71.0846);"
+                            "INSERT INTO third.cities VALUES('Melbourne', -37.8136, 144.9631)";
+    const std::int32_t resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      GTEST_FAIL() << "RESULT CODE: (" << resultCode << ") ERROR: '" << sqlite3_errmsg( database.get() ) << "' SQL: '" << sql << "'";
+    }
+
+    error = sqlite_utils::exportDumpContainer( database.get(), containerFilename );
+    EXPECT_FALSE( error );
+
+    const auto imported { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDumpContainer( imported.get(), containerFilename );
+    EXPECT_FALSE( error );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( imported.get(), "SELECT (SELECT COUNT(*) FROM main.cities), (SELECT COUNT(*) FROM second.cities), (SELECT COUNT(*) FROM third.cities)", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 1 );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 1 ), 2 );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 2 ), 3 );
+
+    /* Every schema is checked before anything is attached */
+    {
+      std::fstream file( containerFilename, std::ios::in | std::ios::out | std::ios::binary );
+      file.seekg( -1, std::ios_base::end );
+      const auto value = static_cast<char>( file.get() );
+      file.seekp( -1, std::ios_base::end );
+      file.put( static_cast<char>( ~value ) );
+    }
+    const auto corrupted { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDumpContainer( corrupted.get(), containerFilename );
+    EXPECT_EQ( error.value(), SQLITE_CORRUPT );
+    std::filesystem::resize_file( containerFilename, std::filesystem::file_size( containerFilename ) - 1 );
+    error = sqlite_utils::importDumpContainer( corrupted.get(), containerFilename );
+    EXPECT_EQ( error.value(), SQLITE_CORRUPT );
+    const auto schemas = sqlite_utils::sqlite3_stmt_make_unique( corrupted.get(), "SELECT COUNT(*) FROM pragma_database_list", error );
+    EXPECT_EQ( sqlite3_step( schemas.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( schemas.get(), 0 ), 1 );
+
+    /* A single schema dump is no container */
+    error = sqlite_utils::exportDump( database.get(), "main", dumpFilename );
+    EXPECT_FALSE( error );
+    error = sqlite_utils::importDumpContainer( imported.get(), dumpFilename );
+    EXPECT_TRUE( error );
+
+    EXPECT_TRUE( std::filesystem::remove( dumpFilename ) );
+    EXPECT_TRUE( std::filesystem::remove( containerFilename ) );
+  }
+
+  TEST( Dump, Incremental ) {
+
+    const std::string trackedFilename = testFilename( ".db" );
+    const std::string deltaFilename = testFilename( "_delta.sql" );
+    const std::string dumpFilename = testFilename( ".sql" );
+
+    std::error_code error = sqlite_utils::registerTrackingVfs();
+    EXPECT_FALSE( error );
+
+    /* Open file database through the tracking vfs */
+    sqlite3 *handle = nullptr;
+    std::int32_t resultCode = sqlite3_open_v2( trackedFilename.c_str(), &handle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, std::string( sqlite_utils::trackingVfsName ).c_str() );
+    const std::unique_ptr<sqlite3, sqlite_utils::sqlite3_deleter> database { handle };
+    if ( resultCode != SQLITE_OK ) {
+
+      GTEST_FAIL() << "RESULT CODE: (" << resultCode << ") ERROR: '" << sqlite3_errmsg( database.get() ) << "'";
+    }
+
+    std::string sql = "CREATE TABLE cities (city STRING, latitude REAL, longitude REAL);"
+                      "WITH RECURSIVE series(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM series WHERE x < 20000) INSERT INTO cities SELECT 'City ' || x, x, x FROM series";
+    resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    if ( resultCode != SQLITE_OK ) {
+
+      GTEST_FAIL() << "RESULT CODE: (" << resultCode << ") ERROR: '" << sqlite3_errmsg( database.get() ) << "' SQL: '" << sql << "'";
+    }
+
+    /* Base dump - tracking starts from here */
+    error = sqlite_utils::exportDump( database.get(), "main", dumpFilename );
+    EXPECT_FALSE( error );
+    const std::string databaseFilename = sqlite3_db_filename( database.get(), "main" );
+    sqlite_utils::resetDirtyPages( databaseFilename );
+
+    sql = "UPDATE cities SET latitude = 0 WHERE city = 'City 10000'";
+    resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+    const std::optional pages = sqlite_utils::dirtyPages( databaseFilename, 4096 );
+    ASSERT_TRUE( pages );
+    EXPECT_FALSE( pages->empty() );
+    EXPECT_LT( pages->size(), 5 );
+    error = sqlite_utils::exportIncremental( database.get(), "main", deltaFilename );
+    EXPECT_FALSE( error );
+
+    sql = "INSERT INTO cities VALUES('Munich', 48.1375, 11.575)";
+    resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+    error = sqlite_utils::exportIncremental( database.get(), "main", deltaFilename );
+    EXPECT_FALSE( error );
+
+    /* Delta is much smaller than the database */
+    EXPECT_LT( std::filesystem::file_size( deltaFilename ), std::filesystem::file_size( dumpFilename ) / 4 );
+
+    const auto imported { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDump( imported.get(), "main", dumpFilename, { deltaFilename } );
+    EXPECT_FALSE( error );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( imported.get(), "SELECT COUNT(city), (SELECT latitude FROM cities WHERE city = 'City 10000') FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 20001 );
+    EXPECT_DOUBLE_EQ( sqlite3_column_double( statement.get(), 1 ), 0 );
+
+    /* Tracking restarted with the export */
+    const std::optional remaining = sqlite_utils::dirtyPages( databaseFilename, 4096 );
+    ASSERT_TRUE( remaining );
+    EXPECT_TRUE( remaining->empty() );
+
+    /* Delta of another page size */
+    std::string delta {};
+    {
+      std::ifstream input( deltaFilename, std::ios::binary );
+      delta.assign( std::istreambuf_iterator<char>( input ), std::istreambuf_iterator<char>() );
+    }
+    ASSERT_GT( delta.size(), 16 );
+    delta.replace( 12, 4, std::string( "\x00\x02\x00\x00", 4 ) );
+    {
+      std::ofstream output( deltaFilename, std::ios::binary | std::ios::trunc );
+      output.write( delta.data(), static_cast<std::streamsize>( delta.size() ) );
+    }
+    error = sqlite_utils::importDump( imported.get(), "main", dumpFilename, { deltaFilename } );
+    EXPECT_EQ( error.value(), SQLITE_CORRUPT );
+
+    /* Without tracking vfs */
+    error = sqlite_utils::exportIncremental( imported.get(), "main", deltaFilename );
+    EXPECT_TRUE( error );
+
+    EXPECT_TRUE( std::filesystem::remove( dumpFilename ) );
+    EXPECT_TRUE( std::filesystem::remove( deltaFilename ) );
+    EXPECT_TRUE( std::filesystem::remove( trackedFilename ) );
+  }
+
+  TEST( Dump, Corrupt ) {
+
+    const std::string dumpFilename = testFilename( ".sql" );
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::string sql = "CREATE TABLE cities (city STRING, latitude REAL, longitude REAL); INSERT INTO cities VALUES('Munich', 48.1375, 11.575)";
+    const std::int32_t resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    error = sqlite_utils::exportDump( database.get(), "main", dumpFilename );
+    EXPECT_FALSE( error );
+
+    /* Flip one byte at the end of the image */
+    {
+      std::fstream file( dumpFilename, std::ios::in | std::ios::out | std::ios::binary );
+      file.seekg( -1, std::ios_base::end );
+      const auto value = static_cast<char>( file.get() );
+      file.seekp( -1, std::ios_base::end );
+      file.put( static_cast<char>( ~value ) );
+    }
+
+    const auto imported { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDump( imported.get(), "main", dumpFilename );
+    EXPECT_EQ( error.value(), SQLITE_CORRUPT );
+
+    /* Truncated */
+    std::filesystem::resize_file( dumpFilename, std::filesystem::file_size( dumpFilename ) - 1 );
+    error = sqlite_utils::importDump( imported.get(), "main", dumpFilename );
+    EXPECT_EQ( error.value(), SQLITE_CORRUPT );
+
+    EXPECT_TRUE( std::filesystem::remove( dumpFilename ) );
+  }
+
+  TEST( Dump, Buffer ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::string sql = "CREATE TABLE cities (city STRING, latitude REAL, longitude REAL); INSERT INTO cities VALUES('Munich', 48.1375, 11.575)";
+    const std::int32_t resultCode = sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::vector<std::uint8_t> buffer {};
+    error = sqlite_utils::exportDump( database.get(), "main", buffer );
+    EXPECT_FALSE( error );
+    EXPECT_FALSE( buffer.empty() );
+
+    const auto count = []( sqlite3 *_handle ) {
+      std::error_code countError {};
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _handle, "SELECT COUNT(city) FROM cities", countError );
+      return sqlite3_step( statement.get() ) == SQLITE_ROW ? sqlite3_column_int( statement.get(), 0 ) : -1;
+    };
+
+    /* Copy of caller memory */
+    const auto copied { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDump( copied.get(), "main", buffer.data(), buffer.size() );
+    EXPECT_FALSE( error );
+    EXPECT_EQ( count( copied.get() ), 1 );
+
+    /* Adopted buffer */
+    std::unique_ptr<std::uint8_t, sqlite_utils::sqlite3_generic_deleter> adopt( static_cast<std::uint8_t *>( sqlite3_malloc64( buffer.size() ) ) );
+    std::copy( std::cbegin( buffer ), std::cend( buffer ), adopt.get() );
+    const auto adopted { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDump( adopted.get(), "main", std::move( adopt ), buffer.size() );
+    EXPECT_FALSE( error );
+    EXPECT_EQ( count( adopted.get() ), 1 );
+
+    /* Stream without size hint - exported from the deserialized database without copy */
+    std::string streamed {};
+    std::size_t chunks = 0;
+    error = sqlite_utils::exportDump(
+        adopted.get(), "main", [ &streamed, &chunks ]( const char *_data, std::size_t _size ) {
+          streamed.append( _data, _size );
+          ++chunks;
+          return true;
+        },
+        1024 );
+    EXPECT_FALSE( error );
+    EXPECT_GT( chunks, 2U );
+    EXPECT_EQ( streamed.size(), buffer.size() );
+
+    /* Writes of other threads wait until the writer returned the last chunk */
+    std::future<std::int32_t> insert {};
+    error = sqlite_utils::exportDump(
+        adopted.get(), "main", [ &insert, &adopted ]( const char *, std::size_t ) {
+          if ( !insert.valid() ) {
+
+            insert = std::async( std::launch::async, [ &adopted ] { return sqlite3_exec( adopted.get(), "INSERT INTO cities VALUES('Berlin', 52.52, 13.405)", nullptr, nullptr, nullptr ); } );
+          }
+          EXPECT_EQ( insert.wait_for( std::chrono::milliseconds( 10 ) ), std::future_status::timeout );
+          return true;
+        },
+        4096 );
+    EXPECT_FALSE( error );
+    EXPECT_EQ( insert.get(), SQLITE_OK );
+    EXPECT_EQ( count( adopted.get() ), 2 );
+
+    std::istringstream input( streamed );
+    const auto streamedDatabase { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::importDump( streamedDatabase.get(), "main", input );
+    EXPECT_FALSE( error );
+    EXPECT_EQ( count( streamedDatabase.get() ), 1 );
+
+    /* Aborted by writer */
+    error = sqlite_utils::exportDump( database.get(), "main", []( const char *, std::size_t ) { return false; } );
+    EXPECT_TRUE( error );
+  }
+
+  TEST( Dump, StreamCapacity ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), "CREATE TABLE blobs (data BLOB); INSERT INTO blobs VALUES(zeroblob(300000))", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::vector<std::uint8_t> buffer {};
+    error = sqlite_utils::exportDump( database.get(), "main", buffer );
+    EXPECT_FALSE( error );
+    const std::string dump( std::cbegin( buffer ), std::cend( buffer ) );
+
+    /* The database holds about the dump size - neither a doubled nor a partly filled buffer */
+    for ( const std::size_t sizeHint : { dump.size(), std::size_t { 0 } } ) {
+
+      std::istringstream input( dump );
+      const auto imported { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+      const sqlite3_int64 used = sqlite3_memory_used();
+      error = sqlite_utils::importDump( imported.get(), "main", input, sizeHint );
+      EXPECT_FALSE( error );
+      EXPECT_LT( sqlite3_memory_used() - used, static_cast<sqlite3_int64>( dump.size() + dump.size() / 4 ) );
+
+      std::error_code countError {};
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( imported.get(), "SELECT length(data) FROM blobs", countError );
+      EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+      EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 300000 );
+    }
+  }
 }
 #ifdef __clang__
   #pragma clang diagnostic pop
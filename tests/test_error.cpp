@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <atomic>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteError.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  TEST( Error, Message ) {
+
+    const std::error_code busy = sqlite_utils::makeError( SQLITE_BUSY );
+    EXPECT_EQ( busy.value(), SQLITE_BUSY );
+    EXPECT_STREQ( busy.category().name(), "sqlite" );
+    EXPECT_EQ( busy.message(), sqlite3_errstr( SQLITE_BUSY ) );
+
+    const std::error_code constraint = sqlite_utils::makeError( SQLITE_CONSTRAINT_UNIQUE, "UNIQUE constraint failed: cities.id" );
+    EXPECT_EQ( constraint.value(), SQLITE_CONSTRAINT_UNIQUE );
+    EXPECT_EQ( constraint.message(), "UNIQUE constraint failed: cities.id" );
+
+    /* The message of another result code falls back to sqlite */
+    EXPECT_EQ( busy.message(), sqlite3_errstr( SQLITE_BUSY ) );
+    EXPECT_EQ( busy.category(), constraint.category() );
+
+    /* Long messages are truncated */
+    const std::error_code truncated = sqlite_utils::makeError( SQLITE_ERROR, std::string( sqlite_utils::errorMessageSize * 2, 'x' ) );
+    EXPECT_EQ( truncated.message(), std::string( sqlite_utils::errorMessageSize, 'x' ) );
+
+    /* Error enums keep the message of the thread */
+    const std::error_code misuse = sqlite::Error::Misuse;
+    EXPECT_EQ( misuse.value(), SQLITE_MISUSE );
+    EXPECT_EQ( misuse, sqlite::Error::Misuse );
+    EXPECT_EQ( truncated.message(), std::string( sqlite_utils::errorMessageSize, 'x' ) );
+  }
+
+  TEST( Error, Threads ) {
+
+    /* Run with SANITIZER_THREAD - every thread keeps its own message */
+    constexpr std::size_t threadCount = 8;
+    constexpr std::int32_t iterations = 20000;
+    std::atomic<std::int32_t> mismatches { 0 };
+    std::vector<std::thread> threads {};
+    for ( std::size_t i = 0; i < threadCount; ++i ) {
+
+      threads.emplace_back( [ &mismatches, i ] {
+        const std::string message = "database is locked by thread " + std::to_string( i );
+        for ( std::int32_t iteration = 0; iteration < iterations; ++iteration ) {
+
+          const std::error_code error = sqlite_utils::makeError( SQLITE_BUSY, message );
+          if ( error.message() != message || sqlite_utils::makeError( SQLITE_LOCKED ).message() != sqlite3_errstr( SQLITE_LOCKED ) ) {
+
+            mismatches.fetch_add( 1, std::memory_order_relaxed );
+          }
+        }
+      } );
+    }
+    for ( std::thread &thread : threads ) {
+
+      thread.join();
+    }
+    EXPECT_EQ( mismatches.load(), 0 );
+
+    /* Messages of other threads are not seen */
+    EXPECT_EQ( sqlite_utils::SqliteErrorCategory::instance().message( SQLITE_BUSY ), sqlite3_errstr( SQLITE_BUSY ) );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
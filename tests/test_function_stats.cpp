@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t, std::uint64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteFunctionStats.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::int32_t threadCount = 4;
+
+  constexpr std::int64_t rows = 1000;
+
+  /**
+   * @brief Open a database with DISTANCE, TRANSLITERATION and sqlite_functions_stats.
+   * @param _error   Error code.
+   * @return Database connection.
+   */
+  std::unique_ptr<sqlite3, sqlite_utils::sqlite3_deleter> open( std::error_code &_error ) {
+
+    auto database { sqlite_utils::sqlite3_make_unique( ":memory:", _error ) };
+    if ( _error ) {
+
+      return database;
+    }
+    sqlite3_create_function_v2( database.get(), "distance", 4, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, &sqlite_utils::distance, nullptr, nullptr, nullptr );
+    sqlite3_create_function_v2( database.get(), "transliteration", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, &sqlite_utils::transliteration, nullptr, nullptr, nullptr );
+    _error = sqlite_utils::registerFunctionStats( database.get() );
+    return database;
+  }
+
+  /**
+   * @brief Single integer of a query.
+   * @param _database   Database connection.
+   * @param _sql   Sql command.
+   * @return Value of the first column or -1 on error.
+   */
+  std::int64_t scalar( sqlite3 *_database,
+                       const std::string &_sql ) {
+
+    std::error_code error {};
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _database, _sql, error );
+    if ( error || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  TEST( FunctionStats, Table ) {
+
+#ifndef SQLITE_FUNCTION_STATS
+    GTEST_SKIP() << "Built without SQLITE_FUNCTION_STATS";
+#endif
+    std::error_code error {};
+    const auto database = open( error );
+    if ( error ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+    sqlite_utils::resetFunctionStats();
+
+    /* Two results and one NULL argument - text arguments count as 0 */
+    EXPECT_EQ( scalar( database.get(), "SELECT count(DISTANCE(52.5, 13.4, latitude, 2.35)) FROM (SELECT 48.85 AS latitude UNION ALL SELECT 40.71 UNION ALL SELECT NULL)" ), 2 );
+    EXPECT_EQ( scalar( database.get(), "SELECT DISTANCE('a', 'b', 'c', 'd') IS NULL" ), 0 );
+    EXPECT_EQ( scalar( database.get(), "SELECT TRANSLITERATION('Zebra') = 'Zebra'" ), 1 );
+
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM sqlite_functions_stats" ), 2 );
+    EXPECT_EQ( scalar( database.get(), "SELECT calls FROM sqlite_functions_stats WHERE name = 'DISTANCE'" ), 4 );
+    EXPECT_EQ( scalar( database.get(), "SELECT nulls FROM sqlite_functions_stats WHERE name = 'DISTANCE'" ), 1 );
+    EXPECT_EQ( scalar( database.get(), "SELECT calls FROM sqlite_functions_stats WHERE name = 'TRANSLITERATION'" ), 1 );
+    EXPECT_EQ( scalar( database.get(), "SELECT nulls + cache_hits FROM sqlite_functions_stats WHERE name = 'TRANSLITERATION'" ), 0 );
+    EXPECT_GT( scalar( database.get(), "SELECT nanoseconds FROM sqlite_functions_stats WHERE name = 'TRANSLITERATION'" ), 0 );
+
+    /* Reset */
+    sqlite_utils::resetFunctionStats();
+    EXPECT_EQ( scalar( database.get(), "SELECT sum(calls) FROM sqlite_functions_stats" ), 0 );
+  }
+
+  TEST( FunctionStats, Threads ) {
+
+#ifndef SQLITE_FUNCTION_STATS
+    GTEST_SKIP() << "Built without SQLITE_FUNCTION_STATS";
+#endif
+    sqlite_utils::resetFunctionStats();
+
+    /* Shards of ended threads are kept */
+    std::vector<std::thread> threads {};
+    for ( std::int32_t thread = 0; thread < threadCount; ++thread ) {
+
+      threads.emplace_back( [] {
+        std::error_code error {};
+        const auto database = open( error );
+        EXPECT_FALSE( error ) << error.message();
+        const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < ?1) SELECT count(DISTANCE(i % 90, 0.0, 0.0, 0.0)) FROM n" );
+        sqlite3_bind_int64( statement.get(), 1, rows );
+        ASSERT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+        EXPECT_EQ( sqlite3_column_int64( statement.get(), 0 ), rows );
+      } );
+    }
+    for ( std::thread &thread : threads ) {
+
+      thread.join();
+    }
+
+    const std::vector<sqlite_utils::FunctionStats> stats = sqlite_utils::functionStats();
+    ASSERT_EQ( stats.size(), 2U );
+    EXPECT_EQ( stats[ 0 ].name, "DISTANCE" );
+    EXPECT_EQ( stats[ 0 ].calls, static_cast<std::uint64_t>( threadCount * rows ) );
+    EXPECT_EQ( stats[ 0 ].nulls, 0U );
+    EXPECT_EQ( stats[ 1 ].calls, 0U );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
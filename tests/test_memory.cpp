@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t, std::uint8_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteMemory.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view databaseFilename = "memory.db";
+
+  /**
+   * @brief Install the allocator once per test process - before sqlite is used.
+   * @return Result code and message of operation.
+   */
+  std::error_code initialize() {
+
+    static const std::error_code error = sqlite_utils::initializeMemory();
+    return error;
+  }
+
+  /**
+   * @brief Single integer of a query.
+   * @param _database   Database connection.
+   * @param _sql   Sql command.
+   * @return Value of the first column or -1 on error.
+   */
+  std::int64_t scalar( sqlite3 *_database,
+                       const std::string &_sql ) {
+
+    const auto statement { sqlite_utils::sqlite3_stmt_make_unique( _database, _sql ) };
+    if ( !statement || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  TEST( Memory, Initialize ) {
+
+    ASSERT_FALSE( initialize() );
+    EXPECT_EQ( sqlite_utils::initializeMemory().value(), SQLITE_MISUSE );
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    ASSERT_FALSE( error );
+    EXPECT_EQ( scalar( database.get(), "SELECT 42" ), 42 );
+
+    const sqlite_utils::MemoryStats stats = sqlite_utils::memoryStats();
+    EXPECT_GT( stats.allocations, 0 );
+    EXPECT_GT( stats.frees, 0 );
+    EXPECT_GT( stats.threadCacheHits, 0 );
+    EXPECT_GT( stats.poolBytes, 0 );
+
+    sqlite3_int64 used = 0;
+    sqlite3_int64 highWater = 0;
+    EXPECT_EQ( sqlite3_status64( SQLITE_STATUS_MEMORY_USED, &used, &highWater, 0 ), SQLITE_OK );
+    EXPECT_GT( used, 0 );
+  }
+
+  TEST( Memory, PageCache ) {
+
+    ASSERT_FALSE( initialize() );
+    std::filesystem::remove( databaseFilename );
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( std::string( databaseFilename ), error ) };
+      ASSERT_FALSE( error );
+
+      /* A small cache recycles pages */
+      ASSERT_EQ( sqlite3_exec( database.get(), "PRAGMA cache_size = 50; CREATE TABLE numbers (id INTEGER PRIMARY KEY, payload TEXT); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 20000) INSERT INTO numbers SELECT i, printf('%0200d', i) FROM n", nullptr, nullptr, nullptr ), SQLITE_OK );
+      EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM numbers WHERE length(payload) = 200" ), 20000 );
+      ASSERT_EQ( sqlite3_exec( database.get(), "DELETE FROM numbers WHERE id > 10000; VACUUM", nullptr, nullptr, nullptr ), SQLITE_OK );
+      EXPECT_EQ( scalar( database.get(), "SELECT sum(id) FROM numbers" ), 10000 * 10001 / 2 );
+      EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM pragma_integrity_check WHERE integrity_check = 'ok'" ), 1 );
+
+      /* Large allocations grow through realloc */
+      EXPECT_EQ( scalar( database.get(), "SELECT length(group_concat(payload, '')) FROM numbers" ), 10000 * 200 );
+
+      const sqlite_utils::MemoryStats stats = sqlite_utils::memoryStats();
+      EXPECT_GT( stats.pageHits, 0 );
+      EXPECT_GT( stats.pageMisses, 0 );
+      EXPECT_GT( stats.pageEvictions, 0 );
+      EXPECT_GT( stats.slabBytes, 0 );
+      EXPECT_GT( stats.largeAllocations, 0 );
+    }
+    std::filesystem::remove( databaseFilename );
+  }
+
+  TEST( Memory, Realloc ) {
+
+    ASSERT_FALSE( initialize() );
+    constexpr std::int32_t largeSize = 100000;
+    auto *memory = static_cast<std::uint8_t *>( sqlite3_malloc( largeSize ) );
+    ASSERT_NE( memory, nullptr );
+    for ( std::int32_t i = 0; i < largeSize; ++i ) {
+
+      memory[ i ] = static_cast<std::uint8_t>( i % 251 );
+    }
+
+    /* Large allocations keep their content when they grow, shrink or become small */
+    for ( const std::int32_t size : { 3 * largeSize, 2 * largeSize, largeSize / 100 } ) {
+
+      auto *resized = static_cast<std::uint8_t *>( sqlite3_realloc( memory, size ) );
+      ASSERT_NE( resized, nullptr );
+      memory = resized;
+      EXPECT_GE( sqlite3_msize( memory ), static_cast<sqlite3_uint64>( size ) );
+      const std::int32_t checked = std::min( size, largeSize );
+      std::int32_t mismatches = 0;
+      for ( std::int32_t i = 0; i < checked; ++i ) {
+
+        mismatches += memory[ i ] != static_cast<std::uint8_t>( i % 251 ) ? 1 : 0;
+      }
+      EXPECT_EQ( mismatches, 0 );
+    }
+    sqlite3_free( memory );
+  }
+
+  TEST( Memory, Threads ) {
+
+    ASSERT_FALSE( initialize() );
+    constexpr std::int64_t rows = 5000;
+    std::vector<std::int64_t> sums( 4, 0 );
+    {
+      std::vector<std::thread> threads {};
+      for ( std::size_t i = 0; i < sums.size(); ++i ) {
+
+        threads.emplace_back( [ &sums, i ] {
+          std::error_code error {};
+          const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+          const std::string sql = "CREATE TABLE numbers (id INTEGER PRIMARY KEY, payload TEXT); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " + std::to_string( rows ) + ") INSERT INTO numbers SELECT i, hex(randomblob(i % 300)) FROM n";
+          if ( !error && sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr ) == SQLITE_OK ) {
+
+            sums[ i ] = scalar( database.get(), "SELECT sum(id) FROM numbers ORDER BY payload" );
+          }
+        } );
+      }
+      for ( std::thread &thread : threads ) {
+
+        thread.join();
+      }
+    }
+    for ( const std::int64_t sum : sums ) {
+
+      EXPECT_EQ( sum, rows * ( rows + 1 ) / 2 );
+    }
+
+    /* Counters of ended threads stay */
+    const sqlite_utils::MemoryStats stats = sqlite_utils::memoryStats();
+    EXPECT_GT( stats.allocations, static_cast<std::uint64_t>( rows ) );
+    EXPECT_GT( stats.threadCacheHits, static_cast<std::uint64_t>( rows ) );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+/* sqlite_functions */
+#include <SqliteOpenOptions.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view databaseFilename = "open_options.db";
+
+  /**
+   * @brief Read an integer PRAGMA.
+   * @param _handle   Database handle.
+   * @param _pragma   Pragma name.
+   * @return Value of the pragma.
+   */
+  std::int64_t pragmaInteger( sqlite3 *_handle,
+                              const std::string &_pragma ) {
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _handle, "PRAGMA " + _pragma );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  /**
+   * @brief Read a text PRAGMA.
+   * @param _handle   Database handle.
+   * @param _pragma   Pragma name.
+   * @return Value of the pragma.
+   */
+  std::string pragmaText( sqlite3 *_handle,
+                          const std::string &_pragma ) {
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _handle, "PRAGMA " + _pragma );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    return reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ); // NOSONAR sqlite text is utf-8
+  }
+
+  TEST( OpenOptions, Oltp ) {
+
+    std::error_code error {};
+    {
+      const auto database { sqlite_utils::sqlite3_make_unique( std::string( databaseFilename ), sqlite_utils::openOptions( sqlite_utils::Profile::Oltp ), error ) };
+      if ( !database ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+      EXPECT_EQ( pragmaText( database.get(), "journal_mode" ), "wal" );
+      EXPECT_EQ( pragmaInteger( database.get(), "synchronous" ), 1 );
+      EXPECT_EQ( pragmaInteger( database.get(), "temp_store" ), 2 );
+      EXPECT_EQ( pragmaInteger( database.get(), "mmap_size" ), std::int64_t { 256 } * 1024 * 1024 );
+      EXPECT_EQ( pragmaInteger( database.get(), "cache_size" ), -65536 );
+      EXPECT_EQ( pragmaInteger( database.get(), "busy_timeout" ), 5000 );
+
+      /* The lookaside serves the allocations of the connection */
+      const std::int32_t resultCode = sqlite3_exec( database.get(), "CREATE TABLE IF NOT EXISTS cities (city TEXT, latitude REAL, longitude REAL)", nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_OK );
+      std::int32_t current = 0;
+      std::int32_t highwater = 0;
+      EXPECT_EQ( sqlite3_db_status( database.get(), SQLITE_DBSTATUS_LOOKASIDE_HIT, &current, &highwater, 0 ), SQLITE_OK );
+      if ( sqlite3_compileoption_used( "OMIT_LOOKASIDE" ) == 0 ) {
+
+        EXPECT_GT( highwater, 0 );
+      }
+    }
+
+    /* A read replica opens the file read-only */
+    {
+      const auto replica { sqlite_utils::sqlite3_make_unique( std::string( databaseFilename ), sqlite_utils::openOptions( sqlite_utils::Profile::ReadReplica ), error ) };
+      if ( !replica ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+      EXPECT_EQ( sqlite3_db_readonly( replica.get(), "main" ), 1 );
+      EXPECT_EQ( pragmaInteger( replica.get(), "cache_size" ), -65536 );
+      EXPECT_EQ( pragmaInteger( replica.get(), "mmap_size" ), std::int64_t { 256 } * 1024 * 1024 );
+      const std::int32_t resultCode = sqlite3_exec( replica.get(), "INSERT INTO cities VALUES('Tokyo', 35.6839, 139.7744)", nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_READONLY );
+    }
+
+    std::filesystem::remove( std::string( databaseFilename ) + "-wal" );
+    std::filesystem::remove( std::string( databaseFilename ) + "-shm" );
+    EXPECT_TRUE( std::filesystem::remove( databaseFilename ) );
+  }
+
+  TEST( OpenOptions, BulkLoad ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", sqlite_utils::openOptions( sqlite_utils::Profile::BulkLoad ), error ) };
+    if ( !database ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+    EXPECT_EQ( pragmaText( database.get(), "journal_mode" ), "memory" );
+    EXPECT_EQ( pragmaInteger( database.get(), "synchronous" ), 0 );
+    EXPECT_EQ( pragmaInteger( database.get(), "temp_store" ), 2 );
+    EXPECT_EQ( pragmaInteger( database.get(), "cache_size" ), -262144 );
+  }
+
+  TEST( OpenOptions, Custom ) {
+
+    std::error_code error {};
+    sqlite_utils::OpenOptions options {};
+    options.uri = true;
+    options.synchronous = sqlite_utils::Synchronous::Extra;
+    options.tempStore = sqlite_utils::TempStore::File;
+    options.cacheSize = 500;
+    const auto database { sqlite_utils::sqlite3_make_unique( "file:custom?mode=memory", options, error ) };
+    if ( !database ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+    EXPECT_EQ( pragmaInteger( database.get(), "synchronous" ), 3 );
+    EXPECT_EQ( pragmaInteger( database.get(), "temp_store" ), 1 );
+    EXPECT_EQ( pragmaInteger( database.get(), "cache_size" ), 500 );
+    EXPECT_FALSE( std::filesystem::exists( "file:custom?mode=memory" ) );
+  }
+
+  TEST( OpenOptions, Missing ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( "missing.db", sqlite_utils::openOptions( sqlite_utils::Profile::ReadReplica ), error ) };
+    EXPECT_FALSE( database );
+    EXPECT_EQ( error.value(), SQLITE_CANTOPEN );
+    EXPECT_FALSE( std::filesystem::exists( "missing.db" ) );
+
+    sqlite_utils::OpenOptions options {};
+    options.vfs = "missing";
+    const auto unknown { sqlite_utils::sqlite3_make_unique( ":memory:", options, error ) };
+    EXPECT_FALSE( unknown );
+    EXPECT_TRUE( error );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::size_t
+#include <cstdint> // std::int32_t, std::uint64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteProfiler.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  /**
+   * @brief Profile of a fingerprint.
+   * @param _profiles   Profiles of profileSnapshot.
+   * @param _fingerprint   Normalized sql.
+   * @return Profile or an empty profile.
+   */
+  sqlite_utils::StatementProfile find( const std::vector<sqlite_utils::StatementProfile> &_profiles,
+                                       const std::string &_fingerprint ) {
+
+    const auto iterator = std::find_if( std::begin( _profiles ), std::end( _profiles ), [ &_fingerprint ]( const sqlite_utils::StatementProfile &_profile ) { return _profile.fingerprint == _fingerprint; } );
+    return iterator == std::end( _profiles ) ? sqlite_utils::StatementProfile {} : *iterator;
+  }
+
+  TEST( Profiler, Normalize ) {
+
+    EXPECT_EQ( sqlite_utils::normalizeSql( "select  city from cities\n where id = 42 and name = 'It''s'" ), "SELECT city FROM cities WHERE id = ? AND name = ?" );
+    EXPECT_EQ( sqlite_utils::normalizeSql( "SELECT * FROM cities WHERE id IN (1,2, 3) -- comment" ), "SELECT * FROM cities WHERE id IN (?)" );
+    EXPECT_EQ( sqlite_utils::normalizeSql( "INSERT INTO cities VALUES (1, 'Munich', 48.1375), (2, 'Tokyo', 3.5e1), (?3, :name, X'0102')" ), "INSERT INTO cities VALUES (?)" );
+    EXPECT_EQ( sqlite_utils::normalizeSql( "SELECT \"select\", [from], `where` /* block */ FROM t2 WHERE x > @min" ), "SELECT \"select\", [from], `where` FROM t2 WHERE x > ?" );
+    EXPECT_EQ( sqlite_utils::normalizeSql( "SELECT DISTANCE( lat, lon, 48.1, 11.5 ) FROM cities;" ), "SELECT DISTANCE(lat, lon, ?) FROM cities;" );
+  }
+
+  TEST( Profiler, Profile ) {
+
+    sqlite_utils::enableProfiling();
+    EXPECT_TRUE( sqlite_utils::profilingEnabled() );
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::enableProfiling( false );
+    ASSERT_FALSE( error );
+    ASSERT_EQ( sqlite3_exec( database.get(), "CREATE TABLE cities (id INTEGER PRIMARY KEY, city TEXT); INSERT INTO cities VALUES (1, 'Munich'), (2, 'Tokyo')", nullptr, nullptr, nullptr ), SQLITE_OK );
+    sqlite_utils::resetProfiles();
+
+    constexpr std::uint64_t queries = 100;
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT city FROM cities WHERE id = ?" );
+    for ( std::uint64_t i = 0; i < queries; ++i ) {
+
+      sqlite3_bind_int64( statement.get(), 1, static_cast<sqlite3_int64>( i % 2 + 1 ) );
+      while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {}
+      sqlite3_reset( statement.get() );
+
+      /* Inline literals share the fingerprint */
+      const std::string sql = "SELECT city FROM cities WHERE id = " + std::to_string( i );
+      ASSERT_EQ( sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr ), SQLITE_OK );
+    }
+
+    const std::vector<sqlite_utils::StatementProfile> profiles = sqlite_utils::profileSnapshot();
+    const sqlite_utils::StatementProfile profile = find( profiles, "SELECT city FROM cities WHERE id = ?" );
+    EXPECT_EQ( profile.count, 2 * queries );
+    EXPECT_GT( profile.total.count(), 0 );
+    EXPECT_LE( profile.min, profile.p50 );
+    EXPECT_LE( profile.p50, profile.p90 );
+    EXPECT_LE( profile.p90, profile.p99 );
+    EXPECT_LE( profile.p99, profile.max );
+    EXPECT_LE( profile.max, profile.total );
+
+    const std::string text = sqlite_utils::profileText( profiles );
+    EXPECT_NE( text.find( "SELECT city FROM cities WHERE id = ?" ), std::string::npos );
+    const std::string json = sqlite_utils::profileJson( profiles );
+    EXPECT_EQ( json.front(), '[' );
+    EXPECT_NE( json.find( "{\"fingerprint\":\"SELECT city FROM cities WHERE id = ?\",\"count\":200," ), std::string::npos );
+
+    sqlite_utils::resetProfiles();
+    EXPECT_TRUE( sqlite_utils::profileSnapshot().empty() );
+    EXPECT_EQ( sqlite_utils::profileJson( {} ), "[]" );
+  }
+
+  TEST( Profiler, Threads ) {
+
+    constexpr std::size_t threadCount = 4;
+    constexpr std::uint64_t queries = 1000;
+    sqlite_utils::resetProfiles();
+    std::vector<std::thread> threads {};
+    for ( std::size_t i = 0; i < threadCount; ++i ) {
+
+      threads.emplace_back( [] {
+        std::error_code error {};
+        const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+        if ( error || sqlite_utils::profileConnection( database.get() ) ) {
+
+          return;
+        }
+        for ( std::uint64_t query = 0; query < queries; ++query ) {
+
+          const std::string sql = "SELECT " + std::to_string( query ) + " + 1";
+          sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr );
+        }
+      } );
+    }
+    for ( std::thread &thread : threads ) {
+
+      thread.join();
+    }
+    EXPECT_EQ( find( sqlite_utils::profileSnapshot(), "SELECT ? + ?" ).count, threadCount * queries );
+  }
+
+  TEST( Profiler, MovedStatement ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    ASSERT_FALSE( error );
+    ASSERT_FALSE( sqlite_utils::profileConnection( database.get() ) );
+    sqlite_utils::resetProfiles();
+
+    /* Stepped on this thread and reset on another one */
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT 42 AS moved" );
+    ASSERT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    std::thread( [ &statement ] { sqlite3_reset( statement.get() ); } ).join();
+
+    /* A stale start of the first run would count the pause */
+    constexpr std::chrono::milliseconds pause { 100 };
+    std::this_thread::sleep_for( pause );
+    ASSERT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    sqlite3_reset( statement.get() );
+
+    const sqlite_utils::StatementProfile profile = find( sqlite_utils::profileSnapshot(), "SELECT ? AS moved" );
+    EXPECT_EQ( profile.count, 2 );
+    EXPECT_LT( profile.max, pause );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
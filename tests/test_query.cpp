@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstddef> // std::byte
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+
+/* sqlite_functions */
+#include <SqliteQuery.h>
+#include <SqliteStatementCache.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  TEST( Query, Rows ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    error = sqlite_utils::execute( database.get(), "CREATE TABLE cities (id INTEGER, city TEXT, latitude REAL, flag BLOB)" );
+    EXPECT_FALSE( error );
+
+    constexpr std::array<std::byte, 3> flag { std::byte { 0x00 }, std::byte { 0xFF }, std::byte { 0x10 } };
+    const std::string_view munich = "Munich";
+    error = sqlite_utils::execute( database.get(), "INSERT INTO cities VALUES(?, ?, ?, ?)", 1, munich, 48.1375, sqlite_utils::BlobView( flag.data(), flag.size() ) );
+    EXPECT_FALSE( error );
+    error = sqlite_utils::execute( database.get(), "INSERT INTO cities VALUES(?, ?, ?, ?)", std::int64_t { 2 }, std::string( "Tokyo" ), std::optional<double> {}, nullptr );
+    EXPECT_FALSE( error );
+
+    std::int32_t count = 0;
+    auto rows = sqlite_utils::query<std::int64_t, std::string_view, std::optional<double>, sqlite_utils::BlobView>( database.get(), "SELECT id, city, latitude, flag FROM cities WHERE id >= ? ORDER BY id", 1 );
+    for ( const auto &[ id, city, latitude, blob ] : rows ) {
+
+      if ( id == 1 ) {
+
+        EXPECT_EQ( city, "Munich" );
+        EXPECT_DOUBLE_EQ( latitude.value_or( 0.0 ), 48.1375 );
+        EXPECT_EQ( blob.size(), flag.size() );
+        EXPECT_EQ( blob.data()[ 1 ], std::byte { 0xFF } );
+      }
+      else {
+
+        EXPECT_EQ( city, "Tokyo" );
+        EXPECT_FALSE( latitude );
+        EXPECT_TRUE( blob.empty() );
+      }
+      ++count;
+    }
+    EXPECT_FALSE( rows.error() );
+    EXPECT_EQ( count, 2 );
+
+    /* Owning text outlives the row */
+    std::string city {};
+    for ( const auto &[ name ] : sqlite_utils::query<std::string>( database.get(), "SELECT city FROM cities WHERE id = ?", 2 ) ) {
+
+      city = name;
+    }
+    EXPECT_EQ( city, "Tokyo" );
+  }
+
+  TEST( Query, Statement ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::StatementCache cache( database.get() );
+    const sqlite_utils::CachedStatement statement = cache.prepare( "SELECT ?1 * 2", error );
+
+    /* The same statement runs with new binds */
+    for ( std::int32_t i = 1; i <= 3; ++i ) {
+
+      std::int32_t result = 0;
+      for ( const auto &[ value ] : sqlite_utils::query<std::int32_t>( statement.get(), i ) ) {
+
+        result = value;
+      }
+      EXPECT_EQ( result, i * 2 );
+    }
+  }
+
+  TEST( Query, Error ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+
+    auto invalid = sqlite_utils::query<std::int32_t>( database.get(), "SELECT FROM" );
+    EXPECT_EQ( invalid.begin(), invalid.end() );
+    EXPECT_EQ( invalid.error().value(), SQLITE_ERROR );
+
+    /* Parameter 2 does not exist */
+    auto range = sqlite_utils::query<std::int32_t>( database.get(), "SELECT ?", 1, 2 );
+    EXPECT_EQ( range.begin(), range.end() );
+    EXPECT_EQ( range.error().value(), SQLITE_RANGE );
+
+    error = sqlite_utils::execute( database.get(), "CREATE TABLE t (a INTEGER NOT NULL)" );
+    EXPECT_FALSE( error );
+    error = sqlite_utils::execute( database.get(), "INSERT INTO t VALUES(?)", nullptr );
+    EXPECT_EQ( error.value(), SQLITE_CONSTRAINT );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
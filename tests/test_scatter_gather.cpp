@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <variant>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteScatterGather.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  /**
+   * @brief Shard filenames of the running test - ctest runs the tests in parallel processes.
+   * @return Database filenames.
+   */
+  std::vector<std::string> shardFilenames() {
+
+    const std::string prefix = "shard_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + "_";
+    return { prefix + "1.db", prefix + "2.db", prefix + "3.db" };
+  }
+
+  /**
+   * @brief Create the shards with the cities of memory_attach.
+   */
+  void createShards() {
+
+    const std::vector<std::string> inserts = {
+      "INSERT INTO cities VALUES('New York', 40.6943, -73.9249), ('Tokyo', 35.6839, 139.7744), ('Munich', 48.1375, 11.575)",
+      "INSERT INTO cities VALUES('Berlin', 52.5167, 13.3833), ('Paris', 48.8566, 2.3522), ('Hong Kong', 22.3069, 114.1831)",
+      "INSERT INTO cities VALUES('Alexandria', 31.2, 29.9167), ('Boston', 42.3188, -71.0846), ('Melbourne', -37.8136, 144.9631)"
+    };
+    const std::vector<std::string> filenames = shardFilenames();
+    for ( std::size_t i = 0; i < filenames.size(); ++i ) {
+
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( filenames[ i ], error ) };
+      std::int32_t resultCode = sqlite3_exec( database.get(), "DROP TABLE IF EXISTS cities; CREATE TABLE cities (city TEXT, latitude REAL, longitude REAL)", nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_OK );
+      resultCode = sqlite3_exec( database.get(), inserts[ i ].c_str(), nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_OK );
+    }
+  }
+
+  /**
+   * @brief Remove the shards.
+   */
+  void removeShards() {
+
+    for ( const std::string &filename : shardFilenames() ) {
+
+      std::filesystem::remove( filename );
+    }
+  }
+
+  TEST( ScatterGather, Merge ) {
+
+    createShards();
+    {
+      sqlite_utils::ScatterGather shards( shardFilenames() );
+      const std::error_code error = shards.open();
+      if ( error ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+      EXPECT_EQ( shards.shards(), 3 );
+
+      std::vector<sqlite_utils::ShardRow> rows {};
+      std::error_code result = shards.query( "SELECT city, latitude FROM cities ORDER BY city", { { 0 } }, rows );
+      EXPECT_FALSE( result );
+      const std::vector<std::string> expected = { "Alexandria", "Berlin", "Boston", "Hong Kong", "Melbourne", "Munich", "New York", "Paris", "Tokyo" };
+      ASSERT_EQ( rows.size(), expected.size() );
+      for ( std::size_t i = 0; i < rows.size(); ++i ) {
+
+        EXPECT_EQ( std::get<std::string>( rows[ i ][ 0 ] ), expected[ i ] );
+      }
+
+      /* Limit is pushed down to every shard */
+      result = shards.query( "SELECT city, latitude FROM cities ORDER BY latitude DESC;", { { 1, true } }, rows, 3 );
+      EXPECT_FALSE( result );
+      ASSERT_EQ( rows.size(), 3 );
+      EXPECT_EQ( std::get<std::string>( rows[ 0 ][ 0 ] ), "Berlin" );
+      EXPECT_EQ( std::get<std::string>( rows[ 1 ][ 0 ] ), "Paris" );
+      EXPECT_EQ( std::get<std::string>( rows[ 2 ][ 0 ] ), "Munich" );
+
+      /* Parameters before the limit */
+      result = shards.query( "SELECT city FROM cities WHERE latitude < ? ORDER BY city", { { 0 } }, rows, 2, { 40.0 } );
+      EXPECT_FALSE( result );
+      ASSERT_EQ( rows.size(), 2 );
+      EXPECT_EQ( std::get<std::string>( rows[ 0 ][ 0 ] ), "Alexandria" );
+      EXPECT_EQ( std::get<std::string>( rows[ 1 ][ 0 ] ), "Hong Kong" );
+
+      /* Without order the shards are concatenated */
+      result = shards.query( "SELECT COUNT(*) FROM cities", {}, rows );
+      EXPECT_FALSE( result );
+      ASSERT_EQ( rows.size(), 3 );
+      EXPECT_EQ( std::get<std::int64_t>( rows[ 2 ][ 0 ] ), 3 );
+    }
+    removeShards();
+  }
+
+  TEST( ScatterGather, Error ) {
+
+    createShards();
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( shardFilenames()[ 1 ], error ) };
+      EXPECT_EQ( sqlite3_exec( database.get(), "DROP TABLE cities", nullptr, nullptr, nullptr ), SQLITE_OK );
+    }
+    {
+      sqlite_utils::ScatterGather shards( shardFilenames() );
+      std::vector<sqlite_utils::ShardRow> rows {};
+      std::error_code error = shards.query( "SELECT city FROM cities", {}, rows );
+      EXPECT_EQ( error.value(), SQLITE_MISUSE );
+
+      error = shards.open();
+      EXPECT_FALSE( error );
+      error = shards.query( "SELECT city FROM cities ORDER BY city", { { 0 } }, rows );
+      EXPECT_EQ( error.value(), SQLITE_ERROR );
+      EXPECT_TRUE( rows.empty() );
+
+      error = shards.query( "SELECT 1", { { 4 } }, rows );
+      EXPECT_EQ( error.value(), SQLITE_RANGE );
+    }
+    removeShards();
+  }
+
+  TEST( ScatterGather, Wrapped ) {
+
+    createShards();
+    {
+      sqlite_utils::ScatterGather shards( shardFilenames() );
+      ASSERT_FALSE( shards.open() );
+
+      /* Own limit and trailing comment of the query */
+      std::vector<sqlite_utils::ShardRow> rows {};
+      std::error_code result = shards.query( "SELECT city, latitude FROM cities ORDER BY latitude DESC LIMIT 2 -- two per shard", { { 1, true } }, rows, 3 );
+      EXPECT_FALSE( result );
+      ASSERT_EQ( rows.size(), 3 );
+      EXPECT_EQ( std::get<std::string>( rows[ 0 ][ 0 ] ), "Berlin" );
+      EXPECT_EQ( std::get<std::string>( rows[ 2 ][ 0 ] ), "Munich" );
+
+      /* Shards sort with BINARY collation like the merge */
+      result = shards.query( "SELECT CASE city WHEN 'Paris' THEN 'paris' ELSE city END COLLATE NOCASE FROM cities ORDER BY 1", { { 0 } }, rows );
+      EXPECT_FALSE( result );
+      ASSERT_EQ( rows.size(), 9 );
+      EXPECT_EQ( std::get<std::string>( rows[ 7 ][ 0 ] ), "Tokyo" );
+      EXPECT_EQ( std::get<std::string>( rows[ 8 ][ 0 ] ), "paris" );
+
+      /* Integers and reals are compared exactly */
+      result = shards.query( "SELECT column1 FROM (VALUES(9007199254740993), (9007199254740992.0))", { { 0 } }, rows );
+      EXPECT_FALSE( result );
+      ASSERT_EQ( rows.size(), 6 );
+      for ( std::size_t i = 0; i < rows.size(); ++i ) {
+
+        EXPECT_EQ( rows[ i ][ 0 ].index(), i < 3 ? 2U : 1U );
+      }
+    }
+    removeShards();
+  }
+
+  TEST( ScatterGather, Concurrent ) {
+
+    createShards();
+    {
+      sqlite_utils::ScatterGather shards( shardFilenames() );
+      ASSERT_FALSE( shards.open() );
+
+      /* Queries of several threads share the shards */
+      std::vector<std::thread> threads {};
+      for ( std::int64_t i = 0; i < 4; ++i ) {
+
+        threads.emplace_back( [ &shards, i ] {
+          for ( std::int32_t j = 0; j < 50; ++j ) {
+
+            std::vector<sqlite_utils::ShardRow> rows {};
+            EXPECT_FALSE( shards.query( "SELECT city, ? FROM cities ORDER BY city", { { 0 } }, rows, 4, { i } ) );
+            ASSERT_EQ( rows.size(), 4 );
+            EXPECT_EQ( std::get<std::string>( rows[ 0 ][ 0 ] ), "Alexandria" );
+            EXPECT_EQ( std::get<std::int64_t>( rows[ 3 ][ 1 ] ), i );
+          }
+        } );
+      }
+      for ( std::thread &thread : threads ) {
+
+        thread.join();
+      }
+    }
+    removeShards();
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::uint8_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteSession.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view createTable = "CREATE TABLE cities (city STRING PRIMARY KEY, latitude REAL, longitude REAL)";
+
+  TEST( Session, Changeset ) {
+
+    /* Open databases */
+    std::error_code error {};
+    const auto source { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const auto replica { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    if ( !source || !replica ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+
+    /* Same base on both sides */
+    for ( sqlite3 *handle : { source.get(), replica.get() } ) {
+
+      const std::string sql = std::string( createTable ) + "; INSERT INTO cities VALUES('Munich', 48.1375, 11.575)";
+      const std::int32_t resultCode = sqlite3_exec( handle, sql.c_str(), nullptr, nullptr, nullptr );
+      if ( resultCode != SQLITE_OK ) {
+
+        GTEST_FAIL() << "RESULT CODE: (" << resultCode << ") ERROR: '" << sqlite3_errmsg( handle ) << "' SQL: '" << sql << "'";
+      }
+    }
+
+    sqlite_utils::Session session( source.get() );
+    error = session.attach( "cities" );
+    EXPECT_FALSE( error );
+
+    std::int32_t resultCode = sqlite3_exec( source.get(), "INSERT INTO cities VALUES('Tokyo', 35.6839, 139.7744); UPDATE cities SET latitude = 48.0 WHERE city = 'Munich'", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::vector<std::uint8_t> changeset {};
+    error = session.checkpoint( changeset );
+    EXPECT_FALSE( error );
+    EXPECT_FALSE( changeset.empty() );
+
+    error = sqlite_utils::applyChangeset( replica.get(), changeset );
+    EXPECT_FALSE( error );
+
+    /* Nothing changed since the last checkpoint */
+    error = session.checkpoint( changeset );
+    EXPECT_FALSE( error );
+    EXPECT_TRUE( changeset.empty() );
+
+    resultCode = sqlite3_exec( source.get(), "DELETE FROM cities WHERE city = 'Tokyo'", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+    error = session.checkpoint( changeset );
+    EXPECT_FALSE( error );
+    EXPECT_FALSE( changeset.empty() );
+    error = sqlite_utils::applyChangeset( replica.get(), changeset );
+    EXPECT_FALSE( error );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( replica.get(), "SELECT COUNT(city), SUM(latitude) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 1 );
+    EXPECT_DOUBLE_EQ( sqlite3_column_double( statement.get(), 1 ), 48.0 );
+  }
+
+  TEST( Session, ConcurrentWrites ) {
+
+    constexpr std::int32_t rows = 2000;
+
+    std::error_code error {};
+    const auto source { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const auto replica { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    ASSERT_TRUE( source && replica );
+    for ( sqlite3 *handle : { source.get(), replica.get() } ) {
+
+      ASSERT_EQ( sqlite3_exec( handle, "CREATE TABLE numbers (id INTEGER PRIMARY KEY)", nullptr, nullptr, nullptr ), SQLITE_OK );
+    }
+
+    sqlite_utils::Session session( source.get() );
+    ASSERT_FALSE( session.attach( "numbers" ) );
+
+    /* Every row is in exactly one changeset */
+    std::atomic<bool> done { false };
+    std::thread writer( [ &source, &done ] {
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( source.get(), "INSERT INTO numbers VALUES(?)" );
+      for ( std::int32_t row = 1; row <= rows; ++row ) {
+
+        sqlite3_bind_int( statement.get(), 1, row );
+        EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_DONE );
+        sqlite3_reset( statement.get() );
+      }
+      done = true;
+    } );
+    std::vector<std::uint8_t> changeset {};
+    std::int32_t checkpoints = 0;
+    while ( !done ) {
+
+      EXPECT_FALSE( session.checkpoint( changeset ) );
+      EXPECT_FALSE( sqlite_utils::applyChangeset( replica.get(), changeset, sqlite_utils::Conflict::Abort ) );
+      ++checkpoints;
+    }
+    writer.join();
+    EXPECT_FALSE( session.checkpoint( changeset ) );
+    EXPECT_FALSE( sqlite_utils::applyChangeset( replica.get(), changeset, sqlite_utils::Conflict::Abort ) );
+    EXPECT_GT( checkpoints, 0 );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( replica.get(), "SELECT COUNT(*), SUM(id) FROM numbers", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), rows );
+    EXPECT_EQ( sqlite3_column_int64( statement.get(), 1 ), static_cast<sqlite3_int64>( rows ) * ( rows + 1 ) / 2 );
+  }
+
+  TEST( Session, Conflict ) {
+
+    std::error_code error {};
+    const auto source { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const auto replica { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    for ( sqlite3 *handle : { source.get(), replica.get() } ) {
+
+      const std::int32_t resultCode = sqlite3_exec( handle, std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_OK );
+    }
+    std::int32_t resultCode = sqlite3_exec( replica.get(), "INSERT INTO cities VALUES('Tokyo', 0, 0)", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    sqlite_utils::Session session( source.get() );
+    error = session.attach();
+    EXPECT_FALSE( error );
+    resultCode = sqlite3_exec( source.get(), "INSERT INTO cities VALUES('Tokyo', 35.6839, 139.7744)", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::vector<std::uint8_t> changeset {};
+    error = session.checkpoint( changeset );
+    EXPECT_FALSE( error );
+
+    error = sqlite_utils::applyChangeset( replica.get(), changeset, sqlite_utils::Conflict::Abort );
+    EXPECT_TRUE( error );
+
+    error = sqlite_utils::applyChangeset( replica.get(), changeset, sqlite_utils::Conflict::Replace );
+    EXPECT_FALSE( error );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( replica.get(), "SELECT latitude FROM cities WHERE city = 'Tokyo'", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_DOUBLE_EQ( sqlite3_column_double( statement.get(), 0 ), 35.6839 );
+  }
+
+  TEST( Session, NotAttached ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::Session session( database.get() );
+    std::vector<std::uint8_t> changeset {};
+    error = session.checkpoint( changeset );
+    EXPECT_TRUE( error );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
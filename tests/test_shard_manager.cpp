@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteShardManager.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::int32_t shardCount = 20;
+
+  /**
+   * @brief Filename prefix of the running test - ctest runs the tests in parallel processes.
+   * @return Filename prefix.
+   */
+  std::string testPrefix() {
+
+    return "tenant_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + "_";
+  }
+
+  /**
+   * @brief Filename of a shard.
+   * @param _index   Shard index.
+   * @return Database filename.
+   */
+  std::string shardFilename( std::int32_t _index ) {
+
+    return testPrefix() + std::to_string( _index ) + ".db";
+  }
+
+  /**
+   * @brief Filename of the dump.
+   * @return Dump filename.
+   */
+  std::string dumpFilename() {
+
+    return testPrefix() + "dump.dump";
+  }
+
+  /**
+   * @brief Tenant id stored in a shard.
+   * @param _handle   Database handle.
+   * @param _schema   Schema of the shard.
+   * @return Tenant id or -1 on error.
+   */
+  std::int64_t tenant( sqlite3 *_handle,
+                       const std::string &_schema ) {
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _handle, "SELECT id FROM \"" + _schema + "\".tenant" );
+    if ( !statement || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  /**
+   * @brief Create the shard files and one dump.
+   */
+  void createShards() {
+
+    for ( std::int32_t i = 0; i <= shardCount; ++i ) {
+
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( i < shardCount ? shardFilename( i ) : ":memory:", error ) };
+      const std::string sql = "DROP TABLE IF EXISTS tenant; CREATE TABLE tenant (id INTEGER); INSERT INTO tenant VALUES(" + std::to_string( i ) + ")";
+      EXPECT_EQ( sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr ), SQLITE_OK );
+      if ( i == shardCount ) {
+
+        error = sqlite_utils::exportDump( database.get(), "main", dumpFilename() );
+        EXPECT_FALSE( error );
+      }
+    }
+  }
+
+  /**
+   * @brief Remove the shard files and the dump.
+   */
+  void removeShards() {
+
+    for ( std::int32_t i = 0; i < shardCount; ++i ) {
+
+      std::filesystem::remove( shardFilename( i ) );
+    }
+    std::filesystem::remove( dumpFilename() );
+  }
+
+  TEST( ShardManager, Lru ) {
+
+    createShards();
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+      EXPECT_EQ( sqlite3_exec( database.get(), "ATTACH DATABASE ':memory:' AS foreign_schema", nullptr, nullptr, nullptr ), SQLITE_OK );
+      sqlite3_limit( database.get(), SQLITE_LIMIT_ATTACHED, 5 );
+
+      sqlite_utils::ShardManager shards( database.get() );
+      EXPECT_EQ( shards.capacity(), 4 );
+      for ( std::int32_t i = 0; i < shardCount; ++i ) {
+
+        error = shards.addFile( "tenant_" + std::to_string( i ), shardFilename( i ) );
+        EXPECT_FALSE( error );
+      }
+      error = shards.addDump( "tenant_dump", dumpFilename() );
+      EXPECT_FALSE( error );
+
+      /* More shards than attach slots */
+      for ( std::int32_t i = 0; i < shardCount; ++i ) {
+
+        const std::string name = "tenant_" + std::to_string( i );
+        error = shards.attach( name );
+        ASSERT_FALSE( error ) << error.message();
+        EXPECT_EQ( tenant( database.get(), name ), i );
+      }
+      EXPECT_EQ( shards.size(), 4 );
+      error = shards.attach( "tenant_dump" );
+      EXPECT_FALSE( error );
+      EXPECT_EQ( tenant( database.get(), "tenant_dump" ), shardCount );
+
+      /* tenant_16 is the least recently used one */
+      EXPECT_FALSE( shards.attached( "tenant_16" ) );
+      error = shards.attach( "tenant_17" );
+      EXPECT_FALSE( error );
+      error = shards.attach( "tenant_0" );
+      EXPECT_FALSE( error );
+      EXPECT_FALSE( shards.attached( "tenant_18" ) );
+      EXPECT_TRUE( shards.attached( "tenant_17" ) );
+
+      const sqlite_utils::ShardMetrics metrics = shards.metrics();
+      EXPECT_EQ( metrics.hits, 1 );
+      EXPECT_EQ( metrics.misses, shardCount + 2 );
+      EXPECT_EQ( metrics.evictions, shardCount - 2 );
+      EXPECT_GT( metrics.attachTime.count(), 0 );
+      EXPECT_GE( metrics.attachTime, metrics.maxAttachTime );
+
+      error = shards.attach( "tenant_unknown" );
+      EXPECT_EQ( error.value(), SQLITE_ERROR );
+      error = shards.addFile( "main", shardFilename( 0 ) );
+      EXPECT_EQ( error.value(), SQLITE_MISUSE );
+    }
+    removeShards();
+  }
+
+  TEST( ShardManager, RunningStatement ) {
+
+    createShards();
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+      sqlite_utils::ShardManager shards( database.get(), 2 );
+      for ( std::int32_t i = 0; i < 3; ++i ) {
+
+        error = shards.addFile( "tenant_" + std::to_string( i ), shardFilename( i ) );
+        EXPECT_FALSE( error );
+      }
+
+      error = shards.prewarm( { "tenant_0", "tenant_1", "tenant_2" } );
+      EXPECT_FALSE( error );
+      EXPECT_TRUE( shards.attached( "tenant_0" ) );
+      EXPECT_TRUE( shards.attached( "tenant_1" ) );
+      EXPECT_FALSE( shards.attached( "tenant_2" ) );
+
+      /* The running statement locks the least recently used shard */
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT id FROM tenant_1.tenant" );
+      EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+      error = shards.attach( "tenant_2" );
+      EXPECT_FALSE( error );
+      EXPECT_TRUE( shards.attached( "tenant_1" ) );
+      EXPECT_FALSE( shards.attached( "tenant_0" ) );
+
+      error = shards.detach( "tenant_2" );
+      EXPECT_FALSE( error );
+      EXPECT_EQ( shards.size(), 1 );
+    }
+    removeShards();
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteSharedMemory.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view dumpFilename = "shared_memory.dump";
+
+  constexpr std::int64_t blobRows = 2000;
+
+  /**
+   * @brief Count rows by reading every page of the blobs.
+   * @param _handle   Database handle.
+   * @return Rows or -1 on error.
+   */
+  std::int64_t scan( sqlite3 *_handle ) {
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _handle, "SELECT COUNT(*) FROM blobs WHERE substr(data, 4000, 1) = zeroblob(1)" );
+    if ( !statement || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  TEST( SharedMemory, Readers ) {
+
+    /* Dump with a page size different to the memdb default */
+    {
+      std::error_code error {};
+      const auto source { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+      const std::string sql = "PRAGMA page_size = 8192; VACUUM; CREATE TABLE blobs (id INTEGER PRIMARY KEY, data BLOB); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " + std::to_string( blobRows ) + ") INSERT INTO blobs SELECT i, zeroblob(4000) FROM n";
+      EXPECT_EQ( sqlite3_exec( source.get(), sql.c_str(), nullptr, nullptr, nullptr ), SQLITE_OK );
+      error = sqlite_utils::exportDump( source.get(), "main", std::string( dumpFilename ) );
+      EXPECT_FALSE( error );
+    }
+
+    sqlite_utils::SharedMemoryDatabase database( "reference" );
+    std::error_code error = database.open();
+    if ( error ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+    error = database.importDump( std::string( dumpFilename ) );
+    EXPECT_FALSE( error );
+    std::filesystem::remove( dumpFilename );
+    EXPECT_EQ( database.uri(), "file:/reference?vfs=memdb" );
+
+    /* Readers share the pages of one copy */
+    const sqlite3_int64 before = sqlite3_memory_used();
+    std::vector<std::unique_ptr<sqlite3, sqlite_utils::sqlite3_deleter>> readers {};
+    for ( std::int32_t i = 0; i < 4; ++i ) {
+
+      readers.emplace_back( database.connect( error ) );
+      ASSERT_TRUE( readers.back() ) << error.message();
+      EXPECT_EQ( scan( readers.back().get() ), blobRows );
+    }
+    EXPECT_LT( sqlite3_memory_used() - before, blobRows * 4000 );
+
+    /* Writes of the anchor are visible, readers are read-only */
+    EXPECT_EQ( sqlite3_exec( database.get(), "DELETE FROM blobs WHERE id > 1000", nullptr, nullptr, nullptr ), SQLITE_OK );
+    EXPECT_EQ( scan( readers.front().get() ), 1000 );
+    EXPECT_EQ( sqlite3_exec( readers.front().get(), "DELETE FROM blobs", nullptr, nullptr, nullptr ), SQLITE_READONLY );
+
+    const auto writer = database.connect( error, false );
+    EXPECT_EQ( sqlite3_exec( writer.get(), "DELETE FROM blobs WHERE id > 10", nullptr, nullptr, nullptr ), SQLITE_OK );
+    EXPECT_EQ( scan( database.get() ), 10 );
+  }
+
+  TEST( SharedMemory, Misuse ) {
+
+    sqlite_utils::SharedMemoryDatabase database( "in?valid" );
+    std::error_code error {};
+    const auto reader = database.connect( error );
+    EXPECT_FALSE( reader );
+    EXPECT_EQ( error.value(), SQLITE_MISUSE );
+
+    error = database.open();
+    EXPECT_EQ( error.value(), SQLITE_MISUSE );
+    error = database.importDump( "missing.dump" );
+    EXPECT_TRUE( error );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
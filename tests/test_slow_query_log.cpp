@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::uint64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteProfiler.h>
+#include <SqliteSlowQueryLog.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  constexpr std::string_view logFilename = "slow_query.log";
+
+  /**
+   * @brief Database filename of the running test - plans are explained on a connection to the file.
+   * @return Database filename.
+   */
+  std::string databaseFilename() {
+
+    return "slow_query_log_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + ".db";
+  }
+
+  /**
+   * @brief Open a profiled database with an unindexed table.
+   * @param _filename   Database filename - an existing file is replaced.
+   * @param _error   Error code.
+   * @return Database connection.
+   */
+  std::unique_ptr<sqlite3, sqlite_utils::sqlite3_deleter> open( const std::string &_filename,
+                                                                std::error_code &_error ) {
+
+    std::filesystem::remove( _filename );
+    auto database { sqlite_utils::sqlite3_make_unique( _filename, _error ) };
+    if ( _error ) {
+
+      return database;
+    }
+    sqlite3_exec( database.get(), "CREATE TABLE cities (id INTEGER PRIMARY KEY, name TEXT, population INTEGER); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 5000) INSERT INTO cities SELECT i, 'city' || i, i * 10 FROM n", nullptr, nullptr, nullptr );
+    _error = sqlite_utils::profileConnection( database.get() );
+    return database;
+  }
+
+  /**
+   * @brief Run a statement with one bound text until done.
+   * @param _database   Database connection.
+   * @param _sql   Sql command.
+   * @param _name   Text of the first parameter.
+   */
+  void run( sqlite3 *_database,
+            const std::string &_sql,
+            const std::string &_name ) {
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _database, _sql );
+    sqlite3_bind_text( statement.get(), 1, _name.c_str(), -1, SQLITE_TRANSIENT );
+    while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {}
+  }
+
+  TEST( SlowQueryLog, Callback ) {
+
+    std::error_code error {};
+    auto database = open( databaseFilename(), error );
+    ASSERT_FALSE( error ) << error.message();
+
+    std::mutex mutex {};
+    std::vector<sqlite_utils::SlowQuery> queries {};
+    sqlite_utils::SlowQueryOptions options {};
+    options.threshold = std::chrono::nanoseconds( 0 );
+    options.callback = [ &mutex, &queries ]( const sqlite_utils::SlowQuery &_query ) {
+      const std::lock_guard lock( mutex );
+      queries.push_back( _query );
+    };
+    ASSERT_FALSE( sqlite_utils::startSlowQueryLog( options ) );
+    EXPECT_EQ( sqlite_utils::startSlowQueryLog( options ).value(), SQLITE_MISUSE );
+
+    run( database.get(), "SELECT * FROM cities WHERE name = ? ORDER BY population", "city42" );
+    run( database.get(), "SELECT * FROM cities WHERE id = ?", "42" );
+    sqlite_utils::stopSlowQueryLog();
+
+    /* Full scan with sort and its plan */
+    ASSERT_EQ( queries.size(), 2U );
+    const sqlite_utils::SlowQuery &scan = queries[ 0 ];
+    EXPECT_EQ( scan.sql, "SELECT * FROM cities WHERE name = 'city42' ORDER BY population" );
+    EXPECT_GT( scan.elapsed.count(), 0 );
+    EXPECT_EQ( scan.fullScanSteps, 4999 );
+    EXPECT_EQ( scan.sorts, 1 );
+    EXPECT_GT( scan.vmSteps, 5000 );
+    EXPECT_NE( scan.plan.find( "SCAN cities" ), std::string::npos ) << scan.plan;
+    EXPECT_NE( scan.plan.find( "USE TEMP B-TREE FOR ORDER BY" ), std::string::npos ) << scan.plan;
+
+    /* Primary key lookup */
+    const sqlite_utils::SlowQuery &lookup = queries[ 1 ];
+    EXPECT_EQ( lookup.fullScanSteps, 0 );
+    EXPECT_EQ( lookup.sorts, 0 );
+    EXPECT_NE( lookup.plan.find( "SEARCH cities USING INTEGER PRIMARY KEY" ), std::string::npos ) << lookup.plan;
+    EXPECT_EQ( sqlite_utils::slowQueriesDropped(), 0U );
+
+    /* Stopped */
+    run( database.get(), "SELECT * FROM cities WHERE name = ?", "city1" );
+    EXPECT_EQ( queries.size(), 2U );
+    database.reset();
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( SlowQueryLog, Counters ) {
+
+    std::error_code error {};
+    auto database = open( databaseFilename(), error );
+    ASSERT_FALSE( error ) << error.message();
+
+    std::mutex mutex {};
+    std::vector<sqlite_utils::SlowQuery> queries {};
+    sqlite_utils::SlowQueryOptions options {};
+    options.threshold = std::chrono::nanoseconds( 0 );
+    options.callback = [ &mutex, &queries ]( const sqlite_utils::SlowQuery &_query ) {
+      const std::lock_guard lock( mutex );
+      queries.push_back( _query );
+    };
+    ASSERT_FALSE( sqlite_utils::startSlowQueryLog( options ) );
+
+    /* Every run reports its own counters - the counters of the statement keep counting */
+    {
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT count(*) FROM cities WHERE name = 'city7'" );
+      for ( std::int32_t index = 0; index < 2; ++index ) {
+
+        while ( sqlite3_step( statement.get() ) == SQLITE_ROW ) {}
+        sqlite3_reset( statement.get() );
+      }
+      sqlite_utils::stopSlowQueryLog();
+      EXPECT_EQ( sqlite3_stmt_status( statement.get(), SQLITE_STMTSTATUS_FULLSCAN_STEP, 0 ), 2 * 4999 );
+      EXPECT_EQ( sqlite_utils::statementCounters( statement.get() ).fullScanSteps, 2 * 4999 );
+    }
+    ASSERT_EQ( queries.size(), 2U );
+    for ( const sqlite_utils::SlowQuery &query : queries ) {
+
+      EXPECT_EQ( query.fullScanSteps, 4999 );
+      EXPECT_NE( query.plan.find( "SCAN cities" ), std::string::npos ) << query.plan;
+    }
+
+    /* In-memory databases have no file to explain on */
+    const auto memory = open( ":memory:", error );
+    ASSERT_FALSE( error ) << error.message();
+    queries.clear();
+    ASSERT_FALSE( sqlite_utils::startSlowQueryLog( options ) );
+    run( memory.get(), "SELECT * FROM cities WHERE name = ?", "city1" );
+    sqlite_utils::stopSlowQueryLog();
+    ASSERT_EQ( queries.size(), 1U );
+    EXPECT_EQ( queries[ 0 ].fullScanSteps, 4999 );
+    EXPECT_TRUE( queries[ 0 ].plan.empty() );
+
+    database.reset();
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( SlowQueryLog, Threads ) {
+
+    constexpr std::int32_t threadCount = 4;
+    constexpr std::int32_t runs = 100;
+
+    std::atomic<std::int32_t> logged { 0 };
+    sqlite_utils::SlowQueryOptions options {};
+    options.threshold = std::chrono::nanoseconds( 0 );
+    options.explain = false;
+    options.callback = [ &logged ]( const sqlite_utils::SlowQuery &_query ) {
+      EXPECT_TRUE( _query.plan.empty() );
+      ++logged;
+    };
+    ASSERT_FALSE( sqlite_utils::startSlowQueryLog( options ) );
+
+    /* Producers never wait - a full ring drops */
+    std::vector<std::thread> threads {};
+    for ( std::int32_t thread = 0; thread < threadCount; ++thread ) {
+
+      threads.emplace_back( [ thread ] {
+        std::error_code error {};
+        const auto database = open( ":memory:", error );
+        EXPECT_FALSE( error ) << error.message();
+        for ( std::int32_t index = 0; index < runs; ++index ) {
+
+          run( database.get(), "SELECT count(*) FROM cities WHERE name = ?", "city" + std::to_string( thread ) );
+        }
+      } );
+    }
+    for ( std::thread &thread : threads ) {
+
+      thread.join();
+    }
+    sqlite_utils::stopSlowQueryLog();
+    EXPECT_EQ( static_cast<std::uint64_t>( logged ) + sqlite_utils::slowQueriesDropped(), static_cast<std::uint64_t>( threadCount * runs ) );
+  }
+
+  TEST( SlowQueryLog, Rotate ) {
+
+    const std::string filename( logFilename );
+    for ( std::int32_t index = 0; index <= 3; ++index ) {
+
+      std::filesystem::remove( filename + ( index > 0 ? "." + std::to_string( index ) : "" ) );
+    }
+
+    std::error_code error {};
+    auto database = open( databaseFilename(), error );
+    ASSERT_FALSE( error ) << error.message();
+
+    sqlite_utils::SlowQueryOptions options {};
+    EXPECT_EQ( sqlite_utils::startSlowQueryLog( options ).value(), SQLITE_MISUSE );
+    options.threshold = std::chrono::nanoseconds( 0 );
+    options.filename = filename;
+    options.maxFileSize = 1024;
+    options.maxFiles = 2;
+    ASSERT_FALSE( sqlite_utils::startSlowQueryLog( options ) );
+    for ( std::int32_t index = 0; index < 40; ++index ) {
+
+      run( database.get(), "SELECT * FROM cities WHERE name = ?", "city" + std::to_string( index ) );
+    }
+    sqlite_utils::stopSlowQueryLog();
+
+    /* Two rotated files are kept */
+    EXPECT_TRUE( std::filesystem::exists( filename ) );
+    EXPECT_TRUE( std::filesystem::exists( filename + ".1" ) );
+    EXPECT_TRUE( std::filesystem::exists( filename + ".2" ) );
+    EXPECT_FALSE( std::filesystem::exists( filename + ".3" ) );
+    EXPECT_LE( std::filesystem::file_size( filename + ".1" ), 1024U );
+
+    std::ifstream file( filename );
+    const std::string text { std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+    EXPECT_EQ( text.rfind( "# Time: ", 0 ), 0U );
+    EXPECT_NE( text.find( "Full scan steps: 4999" ), std::string::npos );
+    EXPECT_NE( text.find( "# Plan:\n#   SCAN cities\n" ), std::string::npos );
+    EXPECT_NE( text.find( "SELECT * FROM cities WHERE name = 'city39';\n" ), std::string::npos );
+
+    for ( std::int32_t index = 0; index <= 2; ++index ) {
+
+      std::filesystem::remove( filename + ( index > 0 ? "." + std::to_string( index ) : "" ) );
+    }
+    database.reset();
+    std::filesystem::remove( databaseFilename() );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteSnapshot.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  /**
+   * @brief Dump filename of the running test - ctest runs the tests in parallel processes.
+   * @param _version Snapshot version.
+   * @return Dump filename.
+   */
+  std::string dumpFilename( std::int32_t _version ) {
+
+    return "snapshot_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + "_" + std::to_string( _version ) + ".dump";
+  }
+
+  /**
+   * @brief Export a dump with one version row.
+   * @param _filename   Dump filename.
+   * @param _version   Version of the reference data.
+   */
+  void createDump( std::string_view _filename,
+                   std::int32_t _version ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::string sql = "CREATE TABLE reference (version INTEGER); INSERT INTO reference VALUES(" + std::to_string( _version ) + ")";
+    EXPECT_EQ( sqlite3_exec( database.get(), sql.c_str(), nullptr, nullptr, nullptr ), SQLITE_OK );
+    error = sqlite_utils::exportDump( database.get(), "main", std::string( _filename ) );
+    EXPECT_FALSE( error );
+  }
+
+  /**
+   * @brief Version of the reference data.
+   * @param _handle   Database handle.
+   * @return Version or -1 on error.
+   */
+  std::int64_t version( sqlite3 *_handle ) {
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( _handle, "SELECT version FROM reference" );
+    if ( !statement || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  TEST( Snapshot, Publish ) {
+
+    const std::string firstDump = dumpFilename( 1 );
+    const std::string secondDump = dumpFilename( 2 );
+    createDump( firstDump, 1 );
+    createDump( secondDump, 2 );
+    {
+      sqlite_utils::SnapshotManager manager( "snapshot_publish" );
+      std::error_code error {};
+      sqlite_utils::SnapshotLease empty = manager.acquire( error );
+      EXPECT_FALSE( empty );
+      EXPECT_EQ( error.value(), SQLITE_MISUSE );
+      EXPECT_EQ( manager.generation(), 0 );
+
+      error = manager.load( firstDump );
+      if ( error ) {
+
+        GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+      }
+      sqlite_utils::SnapshotLease first = manager.acquire( error );
+      ASSERT_TRUE( first );
+      EXPECT_EQ( first.generation(), 1 );
+      EXPECT_EQ( version( first.get() ), 1 );
+
+      /* The pinned generation survives the reload */
+      error = manager.loadAsync( secondDump ).get();
+      EXPECT_FALSE( error );
+      EXPECT_EQ( manager.generation(), 2 );
+      EXPECT_EQ( manager.generations(), 2 );
+      EXPECT_EQ( version( first.get() ), 1 );
+      {
+        const sqlite_utils::SnapshotLease second = manager.acquire( error );
+        EXPECT_EQ( second.generation(), 2 );
+        EXPECT_EQ( version( second.get() ), 2 );
+      }
+
+      /* The last lease frees the old generation */
+      first.release();
+      EXPECT_EQ( manager.generations(), 1 );
+
+      /* A broken dump keeps the current generation */
+      error = manager.load( "missing.dump" );
+      EXPECT_TRUE( error );
+      EXPECT_EQ( manager.generation(), 2 );
+      EXPECT_EQ( manager.generations(), 1 );
+    }
+    std::filesystem::remove( firstDump );
+    std::filesystem::remove( secondDump );
+  }
+
+  TEST( Snapshot, ReloadWhileReading ) {
+
+    const std::string firstDump = dumpFilename( 1 );
+    const std::string secondDump = dumpFilename( 2 );
+    createDump( firstDump, 1 );
+    createDump( secondDump, 2 );
+    {
+      sqlite_utils::SnapshotManager manager( "snapshot_reload" );
+      std::error_code error = manager.load( firstDump );
+      EXPECT_FALSE( error );
+
+      std::atomic<bool> stop { false };
+      std::atomic<std::int32_t> failures { 0 };
+      std::vector<std::thread> readers {};
+      for ( std::int32_t i = 0; i < 4; ++i ) {
+
+        readers.emplace_back( [ &manager, &stop, &failures ]() {
+          while ( !stop.load() ) {
+
+            std::error_code leaseError {};
+            const sqlite_utils::SnapshotLease lease = manager.acquire( leaseError );
+            const std::int64_t current = lease ? version( lease.get() ) : -1;
+            if ( current != static_cast<std::int64_t>( 2 - lease.generation() % 2 ) ) {
+
+              ++failures;
+            }
+          }
+        } );
+      }
+
+      for ( std::int32_t i = 0; i < 20; ++i ) {
+
+        error = manager.loadAsync( i % 2 == 0 ? secondDump : firstDump ).get();
+        EXPECT_FALSE( error );
+      }
+      stop = true;
+      for ( std::thread &reader : readers ) {
+
+        reader.join();
+      }
+      EXPECT_EQ( failures, 0 );
+      EXPECT_EQ( manager.generation(), 21 );
+      EXPECT_EQ( manager.generations(), 1 );
+    }
+    std::filesystem::remove( firstDump );
+    std::filesystem::remove( secondDump );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <sstream>
+#include <string>
+#include <system_error>
+
+/* sqlite_functions */
+#include <SqliteSqlText.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  TEST( SqlText, RoundTrip ) {
+
+    std::error_code error {};
+    const auto source { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const auto replica { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    if ( !source || !replica ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+
+    const std::string sql = "CREATE TABLE cities (id INTEGER PRIMARY KEY AUTOINCREMENT, city TEXT, latitude REAL, flag BLOB);"
+                            "CREATE INDEX cities_city ON cities(city);"
+                            "CREATE VIEW north AS SELECT city FROM cities WHERE latitude > 0;"
+                            "INSERT INTO cities(city, latitude, flag) VALUES('Munich', 48.1375, X'00ff10'), ('O''Higgins', -48.46, NULL), (NULL, 0.1, X'');"
+                            "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 1000) INSERT INTO cities(city, latitude) SELECT 'City ' || i, i / 7.0 FROM n;";
+    const std::int32_t resultCode = sqlite3_exec( source.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::stringstream text {};
+    error = sqlite_utils::exportSqlText( source.get(), "main", text, 100 );
+    EXPECT_FALSE( error );
+
+    error = sqlite_utils::importSqlText( replica.get(), text, 3 );
+    EXPECT_FALSE( error );
+
+    /* Same content on both sides */
+    std::stringstream exported {};
+    std::stringstream reexported {};
+    EXPECT_FALSE( sqlite_utils::exportSqlText( source.get(), "main", exported ) );
+    EXPECT_FALSE( sqlite_utils::exportSqlText( replica.get(), "main", reexported ) );
+    EXPECT_EQ( exported.str(), reexported.str() );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( replica.get(), "SELECT COUNT(*), SUM(latitude), (SELECT hex(flag) FROM cities WHERE id = 1), (SELECT city FROM cities WHERE id = 2), (SELECT seq FROM sqlite_sequence), (SELECT COUNT(*) FROM north) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 1003 );
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 2 ) ), "00FF10" ); // NOSONAR sqlite text is utf-8
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 3 ) ), "O'Higgins" ); // NOSONAR sqlite text is utf-8
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 4 ), 1003 );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 5 ), 1002 );
+  }
+
+  TEST( SqlText, Import ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+
+    /* Transactions of the text are replaced by the batches of the import */
+    std::stringstream text( "BEGIN TRANSACTION;\nCREATE TABLE t (a TEXT);\n-- comment; with semicolon\nINSERT INTO t VALUES('a;b');\nINSERT INTO t VALUES('c');\nCOMMIT;\nINSERT INTO t VALUES('d')" );
+    error = sqlite_utils::importSqlText( database.get(), text, 2 );
+    EXPECT_FALSE( error );
+    EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT group_concat(a, '|') FROM t", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ), "a;b|c|d" ); // NOSONAR sqlite text is utf-8
+  }
+
+  TEST( SqlText, GeneratedColumns ) {
+
+    std::error_code error {};
+    const auto source { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const auto replica { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    if ( !source || !replica ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+
+    /* Literals spanning several import chunks, a trigger body with semicolons */
+    const std::string sql = "CREATE TABLE notes (id INTEGER PRIMARY KEY, note TEXT, size INTEGER GENERATED ALWAYS AS (length(note)) VIRTUAL, upper TEXT AS (upper(substr(note, 1, 3))) STORED);"
+                            "CREATE TABLE log (size INTEGER);"
+                            "CREATE TRIGGER notes_log AFTER INSERT ON notes BEGIN INSERT INTO log VALUES(NEW.size); INSERT INTO log VALUES(-1); END;"
+                            "INSERT INTO notes(note) VALUES('abc'), (replace(hex(zeroblob(100000)), '00', 'x;-- /*''')), ('[\"`');";
+    const std::int32_t resultCode = sqlite3_exec( source.get(), sql.c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::stringstream text {};
+    error = sqlite_utils::exportSqlText( source.get(), "main", text );
+    EXPECT_FALSE( error );
+    EXPECT_NE( sqlite3_get_autocommit( source.get() ), 0 );
+
+    error = sqlite_utils::importSqlText( replica.get(), text );
+    EXPECT_FALSE( error );
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( replica.get(), "SELECT SUM(size), group_concat(upper, '|'), (SELECT COUNT(*) FROM log) FROM notes", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 3 + 800000 + 3 );
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 1 ) ), "ABC|X;-|[\"`" ); // NOSONAR sqlite text is utf-8
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 2 ), 6 );
+  }
+
+  TEST( SqlText, ImportError ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), "CREATE TABLE t (a INTEGER NOT NULL)", nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    std::stringstream text( "INSERT INTO t VALUES(1);\nINSERT INTO t VALUES(NULL);\n" );
+    error = sqlite_utils::importSqlText( database.get(), text );
+    EXPECT_TRUE( error );
+    EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+
+    /* The failed batch is rolled back */
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT COUNT(*) FROM t", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 0 );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
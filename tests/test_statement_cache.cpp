@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <string>
+#include <system_error>
+
+/* sqlite_functions */
+#include <SqliteStatementCache.h>
+#include <SqliteUtils.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  TEST( StatementCache, Hit ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::StatementCache cache( database.get() );
+
+    sqlite3_stmt *first = nullptr;
+    {
+      const sqlite_utils::CachedStatement statement = cache.prepare( "SELECT ?1 + 1", error );
+      EXPECT_FALSE( error );
+      first = statement.get();
+      sqlite3_bind_int( statement.get(), 1, 41 );
+      EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+      EXPECT_EQ( sqlite3_column_int( statement.get(), 0 ), 42 );
+    }
+
+    /* Same statement - reset and without bindings */
+    const std::string sql = "SELECT ?1 + 1";
+    const sqlite_utils::CachedStatement statement = cache.prepare( sql, error );
+    EXPECT_EQ( statement.get(), first );
+    EXPECT_EQ( sqlite3_stmt_busy( statement.get() ), 0 );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_EQ( sqlite3_column_type( statement.get(), 0 ), SQLITE_NULL );
+
+    const sqlite_utils::CacheMetrics metrics = cache.metrics();
+    EXPECT_EQ( metrics.hits, 1 );
+    EXPECT_EQ( metrics.misses, 1 );
+    EXPECT_DOUBLE_EQ( metrics.hitRate(), 0.5 );
+    EXPECT_EQ( cache.size(), 1 );
+  }
+
+  TEST( StatementCache, Eviction ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::StatementCache cache( database.get(), 2 );
+
+    EXPECT_TRUE( cache.prepare( "SELECT 1", error ) );
+    EXPECT_TRUE( cache.prepare( "SELECT 2", error ) );
+    EXPECT_TRUE( cache.prepare( "SELECT 1", error ) );
+
+    /* SELECT 2 is the least recently used */
+    EXPECT_TRUE( cache.prepare( "SELECT 3", error ) );
+    EXPECT_TRUE( cache.prepare( "SELECT 1", error ) );
+    EXPECT_TRUE( cache.prepare( "SELECT 2", error ) );
+
+    const sqlite_utils::CacheMetrics metrics = cache.metrics();
+    EXPECT_EQ( metrics.hits, 2 );
+    EXPECT_EQ( metrics.misses, 4 );
+    EXPECT_EQ( metrics.evictions, 2 );
+    EXPECT_EQ( cache.size(), 2 );
+  }
+
+  TEST( StatementCache, Leased ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::StatementCache cache( database.get(), 1 );
+
+    const sqlite_utils::CachedStatement first = cache.prepare( "SELECT 1", error );
+    const sqlite_utils::CachedStatement second = cache.prepare( "SELECT 1", error );
+    EXPECT_TRUE( second );
+    EXPECT_NE( first.get(), second.get() );
+
+    /* Leased entries are not evicted */
+    const sqlite_utils::CachedStatement third = cache.prepare( "SELECT 2", error );
+    EXPECT_TRUE( third );
+    EXPECT_EQ( cache.size(), 1 );
+    EXPECT_EQ( cache.metrics().evictions, 0 );
+  }
+
+  TEST( StatementCache, Error ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    sqlite_utils::StatementCache cache( database.get() );
+
+    EXPECT_FALSE( cache.prepare( "SELECT FROM", error ) );
+    EXPECT_EQ( error.value(), SQLITE_ERROR );
+    EXPECT_FALSE( cache.prepare( " ", error ) );
+    EXPECT_EQ( error.value(), SQLITE_MISUSE );
+    EXPECT_EQ( cache.size(), 0 );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
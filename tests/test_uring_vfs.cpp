@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+#ifdef HAVE_IO_URING
+  #include <fcntl.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+
+/* sqlite header */
+  #include <sqlite3.h>
+
+/* stl header */
+  #include <filesystem>
+  #include <memory>
+  #include <string>
+  #include <string_view>
+  #include <system_error>
+
+/* sqlite_functions */
+  #include <SqliteOpenOptions.h>
+  #include <SqliteUringVfs.h>
+  #include <SqliteUtils.h>
+#endif
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+#ifdef HAVE_IO_URING
+  /**
+   * @brief Database filename of the running test - ctest runs the tests in parallel processes.
+   * @return Database filename.
+   */
+  std::string databaseFilename() {
+
+    return "uring_vfs_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + ".db";
+  }
+
+  /**
+   * @brief Rows of the test table - spans many read-ahead windows.
+   */
+  constexpr std::int64_t rows = 20000;
+
+  /**
+   * @brief Single integer of a query.
+   * @param _database   Database connection.
+   * @param _sql   Sql command.
+   * @return Value of the first column or -1 on error.
+   */
+  std::int64_t scalar( sqlite3 *_database,
+                       const std::string &_sql ) {
+
+    std::error_code error {};
+    const auto statement { sqlite_utils::sqlite3_stmt_make_unique( _database, _sql, error ) };
+    if ( error || sqlite3_step( statement.get() ) != SQLITE_ROW ) {
+
+      return -1;
+    }
+    return sqlite3_column_int64( statement.get(), 0 );
+  }
+
+  /**
+   * @brief Check for a reserved lock on a database from another process - a process does not see its own posix locks.
+   * @param _filename   Database filename.
+   * @return True, if another process sees the reserved lock.
+   */
+  bool reservedLocked( const std::string &_filename ) {
+
+    const pid_t child = fork();
+    if ( child == 0 ) {
+
+      const std::int32_t fd = ::open( _filename.c_str(), O_RDONLY ); // NOSONAR posix api
+      struct flock lock {};
+      lock.l_type = F_WRLCK;
+      lock.l_whence = SEEK_SET;
+      /* Reserved byte of sqlite - pending byte + 1 */
+      lock.l_start = 0x40000001;
+      lock.l_len = 1;
+      const bool locked = fd >= 0 && fcntl( fd, F_GETLK, &lock ) == 0 && lock.l_type != F_UNLCK;
+      _exit( locked ? 1 : 0 );
+    }
+    std::int32_t status = 0;
+    waitpid( child, &status, 0 );
+    return WIFEXITED( status ) && WEXITSTATUS( status ) == 1;
+  }
+
+  /**
+   * @brief Open a connection on the io_uring vfs.
+   * @param _vfs   Name of the vfs.
+   * @param _journalMode   Journal mode of the connection.
+   * @param _error   Error code.
+   * @return Unique pointer for sqlite3 handle or nullptr on error.
+   */
+  std::unique_ptr<sqlite3, sqlite_utils::sqlite3_deleter> openUring( std::string_view _vfs,
+                                                                     sqlite_utils::JournalMode _journalMode,
+                                                                     std::error_code &_error ) {
+
+    _error = sqlite_utils::registerUringVfs();
+    if ( _error ) {
+
+      return nullptr;
+    }
+    sqlite_utils::OpenOptions options {};
+    options.vfs = std::string( _vfs );
+    options.journalMode = _journalMode;
+    /* A small page cache to read through the vfs */
+    options.cacheSize = 16;
+    return sqlite_utils::sqlite3_make_unique( databaseFilename(), options, _error );
+  }
+
+  /**
+   * @brief Create and scan a table through a vfs.
+   * @param _vfs   Name of the vfs.
+   * @param _journalMode   Journal mode of the connection.
+   */
+  void createAndScan( std::string_view _vfs,
+                      sqlite_utils::JournalMode _journalMode ) {
+
+    std::filesystem::remove( databaseFilename() );
+    std::error_code error {};
+    const auto database = openUring( _vfs, _journalMode, error );
+    if ( error ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+
+    const std::string insert = "CREATE TABLE numbers (id INTEGER PRIMARY KEY, payload TEXT); WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " + std::to_string( rows ) + ") INSERT INTO numbers SELECT i, printf('%0100d', i) FROM n";
+    ASSERT_EQ( sqlite3_exec( database.get(), insert.c_str(), nullptr, nullptr, nullptr ), SQLITE_OK );
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM numbers" ), rows );
+    EXPECT_EQ( scalar( database.get(), "SELECT sum(id) FROM numbers WHERE length(payload) = 100" ), rows * ( rows + 1 ) / 2 );
+    EXPECT_EQ( scalar( database.get(), "SELECT id FROM numbers WHERE id = 12345" ), 12345 );
+
+    /* A write after a scan is read back fresh and not from a read-ahead window */
+    ASSERT_EQ( sqlite3_exec( database.get(), "UPDATE numbers SET payload = 'changed' WHERE id % 1000 = 0", nullptr, nullptr, nullptr ), SQLITE_OK );
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM numbers WHERE payload = 'changed'" ), rows / 1000 );
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM pragma_integrity_check WHERE integrity_check = 'ok'" ), 1 );
+
+    /* Another connection on the default vfs sees the data */
+    const auto other { sqlite_utils::sqlite3_make_unique( databaseFilename(), error ) };
+    ASSERT_FALSE( error );
+    EXPECT_EQ( scalar( other.get(), "SELECT count(*) FROM numbers WHERE payload = 'changed'" ), rows / 1000 );
+    ASSERT_EQ( sqlite3_exec( other.get(), "DELETE FROM numbers WHERE id > 10000", nullptr, nullptr, nullptr ), SQLITE_OK );
+    EXPECT_EQ( scalar( database.get(), "SELECT count(*) FROM numbers" ), 10000 );
+  }
+
+  TEST( UringVfs, Register ) {
+
+    EXPECT_FALSE( sqlite_utils::registerUringVfs() );
+    EXPECT_FALSE( sqlite_utils::registerUringVfs() );
+    EXPECT_NE( sqlite3_vfs_find( sqlite_utils::uringVfsName.data() ), nullptr );
+    EXPECT_NE( sqlite3_vfs_find( sqlite_utils::uringDirectVfsName.data() ), nullptr );
+    EXPECT_NE( sqlite3_vfs_find( nullptr ), sqlite3_vfs_find( sqlite_utils::uringVfsName.data() ) );
+  }
+
+  TEST( UringVfs, Rollback ) {
+
+    createAndScan( sqlite_utils::uringVfsName, sqlite_utils::JournalMode::Delete );
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( UringVfs, Wal ) {
+
+    createAndScan( sqlite_utils::uringVfsName, sqlite_utils::JournalMode::Wal );
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( UringVfs, Direct ) {
+
+    createAndScan( sqlite_utils::uringDirectVfsName, sqlite_utils::JournalMode::Wal );
+    std::filesystem::remove( databaseFilename() );
+  }
+  TEST( UringVfs, Locks ) {
+
+    std::filesystem::remove( databaseFilename() );
+    std::error_code error {};
+    const auto plain { sqlite_utils::sqlite3_make_unique( databaseFilename(), error ) };
+    ASSERT_FALSE( error );
+    ASSERT_EQ( sqlite3_exec( plain.get(), "CREATE TABLE t (a); BEGIN IMMEDIATE; INSERT INTO t VALUES (1)", nullptr, nullptr, nullptr ), SQLITE_OK );
+    ASSERT_TRUE( reservedLocked( databaseFilename() ) );
+
+    /* Closing an io_uring connection keeps the locks of the default vfs connection */
+    {
+      const auto uring = openUring( sqlite_utils::uringVfsName, sqlite_utils::JournalMode::Delete, error );
+      ASSERT_FALSE( error );
+      EXPECT_EQ( scalar( uring.get(), "SELECT count(*) FROM t" ), 0 );
+    }
+    EXPECT_TRUE( reservedLocked( databaseFilename() ) );
+
+    ASSERT_EQ( sqlite3_exec( plain.get(), "COMMIT", nullptr, nullptr, nullptr ), SQLITE_OK );
+    EXPECT_FALSE( reservedLocked( databaseFilename() ) );
+    std::filesystem::remove( databaseFilename() );
+  }
+#endif
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
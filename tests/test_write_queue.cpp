@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2022 Florian Becker <fb@vxapps.com> (VX APPS).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* c header */
+#include <cstdint> // std::int32_t, std::int64_t, std::uint64_t
+
+/* gtest header */
+#include <gtest/gtest.h>
+
+/* sqlite header */
+#include <sqlite3.h>
+
+/* stl header */
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/* sqlite_functions */
+#include <SqliteUtils.h>
+#include <SqliteWriteQueue.h>
+
+using ::testing::InitGoogleTest;
+using ::testing::Test;
+
+#ifdef __clang__
+  #pragma clang diagnostic push
+  #pragma clang diagnostic ignored "-Wglobal-constructors"
+#endif
+namespace vx {
+
+  /**
+   * @brief Database filename of the running test - ctest runs the tests in parallel processes.
+   * @return Database filename.
+   */
+  std::string databaseFilename() {
+
+    return "write_queue_" + std::string( ::testing::UnitTest::GetInstance()->current_test_info()->name() ) + ".db";
+  }
+
+  constexpr std::string_view createTable = "CREATE TABLE cities (id INTEGER PRIMARY KEY, city TEXT NOT NULL)";
+
+  TEST( WriteQueue, GroupCommit ) {
+
+    std::error_code error {};
+    auto database { sqlite_utils::sqlite3_make_unique( databaseFilename(), sqlite_utils::openOptions( sqlite_utils::Profile::Oltp ), error ) };
+    if ( !database ) {
+
+      GTEST_FAIL() << "ERROR: '" << error.message() << "'";
+    }
+    std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    constexpr std::int64_t threads = 8;
+    constexpr std::int64_t writesPerThread = 250;
+    {
+      sqlite_utils::WriteQueue queue( database.get() );
+      std::vector<std::thread> producers {};
+      std::vector<std::vector<std::future<std::error_code>>> results( threads );
+      for ( std::int64_t i = 0; i < threads; ++i ) {
+
+        producers.emplace_back( [ &queue, &results, i ]() {
+          for ( std::int64_t j = 0; j < writesPerThread; ++j ) {
+
+            results[ static_cast<std::size_t>( i ) ].emplace_back( queue.submit( "INSERT INTO cities VALUES(?, ?)", { i * writesPerThread + j, std::string( "City" ) } ) );
+          }
+        } );
+      }
+      for ( std::thread &producer : producers ) {
+
+        producer.join();
+      }
+      for ( auto &futures : results ) {
+
+        for ( auto &future : futures ) {
+
+          EXPECT_FALSE( future.get() );
+        }
+      }
+
+      /* Many writes per commit */
+      EXPECT_EQ( queue.writes(), static_cast<std::uint64_t>( threads * writesPerThread ) );
+      EXPECT_LT( queue.commits(), queue.writes() );
+    }
+
+    {
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT COUNT(*) FROM cities", error );
+      EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+      EXPECT_EQ( sqlite3_column_int64( statement.get(), 0 ), threads * writesPerThread );
+    }
+    database.reset();
+
+    std::filesystem::remove( databaseFilename() + "-wal" );
+    std::filesystem::remove( databaseFilename() + "-shm" );
+    std::filesystem::remove( databaseFilename() );
+  }
+
+  TEST( WriteQueue, FailedWrite ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    {
+      /* Long latency keeps every write in one group */
+      sqlite_utils::WriteQueue queue( database.get(), 16, std::chrono::milliseconds( 200 ) );
+      auto first = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 1 }, std::string( "Munich" ), std::int64_t { 2 }, std::string( "Tokyo" ) } );
+      auto constraint = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 3 }, std::string( "Berlin" ), std::int64_t { 4 }, std::monostate {} } );
+      auto misuse = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 5 } } );
+      auto thrown = queue.submit( []( sqlite3 *_handle ) -> std::error_code {
+        sqlite3_exec( _handle, "INSERT INTO cities VALUES(6, 'Paris')", nullptr, nullptr, nullptr );
+        throw std::runtime_error( "write failed" );
+      } );
+      auto last = queue.submit( []( sqlite3 *_handle ) -> std::error_code {
+        const std::int32_t result = sqlite3_exec( _handle, "INSERT INTO cities VALUES(7, 'Boston')", nullptr, nullptr, nullptr );
+        return { result, std::generic_category() };
+      } );
+
+      EXPECT_FALSE( first.get() );
+      EXPECT_EQ( constraint.get().value(), SQLITE_CONSTRAINT );
+      EXPECT_EQ( misuse.get().value(), SQLITE_MISUSE );
+      EXPECT_EQ( thrown.get().value(), SQLITE_ABORT );
+      EXPECT_FALSE( last.get() );
+      EXPECT_EQ( queue.commits(), 1 );
+    }
+
+    /* Failed writes are rolled back to their savepoint only */
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT group_concat(id) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ), "1,2,7" ); // NOSONAR sqlite text is utf-8
+  }
+
+  TEST( WriteQueue, RolledBackGroup ) {
+
+    std::error_code error {};
+    const auto database { sqlite_utils::sqlite3_make_unique( ":memory:", error ) };
+    const std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+    EXPECT_EQ( resultCode, SQLITE_OK );
+
+    {
+      sqlite_utils::WriteQueue queue( database.get(), 16, std::chrono::milliseconds( 200 ) );
+      auto first = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 1 }, std::string( "Munich" ) } );
+      auto rollback = queue.submit( "INSERT OR ROLLBACK INTO cities VALUES(?, ?)", { std::int64_t { 1 }, std::string( "Tokyo" ) } );
+      auto next = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 2 }, std::string( "Berlin" ) } );
+
+      /* The transaction of the group is gone - the next write runs in a new group */
+      EXPECT_EQ( first.get().value(), SQLITE_ABORT );
+      EXPECT_EQ( rollback.get().value(), SQLITE_CONSTRAINT );
+      EXPECT_FALSE( next.get() );
+      EXPECT_EQ( queue.commits(), 2 );
+    }
+
+    const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT group_concat(id) FROM cities", error );
+    EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+    EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ), "2" ); // NOSONAR sqlite text is utf-8
+    EXPECT_NE( sqlite3_get_autocommit( database.get() ), 0 );
+  }
+
+  TEST( WriteQueue, BusyBegin ) {
+
+    std::filesystem::remove( databaseFilename() );
+    {
+      std::error_code error {};
+      const auto database { sqlite_utils::sqlite3_make_unique( databaseFilename(), error ) };
+      const auto locker { sqlite_utils::sqlite3_make_unique( databaseFilename(), error ) };
+      std::int32_t resultCode = sqlite3_exec( database.get(), std::string( createTable ).c_str(), nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_OK );
+      resultCode = sqlite3_exec( locker.get(), "BEGIN IMMEDIATE", nullptr, nullptr, nullptr );
+      EXPECT_EQ( resultCode, SQLITE_OK );
+
+      /* The first BEGIN IMMEDIATE gives up and releases the lock of the other connection */
+      sqlite3_busy_handler(
+          database.get(), []( void *_locker, std::int32_t ) {
+            sqlite3_exec( static_cast<sqlite3 *>( _locker ), "ROLLBACK", nullptr, nullptr, nullptr );
+            return 0;
+          },
+          locker.get() );
+
+      {
+        sqlite_utils::WriteQueue queue( database.get(), 16, std::chrono::milliseconds( 200 ) );
+        auto busy = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 1 }, std::string( "Munich" ) } );
+        auto second = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 2 }, std::string( "Tokyo" ) } );
+        auto third = queue.submit( "INSERT INTO cities VALUES(?, ?)", { std::int64_t { 3 }, std::string( "Berlin" ) } );
+
+        /* Only the write that started the group fails - the queued writes start a new group */
+        EXPECT_EQ( busy.get().value(), SQLITE_BUSY );
+        EXPECT_FALSE( second.get() );
+        EXPECT_FALSE( third.get() );
+      }
+
+      const auto statement = sqlite_utils::sqlite3_stmt_make_unique( database.get(), "SELECT group_concat(id) FROM cities", error );
+      EXPECT_EQ( sqlite3_step( statement.get() ), SQLITE_ROW );
+      EXPECT_STREQ( reinterpret_cast<const char *>( sqlite3_column_text( statement.get(), 0 ) ), "2,3" ); // NOSONAR sqlite text is utf-8
+    }
+    std::filesystem::remove( databaseFilename() );
+  }
+}
+#ifdef __clang__
+  #pragma clang diagnostic pop
+#endif
+
+std::int32_t main( std::int32_t argc,
+                   char **argv ) {
+
+  InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}